@@ -353,6 +353,14 @@ int  xine_get_param (xine_stream_t *stream, int param) XINE_PROTECTED;
 #define XINE_PARAM_EARLY_FINISHED_EVENT   31 /* send event when demux finish*/
 #define XINE_PARAM_GAPLESS_SWITCH         32 /* next stream only gapless swi*/
 #define XINE_PARAM_DELAY_FINISHED_EVENT   33 /* 1/10sec,0=>disable,-1=>forev*/
+#define XINE_PARAM_KEYFRAMES_ONLY         34 /* 1=>video keyframes only, unthrottled */
+
+/*
+ * XINE_PARAM_KEYFRAMES_ONLY is meant for thumbnail and preview extraction.
+ * demuxers that know send video keyframes only, decoders skip everything
+ * else, audio is not decoded, and frames are shown as soon as they are
+ * ready instead of at their stream time. the setting survives xine_open ().
+ */
 
 /*
  * speed values for XINE_PARAM_SPEED parameter.
@@ -978,6 +986,32 @@ int xine_get_audio_lang (xine_stream_t *stream, int channel,
 			 char *lang) XINE_PROTECTED;
 int xine_get_spu_lang   (xine_stream_t *stream, int channel,
 			 char *lang) XINE_PROTECTED;
+
+/*
+ * get the most recent decoded audio of given logical channel
+ * (see XINE_PARAM_AUDIO_CHANNEL_LOGICAL), eg for loudness monitoring.
+ * this works only for tracks with a decoder worker, see config
+ * "engine.decoder.audio_track_workers". the selected track is
+ * played as usual, the others are decoded but not played.
+ *
+ * set data->data to a buffer of data->num_frames frames capacity,
+ * or to NULL to just query the format. on return, num_frames is
+ * the count of frames available within that capacity, and pts is
+ * the stream pts of the last decoded buffer.
+ *
+ * returns 1 on success, 0 on failure
+ */
+typedef struct {
+  int64_t  pts;
+  int      bits;
+  int      rate;
+  int      mode;       /* AO_CAP_MODE_*, see xine/audio_out.h */
+  int      num_frames;
+  void    *data;
+} xine_audio_track_data_t;
+
+int xine_get_audio_track_data (xine_stream_t *stream, int channel,
+                               xine_audio_track_data_t *data) XINE_PROTECTED;
 /*_x_ increasing this number means an incompatible ABI breakage! */
 #define XINE_LANG_MAX                     32
 
@@ -1055,6 +1089,9 @@ int xine_query_stream_info (xine_stream_t *stream, char *sbuf, size_t sblen, int
 #define XINE_STREAM_INFO_DVD_CHAPTER_COUNT  33
 #define XINE_STREAM_INFO_DVD_ANGLE_NUMBER   34
 #define XINE_STREAM_INFO_DVD_ANGLE_COUNT    35
+#define XINE_STREAM_INFO_NET_KERNEL_DROPS   36 /* datagrams lost in socket queue */
+#define XINE_STREAM_INFO_NET_INPUT_DROPS    37 /* datagrams lost inside xine input */
+#define XINE_STREAM_INFO_KEYFRAMES_ONLY     38 /* see XINE_PARAM_KEYFRAMES_ONLY */
 
 /* possible values for XINE_STREAM_INFO_VIDEO_AFD */
 #define XINE_VIDEO_AFD_NOT_PRESENT         -1
@@ -404,6 +404,10 @@ struct input_plugin_s {
 /* ask plugin to generate a new preview from the current position,
  * eg to skip a large ID3v2 tag. data is ignored. */
 #define INPUT_OPTIONAL_DATA_NEW_PREVIEW 19
+/* data is an off_t * where the plugin stores the earliest stream position
+ * not yet reported where packets got lost in transit, or -1 if none.
+ * demuxers use this to resync instead of joining the pieces. */
+#define INPUT_OPTIONAL_DATA_LOSS      20
 
 #define MAX_MRL_ENTRIES 255
 #define MAX_PREVIEW_SIZE 4096
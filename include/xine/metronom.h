@@ -189,6 +189,11 @@ struct metronom_s {
 /* Nasty input_vdr helper. Inserts an immediate absolute discontinuity,
  * old style without pts reorder fix. */
 #define METRONOM_VDR_TRICK_PTS    11
+/* Accurate seek: the first frame to show after the current stream seek has this pts,
+ * not the one given with the discontinuity. Set this before the first frame. */
+#define METRONOM_SEEK_TARGET      12
+/* Thumbnail mode: ignore video pts, and show each frame right after the previous one. */
+#define METRONOM_KEYFRAMES_ONLY   13
 #define METRONOM_NO_LOCK          0x8000
 
 typedef void xine_speed_change_cb_t (void *user_data, int new_speed);
@@ -62,4 +62,23 @@ void _x_audio_out_resample_monotostereo(int16_t* input_samples,
 void _x_audio_out_resample_stereotomono(int16_t* input_samples,
 					int16_t* output_samples, uint32_t frames) XINE_PROTECTED;
 
+/* decoder side helpers. these use SSE2 or NEON where available. */
+
+/* convert planar float samples to interleaved 16bit. samples are multiplied by
+ * gain, rounded to nearest, and clipped. a NULL plane yields silence on that
+ * channel. */
+void _x_audio_out_float_to_s16(int16_t *output_samples, const float * const *input_planes,
+                               uint32_t channels, uint32_t frames, float gain) XINE_PROTECTED;
+
+/* output_samples[i] += input_samples[i] * gain. */
+void _x_audio_out_float_mix(float *output_samples, const float *input_samples,
+                            uint32_t samples, float gain) XINE_PROTECTED;
+
+/* convert planar fixed point samples with fracbits fraction bits to interleaved
+ * rounded and clipped 16bit. declip attenuates by 2.5dB first. returns the larger
+ * one of peak and the highest absolute input value. */
+int32_t _x_audio_out_fixed_to_s16(int16_t *output_samples, const int32_t * const *input_planes,
+                                  uint32_t channels, uint32_t frames, int fracbits, int declip,
+                                  int32_t peak) XINE_PROTECTED;
+
 #endif
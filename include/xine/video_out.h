@@ -139,8 +139,8 @@ struct vo_frame_s {
   /* cropping to be done */
   int                        crop_left, crop_right, crop_top, crop_bottom;
 
-  int                        lock_counter;
-  pthread_mutex_t            mutex; /* protect access to lock_count */
+  int                        lock_counter; /* atomic in video_out, use ->lock () and ->free () */
+  pthread_mutex_t            mutex; /* protect frame format updates */
 
   /* extra info coming from input or demuxers */
   extra_info_t              *extra_info;
@@ -287,6 +287,25 @@ struct xine_video_port_s {
 #define VO_PROP_CAPS2                 30 /* read-only. second capability flags, see below. */
 #define VO_PROP_TRANSFORM             31 /* XINE_VO_TRANSFORM_* */
 #define VO_NUM_PROPERTIES             32
+/* engine only, never passed to drivers. 32...36 are taken by
+ * XINE_PARAM_VO_CROP_* and XINE_PARAM_VO_SINGLE_STEP. */
+#define VO_PROP_DECODE_HINT           37 /* read-only, VO_DECODE_HINT_* */
+
+/* graded decoder degradation hints, derived from measured frame lateness.
+ * decoders query _x_video_decode_hint () after each draw () and honour what
+ * they can. a level a decoder does not support shall be treated like the
+ * highest level below it that it does support.
+ * the plain draw () skip count is still delivered for older decoders. */
+#define VO_DECODE_HINT_NONE           0 /* decode everything */
+#define VO_DECODE_HINT_LOOP_FILTER    1 /* skip deblocking / loop filter */
+#define VO_DECODE_HINT_NONREF         2 /* + skip non reference frames */
+#define VO_DECODE_HINT_NONKEY         3 /* + skip everything up to next keyframe */
+#define VO_DECODE_HINT_LOWRES         4 /* + decode at reduced resolution */
+
+/* VO_PROP_DECODE_HINT of the stream port, at least VO_DECODE_HINT_NONKEY while
+ * the stream is in XINE_PARAM_KEYFRAMES_ONLY mode. the port may be shared by
+ * more streams, so decoders should use this instead of the plain property. */
+int _x_video_decode_hint (xine_stream_t *stream) XINE_PROTECTED;
 
 /* number of colors in the overlay palette. Currently limited to 256
    at most, because some alphablend functions use an 8-bit index into
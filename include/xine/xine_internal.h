@@ -288,6 +288,23 @@ void _x_demux_send_mrl_reference (xine_stream_t *stream, int alternative,
 				  const char *mrl, const char *title,
 				  int start_time, int duration) XINE_PROTECTED;
 
+/*
+ * persistent keyframe index (see demux.c)
+ * add:  remember a keyframe at byte pos. prev is the pos of the keyframe the caller
+ *       has seen just before, 0 when playing from the start, or -1 after a seek.
+ * find: if *pos >= 0, look up the last keyframe <= *pos. otherwise, look up the
+ *       keyframe at *msecs, counting from the first indexed keyframe.
+ *       returns 1 (exact), 0 (estimated pos), -1 (no help).
+ */
+typedef struct xine_seek_index_s xine_seek_index_t;
+xine_seek_index_t *_x_seek_index_open (xine_stream_t *stream, input_plugin_t *input, const char *type) XINE_PROTECTED;
+void _x_seek_index_close (xine_seek_index_t **idx) XINE_PROTECTED;
+void _x_seek_index_add (xine_seek_index_t *idx, off_t pos, int64_t pts, off_t prev) XINE_PROTECTED;
+int  _x_seek_index_find (xine_seek_index_t *idx, off_t *pos, int *msecs) XINE_PROTECTED;
+/* user wants the index built in advance, and it is not yet complete. */
+int  _x_seek_index_prebuild (xine_seek_index_t *idx) XINE_PROTECTED;
+void _x_seek_index_set_complete (xine_seek_index_t *idx) XINE_PROTECTED;
+
 /*
  * MRL escaped-character decoding (overwrites the source string)
  */
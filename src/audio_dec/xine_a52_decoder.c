@@ -44,13 +44,15 @@
 
 #include <xine/buffer.h>
 #include <xine/xineutils.h>
+#include <xine/resample.h>
 
 #if defined(LIBA52_FIXED)
 # define SAMPLE_OFFS 0
 #elif defined(LIBA52_DOUBLE)
 # define SAMPLE_OFFS 48
 #else
-# define SAMPLE_OFFS 384
+/* float samples go to the SIMD converter as is. */
+# define SAMPLE_OFFS 0
 #endif
 
 #undef DEBUG_A52
@@ -176,34 +178,19 @@ static inline void float_to_int (sample_t *_f, int16_t *s16, int num_channels) {
 #else /* float */
 
 static inline void downmix_lfe_1 (sample_t *target, sample_t *lfe, sample_t gain) {
-  int i;
-  for (i = 0; i < 256; i++)
-    target[i] += (lfe[i] - 384.0) * gain;
+  _x_audio_out_float_mix (target, lfe, 256, gain);
 }
 
 static inline void downmix_lfe_2 (sample_t *target1, sample_t *target2, sample_t *lfe, sample_t gain) {
-  int i;
-  for (i = 0; i < 256; i++) {
-    sample_t v = (lfe[i] - 384.0) * gain;
-    target1[i] += v;
-    target2[i] += v;
-  }
-}
-
-static inline void float_to_int (sample_t *_f, int16_t *s16, int num_channels) {
-  int i;
-  /* XXX assumes IEEE float format, range -2.0 ... 2.0 */
-  for (i = 0; i < 256; i++) {
-    union {sample_t s; int32_t i;} u;
-    int32_t v;
-    u.s = _f[i];
-    v = u.i - 0x43c00000;
-    s16[num_channels * i] = (v + 0x8000) & ~0xffff ? (v >> 31) ^ 0x7fff : v;
-  }
+  _x_audio_out_float_mix (target1, lfe, 256, gain);
+  _x_audio_out_float_mix (target2, lfe, 256, gain);
 }
 
 #endif
 
+/* interleave 256 samples per channel. a NULL channel is muted. */
+#if defined(LIBA52_FIXED) || defined(LIBA52_DOUBLE)
+
 static inline void mute_channel (int16_t * s16, int num_channels) {
   int i;
 
@@ -212,6 +199,25 @@ static inline void mute_channel (int16_t * s16, int num_channels) {
   }
 }
 
+static void a52dec_interleave (int16_t *s16, sample_t **planes, int num_channels) {
+  int i;
+
+  for (i = 0; i < num_channels; i++) {
+    if (planes[i])
+      float_to_int (planes[i], s16 + i, num_channels);
+    else
+      mute_channel (s16 + i, num_channels);
+  }
+}
+
+#else /* float */
+
+static void a52dec_interleave (int16_t *s16, sample_t **planes, int num_channels) {
+  _x_audio_out_float_to_s16 (s16, (const float * const *)planes, num_channels, 256, 32768.0);
+}
+
+#endif
+
 static void a52dec_decode_frame (a52dec_decoder_t *this, int64_t pts, int preview_mode) {
 
   int output_mode = AO_CAP_MODE_STEREO;
@@ -305,60 +311,65 @@ static void a52dec_decode_frame (a52dec_decoder_t *this, int64_t pts, int previe
        are simply left out (no gaps). Downmixing had only been applied
        to non-LFE stuff, so we need to do that one ourselves. */
 
-    switch (output_mode) {
-    case AO_CAP_MODE_MONO:
-      if (this->have_lfe)
-        downmix_lfe_1 (&samples[0*256], &samples[-1*256], this->class->lfe_level_1);
-      float_to_int (&samples[0], int_samples+(i*256), 1);
-      break;
-    case AO_CAP_MODE_STEREO:
-      if (this->have_lfe)
-        downmix_lfe_2 (&samples[0*256], &samples[1*256], &samples[-1*256], this->class->lfe_level_2);
-      float_to_int (&samples[0*256], int_samples+(i*256*2), 2);
-      float_to_int (&samples[1*256], int_samples+(i*256*2)+1, 2);
-      break;
-    case AO_CAP_MODE_4CHANNEL:
-      if (this->have_lfe)
-        downmix_lfe_2 (&samples[0*256], &samples[1*256], &samples[-1*256], this->class->lfe_level_2);
-      float_to_int (&samples[0*256], int_samples+(i*256*4),   4); /*  L */
-      float_to_int (&samples[1*256], int_samples+(i*256*4)+1, 4); /*  R */
-      float_to_int (&samples[2*256], int_samples+(i*256*4)+2, 4); /* RL */
-      float_to_int (&samples[3*256], int_samples+(i*256*4)+3, 4); /* RR */
-      break;
-    case AO_CAP_MODE_4_1CHANNEL:
-      if (this->have_lfe)
-        float_to_int (&samples[-1*256], int_samples+(i*256*6)+5, 6); /* LFE */
-      else
-        mute_channel (int_samples+(i*256*6)+5, 6);
-      float_to_int (&samples[0*256], int_samples+(i*256*6)+0, 6); /* L   */
-      float_to_int (&samples[1*256], int_samples+(i*256*6)+1, 6); /* R   */
-      float_to_int (&samples[2*256], int_samples+(i*256*6)+2, 6); /* RL */
-      float_to_int (&samples[3*256], int_samples+(i*256*6)+3, 6); /* RR */
-      mute_channel ( int_samples+(i*256*6)+4, 6); /* C */
-      break;
-    case AO_CAP_MODE_5CHANNEL:
-      if (this->have_lfe)
-        downmix_lfe_2 (&samples[0*256], &samples[2*256], &samples[-1*256], this->class->lfe_level_2);
-      float_to_int (&samples[0*256], int_samples+(i*256*6)+0, 6); /*  L */
-      float_to_int (&samples[1*256], int_samples+(i*256*6)+4, 6); /*  C */
-      float_to_int (&samples[2*256], int_samples+(i*256*6)+1, 6); /*  R */
-      float_to_int (&samples[3*256], int_samples+(i*256*6)+2, 6); /* RL */
-      float_to_int (&samples[4*256], int_samples+(i*256*6)+3, 6); /* RR */
-      mute_channel ( int_samples+(i*256*6)+5, 6); /* LFE */
-      break;
-    case AO_CAP_MODE_5_1CHANNEL:
-      if (this->have_lfe)
-        float_to_int (&samples[-1*256], int_samples+(i*256*6)+5, 6); /* lfe */
-      else
-        mute_channel (int_samples+(i*256*6)+5, 6);
-      float_to_int (&samples[0*256], int_samples+(i*256*6)+0, 6); /*   L */
-      float_to_int (&samples[1*256], int_samples+(i*256*6)+4, 6); /*   C */
-      float_to_int (&samples[2*256], int_samples+(i*256*6)+1, 6); /*   R */
-      float_to_int (&samples[3*256], int_samples+(i*256*6)+2, 6); /*  RL */
-      float_to_int (&samples[4*256], int_samples+(i*256*6)+3, 6); /*  RR */
-      break;
-    default:
-      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "liba52: help - unsupported mode %08x\n", output_mode);
+    {
+      sample_t *planes[6];
+      int num_channels = 6;
+
+      switch (output_mode) {
+      case AO_CAP_MODE_MONO:
+        if (this->have_lfe)
+          downmix_lfe_1 (&samples[0*256], &samples[-1*256], this->class->lfe_level_1);
+        planes[0] = &samples[0*256];
+        num_channels = 1;
+        break;
+      case AO_CAP_MODE_STEREO:
+        if (this->have_lfe)
+          downmix_lfe_2 (&samples[0*256], &samples[1*256], &samples[-1*256], this->class->lfe_level_2);
+        planes[0] = &samples[0*256];
+        planes[1] = &samples[1*256];
+        num_channels = 2;
+        break;
+      case AO_CAP_MODE_4CHANNEL:
+        if (this->have_lfe)
+          downmix_lfe_2 (&samples[0*256], &samples[1*256], &samples[-1*256], this->class->lfe_level_2);
+        planes[0] = &samples[0*256]; /*  L */
+        planes[1] = &samples[1*256]; /*  R */
+        planes[2] = &samples[2*256]; /* RL */
+        planes[3] = &samples[3*256]; /* RR */
+        num_channels = 4;
+        break;
+      case AO_CAP_MODE_4_1CHANNEL:
+        planes[0] = &samples[0*256]; /*   L */
+        planes[1] = &samples[1*256]; /*   R */
+        planes[2] = &samples[2*256]; /*  RL */
+        planes[3] = &samples[3*256]; /*  RR */
+        planes[4] = NULL;            /*   C */
+        planes[5] = this->have_lfe ? &samples[-1*256] : NULL; /* LFE */
+        break;
+      case AO_CAP_MODE_5CHANNEL:
+        if (this->have_lfe)
+          downmix_lfe_2 (&samples[0*256], &samples[2*256], &samples[-1*256], this->class->lfe_level_2);
+        planes[0] = &samples[0*256]; /*   L */
+        planes[1] = &samples[2*256]; /*   R */
+        planes[2] = &samples[3*256]; /*  RL */
+        planes[3] = &samples[4*256]; /*  RR */
+        planes[4] = &samples[1*256]; /*   C */
+        planes[5] = NULL;            /* LFE */
+        break;
+      case AO_CAP_MODE_5_1CHANNEL:
+        planes[0] = &samples[0*256]; /*   L */
+        planes[1] = &samples[2*256]; /*   R */
+        planes[2] = &samples[3*256]; /*  RL */
+        planes[3] = &samples[4*256]; /*  RR */
+        planes[4] = &samples[1*256]; /*   C */
+        planes[5] = this->have_lfe ? &samples[-1*256] : NULL; /* LFE */
+        break;
+      default:
+        xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "liba52: help - unsupported mode %08x\n", output_mode);
+        num_channels = 0;
+      }
+      if (num_channels)
+        a52dec_interleave (int_samples + i * 256 * num_channels, planes, num_channels);
     }
   }
 
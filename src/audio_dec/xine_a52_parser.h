@@ -79,7 +79,7 @@ typedef struct {
   uint16_t         syncword;
 
   uint8_t         *frame_ptr;
-  uint8_t          frame_buffer[3840];
+  uint8_t          frame_buffer[4096]; /* E-AC-3 max */
 } xine_a52_parser_t;
 
 static void xine_a52_parser_reset(xine_a52_parser_t *this) {
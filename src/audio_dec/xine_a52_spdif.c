@@ -21,10 +21,6 @@
  */
 
 #define _DEFAULT_SOURCE 1
-#ifndef __sun
-/* required for swab() */
-#define _XOPEN_SOURCE 500
-#endif
 /* avoid compiler warnings */
 #define _BSD_SOURCE 1
 
@@ -107,6 +103,33 @@ static const struct frmsize_s frmsizecod_tbl[64] =
   { 640 ,{1280 ,1394 ,1920 } }
 };
 
+/* E-AC-3 audio blocks per frame, by numblkscod. */
+static const uint8_t eac3_numblks[4] = {1, 2, 3, 6};
+
+/* E-AC-3 (bsid 11...16) syncinfo. */
+static int eac3_syncinfo (uint8_t *buf, int *flags, int *sample_rate, int *bit_rate) {
+
+  static const uint16_t rate[4] = {48000, 44100, 32000, 0};
+  int fscod, numblks, frame_size, acmod;
+
+  fscod = buf[4] >> 6;
+  if (fscod == 3) {
+    if ((buf[4] >> 4) == 0xf)
+      return 0;
+    *sample_rate = rate[(buf[4] >> 4) & 3] >> 1;
+    numblks = 6;
+  } else {
+    *sample_rate = rate[fscod];
+    numblks = eac3_numblks[(buf[4] >> 4) & 3];
+  }
+  acmod = (buf[4] >> 1) & 7;
+  *flags = acmod | ((buf[4] & 1) ? A52_LFE : 0);
+
+  frame_size = ((((buf[2] & 7) << 8) | buf[3]) + 1) * 2;
+  *bit_rate = (frame_size * 8 * *sample_rate) / (numblks * 256);
+  return frame_size;
+}
+
 static int a52_syncinfo (uint8_t *buf, int *flags, int *sample_rate, int *bit_rate) {
 
   static const uint16_t rate[] = { 32,  40,  48,  56,  64,  80,  96, 112,
@@ -122,8 +145,10 @@ static int a52_syncinfo (uint8_t *buf, int *flags, int *sample_rate, int *bit_ra
   if ((buf[0] != 0x0b) || (buf[1] != 0x77))   /* syncword */
     return 0;
 
-  if (buf[5] >= 0x60)         /* bsid >= 12 */
+  if (buf[5] >= 0x88)         /* bsid > 16 */
     return 0;
+  if (buf[5] >= 0x58)         /* bsid > 10 */
+    return eac3_syncinfo (buf, flags, sample_rate, bit_rate);
   half = halfrate[buf[5] >> 3];
 
   /* acmod, dsurmod and lfeon */
@@ -153,6 +178,7 @@ static int a52_syncinfo (uint8_t *buf, int *flags, int *sample_rate, int *bit_ra
 }
 
 #include "xine_a52_parser.h"
+#include "xine_iec61937.h"
 
 typedef struct a52dec_decoder_s {
   audio_decoder_t  audio_decoder;
@@ -161,9 +187,16 @@ typedef struct a52dec_decoder_s {
 
   int64_t          pts;
   int              output_open;
+  int              output_rate;
 
   xine_a52_parser_t parser;
 
+  /* E-AC-3 burst in progress. */
+  int              eac3;
+  xine_iec61937_t  iec;
+  int              eac3_blocks;
+  int              eac3_dependent;
+
 } a52dec_decoder_t;
 
 static void a52dec_reset (audio_decoder_t *this_gen) {
@@ -172,6 +205,8 @@ static void a52dec_reset (audio_decoder_t *this_gen) {
 
   xine_a52_parser_reset(&this->parser);
   this->pts               = 0;
+  xine_iec61937_drop (&this->iec, this->stream->audio_out, this->stream);
+  this->eac3_blocks       = 0;
 }
 
 static void a52dec_discontinuity (audio_decoder_t *this_gen) {
@@ -179,52 +214,100 @@ static void a52dec_discontinuity (audio_decoder_t *this_gen) {
   a52dec_reset(this_gen);
 }
 
+static int a52dec_open_output (a52dec_decoder_t *this, int rate) {
+
+  if (this->output_open && (this->output_rate != rate)) {
+    xine_iec61937_drop (&this->iec, this->stream->audio_out, this->stream);
+    this->stream->audio_out->close (this->stream->audio_out, this->stream);
+    this->output_open = 0;
+  }
+  if (!this->output_open) {
+    this->output_open = (this->stream->audio_out->open) (this->stream->audio_out,
+                                                         this->stream, 16, rate,
+                                                         AO_CAP_MODE_A52);
+    this->output_rate = rate;
+  }
+  return this->output_open;
+}
+
+/* E-AC-3 bursts carry 6 audio blocks at 4 times the sample rate,
+ * in frames of 1, 2, 3 or 6 blocks plus their dependent substreams. */
+static void a52dec_eac3_frame (a52dec_decoder_t *this, int64_t pts) {
+
+  xine_audio_port_t *ao = this->stream->audio_out;
+  const uint8_t *data_in = this->parser.frame_buffer;
+  int strmtyp, blocks;
+
+  if (!a52dec_open_output (this, this->parser.a52_sample_rate * 4))
+    return;
+
+  strmtyp = data_in[2] >> 6;
+  if (strmtyp == 1) {
+    /* dependent substream, belongs to the current burst. */
+    this->eac3_dependent = 1;
+    if (!this->iec.buf)
+      return;
+  } else {
+    if (this->eac3_blocks >= 6) {
+      xine_iec61937_put (&this->iec, ao, this->stream, 0);
+      this->eac3_blocks = 0;
+    }
+    if (!this->iec.buf &&
+        !xine_iec61937_begin (&this->iec, ao, this->stream, IEC61937_EAC3, 6144, pts))
+      return;
+    blocks = ((data_in[4] >> 6) == 3) ? 6 : eac3_numblks[(data_in[4] >> 4) & 3];
+    /* additional independent substreams are extra programs, count the 1st only. */
+    if (((data_in[2] >> 3) & 7) == 0)
+      this->eac3_blocks += blocks;
+  }
+
+  if (!xine_iec61937_add (&this->iec, data_in, this->parser.frame_length)) {
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "a52_spdif: E-AC-3 burst overflow.\n");
+    xine_iec61937_drop (&this->iec, ao, this->stream);
+    this->eac3_blocks = 0;
+    return;
+  }
+
+  /* without dependent substreams, no need to wait for the next frame. */
+  if ((this->eac3_blocks >= 6) && !this->eac3_dependent) {
+    xine_iec61937_put (&this->iec, ao, this->stream, 0);
+    this->eac3_blocks = 0;
+  }
+}
+
 static void a52dec_decode_frame (a52dec_decoder_t *this, int64_t pts, int preview_mode) {
 
 #ifdef LOG_PTS
   printf("a52dec:decode_frame:pts=%lld\n",pts);
 #endif
 
-  /*
-   * loop through a52 data
-   */
+  if (preview_mode)
+    return;
 
-  if (!this->output_open) {
-    this->output_open = (this->stream->audio_out->open) (this->stream->audio_out,
-                                                         this->stream, 16,
-                                                         this->parser.a52_sample_rate,
-                                                         AO_CAP_MODE_A52);
+  if (this->parser.frame_buffer[5] >= 0x58) {
+    if (this->eac3)
+      a52dec_eac3_frame (this, pts);
+    return;
   }
 
-  if (this->output_open && !preview_mode) {
-    /* SPDIF Passthrough
-     * Build SPDIF Header and encaps the A52 audio data in it.
-     */
-    uint32_t /*syncword, crc1,*/ fscod,frmsizecod,/*bsid,*/bsmod,frame_size;
-    uint8_t *data_out,*data_in;
-    audio_buffer_t *buf = this->stream->audio_out->get_buffer (this->stream->audio_out);
-    data_in=(uint8_t *) this->parser.frame_buffer;
-    data_out=(uint8_t *) buf->mem;
-    /*syncword = data_in[0] | (data_in[1] << 8);*/
-    /*crc1 = data_in[2] | (data_in[3] << 8);*/
-    fscod = (data_in[4] >> 6) & 0x3;
-    frmsizecod = data_in[4] & 0x3f;
-    /*bsid = (data_in[5] >> 3) & 0x1f;*/
-    bsmod = data_in[5] & 0x7;         /* bsmod, stream = 0 */
-    frame_size = frmsizecod_tbl[frmsizecod].frm_size[fscod] ;
-
-    data_out[0] = 0x72; data_out[1] = 0xf8;   /* spdif syncword    */
-    data_out[2] = 0x1f; data_out[3] = 0x4e;   /* ..............    */
-    data_out[4] = 0x01;                       /* AC3 data          */
-    data_out[5] = bsmod;                      /* bsmod, stream = 0 */
-    data_out[6] = (frame_size << 4) & 0xff;   /* frame_size * 16   */
-    data_out[7] = ((frame_size ) >> 4) & 0xff;
-    swab(data_in, &data_out[8], frame_size * 2 );
-
-    buf->num_frames = 1536;
-    buf->vpts       = pts;
-
-    this->stream->audio_out->put_buffer (this->stream->audio_out, buf, this->stream);
+  if (this->iec.buf) {
+    xine_iec61937_drop (&this->iec, this->stream->audio_out, this->stream);
+    this->eac3_blocks = 0;
+  }
+
+  /* SPDIF Passthrough
+   * Build SPDIF Header and encaps the A52 audio data in it.
+   */
+  if (a52dec_open_output (this, this->parser.a52_sample_rate) &&
+      xine_iec61937_begin (&this->iec, this->stream->audio_out, this->stream, IEC61937_AC3, 1536, pts)) {
+    const uint8_t *data_in = this->parser.frame_buffer;
+    uint32_t fscod      = (data_in[4] >> 6) & 0x3;
+    uint32_t frmsizecod = data_in[4] & 0x3f;
+    uint32_t bsmod      = data_in[5] & 0x7;         /* bsmod, stream = 0 */
+    uint32_t frame_size = frmsizecod_tbl[frmsizecod].frm_size[fscod];
+
+    xine_iec61937_add (&this->iec, data_in, frame_size * 2);
+    xine_iec61937_put (&this->iec, this->stream->audio_out, this->stream, bsmod);
   }
 }
 
@@ -259,6 +342,7 @@ static void a52dec_dispose (audio_decoder_t *this_gen) {
 
   a52dec_decoder_t *this = (a52dec_decoder_t *) this_gen;
 
+  xine_iec61937_drop (&this->iec, this->stream->audio_out, this->stream);
   if (this->output_open)
     this->stream->audio_out->close (this->stream->audio_out, this->stream);
 
@@ -267,12 +351,10 @@ static void a52dec_dispose (audio_decoder_t *this_gen) {
   free (this_gen);
 }
 
-static audio_decoder_t *open_plugin (audio_decoder_class_t *class_gen, xine_stream_t *stream) {
+static audio_decoder_t *a52dec_open (xine_stream_t *stream, int eac3) {
 
   a52dec_decoder_t *this;
 
-  (void)class_gen;
-
   lprintf ("open_plugin called\n");
 
   /*
@@ -294,6 +376,10 @@ static audio_decoder_t *open_plugin (audio_decoder_class_t *class_gen, xine_stre
    */
   xine_a52_parser_reset(&this->parser);
   this->output_open       = 0;
+  this->iec.buf           = NULL;
+  this->eac3_blocks       = 0;
+  this->eac3_dependent    = 0;
+  this->eac3              = eac3;
 
   this->audio_decoder.decode_data   = a52dec_decode_data;
   this->audio_decoder.reset         = a52dec_reset;
@@ -305,6 +391,26 @@ static audio_decoder_t *open_plugin (audio_decoder_class_t *class_gen, xine_stre
   return &this->audio_decoder;
 }
 
+static audio_decoder_t *open_plugin (audio_decoder_class_t *class_gen, xine_stream_t *stream) {
+
+  (void)class_gen;
+  return a52dec_open (stream, 0);
+}
+
+static audio_decoder_t *open_eac3_plugin (audio_decoder_class_t *class_gen, xine_stream_t *stream) {
+
+  cfg_entry_t *entry;
+
+  (void)class_gen;
+
+  /* E-AC-3 needs HDMI, or at least 192kHz S/PDIF. let the user decide. */
+  entry = stream->xine->config->lookup_entry (stream->xine->config, "audio.output.eac3_passthrough");
+  if (!entry || !entry->num_value)
+    return (audio_decoder_t *)1;
+
+  return a52dec_open (stream, 1);
+}
+
 static void *init_plugin (xine_t *xine, const void *data) {
 
   static const audio_decoder_class_t decoder_class = {
@@ -319,6 +425,27 @@ static void *init_plugin (xine_t *xine, const void *data) {
   return (void *)&decoder_class;
 }
 
+static void *init_eac3_plugin (xine_t *xine, const void *data) {
+
+  static const audio_decoder_class_t decoder_class = {
+    .open_plugin     = open_eac3_plugin,
+    .identifier      = "eac3_spdif",
+    .description     = N_("E-AC-3 bitstream output plugin for HDMI"),
+    .dispose         = NULL,
+  };
+  (void)data;
+
+  xine->config->register_bool (xine->config,
+    "audio.output.eac3_passthrough", 0,
+    _("E-AC-3 (Dolby Digital Plus) passthrough"),
+    _("Send E-AC-3 audio undecoded to an external receiver. This needs a digital "
+      "output that does 4 times the sample rate, usually HDMI, and the "
+      "speaker arrangement set to pass through."),
+    10, NULL, NULL);
+
+  return (void *)&decoder_class;
+}
+
 static const uint32_t audio_types[] = {
   BUF_AUDIO_A52,
   BUF_AUDIO_DNET,
@@ -330,9 +457,20 @@ static const decoder_info_t dec_info_audio = {
   .priority        = 20,
 };
 
+static const uint32_t eac3_types[] = {
+  BUF_AUDIO_EAC3,
+  0
+};
+
+static const decoder_info_t dec_info_eac3 = {
+  .supported_types = eac3_types,
+  .priority        = 20,
+};
+
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
   { PLUGIN_AUDIO_DECODER | PLUGIN_MUST_PRELOAD, 16, "a/52_spdif", XINE_VERSION_CODE, &dec_info_audio, init_plugin },
+  { PLUGIN_AUDIO_DECODER | PLUGIN_MUST_PRELOAD, 16, "eac3_spdif", XINE_VERSION_CODE, &dec_info_eac3, init_eac3_plugin },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
 
@@ -27,10 +27,6 @@
  */
 
 #define _DEFAULT_SOURCE 1
-#ifndef __sun
-/* required for swab() */
-#define _XOPEN_SOURCE 500
-#endif
 /* avoid compiler warnings */
 #define _BSD_SOURCE 1
 
@@ -58,6 +54,8 @@
 
 #include <dts.h>
 
+#include "xine_iec61937.h"
+
 #define MAX_AC5_FRAME 4096
 
 typedef struct {
@@ -134,17 +132,16 @@ static inline void mute_channel (int16_t *const s16, const int num_channels) {
 static void dts_decode_frame (dts_decoder_t *this, const int64_t pts) {
 
   audio_buffer_t *audio_buffer;
-  uint32_t  ac5_spdif_type=0;
   int output_mode = AO_CAP_MODE_STEREO;
-  uint8_t        *data_out;
   uint8_t        *const data_in = this->frame_buffer;
 
   lprintf("decode_frame\n");
-  audio_buffer = this->stream->audio_out->get_buffer (this->stream->audio_out);
-  audio_buffer->vpts       = pts;
 
     if(this->bypass_mode) {
       /* SPDIF digital output */
+      xine_iec61937_t iec;
+      int ac5_spdif_type;
+
       if (!this->output_open) {
         this->output_open = ((this->stream->audio_out->open) (this->stream->audio_out, this->stream,
                                                             16, this->dts_sample_rate,
@@ -154,7 +151,6 @@ static void dts_decode_frame (dts_decoder_t *this, const int64_t pts) {
       if (!this->output_open)
         return;
 
-      data_out=(uint8_t *) audio_buffer->mem;
       if (this->ac5_length > MAX_AC5_FRAME) {
         /* XXX is this even possible ? ac5_length is checked in dts_decode_data() */
         xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG, "libdts: ac5_length too long\n");
@@ -164,13 +160,13 @@ static void dts_decode_frame (dts_decoder_t *this, const int64_t pts) {
 
       switch (this->ac5_pcm_length) {
       case 512:
-        ac5_spdif_type = 0x0b; /* DTS-1 (512-sample bursts) */
+        ac5_spdif_type = IEC61937_DTS1; /* DTS-1 (512-sample bursts) */
         break;
       case 1024:
-        ac5_spdif_type = 0x0c; /* DTS-1 (1024-sample bursts) */
+        ac5_spdif_type = IEC61937_DTS2; /* DTS-1 (1024-sample bursts) */
         break;
       case 2048:
-        ac5_spdif_type = 0x0d; /* DTS-1 (2048-sample bursts) */
+        ac5_spdif_type = IEC61937_DTS3; /* DTS-1 (2048-sample bursts) */
         break;
       default:
         xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
@@ -196,36 +192,27 @@ static void dts_decode_frame (dts_decoder_t *this, const int64_t pts) {
       }
 #endif
 
-      lprintf("length=%d pts=%"PRId64"\n",this->ac5_pcm_length,audio_buffer->vpts);
+      lprintf("length=%d pts=%"PRId64"\n",this->ac5_pcm_length,pts);
 
-      audio_buffer->num_frames = this->ac5_pcm_length;
+      if (!xine_iec61937_begin (&iec, this->stream->audio_out, this->stream,
+        ac5_spdif_type, this->ac5_pcm_length, pts))
+        return;
 
       // Checking if AC5 data plus IEC958 header will fit into frames samples data
-      if ( this->ac5_length + 8 <= this->ac5_pcm_length * 2 * 2 ) {
-        data_out[0] = 0x72; data_out[1] = 0xf8;	/* spdif syncword    */
-        data_out[2] = 0x1f; data_out[3] = 0x4e;	/* ..............    */
-        data_out[4] = ac5_spdif_type;		/* DTS data          */
-        data_out[5] = 0;		                /* Unknown */
-        data_out[6] = (this->ac5_length << 3) & 0xff;   /* ac5_length * 8   */
-        data_out[7] = ((this->ac5_length ) >> 5) & 0xff;
-
-        if( this->ac5_pcm_length ) {
-          if( this->ac5_pcm_length % 2) {
-            swab(data_in, &data_out[8], this->ac5_length );
-          } else {
-            swab(data_in, &data_out[8], this->ac5_length + 1);
-          }
-        }
+      if (xine_iec61937_room (&iec) >= this->ac5_length) {
+        xine_iec61937_add (&iec, data_in, this->ac5_length);
+        xine_iec61937_put (&iec, this->stream->audio_out, this->stream, 0);
       // Transmit it without header otherwise, receivers will autodetect DTS
       } else {
         lprintf("AC5 data is too large (%i > %i), sending without IEC958 header\n",
                 this->ac5_length + 8, this->ac5_pcm_length * 2 * 2);
-        memcpy(data_out, data_in, this->ac5_length);
+        xine_iec61937_put_raw (&iec, this->stream->audio_out, this->stream, data_in, this->ac5_length);
       }
+      return;
     } else {
       /* Software decode */
       int       i, dts_output_flags;
-      int16_t  *const int_samples = audio_buffer->mem;
+      int16_t  *int_samples;
       int       number_of_dts_blocks;
 
       level_t   level = 1.0;
@@ -259,6 +246,9 @@ static void dts_decode_frame (dts_decoder_t *this, const int64_t pts) {
 
       if (!this->output_open)
         return;
+      audio_buffer = this->stream->audio_out->get_buffer (this->stream->audio_out);
+      audio_buffer->vpts = pts;
+      int_samples = audio_buffer->mem;
       number_of_dts_blocks = dts_blocks_num (this->dts_state);
       audio_buffer->num_frames = 256*number_of_dts_blocks;
       for(i = 0; i < number_of_dts_blocks; i++) {
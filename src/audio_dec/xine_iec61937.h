@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2000-2020 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * IEC 61937 burst packer for S/PDIF and HDMI passthrough.
+ *
+ * a burst is built right inside an audio_out buffer: 4 preamble words,
+ * the byte swapped payload, and zero stuffing up to the burst repetition
+ * period. payload may be added in several pieces, eg E-AC-3 needs the
+ * frames of 6 audio blocks in 1 burst.
+ */
+
+#ifndef _XINE_IEC61937_H
+#define _XINE_IEC61937_H
+
+#include <sys/types.h>
+#include <string.h>
+
+#include <xine/xine_internal.h>
+#include <xine/audio_out.h>
+
+/* data types (Pc bits 0-6). */
+#define IEC61937_AC3   0x01
+#define IEC61937_DTS1  0x0b /* 512 samples */
+#define IEC61937_DTS2  0x0c /* 1024 samples */
+#define IEC61937_DTS3  0x0d /* 2048 samples */
+#define IEC61937_DTSHD 0x11
+#define IEC61937_EAC3  0x15
+
+#define IEC61937_HEADER_SIZE 8
+
+typedef struct {
+  audio_buffer_t *buf;
+  uint8_t        *start, *ptr, *end;
+  int             type;
+  int             frames;
+  int             odd;
+} xine_iec61937_t;
+
+/* get an output buffer for a burst of frames stereo 16bit frames.
+ * returns 0 if the port does not have one that large. */
+static inline int xine_iec61937_begin (xine_iec61937_t *iec, xine_audio_port_t *ao, xine_stream_t *stream,
+  int type, int frames, int64_t pts) {
+  audio_buffer_t *buf = ao->get_buffer (ao);
+
+  iec->buf    = buf;
+  iec->type   = type;
+  iec->frames = frames;
+  iec->odd    = 0;
+  iec->start  = (uint8_t *)buf->mem;
+  iec->ptr    = iec->start + IEC61937_HEADER_SIZE;
+  iec->end    = iec->start + frames * 4;
+  buf->vpts   = pts;
+  buf->num_frames = 0;
+  if (frames * 4 > buf->mem_size) {
+    ao->put_buffer (ao, buf, stream);
+    iec->buf = NULL;
+    return 0;
+  }
+  return 1;
+}
+
+/* free space left for payload. */
+static inline int xine_iec61937_room (xine_iec61937_t *iec) {
+  return iec->buf ? iec->end - iec->ptr : 0;
+}
+
+/* append big endian payload as little endian 16bit words.
+ * odd sizes are padded, and end the payload. */
+static inline int xine_iec61937_add (xine_iec61937_t *iec, const uint8_t *data, int size) {
+  uint8_t *q = iec->ptr;
+  int n;
+
+  if (!iec->buf || iec->odd || (size > iec->end - q))
+    return 0;
+  for (n = size >> 1; n > 0; n--) {
+    q[0] = data[1];
+    q[1] = data[0];
+    q += 2;
+    data += 2;
+  }
+  if (size & 1) {
+    q[0] = 0;
+    q[1] = data[0];
+    q += 2;
+    iec->odd = 1;
+  }
+  iec->ptr = q;
+  return 1;
+}
+
+/* finish the preamble, stuff, and send. bsmod goes to Pc bits 8-12. */
+static inline void xine_iec61937_put (xine_iec61937_t *iec, xine_audio_port_t *ao, xine_stream_t *stream, int bsmod) {
+  uint8_t *p = iec->start;
+  uint32_t length;
+
+  if (!iec->buf)
+    return;
+  length = iec->ptr - p - IEC61937_HEADER_SIZE;
+  if (iec->odd)
+    length--;
+  /* Pd is in bits for the legacy types, in bytes for the newer ones. */
+  if ((iec->type != IEC61937_EAC3) && (iec->type != IEC61937_DTSHD))
+    length <<= 3;
+  p[0] = 0x72; p[1] = 0xf8;            /* Pa sync */
+  p[2] = 0x1f; p[3] = 0x4e;            /* Pb sync */
+  p[4] = iec->type; p[5] = bsmod & 0x1f; /* Pc */
+  p[6] = length;    p[7] = length >> 8;  /* Pd */
+  memset (iec->ptr, 0, iec->end - iec->ptr);
+  iec->buf->num_frames = iec->frames;
+  ao->put_buffer (ao, iec->buf, stream);
+  iec->buf = NULL;
+}
+
+/* send a frame as is, without preamble. receivers will autodetect it. */
+static inline void xine_iec61937_put_raw (xine_iec61937_t *iec, xine_audio_port_t *ao, xine_stream_t *stream,
+  const uint8_t *data, int size) {
+  if (!iec->buf)
+    return;
+  if (size > iec->end - iec->start)
+    size = iec->end - iec->start;
+  memcpy (iec->start, data, size);
+  memset (iec->start + size, 0, iec->end - iec->start - size);
+  iec->buf->num_frames = iec->frames;
+  ao->put_buffer (ao, iec->buf, stream);
+  iec->buf = NULL;
+}
+
+/* drop an unfinished burst. */
+static inline void xine_iec61937_drop (xine_iec61937_t *iec, xine_audio_port_t *ao, xine_stream_t *stream) {
+  if (!iec->buf)
+    return;
+  iec->buf->num_frames = 0;
+  ao->put_buffer (ao, iec->buf, stream);
+  iec->buf = NULL;
+}
+
+#endif /* _XINE_IEC61937_H */
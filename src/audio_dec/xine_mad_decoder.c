@@ -34,6 +34,7 @@
 #include <xine/audio_out.h>
 #include <xine/buffer.h>
 #include <xine/xineutils.h>
+#include <xine/resample.h>
 #include "bswap.h"
 
 #ifdef HAVE_MAD_H
@@ -207,13 +208,6 @@ static void mad_discontinuity (audio_decoder_t *this_gen) {
   this->seek = 2;
 }
 
-/* utility to scale and round samples to 16 bits */
-
-static inline int32_t _mad_scale (mad_fixed_t sample) {
-  int32_t v = (sample + (1L << (MAD_F_FRACBITS - 16))) >> (MAD_F_FRACBITS + 1 - 16);
-  return ((v + 0x8000) & 0xffff0000) ? (v >> 31) ^ 0x7fff : v;
-}
-
 /*
 static int head_check(mad_decoder_t *this) {
 
@@ -463,64 +457,12 @@ static void mad_decode_data (audio_decoder_t *this_gen, buf_element_t *buf) {
           }
 	  audio_buffer->num_frames = nsamples;
 
-          if (this->synth.pcm.channels == 2) {
-            const mad_fixed_t *left = this->synth.pcm.samples[0] + this->start_padding;
-            const mad_fixed_t *right = this->synth.pcm.samples[1] + this->start_padding;
-            int16_t *output = audio_buffer->mem;
-            if (this->declip) {
-              while (nsamples--) {
-                mad_fixed_t v, a;
-                v = *left++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                v -= v >> 2;
-                *output++ = _mad_scale (v);
-                v = *right++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                v -= v >> 2;
-                *output++ = _mad_scale (v);
-              }
-            } else {
-              while (nsamples--) {
-                mad_fixed_t v, a;
-                v = *left++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                *output++ = _mad_scale (v);
-                v = *right++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                *output++ = _mad_scale (v);
-              }
-            }
-          } else {
-            const mad_fixed_t *mid = this->synth.pcm.samples[0] + this->start_padding;
-            int16_t *output = audio_buffer->mem;
-            if (this->declip) {
-              while (nsamples--) {
-                mad_fixed_t v, a;
-                v = *mid++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                v -= v >> 2;
-                *output++ = _mad_scale (v);
-              }
-            } else {
-              while (nsamples--) {
-                mad_fixed_t v, a;
-                v = *mid++;
-                a = v < 0 ? -v : v;
-                if (a > this->peak)
-                  this->peak = a;
-                *output++ = _mad_scale (v);
-              }
-            }
+          {
+            const int32_t *planes[2];
+            planes[0] = (const int32_t *)this->synth.pcm.samples[0] + this->start_padding;
+            planes[1] = (const int32_t *)this->synth.pcm.samples[1] + this->start_padding;
+            this->peak = _x_audio_out_fixed_to_s16 (audio_buffer->mem, planes,
+              this->synth.pcm.channels == 2 ? 2 : 1, nsamples, MAD_F_FRACBITS, this->declip, this->peak);
           }
           /* disregard glitches after seek. */
           if (this->seek) {
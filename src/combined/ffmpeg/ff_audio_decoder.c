@@ -54,6 +54,7 @@
 #include <xine/xine_internal.h>
 #include <xine/buffer.h>
 #include <xine/xineutils.h>
+#include <xine/resample.h>
 #include "bswap.h"
 #include "ffmpeg_decoder.h"
 #include "ffmpeg_compat.h"
@@ -1005,6 +1006,16 @@ static int ff_audio_decode (ff_audio_decoder_t *this) {
     }\
   } while (0);
       case AV_SAMPLE_FMT_FLTP: /* the most popular one */
+        if (this->front_mixes == 1) {
+          /* no mixing, just reorder and convert. */
+          const float *planes[MAX_CHANNELS];
+          planes[0] = (const float *)this->av_frame->extended_data[this->left[0]];
+          planes[1] = (const float *)this->av_frame->extended_data[this->right[0]];
+          for (j = 2; j < channels; j++)
+            planes[j] = this->map[j] >= 0 ? (const float *)this->av_frame->extended_data[this->map[j]] : NULL;
+          _x_audio_out_float_to_s16 (decode_buffer, planes, channels, samples, gain);
+          break;
+        }
         MIX_AUDIO (float, 1, this->left,  this->front_mixes, 0);
         MIX_AUDIO (float, 1, this->right, this->front_mixes, 1);
         for (j = 0; j < channels; j++) if (this->map[j] >= 0)
@@ -147,6 +147,7 @@ struct ff_video_decoder_s {
   int               bufsize;
   int               size;
   int               skipframes;
+  int               skip_loop_filter; /* configured AVDISCARD_*, or -1 when fixed */
 
   int              *slice_offset_table;
   int               slice_offset_size;
@@ -1182,6 +1183,7 @@ static void init_video_codec (ff_video_decoder_t *this, unsigned int codec_type)
   }
 
   this->skipframes = 0;
+  this->skip_loop_filter = use_vaapi ? -1 : (int)skip_loop_filter_enum_values[this->class->skip_loop_filter_enum];
 
   /* flag for interlaced streams */
   this->frame_flags = 0;
@@ -2060,6 +2062,29 @@ static int decode_video_wrapper (ff_video_decoder_t *this,
 
 static void ff_reset (video_decoder_t *this_gen);
 
+/* map the legacy skip count and the engine decode hint onto lavc discard levels. */
+static void ff_set_skip (ff_video_decoder_t *this) {
+  int hint = _x_video_decode_hint (this->stream);
+
+  if ((hint < VO_DECODE_HINT_NONREF) && (this->skipframes > 0))
+    hint = VO_DECODE_HINT_NONREF;
+
+  /* never less than configured */
+  if (this->skip_loop_filter != -1) {
+    int skip = (hint >= VO_DECODE_HINT_NONREF) ? AVDISCARD_ALL
+             : (hint == VO_DECODE_HINT_LOOP_FILTER) ? AVDISCARD_NONREF
+             : AVDISCARD_DEFAULT;
+    this->context->skip_loop_filter = (skip > this->skip_loop_filter) ? skip : this->skip_loop_filter;
+  }
+#if XFF_VIDEO > 1
+  this->context->skip_frame = (hint >= VO_DECODE_HINT_NONKEY) ? AVDISCARD_NONKEY
+                            : (hint == VO_DECODE_HINT_NONREF) ? AVDISCARD_NONREF
+                            : AVDISCARD_DEFAULT;
+#else
+  this->context->hurry_up = (hint >= VO_DECODE_HINT_NONREF);
+#endif
+}
+
 static void ff_handle_mpeg12_buffer (ff_video_decoder_t *this, buf_element_t *buf) {
 
   vo_frame_t *img;
@@ -2124,12 +2149,8 @@ static void ff_handle_mpeg12_buffer (ff_video_decoder_t *this, buf_element_t *bu
       this->mpeg_parser->buffer_size = 0;
     }
 
-    /* skip decoding b frames if too late */
-#if XFF_VIDEO > 1
-    this->context->skip_frame = (this->skipframes > 0) ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
-#else
-    this->context->hurry_up = (this->skipframes > 0);
-#endif
+    /* skip decoding b frames, or more, if too late */
+    ff_set_skip (this);
 
     lprintf("avcodec_decode_video: size=%d\n", this->mpeg_parser->buffer_size);
 
@@ -2382,12 +2403,8 @@ static void ff_handle_buffer (ff_video_decoder_t *this, buf_element_t *buf) {
         this->size = 0;
         err = 1;
       } else {
-        /* skip decoding b frames if too late */
-#if XFF_VIDEO > 1
-	this->context->skip_frame = (this->skipframes > 0) ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
-#else
-        this->context->hurry_up = (this->skipframes > 0);
-#endif
+        /* skip decoding b frames, or more, if too late */
+        ff_set_skip (this);
         lprintf("buffer size: %d\n", this->size);
 #ifdef XFF_AV_BUFFER
         if (need_unref) {
@@ -63,6 +63,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #define LOG_MODULE "demux_avi"
 #define LOG_VERBOSE
@@ -78,6 +81,37 @@
 #include <xine/demux.h>
 #include "bswap.h"
 
+/* Index entries are published to the demux thread without a lock:
+ * the builder fills the new entry first, then stores the new count. */
+#if (HAVE_ATOMIC_VARS == 1) || (HAVE_ATOMIC_VARS == 2)
+#  define AVI_IDX_PUBLISH(var,val) __atomic_store_n (&(var), (val), __ATOMIC_RELEASE)
+#  define AVI_IDX_FETCH(var) __atomic_load_n (&(var), __ATOMIC_ACQUIRE)
+#  define AVI_BG_INDEX
+#elif (HAVE_ATOMIC_VARS == 3)
+#  define AVI_IDX_PUBLISH(var,val) do { __sync_synchronize (); (var) = (val); } while (0)
+#  define AVI_IDX_FETCH(var) __sync_fetch_and_add (&(var), 0)
+#  define AVI_BG_INDEX
+#else
+#  define AVI_IDX_PUBLISH(var,val) (var) = (val)
+#  define AVI_IDX_FETCH(var) (var)
+#endif
+
+/* pthread_cond_timedwait () deadlines. */
+#ifdef HAVE_POSIX_TIMERS
+#  define xine_gettime(t) clock_gettime (CLOCK_REALTIME, t)
+#else
+static inline int xine_gettime (struct timespec *ts) {
+  struct timeval tv;
+  int r;
+  r = gettimeofday (&tv, NULL);
+  if (!r) {
+    ts->tv_sec  = tv.tv_sec;
+    ts->tv_nsec = tv.tv_usec * 1000;
+  }
+  return r;
+}
+#endif
+
 /*
  * stolen from wine headers
  */
@@ -239,6 +273,13 @@ typedef struct{
   int is_opendml;       /* set to 1 if this is an odml file with multiple index chunks */
   avisuperindex_chunk *video_superindex;  /* index of indices */
   int total_frames;     /* total number of frames if dmlh is present */
+
+  /* while a background builder appends to the index, grown index arrays
+   * cannot be realloc()ed under the reader. they are copied, and the old ones
+   * are kept here until close. */
+  int               index_shared;
+  void            **retired;
+  int               num_retired, max_retired;
 } avi_t;
 
 typedef struct demux_avi_s {
@@ -261,6 +302,15 @@ typedef struct demux_avi_s {
 
   idx_grow_t           idx_grow;
 
+  /* background index builder on a cloned input. */
+  input_plugin_t      *bg_input;
+  pthread_t            bg_thread;
+  pthread_mutex_t      bg_mutex;
+  pthread_cond_t       bg_cond;
+  int                  bg_state;   /* 0 = none, 1 = running, 2 = done */
+  int                  bg_stop;
+  uint32_t             bg_chunks;
+
   uint8_t              no_audio:1;
 
   uint8_t              streaming:1;
@@ -358,25 +408,52 @@ static void check_newpts (demux_avi_t *this, int64_t pts, int video) {
   }
 }
 
+/* Get a bigger index array. */
+static void *index_grow (avi_t *AVI, void *old, size_t used, size_t size) {
+  void *new;
+
+  if (!AVI->index_shared)
+    return realloc (old, size);
+
+  if (AVI->num_retired >= AVI->max_retired) {
+    int n = AVI->max_retired + 32;
+    void **r = realloc (AVI->retired, n * sizeof (*r));
+    if (!r)
+      return NULL;
+    AVI->retired = r;
+    AVI->max_retired = n;
+  }
+  new = malloc (size);
+  if (!new)
+    return NULL;
+  if (old) {
+    memcpy (new, old, used);
+    AVI->retired[AVI->num_retired++] = old;
+  }
+  return new;
+}
+
 /* Append an index entry for a newly-found video frame */
 static int video_index_append(avi_t *AVI, off_t pos, uint32_t len, uint32_t flags) {
   video_index_t *vit = &(AVI->video_idx);
+  video_index_entry_t *vie;
 
   /* Make sure there's room */
   if (vit->video_frames == vit->alloc_frames) {
-    long newalloc = vit->alloc_frames + 4096;
-    video_index_entry_t *newindex =
-      realloc(vit->vindex, newalloc * sizeof(video_index_entry_t));
+    uint32_t newalloc = vit->alloc_frames ? vit->alloc_frames * 2 : 4096;
+    video_index_entry_t *newindex = index_grow (AVI, vit->vindex,
+      vit->video_frames * sizeof (video_index_entry_t), newalloc * sizeof (video_index_entry_t));
     if (!newindex) return -1;
-    vit->vindex = newindex;
+    AVI_IDX_PUBLISH (vit->vindex, newindex);
     vit->alloc_frames = newalloc;
   }
 
   /* Set the new index entry */
-  vit->vindex[vit->video_frames].pos = pos;
-  vit->vindex[vit->video_frames].len = len;
-  vit->vindex[vit->video_frames].flags = flags;
-  vit->video_frames += 1;
+  vie = vit->vindex + vit->video_frames;
+  vie->pos = pos;
+  vie->len = len;
+  vie->flags = flags;
+  AVI_IDX_PUBLISH (vit->video_frames, vit->video_frames + 1);
 
   return 0;
 }
@@ -385,23 +462,25 @@ static int video_index_append(avi_t *AVI, off_t pos, uint32_t len, uint32_t flag
 static int audio_index_append(avi_t *AVI, int stream, off_t pos, uint32_t len,
                               off_t tot, uint32_t block_no) {
   audio_index_t *ait = &(AVI->audio[stream]->audio_idx);
+  audio_index_entry_t *aie;
 
   /* Make sure there's room */
   if (ait->audio_chunks == ait->alloc_chunks) {
-    uint32_t newalloc = ait->alloc_chunks + 4096;
-    audio_index_entry_t *newindex =
-      realloc(ait->aindex, newalloc * sizeof(audio_index_entry_t));
+    uint32_t newalloc = ait->alloc_chunks ? ait->alloc_chunks * 2 : 4096;
+    audio_index_entry_t *newindex = index_grow (AVI, ait->aindex,
+      ait->audio_chunks * sizeof (audio_index_entry_t), newalloc * sizeof (audio_index_entry_t));
     if (!newindex) return -1;
-    ait->aindex = newindex;
+    AVI_IDX_PUBLISH (ait->aindex, newindex);
     ait->alloc_chunks = newalloc;
   }
 
   /* Set the new index entry */
-  ait->aindex[ait->audio_chunks].pos      = pos;
-  ait->aindex[ait->audio_chunks].len      = len;
-  ait->aindex[ait->audio_chunks].tot      = tot;
-  ait->aindex[ait->audio_chunks].block_no = block_no;
-  ait->audio_chunks += 1;
+  aie = ait->aindex + ait->audio_chunks;
+  aie->pos      = pos;
+  aie->len      = len;
+  aie->tot      = tot;
+  aie->block_no = block_no;
+  AVI_IDX_PUBLISH (ait->audio_chunks, ait->audio_chunks + 1);
 
   return 0;
 }
@@ -454,7 +533,7 @@ static int64_t get_video_pts (demux_avi_t *this, off_t pos) {
 /* Use this one to ensure the current video frame is in the index. */
 static int video_pos_stopper(demux_avi_t *this, void *data){
   (void)data;
-  if (this->avi->video_posf >= this->avi->video_idx.video_frames) {
+  if (this->avi->video_posf >= AVI_IDX_FETCH (this->avi->video_idx.video_frames)) {
     return -1;
   }
   return 1;
@@ -466,7 +545,7 @@ static int audio_pos_stopper(demux_avi_t *this, void *data) {
 
   (void)this;
 
-  if (AVI_A->audio_posc >= AVI_A->audio_idx.audio_chunks) {
+  if (AVI_A->audio_posc >= AVI_IDX_FETCH (AVI_A->audio_idx.audio_chunks)) {
     return -1;
   }
   return 1;
@@ -476,7 +555,7 @@ static int audio_pos_stopper(demux_avi_t *this, void *data) {
  * is in the index. */
 static int start_pos_stopper(demux_avi_t *this, void *data) {
   off_t start_pos = *(off_t *)data;
-  int32_t maxframe = this->avi->video_idx.video_frames - 1;
+  int32_t maxframe = AVI_IDX_FETCH (this->avi->video_idx.video_frames) - 1;
 
   while( maxframe >= 0 && this->avi->video_idx.vindex[maxframe].pos >= start_pos ) {
     if ( this->avi->video_idx.vindex[maxframe].flags & AVIIF_KEYFRAME )
@@ -490,7 +569,7 @@ static int start_pos_stopper(demux_avi_t *this, void *data) {
  * is in the index. */
 static int start_time_stopper(demux_avi_t *this, void *data) {
   int64_t video_pts = *(int64_t *)data;
-  int32_t maxframe = this->avi->video_idx.video_frames - 1;
+  int32_t maxframe = AVI_IDX_FETCH (this->avi->video_idx.video_frames) - 1;
 
   while( maxframe >= 0 && get_video_pts(this,maxframe) >= video_pts ) {
     if ( this->avi->video_idx.vindex[maxframe].flags & AVIIF_KEYFRAME )
@@ -501,56 +580,49 @@ static int start_time_stopper(demux_avi_t *this, void *data) {
   return -1;
 }
 
-/* This is called periodically to check if there's more file now than
- * there was before.  If there is, we constuct the index for (just) the
- * new part, and append it to the index we've got so far.  We stop
- * slurping in the new part when stopper(this, stopdata) returns a
- * non-negative value, or there's no more file to read.  If we're taking
- * a long time slurping in the new part, use the on-screen display to
- * notify the user.  Returns -1 if EOF was reached, the non-negative
- * return value of stopper otherwise. */
-static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
-                    void *stopdata) {
+/* send event to frontend about index generation progress */
+static void idx_grow_progress (demux_avi_t *this, int percent) {
+  xine_event_t             event;
+  xine_progress_data_t     prg;
+
+  prg.description = _("Restoring index...");
+  prg.percent = percent;
+
+  event.type = XINE_EVENT_PROGRESS;
+  event.data = &prg;
+  event.data_length = sizeof (xine_progress_data_t);
+
+  xine_event_send (this->stream, &event);
+}
+
+/* The chunk scanner behind idx_grow () below, and the background index
+ * builder. Only the demux thread (fg) reports progress and honors user
+ * actions. */
+static int idx_grow_scan(demux_avi_t *this, input_plugin_t *input,
+                         int (*stopper)(demux_avi_t *, void *), void *stopdata, int fg) {
   int           retval = -1;
   int           num_read = 0;
   uint8_t       data[AVI_HEADER_SIZE];
   uint8_t       data2[4];
-  off_t         savepos = this->input->seek(this->input, 0, SEEK_CUR);
   off_t         chunk_pos;
   uint32_t      chunk_len;
   int           sent_event = 0;
 
-  this->input->seek(this->input, this->idx_grow.nexttagoffset, SEEK_SET);
+  input->seek(input, this->idx_grow.nexttagoffset, SEEK_SET);
   chunk_pos = this->idx_grow.nexttagoffset;
 
   while (((retval = stopper(this, stopdata)) < 0) &&
-         (!_x_action_pending(this->stream))) {
+         (!fg || !_x_action_pending(this->stream))) {
     int valid_chunk = 0;
 
     num_read += 1;
 
-    if (num_read % 1000 == 0) {
-      /* send event to frontend about index generation progress */
-
-      xine_event_t             event;
-      xine_progress_data_t     prg;
-      off_t                    file_len;
-
-      file_len = this->input->get_length (this->input);
-
-      prg.description = _("Restoring index...");
-      prg.percent = 100 * this->idx_grow.nexttagoffset / file_len;
-
-      event.type = XINE_EVENT_PROGRESS;
-      event.data = &prg;
-      event.data_length = sizeof (xine_progress_data_t);
-
-      xine_event_send (this->stream, &event);
-
+    if (fg && (num_read % 1000 == 0)) {
+      idx_grow_progress (this, 100 * this->idx_grow.nexttagoffset / input->get_length (input));
       sent_event = 1;
     }
 
-    if (this->input->read(this->input, data, AVI_HEADER_SIZE) != AVI_HEADER_SIZE) {
+    if (input->read(input, data, AVI_HEADER_SIZE) != AVI_HEADER_SIZE) {
       lprintf("read failed, chunk_pos=%" PRIdMAX "\n", (intmax_t)chunk_pos);
       break;
     }
@@ -559,7 +631,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
     if(strncasecmp(data, "LIST", 4) == 0 ||
         strncasecmp(data, "RIFF", 4) == 0) {
       this->idx_grow.nexttagoffset =
-        this->input->seek(this->input, 4,SEEK_CUR);
+        input->seek(input, 4,SEEK_CUR);
       continue;
     }
 
@@ -584,7 +656,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
        *   i've added XVID which looks like iso mpeg 4
        */
 
-      if (this->input->read(this->input, data2, 4) != 4) {
+      if (input->read(input, data2, 4) != 4) {
       read_failed:
         lprintf("read failed\n");
         break;
@@ -592,7 +664,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
       tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
       switch(this->avi->video_type) {
         case BUF_VIDEO_MSMPEG4_V1:
-          if (this->input->read(this->input, data2, 4) != 4)
+          if (input->read(input, data2, 4) != 4)
             goto read_failed;
           tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
           tmp = tmp << 5;
@@ -643,31 +715,158 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
     if (!valid_chunk) {
       xine_log(this->stream->xine, XINE_LOG_MSG, _("demux_avi: invalid avi chunk \"%c%c%c%c\" at pos %" PRIdMAX "\n"), data[0], data[1], data[2], data[3], (intmax_t)chunk_pos);
     }
-    chunk_pos = this->input->seek(this->input, this->idx_grow.nexttagoffset, SEEK_SET);
+    chunk_pos = input->seek(input, this->idx_grow.nexttagoffset, SEEK_SET);
     if (chunk_pos != this->idx_grow.nexttagoffset) {
       lprintf("seek failed: %" PRIdMAX " != %" PRIdMAX "\n", (intmax_t)chunk_pos, (intmax_t)this->idx_grow.nexttagoffset);
       break;
     }
   }
 
-  if (sent_event == 1) {
-    /* send event to frontend about index generation progress */
-    xine_event_t             event;
-    xine_progress_data_t     prg;
+  if (sent_event == 1)
+    idx_grow_progress (this, 100);
+
+  if (retval < 0) retval = -1;
+  return retval;
+}
+
+#ifdef AVI_BG_INDEX
+/* Background index builder. When an avi has no idx1, we start scanning the
+ * file right after open through a cloned input, and publish the entries as
+ * we go. The demux thread reads what is there, and only waits when it needs
+ * something beyond. When the builder reaches the end, the demux thread takes
+ * over again, for files that are still growing. */
+
+static int bg_stopper(demux_avi_t *this, void *data) {
+  (void)data;
+  if (AVI_IDX_FETCH (this->bg_stop))
+    return 1;
+  /* wake up waiting demux thread now and then. */
+  if (!(++this->bg_chunks & 63)) {
+    pthread_mutex_lock (&this->bg_mutex);
+    pthread_cond_broadcast (&this->bg_cond);
+    pthread_mutex_unlock (&this->bg_mutex);
+  }
+  return -1;
+}
+
+static void *demux_avi_index_loop (void *data) {
+  demux_avi_t *this = (demux_avi_t *)data;
+
+  idx_grow_scan (this, this->bg_input, bg_stopper, NULL, 0);
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "demux_avi: background index done, %u frames.\n", this->avi->video_idx.video_frames);
+
+  pthread_mutex_lock (&this->bg_mutex);
+  this->bg_state = 2;
+  pthread_cond_broadcast (&this->bg_cond);
+  pthread_mutex_unlock (&this->bg_mutex);
+  return NULL;
+}
+
+static void demux_avi_index_start (demux_avi_t *this) {
+  input_plugin_t *in2 = NULL;
+
+  if (this->streaming || this->has_index || this->bg_state)
+    return;
+  if (this->input->get_optional_data (this->input, &in2, INPUT_OPTIONAL_DATA_CLONE) != INPUT_OPTIONAL_SUCCESS)
+    return;
+  if (!in2)
+    return;
+
+  pthread_mutex_init (&this->bg_mutex, NULL);
+  pthread_cond_init (&this->bg_cond, NULL);
+  this->bg_input          = in2;
+  this->bg_stop           = 0;
+  this->bg_state          = 1;
+  this->avi->index_shared = 1;
+  if (pthread_create (&this->bg_thread, NULL, demux_avi_index_loop, this)) {
+    this->bg_state          = 0;
+    this->avi->index_shared = 0;
+    this->bg_input          = NULL;
+    in2->dispose (in2);
+    pthread_cond_destroy (&this->bg_cond);
+    pthread_mutex_destroy (&this->bg_mutex);
+  }
+}
+
+static void demux_avi_index_stop (demux_avi_t *this) {
+  void *dummy;
+
+  if (!this->bg_state)
+    return;
+  AVI_IDX_PUBLISH (this->bg_stop, 1);
+  pthread_join (this->bg_thread, &dummy);
+  this->bg_input->dispose (this->bg_input);
+  this->bg_input = NULL;
+  pthread_cond_destroy (&this->bg_cond);
+  pthread_mutex_destroy (&this->bg_mutex);
+  this->avi->index_shared = 0;
+  this->bg_state = 0;
+}
+
+/* Wait for the builder until stopper is satisfied. */
+static int idx_grow_wait(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
+                         void *stopdata) {
+  int retval, state, waits = 0, sent_event = 0;
+
+  pthread_mutex_lock (&this->bg_mutex);
+  while (((retval = stopper (this, stopdata)) < 0) && (this->bg_state == 1)
+    && !_x_action_pending (this->stream)) {
+    struct timespec ts = {0, 0};
+
+    xine_gettime (&ts);
+    ts.tv_nsec += 100000000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_nsec -= 1000000000;
+      ts.tv_sec  += 1;
+    }
+    pthread_cond_timedwait (&this->bg_cond, &this->bg_mutex, &ts);
+    if (!(++waits % 5)) {
+      idx_grow_progress (this, 100 * this->idx_grow.nexttagoffset / this->input->get_length (this->input));
+      sent_event = 1;
+    }
+  }
+  state = this->bg_state;
+  pthread_mutex_unlock (&this->bg_mutex);
 
-    prg.description = _("Restoring index...");
-    prg.percent = 100;
+  if (sent_event)
+    idx_grow_progress (this, 100);
+  /* builder finished, take over. */
+  if (state == 2)
+    demux_avi_index_stop (this);
 
-    event.type = XINE_EVENT_PROGRESS;
-    event.data = &prg;
-    event.data_length = sizeof (xine_progress_data_t);
+  return retval;
+}
+#else
+#  define demux_avi_index_start(this)
+#  define demux_avi_index_stop(this)
+#endif
 
-    xine_event_send (this->stream, &event);
+/* This is called periodically to check if there's more file now than
+ * there was before.  If there is, we constuct the index for (just) the
+ * new part, and append it to the index we've got so far.  We stop
+ * slurping in the new part when stopper(this, stopdata) returns a
+ * non-negative value, or there's no more file to read.  If we're taking
+ * a long time slurping in the new part, use the on-screen display to
+ * notify the user.  Returns -1 if EOF was reached, the non-negative
+ * return value of stopper otherwise. */
+static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
+                    void *stopdata) {
+  int           retval;
+  off_t         savepos;
+
+#ifdef AVI_BG_INDEX
+  if (this->bg_state) {
+    retval = idx_grow_wait (this, stopper, stopdata);
+    if ((retval >= 0) || this->bg_state)
+      return retval < 0 ? -1 : retval;
   }
+#endif
 
+  savepos = this->input->seek(this->input, 0, SEEK_CUR);
+  retval = idx_grow_scan (this, this->input, stopper, stopdata, 1);
   this->input->seek (this->input, savepos, SEEK_SET);
 
-  if (retval < 0) retval = -1;
   return retval;
 }
 
@@ -675,7 +874,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
 static video_index_entry_t *video_cur_index_entry(demux_avi_t *this) {
   avi_t *AVI = this->avi;
 
-  if (AVI->video_posf >= AVI->video_idx.video_frames) {
+  if (AVI->video_posf >= AVI_IDX_FETCH (AVI->video_idx.video_frames)) {
     /* We don't have enough frames; see if the file's bigger yet. */
     if (idx_grow(this, video_pos_stopper, NULL) < 0) {
       /* We still don't have enough frames.  Oh, well. */
@@ -690,7 +889,7 @@ static audio_index_entry_t *audio_cur_index_entry(demux_avi_t *this,
     avi_audio_t *AVI_A) {
 
   lprintf("posc: %d, chunks: %d\n", AVI_A->audio_posc, AVI_A->audio_idx.audio_chunks);
-  if (AVI_A->audio_posc >= AVI_A->audio_idx.audio_chunks) {
+  if (AVI_A->audio_posc >= AVI_IDX_FETCH (AVI_A->audio_idx.audio_chunks)) {
     /* We don't have enough chunks; see if the file's bigger yet. */
     if (idx_grow(this, audio_pos_stopper, AVI_A) < 0) {
       /* We still don't have enough chunks.  Oh, well. */
@@ -723,6 +922,10 @@ static void AVI_close(avi_t *AVI){
     _x_freep(&AVI->audio[i]);
   }
 
+  for (i = 0; i < AVI->num_retired; i++)
+    free (AVI->retired[i]);
+  _x_freep(&AVI->retired);
+
   free(AVI);
 }
 
@@ -1559,7 +1762,7 @@ static int demux_avi_next (demux_avi_t *this, int decoder_flags) {
   /* Try to grow the index, in case more of the avi file has shown up
    * since we last checked.  If it's still too small, well then we're at
    * the end of the stream. */
-  if (this->avi->video_idx.video_frames <= this->avi->video_posf) {
+  if (AVI_IDX_FETCH (this->avi->video_idx.video_frames) <= this->avi->video_posf) {
     if (idx_grow(this, video_pos_stopper, NULL) < 0) {
       lprintf("end of stream\n");
     }
@@ -1569,7 +1772,7 @@ static int demux_avi_next (demux_avi_t *this, int decoder_flags) {
     avi_audio_t *audio = this->avi->audio[i];
 
     if (!this->no_audio &&
-        (audio->audio_idx.audio_chunks <= audio->audio_posc)) {
+        (AVI_IDX_FETCH (audio->audio_idx.audio_chunks) <= audio->audio_posc)) {
       if (idx_grow(this, audio_pos_stopper, this->avi->audio[i]) < 0) {
         lprintf("end of stream\n");
       }
@@ -1883,8 +2086,10 @@ static int demux_avi_send_chunk (demux_plugin_t *this_gen) {
 static void demux_avi_dispose (demux_plugin_t *this_gen) {
   demux_avi_t *this = (demux_avi_t *) this_gen;
 
-  if (this->avi)
+  if (this->avi) {
+    demux_avi_index_stop (this);
     AVI_close (this->avi);
+  }
 
   free(this);
 }
@@ -2162,7 +2367,7 @@ static int demux_avi_seek_internal (demux_avi_t *this) {
   }
 
   if (start_pos || start_time)
-    max_pos = this->avi->video_idx.video_frames - 1;
+    max_pos = (int64_t)AVI_IDX_FETCH (this->avi->video_idx.video_frames) - 1;
   else
     max_pos=0;
 
@@ -2193,6 +2398,11 @@ static int demux_avi_seek_internal (demux_avi_t *this) {
       }
     }
   }
+  if ((start_pos || start_time) && (max_pos > 0)) {
+    /* the lowest entry past our starting point. */
+    this->avi->video_posf = cur_pos = max_pos;
+    vie = video_cur_index_entry(this);
+  }
 
   while (vie && !(vie->flags & AVIIF_KEYFRAME) && cur_pos) {
     this->avi->video_posf = --cur_pos;
@@ -2218,7 +2428,7 @@ static int demux_avi_seek_internal (demux_avi_t *this) {
     int i;
 
     for(i = 0; i < this->avi->n_audio; i++) {
-      max_pos = this->avi->audio[i]->audio_idx.audio_chunks - 1;
+      max_pos = (int64_t)AVI_IDX_FETCH (this->avi->audio[i]->audio_idx.audio_chunks) - 1;
       min_pos = 0;
       lprintf("audio_chunks=%d, min=%" PRId64 ", max=%" PRId64 "\n", this->avi->audio[i]->audio_idx.audio_chunks, min_pos, max_pos);
       while (min_pos < max_pos) {
@@ -2279,7 +2489,7 @@ static int demux_avi_get_stream_length (demux_plugin_t *this_gen) {
     if (this->streaming) {
       return (int)(get_video_pts(this, this->avi->video_posf) / 90);
     } else {
-      return (int)(get_video_pts(this, this->avi->video_idx.video_frames) / 90);
+      return (int)(get_video_pts(this, AVI_IDX_FETCH (this->avi->video_idx.video_frames)) / 90);
     }
   }
 
@@ -2366,6 +2576,8 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
            "demux_avi: %d frames\n", this->avi->video_idx.video_frames);
 
+  demux_avi_index_start (this);
+
   return &this->demux_plugin;
 }
 
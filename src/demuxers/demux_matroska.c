@@ -2019,6 +2019,11 @@ static int parse_cue_point(demux_matroska_t *this) {
     matroska_index_t *index;
     int i;
 
+    /* Scale the cue to ms precision. */
+    timecode = (uint64_t)timecode * this->timecode_scale / 1000000;
+    this->cues_last_time = timecode;
+    this->cues_last_pos = pos;
+
     index = NULL;
     for (i = 0; i < this->num_indexes; i++)
       if (this->indexes[i].track_num == track_num) {
@@ -2049,32 +2054,83 @@ static int parse_cue_point(demux_matroska_t *this) {
 }
 
 
-static int parse_cues(demux_matroska_t *this) {
+/*
+ * Cues of big files may hold hundreds of thousands of cue points. Instead of
+ * reading them all at open, parse them on demand: cue points are sorted by
+ * time (and thus by position), so stop as soon as one lies beyond the seek
+ * target. The next call resumes where this one stopped.
+ */
+static int parse_cues(demux_matroska_t *this, off_t start_pos, uint32_t stime) {
   ebml_parser_t *ebml = this->ebml;
-  int next_level = 2;
+  ebml_parser_t ebml_bak;
+  off_t current_pos, cues_end;
+  int ret = 1;
 
-  while (next_level == 2) {
+  cues_end = this->cues_pos + this->cues_len;
+  if (!this->cues_pos || (this->cues_next >= cues_end))
+    return 1;
+
+  /* backup current state */
+  current_pos = this->input->get_current_pos(this->input);
+  memcpy(&ebml_bak, ebml, sizeof(ebml_parser_t));   /* FIXME */
+
+  if (this->input->seek(this->input, this->cues_next, SEEK_SET) < 0) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "demux_matroska: failed to seek to pos: %" PRIdMAX "\n",
+            (intmax_t)this->cues_next);
+    this->cues_next = cues_end;
+    return 0;
+  }
+  ebml->elem_stack[0] = this->segment;
+  ebml->elem_stack[1].id = MATROSKA_ID_CUES;
+  ebml->elem_stack[1].start = this->cues_pos;
+  ebml->elem_stack[1].len = this->cues_len;
+
+  while (this->cues_next < cues_end) {
     ebml_elem_t elem;
 
-    if (!ebml_read_elem_head(ebml, &elem))
-      return 0;
+    if (start_pos ? (this->cues_last_pos > start_pos) : (this->cues_last_time > stime))
+      break;
+
+    ebml->level = 2;
+    if (!ebml_read_elem_head(ebml, &elem)) {
+      ret = 0;
+      break;
+    }
 
     switch (elem.id) {
       case MATROSKA_ID_CU_POINT:
         lprintf("CuePoint\n");
-        if (!ebml_read_master (ebml, &elem))
-          return 0;
+        if (!ebml_read_master (ebml, &elem)) {
+          ret = 0;
+          break;
+        }
         if ((elem.len > 0) && !parse_cue_point(this))
-          return 0;
+          ret = 0;
         break;
       default:
         lprintf("Unhandled ID: 0x%x\n", elem.id);
         if (!ebml_skip(ebml, &elem))
-          return 0;
+          ret = 0;
     }
-    next_level = ebml_get_next_level(ebml, &elem);
+    if (!ret)
+      break;
+    if (elem.len > (uint64_t)(cues_end - elem.start))
+      this->cues_next = cues_end;
+    else
+      this->cues_next = elem.start + elem.len;
   }
-  return 1;
+  if (!ret) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+            "demux_matroska: broken cues at pos %" PRIdMAX "\n", (intmax_t)this->cues_next);
+    this->cues_next = cues_end;
+  }
+
+  /* restore old state */
+  memcpy(ebml, &ebml_bak, sizeof(ebml_parser_t));   /* FIXME */
+  if (this->input->seek(this->input, current_pos, SEEK_SET) < 0)
+    return 0;
+  return ret;
 }
 
 
@@ -2256,6 +2312,10 @@ static int parse_block (demux_matroska_t *this, size_t block_size,
      return 0;
   }
 
+  /* keyframes only: video key frames only, no audio or subtitles. */
+  if (this->keyframes_only && ((track != this->video_track) || !is_key))
+    return 1;
+
   pts = ((int64_t)cluster_timecode + timecode_diff) *
         (int64_t)this->timecode_scale * (int64_t)90 /
         (int64_t)1000000;
@@ -2467,9 +2527,38 @@ static int parse_simpleblock(demux_matroska_t *this, size_t block_len, uint64_t
   if( file_len )
     normpos = (int) ( (double) block_pos * 65535 / file_len );
 
-  if (!read_block_data(this, block_len, this->compress_maxlen))
+  if (this->keyframes_only) {
+    /* look at the block header first, and skip the payload if we dont want it. */
+    uint8_t head[12];
+    uint64_t track_num;
+    size_t n = block_len < sizeof (head) ? block_len : sizeof (head);
+    size_t num_len;
+
+    if (this->input->read (this->input, head, n) != (off_t)n)
+      return 0;
+    num_len = parse_ebml_uint (this, head, &track_num);
+    if (!num_len || (n < num_len + 3) || !(head[num_len + 2] & 0x80)
+      || !this->video_track || (track_num != (uint64_t)this->video_track->track_num)) {
+      if (block_len > n)
+        this->input->seek (this->input, block_len - n, SEEK_CUR);
+      return 1;
+    }
+    if (!read_block_data (this, block_len - n, this->compress_maxlen + n))
+      return 0;
+    memcpy (this->block_data + this->compress_maxlen, head, n);
+  } else if (!read_block_data(this, block_len, this->compress_maxlen))
     return 0;
 
+  /* the key frame flag follows track number and timecode */
+  {
+    uint8_t *data = this->block_data + this->compress_maxlen;
+    uint64_t track_num;
+    size_t num_len = parse_ebml_uint(this, data, &track_num);
+
+    if (num_len && (block_len > num_len + 2) && !(data[num_len + 2] & 0x80))
+      is_key = 0;
+  }
+
     /* we have the duration, we can parse the block now */
   if (!parse_block(this, block_len, cluster_timecode, block_duration,
                    normpos, is_key))
@@ -2590,19 +2679,6 @@ static int parse_cluster(demux_matroska_t *this) {
   uint64_t timecode = 0;
   uint64_t duration = 0;
 
-  if (!this->first_cluster_found) {
-    int idx, entry;
-
-    /* Scale the cues to ms precision. */
-    for (idx = 0; idx < this->num_indexes; idx++) {
-      matroska_index_t *index = &this->indexes[idx];
-      for (entry = 0; entry < index->num_entries; entry++)
-        index->timecode[entry] = index->timecode[entry] *
-          this->timecode_scale / 1000000;
-    }
-    this->first_cluster_found = 1;
-  }
-
   handle_events(this);
 
   while (next_level == this_level) {
@@ -2872,10 +2948,13 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
         ret_value = 2;
         break;
       case MATROSKA_ID_CUES:
+        /* parsed on demand when seeking */
         lprintf("Cues\n");
-        if (!ebml_read_master (ebml, &elem))
-          return 0;
-        if ((elem.len > 0) && !parse_cues(this))
+        this->cues_pos = this->cues_next = elem.start;
+        this->cues_len = elem.len;
+        if (this->cues_len > (uint64_t)(this->input->get_length(this->input) - elem.start))
+          this->cues_len = this->input->get_length(this->input) - elem.start;
+        if (!ebml_skip(ebml, &elem))
           return 0;
         break;
       case MATROSKA_ID_ATTACHMENTS:
@@ -2909,6 +2988,240 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
   return ret_value;
 }
 
+/*
+ * Cluster cache. Every cluster seen during playback is remembered with its
+ * timecode. Files without cues are seeked by searching this cache, narrowing
+ * down big gaps by probing for cluster heads in between, and finally
+ * scanning cluster heads linearly. Everything found goes to the cache, too.
+ */
+#define CLUSTER_SCAN_GAP (4 << 20)
+
+/* return the last cached cluster at or before pos, or -1 */
+static int cluster_cache_find(matroska_index_t *c, off_t pos) {
+  int left, middle, right;
+
+  if (!c->num_entries || (pos < c->pos[0]))
+    return -1;
+  left = 0;
+  right = c->num_entries - 1;
+  while (left < right) {
+    middle = (left + right + 1) / 2;
+    if (pos < c->pos[middle])
+      right = middle - 1;
+    else
+      left = middle;
+  }
+  return left;
+}
+
+/* return the last cached cluster starting at or before stime, or -1 */
+static int cluster_cache_find_time(matroska_index_t *c, uint64_t stime) {
+  int left, middle, right;
+
+  if (!c->num_entries || (stime < c->timecode[0]))
+    return -1;
+  left = 0;
+  right = c->num_entries - 1;
+  while (left < right) {
+    middle = (left + right + 1) / 2;
+    if (stime < c->timecode[middle])
+      right = middle - 1;
+    else
+      left = middle;
+  }
+  return left;
+}
+
+static int cluster_cache_add(demux_matroska_t *this, off_t pos, uint64_t timecode) {
+  matroska_index_t *c = &this->clusters;
+  int i;
+
+  i = cluster_cache_find(c, pos);
+  if ((i >= 0) && (c->pos[i] == pos))
+    return i;
+  i++;
+
+  if ((c->num_entries % 1024) == 0) {
+    off_t *p;
+    uint64_t *t;
+
+    p = realloc(c->pos, sizeof(off_t) * (c->num_entries + 1024));
+    if (!p)
+      return -1;
+    c->pos = p;
+    t = realloc(c->timecode, sizeof(uint64_t) * (c->num_entries + 1024));
+    if (!t)
+      return -1;
+    c->timecode = t;
+  }
+  if (i < c->num_entries) {
+    memmove(c->pos + i + 1, c->pos + i, sizeof(off_t) * (c->num_entries - i));
+    memmove(c->timecode + i + 1, c->timecode + i, sizeof(uint64_t) * (c->num_entries - i));
+  }
+  c->pos[i] = pos;
+  c->timecode[i] = timecode;
+  c->num_entries++;
+
+  return i;
+}
+
+/* read the cluster head at pos. return its timecode (in millis),
+ * and the position of the next top level element. */
+static int read_cluster_head(demux_matroska_t *this, off_t pos,
+                             uint64_t *timecode, off_t *next) {
+  ebml_parser_t *ebml = this->ebml;
+  ebml_elem_t cluster;
+  off_t length;
+  int i;
+
+  if (this->input->seek(this->input, pos, SEEK_SET) < 0)
+    return 0;
+  if (!ebml_read_elem_head(ebml, &cluster) || (cluster.id != MATROSKA_ID_CLUSTER))
+    return 0;
+
+  length = this->input->get_length(this->input);
+  if (cluster.len < (uint64_t)(length - cluster.start))
+    *next = cluster.start + cluster.len;
+  else
+    *next = length;
+
+  /* the timecode is the first child in practice */
+  for (i = 0; i < 4; i++) {
+    ebml_elem_t elem;
+
+    if (!ebml_read_elem_head(ebml, &elem))
+      return 0;
+    if (elem.id == MATROSKA_ID_CL_TIMECODE) {
+      uint64_t num;
+
+      if (!ebml_read_uint(ebml, &elem, &num))
+        return 0;
+      *timecode = num * this->timecode_scale / 1000000;
+      return 1;
+    }
+    if (elem.len > (uint64_t)(*next - elem.start))
+      return 0;
+    if (!ebml_skip(ebml, &elem))
+      return 0;
+  }
+  return 0;
+}
+
+/* find the first valid cluster head in [from, to) */
+static off_t find_cluster(demux_matroska_t *this, off_t from, off_t to,
+                          uint64_t *timecode) {
+  uint8_t buf[16384];
+  off_t length = this->input->get_length(this->input);
+
+  while (from < to) {
+    off_t next;
+    int n, i;
+
+    if (this->input->seek(this->input, from, SEEK_SET) < 0)
+      return -1;
+    n = sizeof(buf);
+    if (n > to - from + 3)
+      n = to - from + 3;
+    n = this->input->read(this->input, buf, n);
+    if (n < 4)
+      return -1;
+
+    for (i = 0; i + 4 <= n; i++) {
+      if ((buf[i] != 0x1f) || (buf[i + 1] != 0x43) ||
+          (buf[i + 2] != 0xb6) || (buf[i + 3] != 0x75) || (from + i >= to))
+        continue;
+      if (read_cluster_head(this, from + i, timecode, &next)) {
+        uint8_t id[1];
+
+        /* a real cluster is followed by another top level element */
+        if (next >= length)
+          return from + i;
+        if ((this->input->seek(this->input, next, SEEK_SET) >= 0) &&
+            (this->input->read(this->input, id, 1) == 1) && ((id[0] & 0xf0) == 0x10))
+          return from + i;
+      }
+      /* false positive, go on searching behind it */
+      break;
+    }
+    from += (i + 4 <= n) ? i + 1 : n - 3;
+  }
+  return -1;
+}
+
+static int cluster_seek(demux_matroska_t *this, off_t start_pos, uint32_t stime) {
+  matroska_index_t *c = &this->clusters;
+  off_t length = this->input->get_length(this->input);
+  off_t pos, next;
+  uint64_t timecode;
+  int lo, tries;
+
+  if (start_pos) {
+    pos = find_cluster(this, start_pos, length, &timecode);
+    if (pos >= 0)
+      return cluster_cache_add(this, pos, timecode);
+    return cluster_cache_find(c, start_pos);
+  }
+
+  if (!c->num_entries)
+    return -1;
+
+  /* narrow down big gaps by probing */
+  for (tries = 0; tries < 32; tries++) {
+    off_t lo_pos, hi_pos;
+    uint64_t lo_time, hi_time;
+    int have_hi;
+
+    lo = cluster_cache_find_time(c, stime);
+    if (lo < 0)
+      return 0;
+    lo_pos = c->pos[lo];
+    lo_time = c->timecode[lo];
+    have_hi = (lo + 1 < c->num_entries);
+    if (have_hi) {
+      hi_pos = c->pos[lo + 1];
+      hi_time = c->timecode[lo + 1];
+    } else {
+      hi_pos = length;
+      hi_time = this->duration > 0 ? (uint64_t)this->duration : 0;
+    }
+    if ((hi_pos - lo_pos <= CLUSTER_SCAN_GAP) || (hi_time <= stime) || (hi_time <= lo_time))
+      break;
+
+    pos = lo_pos + (off_t)((double)(hi_pos - lo_pos) * (stime - lo_time) / (hi_time - lo_time));
+    if (pos < lo_pos + (hi_pos - lo_pos) / 8)
+      pos = lo_pos + (hi_pos - lo_pos) / 8;
+    if (pos > hi_pos - (hi_pos - lo_pos) / 8)
+      pos = hi_pos - (hi_pos - lo_pos) / 8;
+
+    pos = find_cluster(this, pos, hi_pos, &timecode);
+    if ((pos < 0) || (timecode < lo_time) || (have_hi && (timecode > hi_time)))
+      break;
+    lprintf("probed cluster at %" PRIdMAX ", time %" PRIu64 "\n", (intmax_t)pos, timecode);
+    if (cluster_cache_add(this, pos, timecode) < 0)
+      break;
+  }
+
+  /* scan cluster heads */
+  lo = cluster_cache_find_time(c, stime);
+  if (lo < 0)
+    return 0;
+  if (!read_cluster_head(this, c->pos[lo], &timecode, &next))
+    return lo;
+  while (next < length) {
+    off_t pos2;
+    int i;
+
+    if (!read_cluster_head(this, next, &timecode, &pos2))
+      break;
+    i = cluster_cache_add(this, next, timecode);
+    if ((i < 0) || (timecode > stime))
+      break;
+    lo = i;
+    next = pos2;
+  }
+  return lo;
+}
+
 /*
  * Function used to parse a top level element during the playback.
  * It skips all elements except clusters.
@@ -2917,8 +3230,9 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
 static int parse_top_level(demux_matroska_t *this, int *next_level) {
   ebml_parser_t *ebml = this->ebml;
   ebml_elem_t elem;
-  off_t cluster_pos, cluster_len;
+  off_t head_pos, cluster_pos, cluster_len;
 
+  head_pos = this->input->get_current_pos(this->input);
   if (!ebml_read_elem_head(ebml, &elem))
     return 0;
 
@@ -2959,6 +3273,8 @@ static int parse_top_level(demux_matroska_t *this, int *next_level) {
           xprintf(ebml->xine, XINE_VERBOSITY_LOG,
                   "seek error (skipping %" PRId64 " bytes)\n", (int64_t)skip);
         }
+      } else {
+        cluster_cache_add(this, head_pos, this->last_timecode * this->timecode_scale / 1000000);
       }
       break;
     case MATROSKA_ID_CUES:
@@ -3030,6 +3346,9 @@ static int demux_matroska_send_chunk (demux_plugin_t *this_gen) {
   demux_matroska_t *this = (demux_matroska_t *) this_gen;
   int next_level;
 
+  this->keyframes_only = this->video_track
+    && _x_stream_info_get (this->stream, XINE_STREAM_INFO_KEYFRAMES_ONLY);
+
   if (!parse_top_level(this, &next_level)) {
     this->status = DEMUX_FINISHED;
   }
@@ -3161,6 +3480,51 @@ static int binary_seek(matroska_index_t *index, off_t start_pos,
 }
 
 
+static int seek_by_clusters(demux_matroska_t *this, off_t start_pos, int start_time) {
+  ebml_parser_t ebml_bak;
+  off_t current_pos;
+  int entry, i;
+
+  /* backup current state, cluster probing reads element heads anywhere */
+  current_pos = this->input->get_current_pos(this->input);
+  memcpy(&ebml_bak, this->ebml, sizeof(ebml_parser_t));   /* FIXME */
+
+  entry = cluster_seek(this, start_pos, start_time < 0 ? 0 : start_time);
+
+  /* restore old state */
+  memcpy(this->ebml, &ebml_bak, sizeof(ebml_parser_t));   /* FIXME */
+
+  if (entry < 0) {
+    lprintf("seeking to %s %" PRIdMAX " - no cluster found.\n", start_pos ? "pos" : "time",
+            start_pos ? (intmax_t)start_pos : (intmax_t)start_time);
+    if (this->input->seek(this->input, current_pos, SEEK_SET) < 0)
+      this->status = DEMUX_FINISHED;
+    return this->status;
+  }
+
+  lprintf("seeking to %s %" PRIdMAX ". decision is cluster at %" PRIu64 "/%" PRIdMAX "\n",
+          start_pos ? "pos" : "time", start_pos ? (intmax_t)start_pos : (intmax_t)start_time,
+          this->clusters.timecode[entry], (intmax_t)this->clusters.pos[entry]);
+
+  if (this->input->seek(this->input, this->clusters.pos[entry], SEEK_SET) < 0)
+    this->status = DEMUX_FINISHED;
+
+  /* we always seek to the ebml level 1 */
+  this->ebml->level = 1;
+
+  /* clusters do not necessarily start with a key frame */
+  for (i = 0; i < this->num_tracks; i++) {
+    if (this->tracks[i]->track_type == MATROSKA_TRACK_VIDEO) {
+      this->skip_to_timecode = this->clusters.timecode[entry] * 90;
+      this->skip_for_track = this->tracks[i]->track_num;
+      break;
+    }
+  }
+  _x_demux_flush_engine(this->stream);
+
+  return this->status;
+}
+
 static int demux_matroska_seek (demux_plugin_t *this_gen,
                                 off_t start_pos, int start_time, int playing) {
 
@@ -3183,9 +3547,7 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
   this->send_newpts   = 1;
   this->buf_flag_seek = 1;
 
-  /* Seeking without an index is not supported yet. */
-  if (!this->num_indexes)
-    return this->status;
+  parse_cues(this, start_pos, start_time < 0 ? 0 : start_time);
 
   /* Find an index for a video track and use the first available index
      otherwise. */
@@ -3212,7 +3574,7 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
 
   /* No suitable index found. */
   if (index == NULL)
-    return this->status;
+    return seek_by_clusters(this, start_pos, start_time);
 
   entry = binary_seek(index, start_pos, start_time);
   if (entry == -1) {
@@ -3268,6 +3630,8 @@ static void demux_matroska_dispose (demux_plugin_t *this_gen) {
     _x_freep(&this->indexes[i].timecode);
   }
   _x_freep(&this->indexes);
+  _x_freep(&this->clusters.pos);
+  _x_freep(&this->clusters.timecode);
 
   /* Free the top_level elem list */
   _x_freep(&this->top_level_list);
@@ -72,6 +72,7 @@ typedef struct {
   int                  duration;            /* in millis */
   int                  preview_sent;
   int                  preview_mode;
+  int                  keyframes_only;      /* XINE_PARAM_KEYFRAMES_ONLY */
   char                *title;
 
   /* meta seek info */
@@ -81,10 +82,20 @@ typedef struct {
   /* seek info */
   matroska_index_t    *indexes;
   int                  num_indexes;
-  int                  first_cluster_found;
   int                  skip_to_timecode;
   int                  skip_for_track;
 
+  /* cues are parsed on demand, cue points are sorted by time */
+  off_t                cues_pos;            /* Cues payload start, 0 if unknown */
+  uint64_t             cues_len;
+  off_t                cues_next;           /* next unparsed cue point */
+  uint64_t             cues_last_time;      /* in millis */
+  off_t                cues_last_pos;
+
+  /* clusters seen during playback and seeking, sorted by position,
+   * timecodes in millis */
+  matroska_index_t     clusters;
+
   /* tracks */
   int                  num_tracks;
   int                  num_video_tracks;
@@ -85,6 +85,11 @@ typedef struct demux_mpeg_block_s {
   int64_t               last_cell_time;
   off_t                 last_cell_pos;
   int                   last_begin_time;
+
+  /* persistent keyframe index. */
+  xine_seek_index_t    *seek_index;
+  off_t                 seek_index_prev;
+  off_t                 block_pos;
 } demux_mpeg_block_t ;
 
 
@@ -174,6 +179,8 @@ static void demux_mpeg_block_parse_pack (demux_mpeg_block_t *this, int preview_m
 
   lprintf ("read_block\n");
 
+  if (this->seek_index)
+    this->block_pos = this->input->get_current_pos (this->input);
   buf = this->input->read_block (this->input, this->video_fifo, this->blocksize);
 
   if (buf==NULL) {
@@ -973,6 +980,20 @@ static int32_t parse_private_stream_1(demux_mpeg_block_t *this, uint8_t *p, buf_
     return -1;
 }
 
+/* does this mpeg video payload start with a keyframe? */
+static int is_keyframe (const uint8_t *p, int len) {
+  const uint8_t *e = p + len - 6;
+  for (; p <= e; p++) {
+    if (p[0] || p[1] || (p[2] != 0x01))
+      continue;
+    if (p[3] == 0xb3) /* sequence header */
+      return 1;
+    if (p[3] == 0x00) /* picture */
+      return ((p[5] >> 3) & 7) == 1;
+  }
+  return 0;
+}
+
 static int32_t parse_video_stream(demux_mpeg_block_t *this, uint8_t *p, buf_element_t *buf) {
   int32_t result;
 
@@ -981,6 +1002,11 @@ static int32_t parse_video_stream(demux_mpeg_block_t *this, uint8_t *p, buf_elem
 
   p += result;
 
+  if (this->seek_index && this->pts && is_keyframe (p, this->packet_len)) {
+    _x_seek_index_add (this->seek_index, this->block_pos, this->pts, this->seek_index_prev);
+    this->seek_index_prev = this->block_pos;
+  }
+
   buf->content   = p;
   buf->size      = this->packet_len;
   buf->type      = BUF_VIDEO_MPEG;
@@ -1206,6 +1232,7 @@ static void demux_mpeg_block_dispose (demux_plugin_t *this_gen) {
 
   demux_mpeg_block_t *this = (demux_mpeg_block_t *) this_gen;
 
+  _x_seek_index_close (&this->seek_index);
   free (this);
 }
 
@@ -1273,8 +1300,14 @@ static void demux_mpeg_block_send_headers (demux_plugin_t *this_gen) {
 
     int num_buffers = NUM_PREVIEW_BUFFERS;
 
+    /* block devices (dvd) have their own navigation. */
+    _x_seek_index_close (&this->seek_index);
+    if (this->input->get_blocksize (this->input) <= 0)
+      this->seek_index = _x_seek_index_open (this->stream, this->input, "vob");
+
     if (this->input->seek (this->input, 0, SEEK_SET) != 0)
       return;
+    this->seek_index_prev = 0;
 
     this->status = DEMUX_OK ;
     while ( (num_buffers>0) && (this->status == DEMUX_OK) ) {
@@ -1301,8 +1334,15 @@ static int demux_mpeg_block_seek (demux_plugin_t *this_gen,
               this->input->get_length (this->input) );
 
   if((this->input->get_capabilities(this->input) & INPUT_CAP_SEEKABLE) != 0) {
-
-    if (start_pos) {
+    off_t idx_pos = (!start_pos && start_time) ? -1 : start_pos;
+    int idx_time = start_time;
+
+    if (_x_seek_index_find (this->seek_index, &idx_pos, &idx_time) >= 0) {
+      lprintf ("seek: using index pos %" PRId64 "\n", (int64_t)idx_pos);
+      idx_pos /= (off_t) this->blocksize;
+      idx_pos *= (off_t) this->blocksize;
+      this->input->seek (this->input, idx_pos, SEEK_SET);
+    } else if (start_pos) {
       start_pos /= (off_t) this->blocksize;
       start_pos *= (off_t) this->blocksize;
 
@@ -1331,6 +1371,7 @@ static int demux_mpeg_block_seek (demux_plugin_t *this_gen,
       }
     } else
       this->input->seek (this->input, 0, SEEK_SET);
+    this->seek_index_prev = this->input->get_current_pos (this->input) == 0 ? 0 : -1;
   }
 
   /*
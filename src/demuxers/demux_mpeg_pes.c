@@ -101,6 +101,11 @@ typedef struct demux_mpeg_pes_s {
   int64_t               last_cell_time;
   off_t                 last_cell_pos;
 
+  /* persistent keyframe index. */
+  xine_seek_index_t    *seek_index;
+  off_t                 seek_index_prev;
+  off_t                 packet_pos, pack_pos;
+
   uint8_t               preview_data[ MAX_PREVIEW_SIZE ];
   off_t                 preview_size, preview_done;
 } demux_mpeg_pes_t ;
@@ -331,6 +336,8 @@ static void demux_mpeg_pes_parse_pack (demux_mpeg_pes_t *this, int preview_mode)
       return;
     }
   }
+  if (this->seek_index)
+    this->packet_pos = this->input->get_current_pos (this->input) - 6;
 
   /* FIXME: buf must be allocated from somewhere before calling here. */
 
@@ -650,6 +657,7 @@ static int32_t parse_program_stream_pack_header(demux_mpeg_pes_t *this, uint8_t
     return -1;
   }
   this->mpeg1 = (p[4] & 0x40) == 0;
+  this->pack_pos = this->packet_pos;
 
   if (this->mpeg1) {
   /* system_clock_reference */
@@ -1214,6 +1222,28 @@ static int32_t parse_private_stream_1(demux_mpeg_pes_t *this, uint8_t *p, buf_el
     return this->packet_len + result;
 }
 
+/* does this video payload start with a keyframe? */
+static int is_keyframe (demux_mpeg_pes_t *this, const uint8_t *p, int len) {
+  const uint8_t *e = p + len - 6;
+  for (; p <= e; p++) {
+    if (p[0] || p[1] || (p[2] != 0x01))
+      continue;
+    if (this->mpeg12_h264_detected & 1) {
+      int nal_type_code = p[3] & 0x1f;
+      if ((nal_type_code == 5) || (nal_type_code == 7)) /* idr slice, sps */
+        return 1;
+      if (nal_type_code == 1) /* non idr slice */
+        return 0;
+    } else {
+      if (p[3] == 0xb3) /* sequence header */
+        return 1;
+      if (p[3] == 0x00) /* picture */
+        return ((p[5] >> 3) & 7) == 1;
+    }
+  }
+  return 0;
+}
+
 static int32_t parse_video_stream(demux_mpeg_pes_t *this, uint8_t *p, buf_element_t *buf) {
   int32_t result;
   uint32_t todo_length=0;
@@ -1281,6 +1311,12 @@ static int32_t parse_video_stream(demux_mpeg_pes_t *this, uint8_t *p, buf_elemen
     lprintf("%s%c\n", (this->mpeg12_h264_detected & 1) ? "H.264" : "MPEG1/2", (this->mpeg12_h264_detected & 2) ? '!' : '?');
   }
 
+  if (this->seek_index && this->pts && is_keyframe (this, p, payload_size)) {
+    off_t pos = this->pack_pos >= 0 ? this->pack_pos : this->packet_pos;
+    _x_seek_index_add (this->seek_index, pos, this->pts, this->seek_index_prev);
+    this->seek_index_prev = pos;
+  }
+
   /* when an H.264 AUD is seen, we first need to tell the decoder that the
      previous frame was complete.
    */
@@ -1560,6 +1596,13 @@ static int demux_mpeg_pes_estimate_rate (demux_mpeg_pes_t *this) {
 }
 #endif /*ESTIMATE_RATE_FIXED*/
 
+static void demux_mpeg_pes_dispose (demux_plugin_t *this_gen) {
+  demux_mpeg_pes_t *this = (demux_mpeg_pes_t *) this_gen;
+
+  _x_seek_index_close (&this->seek_index);
+  free (this);
+}
+
 static int demux_mpeg_pes_get_status (demux_plugin_t *this_gen) {
   demux_mpeg_pes_t *this = (demux_mpeg_pes_t *) this_gen;
 
@@ -1591,10 +1634,15 @@ static void demux_mpeg_pes_send_headers (demux_plugin_t *this_gen) {
 
     int num_buffers = NUM_PREVIEW_BUFFERS;
 
+    _x_seek_index_close (&this->seek_index);
+    this->seek_index = _x_seek_index_open (this->stream, this->input, "ps");
+
     if (this->input->seek (this->input, 0, SEEK_SET) != 0) {
       this->status = DEMUX_FINISHED;
       return;
     }
+    this->seek_index_prev = 0;
+    this->pack_pos = -1;
 
     this->status = DEMUX_OK ;
     while ( (num_buffers>0) && (this->status == DEMUX_OK) ) {
@@ -1627,13 +1675,18 @@ static int demux_mpeg_pes_seek (demux_plugin_t *this_gen,
                                    off_t start_pos, int start_time, int playing) {
 
   demux_mpeg_pes_t *this = (demux_mpeg_pes_t *) this_gen;
+  int idx_time = start_time;
   start_time /= 1000;
   start_pos = (off_t) ( (double) start_pos / 65535 *
               this->input->get_length (this->input) );
 
   if((this->input->get_capabilities(this->input) & INPUT_CAP_SEEKABLE) != 0) {
+    off_t idx_pos = (!start_pos && start_time) ? -1 : start_pos;
 
-    if (start_pos) {
+    if (_x_seek_index_find (this->seek_index, &idx_pos, &idx_time) >= 0) {
+      lprintf ("seek: using index pos %" PRId64 "\n", (int64_t)idx_pos);
+      this->input->seek (this->input, idx_pos, SEEK_SET);
+    } else if (start_pos) {
       start_pos /= (off_t) 2048;
       start_pos *= (off_t) 2048;
 
@@ -1656,6 +1709,8 @@ static int demux_mpeg_pes_seek (demux_plugin_t *this_gen,
       this->input->seek (this->input, start_pos, SEEK_SET);
     } else
       this->input->seek (this->input, 0, SEEK_SET);
+    this->seek_index_prev = this->input->get_current_pos (this->input) == 0 ? 0 : -1;
+    this->pack_pos = -1;
   }
 
   /*
@@ -1768,6 +1823,8 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   /* trigger detection of MPEG 1/2 respectively H.264 content */
   this->mpeg12_h264_detected = 0;
   this->preview_size = 0;
+  this->seek_index = NULL;
+  this->pack_pos = -1;
   this->stream = stream;
   this->input  = input;
   this->status = DEMUX_FINISHED;
@@ -1783,7 +1840,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   this->demux_plugin.send_headers      = demux_mpeg_pes_send_headers;
   this->demux_plugin.send_chunk        = demux_mpeg_pes_send_chunk;
   this->demux_plugin.seek              = demux_mpeg_pes_seek;
-  this->demux_plugin.dispose           = default_demux_plugin_dispose;
+  this->demux_plugin.dispose           = demux_mpeg_pes_dispose;
   this->demux_plugin.get_status        = demux_mpeg_pes_get_status;
   this->demux_plugin.get_stream_length = demux_mpeg_pes_get_stream_length;
   this->demux_plugin.get_capabilities  = demux_mpeg_pes_get_capabilities;
@@ -32,6 +32,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #define LOG_MODULE "demux_mpgaudio"
 #define LOG_VERBOSE
@@ -76,6 +77,15 @@
 /* Xing header stuff */
 #define VBRI_TAG FOURCC_TAG('V', 'B', 'R', 'I')
 
+/* the frame index holds the offset of every MPA_INDEX_STEP th audio frame. */
+#define MPA_INDEX_STEP       32
+/* layer 3 frames may take up to 511 bytes of bit reservoir from the frames
+ * before, and the synthesis filter needs 1 more frame to settle. send that
+ * many frames ahead of a seek target, for decoder warm up only. */
+#define MPA_PREROLL_L3       4
+#define MPA_PREROLL          1
+#define MPA_SCAN_BUF_SIZE    (64 << 10)
+
 /* mp3 frame struct */
 typedef struct {
   /* header */
@@ -89,6 +99,7 @@ typedef struct {
   uint8_t              channel_mode:3;
   uint8_t              padding:3;            /* in bytes */
   uint8_t              is_free_bitrate:1;
+  uint16_t             samples;              /* per frame */
 } mpg_audio_frame_t;
 
 /* Xing Vbr Header struct */
@@ -127,7 +138,7 @@ typedef struct {
   input_plugin_t      *input;
   int                  status;
 
-  uint32_t             stream_length;    /* in seconds */
+  uint32_t             stream_length;    /* in millis, see mpg_stream_length () */
   int                  br;               /* bitrate in bits/second */
   uint32_t             blocksize;
 
@@ -156,6 +167,26 @@ typedef struct {
   int                  mpg_layer;
   int                  valid_frames;
 
+  /* first audio frame, after a Xing/Vbri frame if any. */
+  off_t                audio_start;
+  mpg_audio_frame_t    ref_frame;
+
+  /* number of the next audio frame, if frame_num_ok. then, the frame is
+   * placed on the sample timeline, and samples before seek_sample are
+   * dropped. */
+  uint32_t             frame_num;
+  int                  frame_num_ok;
+  int64_t              seek_sample;
+
+  /* frame index, and its background builder on a cloned input. */
+  pthread_mutex_t      index_lock;
+  off_t               *index;
+  uint32_t             index_used, index_size;
+  input_plugin_t      *bg_input;
+  pthread_t            bg_thread;
+  int                  bg_state;         /* 0 = none, 1 = running, 2 = done */
+  int                  bg_stop;
+
 } demux_mpgaudio_t ;
 
 /*
@@ -281,6 +312,7 @@ static int parse_frame_header(mpg_audio_frame_t *const frame, const uint8_t *con
 
   {
     const uint16_t samples = mp3_samples[frame->version_idx][frame->layer - 1];
+    frame->samples = samples;
     frame->bitrate = mp3_bitrates[frame->version_idx][frame->layer - 1][frame_header.bitrate_idx] * 1000;
     frame->freq    = mp3_freqs[frame->version_idx][frame_header.freq_idx];
     frame->duration  = 1000.0f * (double)samples / (double)frame->freq;
@@ -408,7 +440,7 @@ static xing_header_t *XINE_MALLOC parse_xing_header(mpg_audio_frame_t *frame,
       if (_X_BE_32(&ptr[0x9C]) == LAME_TAG) {
         lprintf("Lame header found\n");
         xing->start_delay = (ptr[0xb1] << 4) | (ptr[0xb2] >> 4);
-        xing->end_delay = ((ptr[0xb2] & 0x0f) << 4) | ptr[0xb3];
+        xing->end_delay = ((ptr[0xb2] & 0x0f) << 8) | ptr[0xb3];
         lprintf("start delay : %d samples\n", xing->start_delay);
         lprintf("end delay : %d samples\n", xing->end_delay);
       }
@@ -526,6 +558,143 @@ static vbri_header_t *XINE_MALLOC parse_vbri_header(mpg_audio_frame_t *frame,
   }
 }
 
+/*
+ * Frame index
+ */
+
+/* add the offset of audio frame num if it is the next one due.
+ * index_lock must be held. */
+static void mpg_index_add (demux_mpgaudio_t *this, uint32_t num, off_t pos) {
+  if ((num % MPA_INDEX_STEP) || (num / MPA_INDEX_STEP != this->index_used))
+    return;
+  if (this->index_used >= this->index_size) {
+    uint32_t n = this->index_size ? this->index_size * 2 : 1024;
+    off_t *new_index = realloc (this->index, n * sizeof (*new_index));
+    if (!new_index)
+      return;
+    this->index = new_index;
+    this->index_size = n;
+  }
+  this->index[this->index_used++] = pos;
+}
+
+/* the index builder refines a guessed length when done. */
+static uint32_t mpg_stream_length (demux_mpgaudio_t *this) {
+  uint32_t length;
+
+  pthread_mutex_lock (&this->index_lock);
+  length = this->stream_length;
+  pthread_mutex_unlock (&this->index_lock);
+  return length;
+}
+
+/* encoder delay and padding from the LAME tag, in samples. */
+static uint32_t mpg_start_delay (demux_mpgaudio_t *this) {
+  return this->xing_header ? this->xing_header->start_delay : 0;
+}
+
+static int64_t mpg_end_sample (demux_mpgaudio_t *this) {
+  if (this->xing_header && this->xing_header->end_delay && this->xing_header->stream_frames)
+    return (int64_t)this->xing_header->stream_frames * this->ref_frame.samples - this->xing_header->end_delay;
+  return INT64_MAX;
+}
+
+/* timeline position of a raw sample in 1/90000s. encoder delay is not part of the timeline. */
+static int64_t mpg_sample_pts (demux_mpgaudio_t *this, int64_t sample) {
+  sample -= mpg_start_delay (this);
+  return sample * 90000 / this->ref_frame.freq;
+}
+
+static void *demux_mpgaudio_index_loop (void *data) {
+  demux_mpgaudio_t *this = (demux_mpgaudio_t *)data;
+  input_plugin_t *input = this->bg_input;
+  uint8_t *buf = malloc (MPA_SCAN_BUF_SIZE);
+  off_t pos, bpos = 0;
+  int blen = 0;
+  uint32_t num;
+
+  pthread_mutex_lock (&this->index_lock);
+  num = (this->index_used - 1) * MPA_INDEX_STEP;
+  pos = this->index[this->index_used - 1];
+  pthread_mutex_unlock (&this->index_lock);
+
+  /* header only scan. just check for the same stream type, and step over the payload. */
+  while (buf) {
+    mpg_audio_frame_t frame;
+
+    if ((pos < bpos) || (pos + 4 > bpos + blen)) {
+      if (input->seek (input, pos, SEEK_SET) != pos)
+        break;
+      bpos = pos;
+      blen = input->read (input, buf, MPA_SCAN_BUF_SIZE);
+      if (blen < 4)
+        break;
+    }
+    memset (&frame, 0, sizeof (frame));
+    if (!parse_frame_header (&frame, buf + (pos - bpos)) || !frame.size ||
+      (frame.version_idx != this->ref_frame.version_idx) ||
+      (frame.layer != this->ref_frame.layer) ||
+      (frame.freq != this->ref_frame.freq))
+      break;
+    if (!(num % MPA_INDEX_STEP)) {
+      int stop;
+      pthread_mutex_lock (&this->index_lock);
+      stop = this->bg_stop;
+      if (!stop)
+        mpg_index_add (this, num, pos);
+      pthread_mutex_unlock (&this->index_lock);
+      if (stop)
+        break;
+    }
+    pos += frame.size;
+    num++;
+  }
+  free (buf);
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": frame index done, %u frames.\n", num);
+  pthread_mutex_lock (&this->index_lock);
+  /* without a Vbr header, the length was a guess. now we know better,
+   * unless we did not get through (much tail data or a damaged stream). */
+  if (!this->bg_stop && !this->xing_header && !this->vbri_header && (pos + 4096 >= this->mpg_frame_end))
+    this->stream_length = (uint64_t)num * this->ref_frame.samples * 1000 / this->ref_frame.freq;
+  this->bg_state = 2;
+  pthread_mutex_unlock (&this->index_lock);
+  return NULL;
+}
+
+static void demux_mpgaudio_index_start (demux_mpgaudio_t *this) {
+  input_plugin_t *in2 = NULL;
+
+  if (this->bg_state || !this->index_used || this->ref_frame.is_free_bitrate)
+    return;
+  if (this->input->get_optional_data (this->input, &in2, INPUT_OPTIONAL_DATA_CLONE) != INPUT_OPTIONAL_SUCCESS)
+    return;
+  if (!in2)
+    return;
+  this->bg_input = in2;
+  this->bg_stop  = 0;
+  this->bg_state = 1;
+  if (pthread_create (&this->bg_thread, NULL, demux_mpgaudio_index_loop, this)) {
+    this->bg_state = 0;
+    this->bg_input = NULL;
+    in2->dispose (in2);
+  }
+}
+
+static void demux_mpgaudio_index_stop (demux_mpgaudio_t *this) {
+  void *dummy;
+
+  if (!this->bg_state)
+    return;
+  pthread_mutex_lock (&this->index_lock);
+  this->bg_stop = 1;
+  pthread_mutex_unlock (&this->index_lock);
+  pthread_join (this->bg_thread, &dummy);
+  this->bg_input->dispose (this->bg_input);
+  this->bg_input = NULL;
+  this->bg_state = 0;
+}
 
 /*
  * Parse a mp3 frame paylod
@@ -537,6 +706,7 @@ static int parse_frame_payload(demux_mpgaudio_t *this,
   buf_element_t *buf;
   off_t          frame_pos, len;
   uint64_t       pts = 0;
+  uint32_t       stream_length;
   int            payload_size = 0;
 
   frame_pos = this->input->get_current_pos(this->input) - 4;
@@ -613,12 +783,18 @@ static int parse_frame_payload(demux_mpgaudio_t *this,
   if (this->check_vbr_header) {
     this->check_vbr_header = 0;
     this->mpg_frame_start = frame_pos;
+    this->audio_start = frame_pos;
+    this->ref_frame = this->cur_frame;
+    this->frame_num = 0;
+    this->frame_num_ok = !this->cur_frame.is_free_bitrate;
+    this->seek_sample = 0;
     free(this->xing_header);
     this->xing_header = parse_xing_header(&this->cur_frame, buf->content, this->cur_frame.size);
     if (this->xing_header) {
       buf->free_buffer(buf);
       xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
               LOG_MODULE ": found Xing header at offset %"PRId64"\n", frame_pos);
+      this->audio_start = frame_pos + this->cur_frame.size;
       return 1;
     }
     _free_vbri_header(&this->vbri_header);
@@ -627,25 +803,55 @@ static int parse_frame_payload(demux_mpgaudio_t *this,
       buf->free_buffer(buf);
       xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
               LOG_MODULE ": found Vbri header at offset %"PRId64"\n", frame_pos);
+      this->audio_start = frame_pos + this->cur_frame.size;
       return 1;
     }
   }
 
   pts = (int64_t)(this->cur_time * 90.0f);
 
-  if (this->stream_length)
-    buf->extra_info->input_normpos = (this->cur_time * 65535.0f) / this->stream_length;
-
-  buf->extra_info->input_time = this->cur_time;
-  buf->pts                    = pts;
   buf->size                   = this->cur_frame.size;
   buf->type                   = BUF_AUDIO_MPEG;
   buf->decoder_info[0]        = 1;
   buf->decoder_flags          = decoder_flags | BUF_FLAG_FRAME_END;
 
-  /* send encoder padding */
-  if (this->xing_header) {
-    if (frame_pos == this->mpg_frame_start) {
+  if (this->frame_num_ok && (this->cur_frame.samples == this->ref_frame.samples)) {
+    /* we know where we are. place the frame on the sample timeline, and drop
+     * encoder delay, encoder padding, and seek preroll sample accurately. */
+    uint32_t num = this->frame_num++;
+    int64_t first = (int64_t)num * this->ref_frame.samples;
+    int64_t keep = mpg_start_delay (this), end = mpg_end_sample (this);
+    int64_t start_pad, end_pad;
+
+    if (keep < this->seek_sample)
+      keep = this->seek_sample;
+    start_pad = keep - first;
+    if (start_pad < 0)
+      start_pad = 0;
+    else if (start_pad > this->cur_frame.samples)
+      start_pad = this->cur_frame.samples;
+    end_pad = first + this->cur_frame.samples - end;
+    if (end_pad < 0)
+      end_pad = 0;
+    else if (end_pad > this->cur_frame.samples - start_pad)
+      end_pad = this->cur_frame.samples - start_pad;
+    if (start_pad || end_pad) {
+      lprintf("sending a padding of %d/%d samples.\n", (int)start_pad, (int)end_pad);
+      buf->decoder_flags |= BUF_FLAG_AUDIO_PADDING;
+      buf->decoder_info[1] = start_pad;
+      buf->decoder_info[2] = end_pad;
+    }
+    pts = mpg_sample_pts (this, first + start_pad);
+    if (pts < 0)
+      pts = 0;
+    this->cur_time = (double)pts / 90.0;
+
+    pthread_mutex_lock (&this->index_lock);
+    mpg_index_add (this, num, frame_pos);
+    pthread_mutex_unlock (&this->index_lock);
+  } else if (this->xing_header) {
+    /* send encoder padding */
+    if (frame_pos == this->audio_start) {
       lprintf("sending a start padding of %d samples.\n", this->xing_header->start_delay);
       buf->decoder_flags = buf->decoder_flags | BUF_FLAG_AUDIO_PADDING;
       buf->decoder_info[1] = this->xing_header->start_delay;
@@ -658,9 +864,19 @@ static int parse_frame_payload(demux_mpgaudio_t *this,
     }
   }
 
+  stream_length = mpg_stream_length (this);
+  if (stream_length)
+    buf->extra_info->input_normpos = (this->cur_time * 65535.0f) / stream_length;
+
+  buf->extra_info->input_time = this->cur_time;
+  buf->pts                    = pts;
+
   lprintf("send buffer: size=%d, pts=%"PRId64"\n", buf->size, pts);
   this->audio_fifo->put(this->audio_fifo, buf);
-  this->cur_time += this->cur_frame.duration;
+  if (this->frame_num_ok)
+    this->cur_time = (double)mpg_sample_pts (this, (int64_t)this->frame_num * this->ref_frame.samples) / 90.0;
+  else
+    this->cur_time += this->cur_frame.duration;
   return 1;
 }
 
@@ -762,6 +978,8 @@ static int demux_mpgaudio_next (demux_mpgaudio_t *this, int decoder_flags, int s
       if (!loose_sync) {
         off_t frame_pos = this->input->get_current_pos(this->input) - 4;
         loose_sync = 1;
+        /* frame count is no longer reliable. */
+        this->frame_num_ok = 0;
         xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
                 LOG_MODULE ": loose mp3 sync at offset %"PRId64"\n", frame_pos);
       }
@@ -940,6 +1158,17 @@ static void demux_mpgaudio_send_headers (demux_plugin_t *this_gen) {
     if (!this->stream_length && this->br) {
       this->stream_length = (this->mpg_size * 1000) / (this->br / 8);
     }
+    if (this->frame_num_ok && (mpg_end_sample (this) != INT64_MAX)) {
+      /* gapless length */
+      this->stream_length = mpg_sample_pts (this, mpg_end_sample (this)) / 90;
+    }
+
+    if (this->frame_num_ok) {
+      pthread_mutex_lock (&this->index_lock);
+      mpg_index_add (this, 0, this->audio_start);
+      pthread_mutex_unlock (&this->index_lock);
+      demux_mpgaudio_index_start (this);
+    }
 
     _x_stream_info_set(this->stream, XINE_STREAM_INFO_BITRATE, this->br);
     _x_stream_info_set(this->stream, XINE_STREAM_INFO_AUDIO_BITRATE, this->br);
@@ -1041,9 +1270,58 @@ static off_t vbri_get_seek_point(vbri_header_t *vbri, int time, int stream_lengt
   return (off_t)fx;
 }
 
+/*
+ * Sample accurate seek using the frame index.
+ * return 1 on success, 0 if the index does not cover start_time yet
+ */
+static int mpg_index_seek (demux_mpgaudio_t *this, int start_time) {
+  int64_t  sample;
+  uint32_t num, first, preroll;
+  off_t    pos;
+
+  if (!this->ref_frame.samples || !this->ref_frame.freq)
+    return 0;
+
+  sample  = (int64_t)start_time * this->ref_frame.freq / 1000 + mpg_start_delay (this);
+  num     = sample / this->ref_frame.samples;
+  preroll = (this->ref_frame.layer == 3) ? MPA_PREROLL_L3 : MPA_PREROLL;
+  first   = (num > preroll) ? num - preroll : 0;
+
+  pthread_mutex_lock (&this->index_lock);
+  if (first / MPA_INDEX_STEP >= this->index_used) {
+    pthread_mutex_unlock (&this->index_lock);
+    return 0;
+  }
+  pos = this->index[first / MPA_INDEX_STEP];
+  pthread_mutex_unlock (&this->index_lock);
+
+  /* step over the frames between index entry and first. */
+  for (num = first - first % MPA_INDEX_STEP; num < first; num++) {
+    mpg_audio_frame_t frame;
+    uint8_t head[4];
+
+    memset (&frame, 0, sizeof (frame));
+    if ((this->input->seek (this->input, pos, SEEK_SET) != pos) ||
+      (this->input->read (this->input, head, 4) != 4) ||
+      !parse_frame_header (&frame, head) || !frame.size)
+      return 0;
+    pos += frame.size;
+  }
+  if (this->input->seek (this->input, pos, SEEK_SET) != pos)
+    return 0;
+
+  lprintf("time seek: index: time=%d, frame=%u, pos=%"PRId64"\n", start_time, first, pos);
+  this->frame_num    = first;
+  this->frame_num_ok = 1;
+  this->seek_sample  = sample;
+  this->cur_time     = (double)mpg_sample_pts (this, (int64_t)first * this->ref_frame.samples) / 90.0;
+  return 1;
+}
+
 /*
  * Seeking function
- * Try to use the Vbr header if present.
+ * Use the frame index if it already covers the target.
+ * Else try to use the Vbr header if present.
  * If no Vbr header is present then use a CBR formula
  *
  * Position seek is relative to the total time of the stream, the position
@@ -1054,43 +1332,47 @@ static int demux_mpgaudio_seek (demux_plugin_t *this_gen,
 
   demux_mpgaudio_t *this = (demux_mpgaudio_t *) this_gen;
   off_t seek_pos = this->mpg_frame_start;
+  uint32_t stream_length = mpg_stream_length (this);
 
   if ((this->input->get_capabilities(this->input) & INPUT_CAP_SEEKABLE) != 0) {
     /* Convert position seek to time seek */
     if (!start_time) {
-      start_time = (int)((double)start_pos * (double)this->stream_length / 65535.0f);
+      start_time = (int)((double)start_pos * (double)stream_length / 65535.0f);
       lprintf("position seek: start_pos=%"PRId64" => start_time=%d\n", start_pos, start_time);
     }
 
     if (start_time < 0)
       start_time = 0;
-    if ((unsigned int)start_time > this->stream_length)
-      start_time = this->stream_length;
-
-    if (this->stream_length > 0) {
-      if (this->xing_header &&
-          (this->xing_header->flags & XING_TOC_FLAG)) {
-        seek_pos += xing_get_seek_point(this->xing_header, start_time, this->stream_length);
-        lprintf("time seek: xing: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
-      } else if (this->vbri_header) {
-        seek_pos += vbri_get_seek_point(this->vbri_header, start_time, this->stream_length);
-        lprintf("time seek: vbri: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
-      } else {
-        /* cbr */
-        seek_pos += ((double)start_time / 1000.0) * ((double)this->br / 8.0);
-        lprintf("time seek: cbr: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
+    if ((unsigned int)start_time > stream_length)
+      start_time = stream_length;
+
+    if (!mpg_index_seek (this, start_time)) {
+      if (stream_length > 0) {
+        if (this->xing_header &&
+            (this->xing_header->flags & XING_TOC_FLAG)) {
+          seek_pos += xing_get_seek_point(this->xing_header, start_time, stream_length);
+          lprintf("time seek: xing: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
+        } else if (this->vbri_header) {
+          seek_pos += vbri_get_seek_point(this->vbri_header, start_time, stream_length);
+          lprintf("time seek: vbri: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
+        } else {
+          /* cbr */
+          seek_pos += ((double)start_time / 1000.0) * ((double)this->br / 8.0);
+          lprintf("time seek: cbr: time=%d, pos=%"PRId64"\n", start_time, seek_pos);
+        }
       }
+      /* assume seeking is always perfect... */
+      this->cur_time = start_time;
+      this->frame_num_ok = 0;
+      this->input->seek (this->input, seek_pos, SEEK_SET);
     }
-    /* assume seeking is always perfect... */
-    this->cur_time = start_time;
-    this->input->seek (this->input, seek_pos, SEEK_SET);
     this->found_next_frame = 0;
 
     if (playing) {
       _x_demux_flush_engine(this->stream);
     }
     _x_demux_control_newpts(this->stream,
-                            (int64_t)(this->cur_time * 90.0f),
+                            (int64_t)start_time * 90,
                              (playing) ? BUF_FLAG_SEEK : 0);
   }
   this->status = DEMUX_OK;
@@ -1100,9 +1382,10 @@ static int demux_mpgaudio_seek (demux_plugin_t *this_gen,
 
 static int demux_mpgaudio_get_stream_length (demux_plugin_t *this_gen) {
   demux_mpgaudio_t *this = (demux_mpgaudio_t *) this_gen;
+  uint32_t stream_length = mpg_stream_length (this);
 
-  if (this->stream_length > 0) {
-    return this->stream_length;
+  if (stream_length > 0) {
+    return stream_length;
   } else
     return 0;
 }
@@ -1124,6 +1407,9 @@ static void demux_mpgaudio_dispose (demux_plugin_t *this_gen) {
 
   demux_mpgaudio_t *this = (demux_mpgaudio_t *) this_gen;
 
+  demux_mpgaudio_index_stop (this);
+  pthread_mutex_destroy (&this->index_lock);
+  _x_freep (&this->index);
   _free_vbri_header(&this->vbri_header);
   _x_freep(&this->xing_header);
   free(this);
@@ -1173,6 +1459,8 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   this->status      = DEMUX_FINISHED;
   this->stream      = stream;
 
+  pthread_mutex_init (&this->index_lock, NULL);
+
   this->mpg_version = version;
   this->mpg_layer   = layer;
   if (version || layer) {
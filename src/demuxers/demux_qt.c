@@ -84,6 +84,9 @@ typedef unsigned int qt_atom;
 #define TKHD_ATOM QT_ATOM('t', 'k', 'h', 'd')
 #define MDHD_ATOM QT_ATOM('m', 'd', 'h', 'd')
 #define ELST_ATOM QT_ATOM('e', 'l', 's', 't')
+#define MDIA_ATOM QT_ATOM('m', 'd', 'i', 'a')
+#define MINF_ATOM QT_ATOM('m', 'i', 'n', 'f')
+#define STBL_ATOM QT_ATOM('s', 't', 'b', 'l')
 
 /* atoms in a sample table */
 #define STSD_ATOM QT_ATOM('s', 't', 's', 'd')
@@ -257,6 +260,100 @@ typedef struct {
 #  define QTF_MEDIA_ID(f) ((f)._ffs.bytes[6])
 #endif
 
+/* Long recordings easily have millions of samples. Instead of expanding the
+ * sample tables into a qt_frame array at open time, keep the moov tables, plus
+ * a table read position every QT_INDEX_STEP samples. Then, decode blocks of
+ * QT_INDEX_STEP frames on demand. */
+#define QT_INDEX_SHIFT 8
+#define QT_INDEX_STEP  (1 << QT_INDEX_SHIFT)
+
+typedef struct {
+  uint64_t offset;     /* file offset of next sample in current chunk */
+  int64_t  pts;        /* raw dts of next sample */
+  uint32_t sample;     /* next sample number */
+  uint32_t chunk;      /* chunks used */
+  uint32_t stsc;       /* sample to chunk entries used */
+  uint32_t stsc_left;  /* chunks left in current entry */
+  int32_t  chunk_left; /* samples left in current chunk */
+  uint32_t size_pos;
+  uint32_t size_value;
+  uint32_t stts_pos;
+  uint32_t stts_left;
+  uint32_t stts_value;
+  uint32_t ctts_pos;
+  uint32_t ctts_left;
+  uint32_t ctts_value;
+  uint32_t stss_pos;
+} qt_sample_pos_t;
+
+/* a run of consecutive source samples after edit list processing. */
+typedef struct {
+  uint32_t out;        /* first frame number */
+  uint32_t src;        /* first sample number */
+  int64_t  pts;        /* dts of first frame, trak timescale */
+  int64_t  src_pts;    /* raw dts of first sample */
+  int      linear;     /* 0 (all frames use pts), 1 (pts + raw dts - src_pts) */
+} qt_edit_run_t;
+
+typedef struct {
+  /* decoder setup */
+  uint32_t         step;        /* chunk samples per frame */
+  uint32_t         size_count;
+  uint32_t         stts_count;
+  uint32_t         ctts_count;
+  int              cbr;         /* 1 frame per chunk */
+  /* number of decodable samples, and raw dts after them */
+  uint32_t         src_count;
+  int64_t          src_end_pts;
+  /* xine pts of the last frame, and after it */
+  int64_t          last_pts;
+  int64_t          end_pts;
+  /* read positions, made when first needed */
+  qt_sample_pos_t *marks;
+  uint32_t         num_marks;
+  qt_edit_run_t   *runs;
+  uint32_t         num_runs;
+  /* the decoder */
+  qt_sample_pos_t  pos;
+  uint32_t         block_first[2];
+  int              block_last;
+  qt_frame         block[2][QT_INDEX_STEP];
+} qt_sample_index_t;
+
+/* With a seekable input, a big moov atom is opened without the bulk of its
+ * chunk offset, sample size and time offset tables. The sample index only
+ * reads these sequentially from the start until playback begins. The rest is
+ * fetched in QT_MOOV_PAGE units later, during playback or when first needed.
+ * With a slow seekable input (http), every seek may be a new request, and
+ * shorter forward seeks are often done by reading through. So we skip only
+ * gaps of at least 10 MiB there, and fetch less often but more at a time. */
+#define QT_MOOV_PAGE_SHIFT     16
+#define QT_MOOV_PAGE           (1 << QT_MOOV_PAGE_SHIFT)
+#define QT_MOOV_LAZY_MIN       (4 * QT_MOOV_PAGE)
+/* background fetch this many pages every QT_MOOV_FETCH_INTERVAL chunks. */
+#define QT_MOOV_FETCH_PAGES    16
+#define QT_MOOV_FETCH_INTERVAL 32
+#define QT_MOOV_SLOW_SKIP      160
+#define QT_MOOV_SLOW_FETCH     64
+#define QT_MOOV_SLOW_INTERVAL  128
+
+typedef struct {
+  input_plugin_t *input;
+  xine_t         *xine;
+  uint8_t        *buf;       /* the moov atom */
+  off_t           offset;    /* file offset thereof */
+  uint32_t        size;
+  uint32_t        have;      /* bytes read sequentially while opening */
+  uint32_t        num_pages;
+  uint32_t        missing;   /* count of pages not yet loaded */
+  uint32_t        next;      /* first page that may be missing */
+  int             chunks;    /* send_chunk () calls until next background fetch */
+  uint32_t        skip_min;  /* smallest gap worth a seek, in pages */
+  uint32_t        fetch;     /* pages per background fetch */
+  int             interval;  /* send_chunk () calls between background fetches */
+  uint8_t        *pages;     /* 1 if missing */
+} qt_moov_t;
+
 typedef struct {
   int64_t track_duration;
   int64_t media_time;
@@ -322,6 +419,10 @@ typedef struct {
 
   /* internal frame table corresponding to this trak */
   qt_frame    *frames;
+  /* or, the compact version of it. use qt_frame_at () to access either. */
+  qt_sample_index_t *index;
+  /* the moov atom, while it is partially loaded. */
+  qt_moov_t         *moov;
   unsigned int frame_count;
   unsigned int current_frame;
 
@@ -400,6 +501,9 @@ typedef struct {
   uint32_t     normpos_shift;
 
   int64_t      moov_first_offset;
+  /* kept for the sample index */
+  uint8_t     *moov_atom;
+  qt_moov_t    moov;
 
   unsigned int trak_count;
   qt_trak     *traks;
@@ -561,6 +665,571 @@ static inline void dump_moov_atom (uint8_t *moov_atom, int moov_atom_size) {
 #endif
 }
 
+/**********************************************************************
+ * partial moov functions
+ **********************************************************************/
+
+/* read moov bytes up to end, in file order. */
+static int qt_moov_read_to (qt_moov_t *m, uint32_t end) {
+  if (end > m->size)
+    end = m->size;
+  if (end > m->have) {
+    if (m->input->read (m->input, m->buf + m->have, end - m->have) != (off_t)(end - m->have))
+      return 0;
+    m->have = end;
+  }
+  return 1;
+}
+
+/* leave out the whole pages inside a big table, except for the first. */
+static int qt_moov_skip (qt_moov_t *m, uint32_t pos, uint32_t size) {
+  uint32_t first = (pos + 20 + 2 * QT_MOOV_PAGE - 1) >> QT_MOOV_PAGE_SHIFT;
+  uint32_t last  = (pos + size) >> QT_MOOV_PAGE_SHIFT;
+  off_t    resume;
+
+  if (last < first + m->skip_min)
+    return 0;
+  if (!qt_moov_read_to (m, first << QT_MOOV_PAGE_SHIFT))
+    return -1;
+  resume = m->offset + ((off_t)last << QT_MOOV_PAGE_SHIFT);
+  if (m->input->seek (m->input, resume, SEEK_SET) != resume)
+    return -1;
+  memset (m->buf + ((size_t)first << QT_MOOV_PAGE_SHIFT), 0, (size_t)(last - first) << QT_MOOV_PAGE_SHIFT);
+  memset (m->pages + first, 1, last - first);
+  m->missing += last - first;
+  m->have = last << QT_MOOV_PAGE_SHIFT;
+  return 1;
+}
+
+/* read the moov atom, except for the bulk of stco, co64, stsz, stz2 and ctts.
+ * the atom header (hsize bytes) is already there. */
+static int qt_moov_stream (qt_moov_t *m, uint32_t hsize) {
+  uint32_t stop[5], pos = hsize;
+  int depth = 0;
+
+  m->have = hsize;
+  m->num_pages = (m->size + QT_MOOV_PAGE - 1) >> QT_MOOV_PAGE_SHIFT;
+  m->pages = calloc (1, m->num_pages);
+  if (!m->pages)
+    return 0;
+  stop[0] = m->size;
+
+  while (depth >= 0) {
+    uint32_t size, type;
+    if (pos + 8 > stop[depth]) {
+      pos = stop[depth--];
+      continue;
+    }
+    if (!qt_moov_read_to (m, pos + 8))
+      return 0;
+    size = _X_BE_32 (m->buf + pos);
+    type = _X_BE_32 (m->buf + pos + 4);
+    if ((size < 8) || (size > stop[depth] - pos))
+      size = stop[depth] - pos;
+    /* compressed moov needs all of it */
+    if ((depth == 0) && (pos == hsize) && (type == CMOV_ATOM))
+      break;
+    if ((depth < 4) && (size >= 16) &&
+      (((depth == 0) && (type == TRAK_ATOM)) ||
+       ((depth == 1) && (type == MDIA_ATOM)) ||
+       ((depth == 2) && (type == MINF_ATOM)) ||
+       ((depth == 3) && (type == STBL_ATOM)))) {
+      stop[++depth] = pos + size;
+      pos += 8;
+      continue;
+    }
+    if ((depth == 4) &&
+      ((type == STCO_ATOM) || (type == CO64_ATOM) ||
+       (type == STSZ_ATOM) || (type == STZ2_ATOM) || (type == CTTS_ATOM))) {
+      if (qt_moov_skip (m, pos, size) < 0)
+        return 0;
+    }
+    pos += size;
+  }
+
+  if (!qt_moov_read_to (m, m->size))
+    return 0;
+  if (!m->missing) {
+    free (m->pages);
+    m->pages = NULL;
+  }
+  m->chunks = m->interval;
+  return 1;
+}
+
+/* load missing pages first...last - 1, and maybe some more after them.
+ * the input read position is kept. */
+static void qt_moov_load (qt_moov_t *m, uint32_t first, uint32_t last) {
+  off_t save = m->input->get_current_pos (m->input);
+  uint32_t max = first + m->fetch;
+
+  if (max > m->num_pages)
+    max = m->num_pages;
+  if (last < max)
+    last = max;
+  if (last > m->num_pages)
+    last = m->num_pages;
+
+  while (first < last) {
+    uint32_t e, start, end;
+    if (!m->pages[first]) {
+      first++;
+      continue;
+    }
+    for (e = first + 1; (e < last) && m->pages[e]; e++) ;
+    start = first << QT_MOOV_PAGE_SHIFT;
+    end   = (e < m->num_pages) ? e << QT_MOOV_PAGE_SHIFT : m->size;
+    if ((m->input->seek (m->input, m->offset + start, SEEK_SET) != m->offset + start) ||
+        (m->input->read (m->input, m->buf + start, end - start) != (off_t)(end - start))) {
+      /* tables stay zero there. dont retry. */
+      xprintf (m->xine, XINE_VERBOSITY_DEBUG,
+        "demux_qt: failed to load moov bytes %u...%u.\n", (unsigned int)start, (unsigned int)end);
+    }
+    memset (m->pages + first, 0, e - first);
+    m->missing -= e - first;
+    first = e;
+  }
+  while ((m->next < m->num_pages) && !m->pages[m->next])
+    m->next++;
+
+  if (save >= 0)
+    m->input->seek (m->input, save, SEEK_SET);
+  if (!m->missing) {
+    xprintf (m->xine, XINE_VERBOSITY_DEBUG, "demux_qt: moov atom is complete now.\n");
+    free (m->pages);
+    m->pages = NULL;
+  }
+}
+
+static void qt_moov_load_all (qt_moov_t *m) {
+  while (m->missing)
+    qt_moov_load (m, m->next, m->num_pages);
+}
+
+/* called per send_chunk (), when pages are missing. */
+static void qt_moov_fetch_next (qt_moov_t *m) {
+  if (--m->chunks > 0)
+    return;
+  m->chunks = m->interval;
+  while ((m->next < m->num_pages) && !m->pages[m->next])
+    m->next++;
+  qt_moov_load (m, m->next, m->next + 1);
+}
+
+/* make sure the table bytes p...p + len - 1 are there. */
+static inline void qt_moov_need (qt_trak *trak, const uint8_t *p, uint32_t len) {
+  qt_moov_t *m = trak->moov;
+  if (m && m->missing) {
+    uint32_t first = (uint32_t)(p - m->buf) >> QT_MOOV_PAGE_SHIFT;
+    uint32_t last  = (uint32_t)(p - m->buf + len - 1) >> QT_MOOV_PAGE_SHIFT;
+    /* 1 and 2 byte sizes may read into the padding. */
+    if (last >= m->num_pages)
+      last = m->num_pages - 1;
+    if (m->pages[first] | m->pages[last])
+      qt_moov_load (m, first, last + 1);
+  }
+}
+
+/**********************************************************************
+ * sample index functions
+ **********************************************************************/
+
+static void qt_index_free (qt_trak *trak) {
+  if (trak->index) {
+    free (trak->index->marks);
+    free (trak->index->runs);
+    free (trak->index);
+    trak->index = NULL;
+  }
+}
+
+/* enter next non empty chunk. returns 0 at end of tables. */
+static int qt_sample_chunk (qt_trak *trak, qt_sample_pos_t *p) {
+  while (p->chunk_left <= 0) {
+    /* Iterate from the first chunk of the current table entry to
+     * the first chunk of the next table entry.
+     * Entries are 1 based.
+     * If the first chunk is in the last table entry, iterate to the
+     * final chunk number (the number of offsets in stco table). */
+    while (!p->stsc_left) {
+      const sample_to_chunk_table_t *e;
+      if (p->stsc >= trak->sample_to_chunk_count)
+        return 0;
+      e = trak->sample_to_chunk_table + p->stsc++;
+      p->stsc_left = e[1].first_chunk - e[0].first_chunk;
+    }
+    if (p->chunk >= trak->chunk_offset_count)
+      return 0;
+    p->stsc_left--;
+    if (trak->chunk_offset_table32) {
+      qt_moov_need (trak, trak->chunk_offset_table32 + 4 * p->chunk, 4);
+      p->offset = _X_BE_32 (trak->chunk_offset_table32 + 4 * p->chunk);
+    } else {
+      qt_moov_need (trak, trak->chunk_offset_table64 + 8 * p->chunk, 8);
+      p->offset = _X_BE_64 (trak->chunk_offset_table64 + 8 * p->chunk);
+    }
+    p->chunk++;
+    p->chunk_left = trak->index->cbr ? 1 : (int32_t)trak->sample_to_chunk_table[p->stsc - 1].samples_per_chunk;
+  }
+  return 1;
+}
+
+/* advance a stts/ctts like table by n samples. an empty entry lasts forever. */
+static void qt_run_skip (qt_trak *trak, const uint8_t *table, uint32_t count,
+  uint32_t *pos, uint32_t *left, uint32_t *value, int64_t *pts, uint32_t n) {
+  while (n) {
+    uint32_t m;
+    if (!*left && (*pos < count)) {
+      const uint8_t *t = table + 8 * (*pos)++;
+      qt_moov_need (trak, t, 8);
+      *left  = _X_BE_32 (t);
+      *value = _X_BE_32 (t + 4);
+    }
+    m = (*left && (*left < n)) ? *left : n;
+    if (pts)
+      *pts += (int64_t)m * *value;
+    *left -= m;
+    n -= m;
+  }
+}
+
+/* find first sync sample table entry >= fr, starting at entry l. */
+static uint32_t qt_stss_find (qt_trak *trak, uint32_t l, uint32_t fr) {
+  uint32_t r = trak->sync_sample_count;
+  while (l < r) {
+    uint32_t m = (l + r) >> 1;
+    if (_X_BE_32 (trak->sync_sample_table + 4 * m) < fr)
+      l = m + 1;
+    else
+      r = m;
+  }
+  return l;
+}
+
+/* advance p by up to n samples. sizes are only read inside the final chunk.
+ * returns the count of samples skipped. */
+static uint32_t qt_sample_skip (qt_trak *trak, qt_sample_pos_t *p, uint32_t n) {
+  qt_sample_index_t *idx = trak->index;
+  uint32_t done = 0;
+
+  while (done < n) {
+    uint32_t k, left;
+    if (!qt_sample_chunk (trak, p))
+      break;
+    left = ((uint32_t)p->chunk_left + idx->step - 1) / idx->step;
+    k = n - done;
+    if (k > left)
+      k = left;
+    if (idx->cbr) {
+      p->pts += trak->sample_to_chunk_table[p->stsc - 1].samples_per_chunk;
+    } else {
+      if (k < left) {
+        /* we stop inside this chunk, and need the offset there. */
+        uint32_t i;
+        for (i = 0; i < k; i++) {
+          if (p->size_pos < idx->size_count) {
+            qt_moov_need (trak, trak->sample_size_table + p->size_pos * trak->sample_size_bytes, 4);
+            p->size_value = _X_BE_32 (trak->sample_size_table + p->size_pos * trak->sample_size_bytes)
+                          >> trak->sample_size_shift;
+            p->size_pos++;
+          }
+          p->offset += p->size_value;
+        }
+      } else if (p->size_pos < idx->size_count) {
+        uint32_t m = idx->size_count - p->size_pos;
+        if (m > k)
+          m = k;
+        p->size_pos += m;
+        qt_moov_need (trak, trak->sample_size_table + (p->size_pos - 1) * trak->sample_size_bytes, 4);
+        p->size_value = _X_BE_32 (trak->sample_size_table + (p->size_pos - 1) * trak->sample_size_bytes)
+                      >> trak->sample_size_shift;
+      }
+      qt_run_skip (trak, trak->time_to_sample_table, idx->stts_count,
+        &p->stts_pos, &p->stts_left, &p->stts_value, &p->pts, k);
+      qt_run_skip (trak, trak->timeoffs_to_sample_table, idx->ctts_count,
+        &p->ctts_pos, &p->ctts_left, &p->ctts_value, NULL, k);
+    }
+    p->sample += k;
+    p->chunk_left -= k * idx->step;
+    done += k;
+  }
+  if (trak->sync_sample_table && done)
+    p->stss_pos = qt_stss_find (trak, p->stss_pos, p->sample + 1);
+  return done;
+}
+
+/* advance sample number and raw dts only. the result is not good for qt_sample_step (). */
+static void qt_time_skip (qt_trak *trak, qt_sample_pos_t *p, uint32_t n) {
+  if (trak->index->cbr) {
+    qt_sample_skip (trak, p, n);
+    return;
+  }
+  qt_run_skip (trak, trak->time_to_sample_table, trak->index->stts_count,
+    &p->stts_pos, &p->stts_left, &p->stts_value, &p->pts, n);
+  p->sample += n;
+}
+
+/* count samples from p until the first one with raw dts > pts, up to max. */
+static uint32_t qt_sample_count_to (qt_trak *trak, const qt_sample_pos_t *p, int64_t pts, uint32_t max) {
+  qt_sample_index_t *idx = trak->index;
+  uint32_t pos = p->stts_pos, left = p->stts_left, value = p->stts_value, m = 0;
+  int64_t  dts = p->pts;
+
+  if (idx->cbr) {
+    /* chunks may differ in duration, just walk. */
+    qt_sample_pos_t q = *p;
+    while ((q.pts <= pts) && (m < max) && qt_sample_skip (trak, &q, 1))
+      m++;
+    return m;
+  }
+  while ((dts <= pts) && (m < max)) {
+    uint64_t need;
+    if (!left && (pos < idx->stts_count)) {
+      const uint8_t *t = trak->time_to_sample_table + 8 * pos++;
+      left  = _X_BE_32 (t);
+      value = _X_BE_32 (t + 4);
+    }
+    need = value ? (uint64_t)(pts - dts) / value + 1 : ~(uint64_t)0;
+    if (left && (need > left))
+      need = left;
+    if (need > max - m)
+      need = max - m;
+    dts  += (int64_t)need * value;
+    left -= need;
+    m    += need;
+  }
+  return m;
+}
+
+/* get raw sample at p, and advance p. returns 0 at end of tables. */
+static int qt_sample_step (qt_trak *trak, qt_sample_pos_t *p, qt_frame *f) {
+  qt_sample_index_t *idx = trak->index;
+  const sample_to_chunk_table_t *e;
+
+  if (!qt_sample_chunk (trak, p))
+    return 0;
+  e = trak->sample_to_chunk_table + p->stsc - 1;
+
+  f->_ffs.offset = p->offset;
+  QTF_MEDIA_ID(f[0]) = e->media_id;
+
+  if (idx->cbr) {
+    /* the chunk size is actually the audio frame count */
+    uint32_t duration = e->samples_per_chunk;
+    f->size = (duration * trak->properties->s.audio.channels)
+            / trak->properties->s.audio.samples_per_frame
+            * trak->properties->s.audio.bytes_per_frame;
+    f->pts = p->pts;
+    p->pts += duration;
+    f->ptsoffs = 0;
+    QTF_KEYFRAME(f[0]) = 0;
+  } else {
+    /* far most files use 4 byte sizes, optimize for them.
+     * for others, moov buffer is safety padded. */
+    if (p->size_pos < idx->size_count) {
+      qt_moov_need (trak, trak->sample_size_table + p->size_pos * trak->sample_size_bytes, 4);
+      p->size_value = _X_BE_32 (trak->sample_size_table + p->size_pos * trak->sample_size_bytes)
+                    >> trak->sample_size_shift;
+      p->size_pos++;
+    }
+    f->size = p->size_value;
+    p->offset += p->size_value;
+
+    /* figure out the pts situation */
+    if (!p->stts_left && (p->stts_pos < idx->stts_count)) {
+      const uint8_t *t = trak->time_to_sample_table + 8 * p->stts_pos++;
+      p->stts_left  = _X_BE_32 (t);
+      p->stts_value = _X_BE_32 (t + 4);
+    }
+    f->pts = p->pts;
+    p->pts += p->stts_value;
+    p->stts_left--;
+
+    /* offset pts for reordered video */
+    if (!p->ctts_left && (p->ctts_pos < idx->ctts_count)) {
+      const uint8_t *t = trak->timeoffs_to_sample_table + 8 * p->ctts_pos++;
+      qt_moov_need (trak, t, 8);
+      p->ctts_left  = _X_BE_32 (t);
+      p->ctts_value = _X_BE_32 (t + 4);
+    }
+    /* TJ. this is 32 bit signed. */
+    f->ptsoffs = (int32_t)p->ctts_value;
+    p->ctts_left--;
+
+    /* if there is no stss (sample sync) table, make all of the frames keyframes. */
+    if (trak->sync_sample_table) {
+      uint32_t fr = p->sample + 1, v = 0;
+      while ((p->stss_pos < trak->sync_sample_count)
+        && ((v = _X_BE_32 (trak->sync_sample_table + 4 * p->stss_pos)) < fr))
+        p->stss_pos++;
+      QTF_KEYFRAME(f[0]) = (p->stss_pos < trak->sync_sample_count) && (v == fr);
+    } else {
+      QTF_KEYFRAME(f[0]) = 1;
+    }
+  }
+
+  p->sample++;
+  p->chunk_left -= idx->step;
+  return 1;
+}
+
+/* make read positions up to number k. */
+static void qt_index_mark (qt_trak *trak, uint32_t k) {
+  qt_sample_index_t *idx = trak->index;
+  while (idx->num_marks <= k) {
+    qt_sample_pos_t q = idx->marks[idx->num_marks - 1];
+    qt_sample_skip (trak, &q, QT_INDEX_STEP);
+    idx->marks[idx->num_marks++] = q;
+  }
+}
+
+/* set p to sample n. */
+static void qt_index_seek (qt_trak *trak, qt_sample_pos_t *p, uint32_t n) {
+  qt_sample_index_t *idx = trak->index;
+  uint32_t k = n >> QT_INDEX_SHIFT;
+  if ((n < p->sample) || (k > (p->sample >> QT_INDEX_SHIFT))) {
+    qt_index_mark (trak, k);
+    *p = idx->marks[k];
+  }
+  qt_sample_skip (trak, p, n - p->sample);
+}
+
+/* get raw sample n. returns 0 if there is none. */
+static int qt_sample_get (qt_trak *trak, qt_sample_pos_t *p, uint32_t n, qt_frame *f) {
+  qt_sample_index_t *idx = trak->index;
+
+  if (n >= idx->src_count)
+    return 0;
+  qt_index_seek (trak, p, n);
+  if ((p->sample != n) || !qt_sample_step (trak, p, f))
+    return 0;
+  /* got next read position for free. */
+  if (!(p->sample & (QT_INDEX_STEP - 1)) && ((p->sample >> QT_INDEX_SHIFT) == idx->num_marks)
+    && (p->sample < idx->src_count))
+    idx->marks[idx->num_marks++] = *p;
+  return 1;
+}
+
+/* pts of frame n, without decoding it. */
+static int64_t qt_index_pts (qt_trak *trak, uint32_t n) {
+  qt_sample_index_t *idx = trak->index;
+  const qt_edit_run_t *r = NULL;
+  qt_sample_pos_t t;
+  int64_t pts;
+  uint32_t k;
+
+  if (idx->num_runs) {
+    r = idx->runs + idx->num_runs - 1;
+    while ((r > idx->runs) && (r->out > n))
+      r--;
+    if (!r->linear) {
+      pts = r->pts;
+      scale_int_do (&trak->si, &pts);
+      return pts;
+    }
+    n = r->src + (n - r->out);
+  }
+  k = n >> QT_INDEX_SHIFT;
+  if (k >= idx->num_marks)
+    k = idx->num_marks - 1;
+  t = idx->marks[k];
+  qt_time_skip (trak, &t, n - t.sample);
+  pts = r ? r->pts + t.pts - r->src_pts : t.pts;
+  scale_int_do (&trak->si, &pts);
+  return pts;
+}
+
+static void qt_index_decode_block (qt_trak *trak, int b, uint32_t first) {
+  qt_sample_index_t *idx = trak->index;
+  qt_frame *f = idx->block[b];
+  const qt_edit_run_t *r = idx->runs, *e = r + idx->num_runs;
+  uint32_t n, end = first + QT_INDEX_STEP;
+
+  if (end > trak->frame_count + 1)
+    end = trak->frame_count + 1;
+  if (r) {
+    /* find run. */
+    const qt_edit_run_t *l = r + 1, *m;
+    while (l < e) {
+      m = l + ((e - l) >> 1);
+      if (m->out <= first)
+        r = m, l = m + 1;
+      else
+        e = m;
+    }
+    e = idx->runs + idx->num_runs;
+  }
+
+  for (n = first; n < end; n++, f++) {
+    uint32_t src = n;
+    if (r) {
+      while ((r + 1 < e) && (r[1].out <= n))
+        r++;
+      src = r->src + (n - r->out);
+    }
+    if ((r && (n >= trak->frame_count)) || !qt_sample_get (trak, &idx->pos, src, f)) {
+      /* convenience frame */
+      memset (f, 0, sizeof (*f));
+      f->pts = idx->end_pts;
+      continue;
+    }
+    if (r)
+      f->pts = r->linear ? r->pts + f->pts - r->src_pts : r->pts;
+    scale_int_do (&trak->si, &f->pts);
+    f->ptsoffs = (f->ptsoffs * trak->ptsoffs_mul) >> 12;
+  }
+  idx->block_first[b] = first;
+}
+
+static qt_frame *qt_index_frame (qt_trak *trak, uint32_t n) {
+  qt_sample_index_t *idx = trak->index;
+  uint32_t first = n & ~(QT_INDEX_STEP - 1);
+  int b = idx->block_last;
+
+  if (idx->block_first[b] != first) {
+    /* keep the most recent block valid, callers may still use it. */
+    b ^= 1;
+    if (idx->block_first[b] != first)
+      qt_index_decode_block (trak, b, first);
+    idx->block_last = b;
+  }
+  return idx->block[b] + (n - first);
+}
+
+/* frame n, valid until the next call for another trak block. */
+static inline qt_frame *qt_frame_at (qt_trak *trak, uint32_t n) {
+  return trak->frames ? trak->frames + n : qt_index_frame (trak, n);
+}
+
+/* pts after the last frame. avoids decoding the final block if possible. */
+static int64_t qt_end_pts (qt_trak *trak) {
+  if (trak->index && (trak->index->num_runs || (trak->frame_count >= trak->index->src_count)))
+    return trak->index->end_pts;
+  return qt_frame_at (trak, trak->frame_count)->pts;
+}
+
+/* seek helper, does not need to decode near the end. */
+static int64_t qt_last_pts (qt_trak *trak) {
+  return trak->frames ? trak->frames[trak->frame_count - 1].pts : trak->index->last_pts;
+}
+
+/* fragment mode appends to a real frame table. */
+static int qt_index_expand (qt_trak *trak) {
+  qt_frame *frames;
+  uint32_t n;
+
+  if (!trak->index)
+    return 1;
+  frames = malloc ((trak->frame_count + 1) * sizeof (*frames));
+  if (!frames)
+    return 0;
+  for (n = 0; n <= trak->frame_count; n++)
+    frames[n] = *qt_index_frame (trak, n);
+  qt_index_free (trak);
+  trak->frames = frames;
+  return 1;
+}
+
 /**********************************************************************
  * lazyqt functions
  **********************************************************************/
@@ -590,6 +1259,8 @@ static void reset_qt_info (demux_qt_t *this) {
   this->qt.fragbuf_size      = 0;
   this->qt.fragment_buf      = NULL;
   this->qt.fragment_next     = 0;
+  this->qt.moov_atom         = NULL;
+  memset (&this->qt.moov, 0, sizeof (this->qt.moov));
 #else
   memset (&this->qt, 0, sizeof (this->qt));
 #endif
@@ -614,6 +1285,7 @@ static void free_qt_info (demux_qt_t *this) {
     unsigned int i;
     for (i = 0; i < this->qt.trak_count; i++) {
       free (this->qt.traks[i].frames);
+      qt_index_free (&this->qt.traks[i]);
       free (this->qt.traks[i].edit_list_table);
       free (this->qt.traks[i].sample_to_chunk_table);
       if (this->qt.traks[i].type == MEDIA_AUDIO) {
@@ -632,6 +1304,8 @@ static void free_qt_info (demux_qt_t *this) {
     free (this->qt.references);
   }
   free (this->qt.fragment_buf);
+  free (this->qt.moov_atom);
+  free (this->qt.moov.pages);
   free (this->qt.base_mrl);
   free (this->qt.artist);
   free (this->qt.name);
@@ -862,6 +1536,8 @@ static qt_error parse_trak_atom (qt_trak *trak, uint8_t *trak_atom) {
   trak->timeoffs_to_sample_count = 0;
   trak->timeoffs_to_sample_table = NULL;
   trak->frames = NULL;
+  trak->index = NULL;
+  trak->moov = NULL;
   trak->frame_count = 0;
   trak->current_frame = 0;
   trak->flags = 0;
@@ -1645,8 +2321,17 @@ static void qt_keyframes_simple_add (qt_trak *trak, qt_frame *f) {
   }
 }
 
+static int qt_stss_cmp (const void *a, const void *b) {
+  uint32_t va = _X_BE_32 (a), vb = _X_BE_32 (b);
+  return va < vb ? -1 : va > vb ? 1 : 0;
+}
+
 static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale) {
 
+  qt_sample_index_t *idx;
+  qt_sample_pos_t p;
+  uint32_t n, frame_count;
+
   if ((trak->type != MEDIA_VIDEO) &&
       (trak->type != MEDIA_AUDIO))
     return QT_OK;
@@ -1674,13 +2359,33 @@ static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale)
     }
   }
 
+  /* the sample index reads sync samples in order. */
+  if (trak->sync_sample_count > 1) {
+    uint8_t *q = trak->sync_sample_table;
+    for (n = 1; n < trak->sync_sample_count; n++) {
+      if (_X_BE_32 (q + 4 * n) < _X_BE_32 (q + 4 * n - 4)) {
+        qsort (q, trak->sync_sample_count, 4, qt_stss_cmp);
+        break;
+      }
+    }
+  }
+
+  trak->frame_count = 0;
+  trak->current_frame = 0;
+  if (!trak->chunk_offset_count || !trak->sample_to_chunk_count)
+    return QT_OK;
+
+  idx = calloc (1, sizeof (*idx));
+  if (!idx)
+    return QT_NO_MEMORY;
+  trak->index = idx;
+  idx->block_first[0] = idx->block_first[1] = 1; /* invalid */
+  memset (&p, 0, sizeof (p));
+
   /* AUDIO and OTHER frame types follow the same rules; VIDEO and vbr audio
    * frame types follow a different set */
   if ((trak->type == MEDIA_VIDEO) ||
       ((trak->type == MEDIA_AUDIO) && (trak->properties->s.audio.vbr))) {
-    /* maintain counters for each of the subtracks within the trak */
-    int *media_id_counts = NULL;
-    qt_frame *frame;
     unsigned int samples_per_frame;
 
     /* test for legacy compressed audio */
@@ -1694,197 +2399,72 @@ static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale)
       samples_per_frame = 1;
 
     /* figure out # of samples */
-    trak->frame_count = 0;
     {
       unsigned int u;
       int n = trak->chunk_offset_count;
-      if (!n)
-        return QT_OK;
-      if (!trak->sample_to_chunk_count)
-        return QT_OK;
+      frame_count = 0;
       for (u = 0; u + 1 < trak->sample_to_chunk_count; u++) {
         int j, s = trak->sample_to_chunk_table[u].samples_per_chunk;
-        if ((samples_per_frame != 1) && (s % samples_per_frame))
-          return QT_OK; /* unaligned chunk, should not happen */
+        if ((samples_per_frame != 1) && (s % samples_per_frame)) {
+          /* unaligned chunk, should not happen */
+          qt_index_free (trak);
+          return QT_OK;
+        }
         j = trak->sample_to_chunk_table[u + 1].first_chunk -
             trak->sample_to_chunk_table[u].first_chunk;
         if (j > n)
           j = n;
-        trak->frame_count += j * s;
+        frame_count += j * s;
         n -= j;
       }
-      trak->frame_count += n * trak->sample_to_chunk_table[u].samples_per_chunk;
+      frame_count += n * trak->sample_to_chunk_table[u].samples_per_chunk;
     }
-    trak->frame_count = (trak->frame_count + samples_per_frame - 1) / samples_per_frame;
-    if (!trak->frame_count)
-      return QT_OK;
-
-    /* 1 more for convenient end marker. */
-    trak->frames = malloc ((trak->frame_count + 1) * sizeof (qt_frame));
-    if (!trak->frames)
-      return QT_NO_MEMORY;
-    frame = trak->frames;
-    frame->pts = 0;
-    trak->current_frame = 0;
+    frame_count = (frame_count + samples_per_frame - 1) / samples_per_frame;
+
+    idx->step       = samples_per_frame;
+    idx->size_count = trak->sample_size_count;
+    idx->stts_count = trak->time_to_sample_count;
+    idx->ctts_count = trak->timeoffs_to_sample_count;
+    p.size_value    = trak->sample_size;
+    p.stts_value    = 1;
+    if (samples_per_frame != 1) {
+      /* Old style demuxing. Tweak our frame builder.
+       * Treating whole chunks as frames would be faster, but unfortunately
+       * some ffmpeg decoders dont like multiple frames in one go. */
+      idx->size_count = 0;
+      idx->stts_count = 0;
+      idx->ctts_count = 0;
+      p.size_value    = trak->properties->s.audio.bytes_per_frame;
+      p.stts_value    = samples_per_frame;
+      trak->samples = _X_BE_32 (trak->time_to_sample_table) / samples_per_frame;
+    }
+  } else { /* trak->type == MEDIA_AUDIO */
+    /* in this case, the total number of frames is equal to the number of chunks */
+    frame_count = trak->chunk_offset_count;
+    idx->cbr  = 1;
+    idx->step = 1;
+  }
 
-    media_id_counts = calloc (trak->stsd_atoms_count + 1, sizeof (int));
+  /* decide which video properties atom to use */
+  if (!idx->cbr && frame_count) {
+    int *media_id_counts = calloc (trak->stsd_atoms_count + 1, sizeof (int));
     if (!media_id_counts) {
-      free (trak->frames);
-      trak->frames = NULL;
+      qt_index_free (trak);
       return QT_NO_MEMORY;
     }
-
     {
-      unsigned int u;
-      /* initialize more accounting variables */
-      /* file position */
-      const uint8_t *o      = trak->chunk_offset_table32 ?
-                              trak->chunk_offset_table32 : trak->chunk_offset_table64;
-      uint64_t offset_value = 0;
-      /* size */
-      const uint8_t *s    = trak->sample_size_table;
-      uint32_t size_left  = trak->sample_size_count;
-      uint32_t size_value = trak->sample_size;
-      /* sample duration */
-      const uint8_t *p            = trak->time_to_sample_table;
-      uint32_t duration_left      = trak->time_to_sample_count;
-      uint32_t duration_countdown = 0;
-      uint32_t duration_value     = 1;
-      int64_t  pts_value          = 0;
-      /* used by reordered video */
-      const uint8_t *q           = trak->timeoffs_to_sample_table;
-      uint32_t ptsoffs_left      = trak->timeoffs_to_sample_count;
-      uint32_t ptsoffs_countdown = 0;
-      int32_t  ptsoffs_value     = 0;
-
-      if (samples_per_frame != 1) {
-        /* Old style demuxing. Tweak our frame builder.
-         * Treating whole chunks as frames would be faster, but unfortunately
-         * some ffmpeg decoders dont like multiple frames in one go. */
-        size_left = 0;
-        size_value = trak->properties->s.audio.bytes_per_frame;
-        duration_left = 0;
-        duration_value = samples_per_frame;
-        ptsoffs_left = 0;
-        trak->samples = _X_BE_32 (trak->time_to_sample_table) / samples_per_frame;
-      }
-
-      /* iterate through each start chunk in the stsc table */
+      unsigned int u, left = trak->chunk_offset_count;
       for (u = 0; u < trak->sample_to_chunk_count; u++) {
-        unsigned int keyframe_default = trak->sync_sample_table ? 0 : 1;
-        unsigned int media_id         = trak->sample_to_chunk_table[u].media_id;
-        int _samples_per_chunk        = trak->sample_to_chunk_table[u].samples_per_chunk;
-        unsigned int sn;
-        /* Iterate from the first chunk of the current table entry to
-         * the first chunk of the next table entry.
-         * Entries are 1 based.
-         * If the first chunk is in the last table entry, iterate to the
-         * final chunk number (the number of offsets in stco table). */
-        sn = trak->sample_to_chunk_table[u + 1].first_chunk
-           - trak->sample_to_chunk_table[u].first_chunk;
-        /* iterate through each sample in a chunk */
-        while (sn--) {
-
-          int samples_per_chunk = _samples_per_chunk;
-
-          if (trak->chunk_offset_table32)
-            offset_value = _X_BE_32 (o), o += 4;
-          else
-            offset_value = _X_BE_64 (o), o += 8;
-
-          while (samples_per_chunk > 0) {
-
-            /* figure out the offset and size.
-             * far most files use 4 byte sizes, optimize for them.
-             * for others, moov buffer is safety padded. */
-            if (size_left) {
-              size_value = _X_BE_32 (s);
-              s += trak->sample_size_bytes;
-              size_value >>= trak->sample_size_shift;
-              size_left--;
-            }
-            frame->_ffs.offset = offset_value;
-            frame->size = size_value;
-            offset_value += size_value;
-
-            /* media id accounting */
-            QTF_MEDIA_ID(frame[0]) = media_id;
-            media_id_counts[media_id] += 1;
-
-            /* if there is no stss (sample sync) table, make all of the frames
-             * keyframes; otherwise, clear the keyframe bits for now */
-            QTF_KEYFRAME(frame[0]) = keyframe_default;
-
-            /* figure out the pts situation */
-            if (!duration_countdown && duration_left) {
-              duration_countdown = _X_BE_32 (p); p += 4;
-              duration_value     = _X_BE_32 (p); p += 4;
-              duration_left--;
-            }
-            frame->pts = pts_value;
-            pts_value += duration_value;
-            duration_countdown--;
-
-            /* offset pts for reordered video */
-            if (!ptsoffs_countdown && ptsoffs_left) {
-              unsigned int v;
-              ptsoffs_countdown = _X_BE_32 (q); q += 4;
-              v                 = _X_BE_32 (q); q += 4;
-              /* TJ. this is 32 bit signed. */
-              ptsoffs_value = v;
-              if ((sizeof (int) > 4) && (ptsoffs_value & 0x80000000))
-                ptsoffs_value |= ~0xffffffffL;
-              ptsoffs_left--;
-            }
-            frame->ptsoffs = ptsoffs_value;
-            ptsoffs_countdown--;
-
-            if (!trak->edit_list_count) {
-              scale_int_do (&trak->si, &frame->pts);
-              frame->ptsoffs = (frame->ptsoffs * trak->ptsoffs_mul) >> 12;
-            }
-
-            frame++;
-            samples_per_chunk -= samples_per_frame;
-          }
-        }
+        const sample_to_chunk_table_t *e = trak->sample_to_chunk_table + u;
+        unsigned int c = e[1].first_chunk - e[0].first_chunk;
+        int s = e[0].samples_per_chunk;
+        if (c > left)
+          c = left;
+        left -= c;
+        if (s > 0)
+          media_id_counts[e[0].media_id] += c * ((s + idx->step - 1) / idx->step);
       }
-      /* provide append time for fragments */
-      trak->fragment_dts = pts_value;
-      /* convenience frame */
-      frame->pts = pts_value;
-      if (!trak->edit_list_count)
-        scale_int_do (&trak->si, &frame->pts);
     }
-
-    /* was the last chunk incomplete? */
-    if (trak->samples && (trak->samples < trak->frame_count))
-      trak->frame_count = trak->samples;
-
-    /* fill in the keyframe information */
-    qt_keyframes_size (trak, trak->sync_sample_count);
-    if (!trak->edit_list_count && (trak->keyframes_size >= trak->sync_sample_count)) {
-      unsigned int u;
-      uint8_t *p = trak->sync_sample_table;
-      for (u = 0; u < trak->sync_sample_count; u++) {
-        unsigned int fr = _X_BE_32 (p); p += 4;
-        if ((fr > 0) && (fr <= trak->frame_count)) {
-          QTF_KEYFRAME(trak->frames[fr - 1]) = 1;
-          /* we already have xine pts, register them */
-          qt_keyframes_simple_add (trak, trak->frames + fr - 1);
-        }
-      }
-    } else {
-      unsigned int u;
-      uint8_t *p = trak->sync_sample_table;
-      for (u = 0; u < trak->sync_sample_count; u++) {
-        unsigned int fr = _X_BE_32 (p); p += 4;
-        if ((fr > 0) && (fr <= trak->frame_count))
-          QTF_KEYFRAME(trak->frames[fr - 1]) = 1;
-      }
-    }
-
-    /* decide which video properties atom to use */
     {
       unsigned int u;
       int atom_to_use = 0;
@@ -1893,84 +2473,106 @@ static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale)
           atom_to_use = u;
       trak->properties = &trak->stsd_atoms[atom_to_use];
     }
-    free(media_id_counts);
-
-  } else { /* trak->type == MEDIA_AUDIO */
-
-    unsigned int u;
-    int64_t pts_value = 0;
-    const uint8_t *p = trak->chunk_offset_table32 ?
-                       trak->chunk_offset_table32 : trak->chunk_offset_table64;
-    /* in this case, the total number of frames is equal to the number of chunks */
-    trak->frame_count = trak->chunk_offset_count;
-    trak->frames = malloc ((trak->frame_count + 1) * sizeof (qt_frame));
-    if (!trak->frames)
-      return QT_NO_MEMORY;
-    trak->frames[0].pts = 0;
+    free (media_id_counts);
+  }
 
-    /* iterate through each start chunk in the stsc table */
+  /* count what the chunk tables really yield. */
+  {
+    uint64_t total = 0;
+    unsigned int u, left = trak->chunk_offset_count;
     for (u = 0; u < trak->sample_to_chunk_count; u++) {
-      uint32_t media_id = trak->sample_to_chunk_table[u].media_id;
-      /* the chunk size is actually the audio frame count */
-      uint32_t duration = trak->sample_to_chunk_table[u].samples_per_chunk;
-      uint32_t fsize    = (duration * trak->properties->s.audio.channels)
-                        / trak->properties->s.audio.samples_per_frame
-                        * trak->properties->s.audio.bytes_per_frame;
-      /* iterate through each sample in a chunk and fill in size and
-       * pts information */
-      qt_frame *af = trak->frames + trak->sample_to_chunk_table[u].first_chunk - 1;
-      /* Iterate from the first chunk of the current table entry to
-       * the first chunk of the next table entry.
-       * Entries are 1 based.
-       * If the first chunk is in the last table entry, iterate to the
-       * final chunk number (the number of offsets in stco table) */
-      unsigned int sn = trak->sample_to_chunk_table[u + 1].first_chunk
-                      - trak->sample_to_chunk_table[u].first_chunk;
-      while (sn--) {
-
-        /* figure out the pts for this chunk */
-        af->pts = pts_value;
-        if (!trak->edit_list_count) {
-          scale_int_do (&trak->si, &af->pts);
-        }
-        pts_value += duration;
-        af->ptsoffs = 0;
-
-        if (trak->chunk_offset_table32)
-          af->_ffs.offset = _X_BE_32 (p), p += 4;
-        else
-          af->_ffs.offset = _X_BE_64 (p), p += 8;
-
-        /* fetch the alleged chunk size according to the QT header */
-        af->size = fsize;
+      const sample_to_chunk_table_t *e = trak->sample_to_chunk_table + u;
+      unsigned int c = e[1].first_chunk - e[0].first_chunk;
+      int s = e[0].samples_per_chunk;
+      if (c > left)
+        c = left;
+      left -= c;
+      if (idx->cbr) {
+        total += c;
+        idx->src_end_pts += (int64_t)c * e[0].samples_per_chunk;
+      } else if (s > 0) {
+        total += (uint64_t)c * ((s + idx->step - 1) / idx->step);
+      }
+    }
+    if (total < frame_count)
+      frame_count = total;
+  }
+  if (!frame_count) {
+    qt_index_free (trak);
+    return QT_OK;
+  }
+  /* the read positions are made when first needed. */
+  idx->marks = malloc (((frame_count + QT_INDEX_STEP - 1) >> QT_INDEX_SHIFT) * sizeof (*idx->marks));
+  if (!idx->marks) {
+    qt_index_free (trak);
+    return QT_NO_MEMORY;
+  }
+  idx->marks[0]  = p;
+  idx->num_marks = 1;
+  idx->pos       = p;
+  idx->src_count = frame_count;
+  if (!idx->cbr) {
+    qt_time_skip (trak, &p, frame_count);
+    idx->src_end_pts = p.pts;
+  }
+  idx->end_pts = idx->src_end_pts;
+  scale_int_do (&trak->si, &idx->end_pts);
+  /* provide append time for fragments */
+  trak->fragment_dts = idx->src_end_pts;
 
-        /* media id accounting */
-        QTF_MEDIA_ID(af[0]) = media_id;
-        QTF_KEYFRAME(af[0]) = 0;
+  /* was the last chunk incomplete? */
+  if (!idx->cbr && trak->samples && (trak->samples < frame_count))
+    frame_count = trak->samples;
+  trak->frame_count = frame_count;
 
-        af++;
-      }
-      /* convenience frame */
-      af->pts = pts_value;
-      if (!trak->edit_list_count) {
-        scale_int_do (&trak->si, &af->pts);
+  if (!idx->cbr) {
+    qt_keyframes_size (trak, trak->sync_sample_count);
+    if (!trak->edit_list_count && (trak->keyframes_size >= trak->sync_sample_count)) {
+      /* we already have xine pts, register them */
+      uint8_t *q = trak->sync_sample_table;
+      p = idx->marks[0];
+      for (n = 0; n < trak->sync_sample_count; n++) {
+        unsigned int fr = _X_BE_32 (q); q += 4;
+        if ((fr > 0) && (fr <= trak->frame_count)) {
+          qt_frame f;
+          qt_time_skip (trak, &p, fr - 1 - p.sample);
+          f.pts = p.pts;
+          scale_int_do (&trak->si, &f.pts);
+          qt_keyframes_simple_add (trak, &f);
+        }
       }
     }
-    /* provide append time for fragments */
-    trak->fragment_dts = pts_value;
   }
 
-  if (trak->frame_count && trak->edit_list_count) {
+  if (trak->edit_list_count) {
     /* Fix up pts information w.r.t. the edit list table.
      * Supported: initial trak delay, gaps, and skipped intervals.
      * Not supported: repeating and reordering intervals.
-     * Also, make xine timestamps right here and avoid an extra pass. */
+     * This yields 1 or 2 runs of frames per edit. */
     uint32_t edit_list_index;
     uint32_t use_keyframes = trak->sync_sample_count && (trak->keyframes_size >= trak->sync_sample_count);
-    int64_t  edit_list_pts = 0, edit_list_duration = 0;
-    qt_frame *sf = trak->frames, *tf = sf, *ef = sf + trak->frame_count;
+    int64_t  edit_list_pts = 0, edit_list_duration = 0, ef_pts;
+    uint32_t sf = 0, tf = 0, ef = trak->frame_count;
+    qt_edit_run_t *r;
+
+    r = idx->runs = malloc (2 * trak->edit_list_count * sizeof (*idx->runs));
+    if (!r) {
+      qt_index_free (trak);
+      trak->frame_count = 0;
+      return QT_NO_MEMORY;
+    }
+    p = idx->marks[0];
+    {
+      qt_sample_pos_t q = p;
+      qt_time_skip (trak, &q, ef);
+      ef_pts = q.pts;
+    }
+
     for (edit_list_index = 0; edit_list_index < trak->edit_list_count; edit_list_index++) {
-      int64_t edit_list_media_time, offs = 0;
+      int64_t edit_list_media_time, offs = 0, start;
+      qt_sample_pos_t q;
+      qt_frame f;
+      uint32_t kf = sf;
       /* snap to exact end of previous edit */
       edit_list_pts += edit_list_duration;
       /* duration is in global timescale units; convert to trak timescale */
@@ -1984,102 +2586,92 @@ static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale)
       /* extend last edit to end of trak, why?
        * anyway, add 1 second and catch ptsoffs. */
       if (edit_list_index == trak->edit_list_count - 1)
-        edit_list_duration = ef->pts - edit_list_pts + trak->timescale;
-      /* skip interval */
-      if (trak->sync_sample_count) {
-        /* find edit start, and the nearest keyframe before. */
-        qt_frame *f = sf;
-        for (; sf < ef; sf++) {
-          offs = sf->pts;
-          offs += sf->ptsoffs;
-          offs -= edit_list_media_time;
-          if (QTF_KEYFRAME(sf[0]))
-            f = sf;
-          if (offs >= 0)
-            break;
-        }
-        if (sf == ef)
+        edit_list_duration = ef_pts - edit_list_pts + trak->timescale;
+      /* skip interval. find edit start, and the nearest keyframe before. */
+      if (p.sample != sf)
+        qt_index_seek (trak, &p, sf);
+      for (; sf < ef; sf++) {
+        q = p;
+        qt_sample_step (trak, &q, &f);
+        offs = f.pts;
+        offs += f.ptsoffs;
+        offs -= edit_list_media_time;
+        if (QTF_KEYFRAME(f))
+          kf = sf;
+        if (offs >= 0)
           break;
-        offs -= sf->ptsoffs;
-        edit_list_pts += offs;
-        /* insert decoder preroll area */
-        for (; f < sf; f++) {
-          if (f != tf)
-            *tf = *f;
-          tf->pts = edit_list_pts;
-          scale_int_do (&trak->si, &tf->pts);
-          tf->ptsoffs = (tf->ptsoffs * trak->ptsoffs_mul) >> 12;
-          tf++;
-        }
-      } else {
-        /* find edit start. */
-        for (; sf < ef; sf++) {
-          offs = sf->pts;
-          offs += sf->ptsoffs;
-          offs -= edit_list_media_time;
-          if (offs >= 0)
-            break;
-        }
-        if (sf == ef)
-          break;
-        offs -= sf->ptsoffs;
-        edit_list_pts += offs;
+        p = q;
+      }
+      if (sf == ef)
+        break;
+      offs -= f.ptsoffs;
+      edit_list_pts += offs;
+      /* insert decoder preroll area */
+      if (trak->sync_sample_count && (kf < sf)) {
+        r->out = tf;
+        r->src = kf;
+        r->pts = edit_list_pts;
+        r->src_pts = 0;
+        r->linear = 0;
+        r++;
+        tf += sf - kf;
       }
       /* avoid separate end of table test */
-      if (edit_list_duration > ef[0].pts - sf[0].pts)
-        edit_list_duration = ef[0].pts - sf[0].pts;
+      if (edit_list_duration > ef_pts - p.pts)
+        edit_list_duration = ef_pts - p.pts;
       /* ">= 0" is easier than "> 0" in 32bit mode */
       edit_list_duration -= 1;
-      /* insert interval */
-      if (sf == tf) {
-        /* no frames skipped yet (usual case) */
-        do {
-          /* this _does_ fit, see above */
-          uint32_t d = sf[1].pts - sf[0].pts;
-          sf[0].pts = edit_list_pts;
-          scale_int_do (&trak->si, &sf[0].pts);
-          sf[0].ptsoffs = (sf[0].ptsoffs * trak->ptsoffs_mul) >> 12;
-          if (QTF_KEYFRAME(sf[0]) & use_keyframes)
-            qt_keyframes_simple_add (trak, sf);
-          sf++;
-          edit_list_pts += d;
-          edit_list_duration -= d;
-        } while (edit_list_duration >= 0);
-        tf = sf;
-      } else {
-        /* shift out skipped frames */
-        do {
-          uint32_t d = sf[1].pts - sf[0].pts;
-          tf[0] = sf[0];
-          tf[0].pts = edit_list_pts;
-          scale_int_do (&trak->si, &tf[0].pts);
-          tf[0].ptsoffs = (tf[0].ptsoffs * trak->ptsoffs_mul) >> 12;
-          if (QTF_KEYFRAME(tf[0]) & use_keyframes)
-            qt_keyframes_simple_add (trak, tf);
-          sf++;
-          tf++;
-          edit_list_pts += d;
-          edit_list_duration -= d;
-        } while (edit_list_duration >= 0);
+      /* insert interval. it ends with the first frame after
+       * at least 1 frame, that starts beyond edit_list_duration.
+       * only dts is needed here, p is no longer valid for reading after this. */
+      r->out = tf;
+      r->src = sf;
+      r->pts = edit_list_pts;
+      r->src_pts = start = p.pts;
+      r->linear = 1;
+      r++;
+      q = p;
+      qt_time_skip (trak, &p, 1);
+      qt_time_skip (trak, &p, qt_sample_count_to (trak, &p, start + edit_list_duration, ef - sf - 1));
+      if (use_keyframes) {
+        /* register keyframes inside. */
+        uint32_t u = qt_stss_find (trak, 0, sf + 1), last = sf;
+        for (; u < trak->sync_sample_count; u++) {
+          uint32_t fr = _X_BE_32 (trak->sync_sample_table + 4 * u);
+          qt_frame kfr;
+          if (fr > p.sample)
+            break;
+          if (fr <= last)
+            continue;
+          last = fr;
+          qt_time_skip (trak, &q, fr - 1 - q.sample);
+          kfr.pts = edit_list_pts + q.pts - start;
+          scale_int_do (&trak->si, &kfr.pts);
+          qt_keyframes_simple_add (trak, &kfr);
+        }
       }
+      tf += p.sample - sf;
+      sf = p.sample;
+      edit_list_pts += p.pts - start;
+      edit_list_duration -= p.pts - start;
       edit_list_duration += 1;
       edit_list_pts -= offs;
     }
+    idx->num_runs = r - idx->runs;
     trak->fragment_dts = edit_list_pts;
     /* convenience frame */
-    tf->pts            = edit_list_pts;
-    scale_int_do (&trak->si, &tf[0].pts);
-    trak->frame_count  = tf - trak->frames;
-  }
-#ifdef DEBUG_EDIT_LIST
-  {
-    unsigned int u;
-    qt_frame *f = trak->frames;
-    for (u = 0; u <= trak->frame_count; u++) {
-      debug_edit_list ("  final pts for sample %u = %"PRId64"\n", u, f->pts);
-      f++;
+    idx->end_pts       = edit_list_pts;
+    scale_int_do (&trak->si, &idx->end_pts);
+    trak->frame_count  = tf;
+    if (!tf) {
+      qt_index_free (trak);
+      return QT_OK;
     }
   }
+  idx->last_pts = qt_index_pts (trak, trak->frame_count - 1);
+#if DEBUG_EDIT_LIST
+  for (n = 0; n <= trak->frame_count; n++)
+    debug_edit_list ("  final pts for sample %u = %"PRId64"\n", n, qt_frame_at (trak, n)->pts);
 #endif
 
   return QT_OK;
@@ -2231,6 +2823,9 @@ static int parse_mvex_atom (demux_qt_t *this, uint8_t *mvex_atom, unsigned int b
             }
           }
         }
+        /* fragments append to a plain frame table. */
+        if (!qt_index_expand (trak))
+          break;
         trak->fragment_frames = trak->frame_count;
         this->qt.fragment_count = 0;
         break;
@@ -2926,7 +3521,7 @@ static void qt_update_duration (demux_qt_t *this) {
   uint32_t n;
   for (n = this->qt.trak_count; n; n--) {
     if (trak->frame_count) {
-      int32_t msecs = qt_pts_2_msecs (trak->frames[trak->frame_count].pts);
+      int32_t msecs = qt_pts_2_msecs (qt_end_pts (trak));
       if (msecs > this->qt.msecs)
         this->qt.msecs = msecs;
     }
@@ -3005,6 +3600,8 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
       this->qt.last_error = parse_trak_atom (&this->qt.traks[this->qt.trak_count], *a);
       if (this->qt.last_error != QT_OK)
         return;
+      if (this->qt.moov.missing)
+        this->qt.traks[this->qt.trak_count].moov = &this->qt.moov;
       this->qt.trak_count++;
       a++;
     }
@@ -3074,15 +3671,18 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
       return;
     }
     if (trak->frame_count) {
+      qt_frame *f = qt_frame_at (trak, 0);
       xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
         "demux_qt:            start %" PRId64 "pts, %u frames.\n",
-        trak->frames[0].pts + trak->frames[0].ptsoffs,
+        f->pts + f->ptsoffs,
         trak->frame_count);
     }
   }
 
   /* must parse mvex _after_ building traks */
   if (mvex_atom) {
+    /* fragments append to full frame tables. */
+    qt_moov_load_all (&this->qt.moov);
     parse_mvex_atom (this, mvex_atom, mvex_size);
     /* reassemble fragments, if any */
     fragment_scan (this);
@@ -3098,11 +3698,11 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
     for (j = 0; j < trak->frame_count; j++)
       debug_frame_table("      %d: %8X bytes @ %"PRIX64", %"PRId64" pts, media id %d%s\n",
         j,
-        trak->frames[j].size,
-        QTF_OFFSET(trak[0].frames[j]),
-        trak->frames[j].pts,
-        (int)QTF_MEDIA_ID(trak[0].frames[j]),
-        (QTF_KEYFRAME(trak[0].frames[j])) ? " (keyframe)" : "");
+        qt_frame_at (trak, j)->size,
+        QTF_OFFSET(qt_frame_at (trak, j)[0]),
+        qt_frame_at (trak, j)->pts,
+        (int)QTF_MEDIA_ID(qt_frame_at (trak, j)[0]),
+        (QTF_KEYFRAME(qt_frame_at (trak, j)[0])) ? " (keyframe)" : "");
 #endif
     /* decide which audio trak and which video trak has the most frames */
     if ((trak->type == MEDIA_VIDEO) &&
@@ -3160,7 +3760,8 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
   }
 }
 
-static qt_error load_moov_atom (input_plugin_t *input, uint8_t **moov_atom, off_t *moov_atom_offset) {
+static qt_error load_moov_atom (input_plugin_t *input, uint8_t **moov_atom, off_t *moov_atom_offset,
+  qt_moov_t *lazy) {
   uint8_t buf[MAX_PREVIEW_SIZE] = { 0, }, *p;
   uint64_t size = 0;
   uint32_t hsize;
@@ -3305,6 +3906,28 @@ static qt_error load_moov_atom (input_plugin_t *input, uint8_t **moov_atom, off_
     return QT_NO_MEMORY;
   if (hsize)
     memcpy (*moov_atom, p, hsize);
+
+  /* with random access, dont wait for the big tables.
+   * this saves most of the moov download time with http. */
+  if ((hsize == 8) && (size >= QT_MOOV_LAZY_MIN) &&
+    (input->get_capabilities (input) & (INPUT_CAP_SEEKABLE | INPUT_CAP_SLOW_SEEKABLE))) {
+    int slow = !(input->get_capabilities (input) & INPUT_CAP_SEEKABLE);
+    lazy->input    = input;
+    lazy->buf      = *moov_atom;
+    lazy->offset   = pos;
+    lazy->size     = size;
+    lazy->skip_min = slow ? QT_MOOV_SLOW_SKIP : 2;
+    lazy->fetch    = slow ? QT_MOOV_SLOW_FETCH : QT_MOOV_FETCH_PAGES;
+    lazy->interval = slow ? QT_MOOV_SLOW_INTERVAL : QT_MOOV_FETCH_INTERVAL;
+    if (!qt_moov_stream (lazy, hsize)) {
+      free (lazy->pages);
+      memset (lazy, 0, sizeof (*lazy));
+      free (*moov_atom);
+      return QT_FILE_READ_ERROR;
+    }
+    return QT_OK;
+  }
+
   if (input->read (input, *moov_atom + hsize, size - hsize) != (off_t)size - hsize) {
     free (*moov_atom);
     return QT_FILE_READ_ERROR;
@@ -3378,12 +4001,15 @@ static qt_error open_qt_file (demux_qt_t *this, uint8_t *moov_atom, off_t moov_a
   } while (0);
 
   /* write moov atom to disk if debugging option is turned on */
+#if DEBUG_DUMP_MOOV
+  qt_moov_load_all (&this->qt.moov);
+#endif
   dump_moov_atom(moov_atom, moov_atom_size);
 
-  /* take apart the moov atom */
+  /* take apart the moov atom. the sample index still needs it later. */
   parse_moov_atom (this, moov_atom);
 
-  free (moov_atom);
+  this->qt.moov_atom = moov_atom;
   return this->qt.last_error;
 }
 
@@ -3401,7 +4027,14 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
   int frame_duration;
   int first_buf;
   qt_trak *trak = NULL;
-  off_t current_pos = this->input->get_current_pos (this->input);
+  qt_frame *frame;
+  off_t current_pos;
+  int keyframes_only;
+
+  /* load the rest of a partial moov meanwhile */
+  if (this->qt.moov.missing)
+    qt_moov_fetch_next (&this->qt.moov);
+  current_pos = this->input->get_current_pos (this->input);
 
   /* if this is DRM-protected content, finish playback before it even
    * tries to start */
@@ -3420,6 +4053,10 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     return this->status;
   }
 
+  /* XINE_PARAM_KEYFRAMES_ONLY: video sync samples only, no audio. */
+  keyframes_only = (this->qt.video_trak >= 0)
+    && _x_stream_info_get (this->stream, XINE_STREAM_INFO_KEYFRAMES_ONLY);
+
   /* Decide the trak from which to dispatch a frame. Policy: Dispatch
    * the frames in offset order as much as possible. If the pts difference
    * between the current frames from the audio and video traks is too
@@ -3439,7 +4076,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
       if (trak->current_frame < trak->frame_count)
         traks[trak_count++] = this->qt.video_trak;
     }
-    for (i = 0; i < this->qt.audio_trak_count; i++) {
+    for (i = keyframes_only ? this->qt.audio_trak_count : 0; i < this->qt.audio_trak_count; i++) {
       trak = &this->qt.traks[this->qt.audio_traks[i]];
       if (trak->current_frame < trak->frame_count)
         traks[trak_count++] = this->qt.audio_traks[i];
@@ -3467,7 +4104,8 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
       int64_t pts;
       off_t pos;
       trak = &this->qt.traks[traks[i]];
-      pts  = trak->frames[trak->current_frame].pts;
+      frame = qt_frame_at (trak, trak->current_frame);
+      pts  = frame->pts;
       if (i == 0) {
         min_pts  = max_pts = pts;
         min_trak = traks[i];
@@ -3476,7 +4114,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
         min_trak = traks[i];
       } else if (pts > max_pts)
         max_pts  = pts;
-      pos = QTF_OFFSET(trak->frames[trak->current_frame]);
+      pos = QTF_OFFSET(frame[0]);
       if ((pos >= current_pos) && (pos < next_pos)) {
         next_pos = pos;
         next_trak = traks[i];
@@ -3490,12 +4128,21 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     trak = &this->qt.traks[i];
   } while (0);
 
+  if (keyframes_only && (trak->type == MEDIA_VIDEO)) {
+    /* jump right to the next sync sample, without reading anything in between. */
+    while ((trak->current_frame < trak->frame_count) && !QTF_KEYFRAME (qt_frame_at (trak, trak->current_frame)[0]))
+      trak->current_frame++;
+    if (trak->current_frame >= trak->frame_count)
+      return this->status;
+  }
+
+  frame = qt_frame_at (trak, trak->current_frame);
   if (this->stream->xine->verbosity == XINE_VERBOSITY_DEBUG + 1) {
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG + 1,
       "demux_qt: sending trak %d dts %"PRId64" pos %"PRId64"\n",
       (int)(trak - this->qt.traks),
-      trak->frames[trak->current_frame].pts,
-      QTF_OFFSET(trak->frames[trak->current_frame]));
+      frame->pts,
+      QTF_OFFSET(frame[0]));
   }
 
   /* check if it is time to seek */
@@ -3504,20 +4151,20 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     /* send min pts of all used traks, usually audio (see demux_qt_seek ()). */
     _x_demux_control_newpts (this->stream,
-        trak->frames[trak->current_frame].pts + trak->frames[trak->current_frame].ptsoffs, BUF_FLAG_SEEK);
+        frame->pts + frame->ptsoffs, BUF_FLAG_SEEK);
   }
 
   if (trak->type == MEDIA_VIDEO) {
     i = trak->current_frame++;
 
-    if (QTF_MEDIA_ID(trak->frames[i]) != trak->properties->media_id) {
+    if (QTF_MEDIA_ID(frame[0]) != trak->properties->media_id) {
       this->status = DEMUX_OK;
       return this->status;
     }
 
-    remaining_sample_bytes = trak->frames[i].size;
-    if ((off_t)QTF_OFFSET(trak->frames[i]) != current_pos) {
-      if (this->input->seek (this->input, QTF_OFFSET(trak->frames[i]), SEEK_SET) < 0) {
+    remaining_sample_bytes = frame->size;
+    if ((off_t)QTF_OFFSET(frame[0]) != current_pos) {
+      if (this->input->seek (this->input, QTF_OFFSET(frame[0]), SEEK_SET) < 0) {
         /* Do not stop demuxing. Maybe corrupt file or broken track. */
         return this->status;
       }
@@ -3525,8 +4172,8 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     /* frame duration is the pts diff between this video frame and the next video frame
      * or the convenience frame at the end of list */
-    frame_duration  = trak->frames[i + 1].pts;
-    frame_duration -= trak->frames[i].pts;
+    frame_duration  = qt_frame_at (trak, i + 1)->pts;
+    frame_duration -= frame->pts;
 
     /* Due to the edit lists, some successive frames have the same pts
      * which would ordinarily cause frame_duration to be 0 which can
@@ -3545,15 +4192,15 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     debug_video_demux("  qt: sending off video frame %d from offset 0x%"PRIX64", %d bytes, media id %d, %"PRId64" pts\n",
       i,
-      QTF_OFFSET(trak->frames[i]),
-      trak->frames[i].size,
-      (int)QTF_MEDIA_ID(trak->frames[i]),
-      trak->frames[i].pts);
+      QTF_OFFSET(frame[0]),
+      frame->size,
+      (int)QTF_MEDIA_ID(frame[0]),
+      frame->pts);
 
     while (remaining_sample_bytes) {
       buf = this->video_fifo->buffer_pool_size_alloc (this->video_fifo, remaining_sample_bytes);
       buf->type = trak->properties->codec_buftype;
-      buf->pts = trak->frames[i].pts + (int64_t)trak->frames[i].ptsoffs + this->ptsoffs;
+      buf->pts = frame->pts + (int64_t)frame->ptsoffs + this->ptsoffs;
       buf->extra_info->input_time = qt_pts_2_msecs (buf->pts);
       buf->extra_info->input_normpos = qt_msec_2_normpos (this, buf->extra_info->input_time);
 
@@ -3573,7 +4220,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
         break;
       }
 
-      if (QTF_KEYFRAME(trak->frames[i]))
+      if (QTF_KEYFRAME(frame[0]))
         buf->decoder_flags |= BUF_FLAG_KEYFRAME;
       if (!remaining_sample_bytes)
         buf->decoder_flags |= BUF_FLAG_FRAME_END;
@@ -3585,7 +4232,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     /* load an audio sample and packetize it */
     i = trak->current_frame++;
 
-    if (QTF_MEDIA_ID(trak->frames[i]) != trak->properties->media_id) {
+    if (QTF_MEDIA_ID(frame[0]) != trak->properties->media_id) {
       this->status = DEMUX_OK;
       return this->status;
     }
@@ -3594,10 +4241,10 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     if (!this->audio_fifo)
       return this->status;
 
-    remaining_sample_bytes = trak->frames[i].size;
+    remaining_sample_bytes = frame->size;
 
-    if ((off_t)QTF_OFFSET(trak->frames[i]) != current_pos) {
-      if (this->input->seek (this->input, QTF_OFFSET(trak->frames[i]), SEEK_SET) < 0) {
+    if ((off_t)QTF_OFFSET(frame[0]) != current_pos) {
+      if (this->input->seek (this->input, QTF_OFFSET(frame[0]), SEEK_SET) < 0) {
         /* Do not stop demuxing. Maybe corrupt file or broken track. */
         return this->status;
       }
@@ -3605,16 +4252,16 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     debug_audio_demux("  qt: sending off audio frame %d from offset 0x%"PRIX64", %d bytes, media id %d, %"PRId64" pts\n",
       i,
-      QTF_OFFSET(trak->frames[i]),
-      trak->frames[i].size,
-      (int)QTF_MEDIA_ID(trak->frames[i]),
-      trak->frames[i].pts);
+      QTF_OFFSET(frame[0]),
+      frame->size,
+      (int)QTF_MEDIA_ID(frame[0]),
+      frame->pts);
 
     first_buf = 1;
     while (remaining_sample_bytes) {
       buf = this->audio_fifo->buffer_pool_size_alloc (this->audio_fifo, remaining_sample_bytes);
       buf->type = trak->properties->codec_buftype;
-      buf->extra_info->input_time = qt_pts_2_msecs (trak->frames[i].pts);
+      buf->extra_info->input_time = qt_pts_2_msecs (frame->pts);
       buf->extra_info->input_normpos = qt_msec_2_normpos (this, buf->extra_info->input_time);
       /* The audio chunk is often broken up into multiple 8K buffers when
        * it is sent to the audio decoder. Only attach the proper timestamp
@@ -3625,14 +4272,14 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
       if ((buf->type == BUF_AUDIO_LPCM_BE) ||
           (buf->type == BUF_AUDIO_LPCM_LE)) {
         if (first_buf) {
-          buf->pts = trak->frames[i].pts + this->ptsoffs;
+          buf->pts = frame->pts + this->ptsoffs;
           first_buf = 0;
         } else {
           buf->extra_info->input_time = 0;
           buf->pts = 0;
         }
       } else {
-        buf->pts = trak->frames[i].pts + this->ptsoffs;
+        buf->pts = frame->pts + this->ptsoffs;
       }
 
       /* 24-bit audio doesn't fit evenly into the default 8192-byte buffers */
@@ -3703,17 +4350,17 @@ static void demux_qt_send_headers(demux_plugin_t *this_gen) {
   if (this->qt.video_trak != -1) {
     video_trak = &this->qt.traks[this->qt.video_trak];
 #ifdef QT_OFFSET_SEEK
-    first_video_offset = QTF_OFFSET(video_trak->frames[0]);
-    last_video_offset = video_trak->frames[video_trak->frame_count - 1].size +
-      QTF_OFFSET(video_trak->frames[video_trak->frame_count - 1]);
+    first_video_offset = QTF_OFFSET(qt_frame_at (video_trak, 0)[0]);
+    last_video_offset = qt_frame_at (video_trak, video_trak->frame_count - 1)->size +
+      QTF_OFFSET(qt_frame_at (video_trak, video_trak->frame_count - 1)[0]);
 #endif
   }
   if (this->qt.audio_trak != -1) {
     audio_trak = &this->qt.traks[this->qt.audio_trak];
 #ifdef QT_OFFSET_SEEK
-    first_audio_offset = QTF_OFFSET(audio_trak->frames[0]);
-    last_audio_offset = audio_trak->frames[audio_trak->frame_count - 1].size +
-      QTF_OFFSET(audio_trak->frames[audio_trak->frame_count - 1]);
+    first_audio_offset = QTF_OFFSET(qt_frame_at (audio_trak, 0)[0]);
+    last_audio_offset = qt_frame_at (audio_trak, audio_trak->frame_count - 1)->size +
+      QTF_OFFSET(qt_frame_at (audio_trak, audio_trak->frame_count - 1)[0]);
 #endif
   }
 
@@ -3972,9 +4619,9 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
   /* perform a binary search on the trak, testing the offset
    * boundaries first; offset request has precedent over time request */
   if (start_pos) {
-    if (start_pos <= (off_t)QTF_OFFSET(trak->frames[0]))
+    if (start_pos <= (off_t)QTF_OFFSET(qt_frame_at (trak, 0)[0]))
       best_index = 0;
-    else if (start_pos >= (off_t)QTF_OFFSET(trak->frames[trak->frame_count - 1]))
+    else if (start_pos >= (off_t)QTF_OFFSET(qt_frame_at (trak, trak->frame_count - 1)[0]))
       best_index = trak->frame_count - 1;
     else {
       left = 0;
@@ -3983,10 +4630,10 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
 
       while (!found) {
 	middle = (left + right + 1) / 2;
-        if ((start_pos >= (off_t)QTF_OFFSET(trak->frames[middle])) &&
-            (start_pos < (off_t)QTF_OFFSET(trak->frames[middle + 1]))) {
+        if ((start_pos >= (off_t)QTF_OFFSET(qt_frame_at (trak, middle)[0])) &&
+            (start_pos < (off_t)QTF_OFFSET(qt_frame_at (trak, middle + 1)[0]))) {
           found = 1;
-        } else if (start_pos < (off_t)QTF_OFFSET(trak->frames[middle])) {
+        } else if (start_pos < (off_t)QTF_OFFSET(qt_frame_at (trak, middle)[0])) {
           right = middle - 1;
         } else {
           left = middle;
@@ -4004,16 +4651,16 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
   {
     int64_t pts = (int64_t)90 * start_time;
 
-    if (pts <= trak->frames[0].pts)
+    if (pts <= qt_frame_at (trak, 0)->pts)
       best_index = 0;
-    else if (pts >= trak->frames[trak->frame_count - 1].pts)
+    else if (pts >= qt_last_pts (trak))
       best_index = trak->frame_count - 1;
     else {
       left = 0;
       right = trak->frame_count - 1;
       do {
 	middle = (left + right + 1) / 2;
-	if (pts < trak->frames[middle].pts) {
+	if (pts < qt_frame_at (trak, middle)->pts) {
 	  right = (middle - 1);
 	} else {
 	  left = middle;
@@ -4059,12 +4706,12 @@ static int demux_qt_seek (demux_plugin_t *this_gen,
       return this->status;
     /* search back in the video trak for the nearest keyframe */
     while (video_trak->current_frame) {
-      if (QTF_KEYFRAME(video_trak->frames[video_trak->current_frame])) {
+      if (QTF_KEYFRAME(qt_frame_at (video_trak, video_trak->current_frame)[0])) {
         break;
       }
       video_trak->current_frame--;
     }
-    keyframe_pts = video_trak->frames[video_trak->current_frame].pts;
+    keyframe_pts = qt_frame_at (video_trak, video_trak->current_frame)->pts;
   }
 
   /* seek all supported audio traks */
@@ -4081,11 +4728,11 @@ static int demux_qt_seek (demux_plugin_t *this_gen,
    * no video trak */
   if (keyframe_pts >= 0) for (i = 0; i < this->qt.audio_trak_count; i++) {
     audio_trak = &this->qt.traks[this->qt.audio_traks[i]];
-    if (keyframe_pts > audio_trak->frames[audio_trak->frame_count - 1].pts) {
+    if (keyframe_pts > qt_last_pts (audio_trak)) {
       /* whoops, this trak is too short, mark it finished */
       audio_trak->current_frame = audio_trak->frame_count;
     } else while (audio_trak->current_frame) {
-      if (audio_trak->frames[audio_trak->current_frame].pts <= keyframe_pts) {
+      if (qt_frame_at (audio_trak, audio_trak->current_frame)->pts <= keyframe_pts) {
         break;
       }
       audio_trak->current_frame--;
@@ -4159,7 +4806,8 @@ static int demux_qt_get_optional_data(demux_plugin_t *this_gen,
     case DEMUX_OPTIONAL_DATA_VIDEO_TIME:
       if (data && (this->qt.video_trak >= 0)) {
         qt_trak *trak = &this->qt.traks[this->qt.video_trak];
-        int32_t vtime = (trak->frames[trak->current_frame].pts + trak->frames[trak->current_frame].ptsoffs) / 90;
+        qt_frame *f = qt_frame_at (trak, trak->current_frame);
+        int32_t vtime = (f->pts + f->ptsoffs) / 90;
         memcpy (data, &vtime, sizeof (vtime));
         return DEMUX_OPTIONAL_SUCCESS;
       }
@@ -4176,6 +4824,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   xine_cfg_entry_t entry;
   uint8_t         *moov_atom = NULL;
   off_t            moov_atom_offset;
+  qt_moov_t        lazy;
   qt_error         last_error;
 
   if ((input->get_capabilities(input) & INPUT_CAP_BLOCK)) {
@@ -4191,13 +4840,15 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
       return NULL;
   }
 
-  last_error = load_moov_atom (input, &moov_atom, &moov_atom_offset);
+  memset (&lazy, 0, sizeof (lazy));
+  last_error = load_moov_atom (input, &moov_atom, &moov_atom_offset, &lazy);
   if (last_error != QT_OK)
     return NULL;
 
   /* check that the next atom in the chunk contains alphanumeric characters
    * in the atom type field; if not, disqualify the file as a QT file */
   if (_X_BE_32 (moov_atom) < 16) {
+    free (lazy.pages);
     free (moov_atom);
     return NULL;
   }
@@ -4205,6 +4856,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
     int i;
     for (i = 12; i < 16; i++) {
       if (!isalnum (moov_atom[i])) {
+        free (lazy.pages);
         free (moov_atom);
         return NULL;
       }
@@ -4213,6 +4865,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
 
   this = calloc (1, sizeof (demux_qt_t));
   if (!this) {
+    free (lazy.pages);
     free (moov_atom);
     return NULL;
   }
@@ -4246,6 +4899,12 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   this->status = DEMUX_FINISHED;
 
   create_qt_info (this);
+  if (lazy.missing) {
+    lazy.xine = stream->xine;
+    this->qt.moov = lazy;
+    xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+      "demux_qt: starting with %u of %u moov pages missing.\n", lazy.missing, lazy.num_pages);
+  }
 
   last_error = open_qt_file (this, moov_atom, moov_atom_offset);
 
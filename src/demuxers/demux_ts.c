@@ -147,6 +147,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #ifdef HAVE_ARPA_INET_H
 #include <arpa/inet.h>  /* htonl */
@@ -187,6 +189,22 @@
 /* Packet readers: 1 (original), 2 (fast experimental) */
 #define TS_PACKET_READER 2
 
+/* pthread_cond_timedwait () deadlines. */
+#ifdef HAVE_POSIX_TIMERS
+#  define xine_gettime(t) clock_gettime (CLOCK_REALTIME, t)
+#else
+static inline int xine_gettime (struct timespec *ts) {
+  struct timeval tv;
+  int r;
+  r = gettimeofday (&tv, NULL);
+  if (!r) {
+    ts->tv_sec  = tv.tv_sec;
+    ts->tv_nsec = tv.tv_usec * 1000;
+  }
+  return r;
+}
+#endif
+
 /* transport stream packet layer */
 #define TSP_sync_byte          0xff000000
 #define TSP_transport_error    0x00800000
@@ -510,7 +528,75 @@ typedef struct {
   uint8_t  buf[4098];
 } demux_ts_pmt;
 
+/*
+ * Program taps. While a demux_ts is playing a multi program input, another
+ * stream may open "tsprog:/<program number>". That demux then forwards all
+ * packets of the program, plus a PAT listing just that program, to the tap,
+ * and leaves the program alone itself. The other stream runs its own demux_ts
+ * on this filtered multiplex, with its own fifos, metronom and decoders.
+ * The input is still read and split into packets only once.
+ * "tsprog:/<program number>/<mrl>" picks the master playing that mrl. The
+ * short form works when there is just one master in this xine instance.
+ */
+#define TS_TAP_MRL       "tsprog:/"
+#define TS_TAP_RING_SIZE (PKT_SIZE * 4096)
+#define TS_TAP_LOSS_MAX  16
+#define TS_TAP_PREVIEW   2048
+
+typedef struct demux_ts_tap_s demux_ts_tap_t;
+typedef struct demux_ts_tap_reg_s demux_ts_tap_reg_t;
+
+/* the masters of a xine instance. */
+struct demux_ts_tap_reg_s {
+  demux_ts_tap_reg_t *next;
+  xine_t             *xine;
+  int                 refs;
+  pthread_mutex_t     lock;
+  struct demux_ts_s  *masters;
+};
+
+typedef struct {
+  demux_class_t       demux_class;
+  demux_ts_tap_reg_t *tap_reg;
+} demux_ts_class_t;
+
 typedef struct {
+  input_class_t       input_class;
+  demux_ts_tap_reg_t *tap_reg;
+} demux_ts_tap_class_t;
+
+struct demux_ts_tap_s {
+  input_plugin_t     input_plugin;
+  xine_stream_t     *stream;
+  demux_ts_tap_reg_t *reg;
+
+  /* in master->tap_new (guarded by reg->lock), or in master->taps (master demux thread). */
+  demux_ts_tap_t    *next;
+  /* guarded by reg->lock. held by the input plugin, and by the master. */
+  int                refs;
+  int                closed;
+
+  /* master demux thread only. */
+  uint32_t           program;
+  uint32_t           pmt_pid;
+  unsigned int       pat_cc;
+  uint8_t            pids[0x2000 / 8];
+
+  /* guarded by both reg->lock and mutex. NULL when the feeding demux has gone. */
+  struct demux_ts_s *master;
+
+  /* guarded by mutex. ring positions are input offsets. */
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cond;
+  off_t              rd, wr;
+  unsigned int       loss_get, loss_put;
+  off_t              loss_pos[TS_TAP_LOSS_MAX];
+
+  char              *mrl;
+  uint8_t            ring[TS_TAP_RING_SIZE];
+};
+
+typedef struct demux_ts_s {
   /*
    * The first field must be the "base class" for the plugin!
    */
@@ -543,6 +629,11 @@ typedef struct {
   uint32_t         pat_interval;
   uint32_t         keyframe_interval;
   frametype_t     (*get_frametype)(const uint8_t *f, uint32_t len);
+  /* XINE_PARAM_KEYFRAMES_ONLY: type of the last video pes, and whether we are
+   * inside a keyframe. */
+  frametype_t      pes_frametype;
+  uint8_t          keyframes_only;
+  uint8_t          keyframes_keep;
   /* programs */
   demux_ts_pmt    *pmts[MAX_PMTS];
   uint32_t         programs[MAX_PMTS + 1];
@@ -610,15 +701,45 @@ typedef struct {
    * 0xff                  (special/unused) */
   uint8_t pid_index[0x2000];
 
+  /* program taps. */
+  demux_ts_tap_reg_t *tap_reg;
+  /* guarded by tap_reg->lock. */
+  struct demux_ts_s *next_master;
+  demux_ts_tap_t    *tap_new;
+  int                tap_changed;
+  /* demux thread only. */
+  demux_ts_tap_t    *taps;
+  uint8_t            tap_pids[0x2000 / 8];
+  /* persistent keyframe index, and its background builder. */
+  xine_seek_index_t *seek_index;
+  off_t              seek_index_prev;
+  input_plugin_t    *index_input;
+  pthread_t          index_thread;
+  int                index_running;
+  int                index_stop;
+
 #if TS_PACKET_READER == 2
   int     buf_pos;
   int     buf_size;
   int     buf_max;
+  /* input position of buf[buf_size], and of the next packet loss reported by input. */
+  off_t   buf_end_pos;
+  off_t   loss_pos;
+  int     loss_check;
 #endif
   uint8_t buf[BUF_SIZE]; /* == PKT_SIZE * NPKT_PER_READ */
 
 } demux_ts_t;
 
+/* input position of the ts packet just taken. */
+static off_t demux_ts_packet_pos (demux_ts_t *this) {
+#if TS_PACKET_READER == 2
+  return this->buf_end_pos - this->buf_size + this->buf_pos - (this->hdmv > 0 ? 192 : PKT_SIZE);
+#else
+  return this->frame_pos;
+#endif
+}
+
 static void demux_ts_hexdump (demux_ts_t *this, const char *intro, const uint8_t *p, uint32_t len) {
   static const uint8_t tab_hex[16] = "0123456789abcdef";
   uint8_t sb[512 * 3], *q = sb;
@@ -851,6 +972,298 @@ static void demux_ts_dynamic_pmt_clear (demux_ts_t *this) {
       this->pmts[i]->length = 0;
 }
 
+/*
+ * program tap master side. each xine instance has its own registry of masters.
+ * its lock is taken only when a master or tap comes or goes, never per packet.
+ * order of locks is reg->lock, then tap->mutex.
+ */
+
+static pthread_mutex_t demux_ts_tap_regs_lock = PTHREAD_MUTEX_INITIALIZER;
+static demux_ts_tap_reg_t *demux_ts_tap_regs = NULL;
+
+static demux_ts_tap_reg_t *demux_ts_tap_reg_get (xine_t *xine) {
+  demux_ts_tap_reg_t *reg;
+
+  pthread_mutex_lock (&demux_ts_tap_regs_lock);
+  for (reg = demux_ts_tap_regs; reg; reg = reg->next) {
+    if (reg->xine == xine)
+      break;
+  }
+  if (reg) {
+    reg->refs++;
+  } else {
+    reg = calloc (1, sizeof (*reg));
+    if (reg) {
+#ifndef HAVE_ZERO_SAFE_MEM
+      reg->masters = NULL;
+#endif
+      reg->xine = xine;
+      reg->refs = 1;
+      pthread_mutex_init (&reg->lock, NULL);
+      reg->next = demux_ts_tap_regs;
+      demux_ts_tap_regs = reg;
+    }
+  }
+  pthread_mutex_unlock (&demux_ts_tap_regs_lock);
+  return reg;
+}
+
+static void demux_ts_tap_reg_put (demux_ts_tap_reg_t *reg) {
+  demux_ts_tap_reg_t **r;
+
+  if (!reg)
+    return;
+  pthread_mutex_lock (&demux_ts_tap_regs_lock);
+  if (--reg->refs > 0) {
+    pthread_mutex_unlock (&demux_ts_tap_regs_lock);
+    return;
+  }
+  for (r = &demux_ts_tap_regs; *r; r = &(*r)->next) {
+    if (*r == reg) {
+      *r = reg->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&demux_ts_tap_regs_lock);
+  pthread_mutex_destroy (&reg->lock);
+  free (reg);
+}
+
+static void demux_ts_tap_free (demux_ts_tap_t *tap) {
+  pthread_cond_destroy (&tap->cond);
+  pthread_mutex_destroy (&tap->mutex);
+  free (tap->mrl);
+  free (tap);
+}
+
+#define demux_ts_tapped(this,pid) ((this)->taps && ((this)->tap_pids[(pid) >> 3] & (1 << ((pid) & 7))))
+
+static void demux_ts_tap_register (demux_ts_t *this) {
+  demux_ts_tap_reg_t *reg = this->tap_reg;
+
+  if (!reg)
+    return;
+  pthread_mutex_lock (&reg->lock);
+  this->next_master = reg->masters;
+  reg->masters = this;
+  pthread_mutex_unlock (&reg->lock);
+}
+
+static void demux_ts_tap_unregister (demux_ts_t *this) {
+  demux_ts_tap_reg_t *reg = this->tap_reg;
+  demux_ts_t **m;
+  demux_ts_tap_t *tap, *dead = NULL;
+  int i;
+
+  if (!reg)
+    return;
+  pthread_mutex_lock (&reg->lock);
+  for (m = &reg->masters; *m; m = &(*m)->next_master) {
+    if (*m == this) {
+      *m = this->next_master;
+      break;
+    }
+  }
+  /* taps belong to their input plugins. just let them run dry. */
+  for (i = 0; i < 2; i++) {
+    demux_ts_tap_t **list = i ? &this->taps : &this->tap_new;
+    while ((tap = *list)) {
+      *list = tap->next;
+      tap->next = NULL;
+      pthread_mutex_lock (&tap->mutex);
+      tap->master = NULL;
+      pthread_cond_broadcast (&tap->cond);
+      pthread_mutex_unlock (&tap->mutex);
+      if (--tap->refs == 0) {
+        tap->next = dead;
+        dead = tap;
+      }
+    }
+  }
+  pthread_mutex_unlock (&reg->lock);
+  while ((tap = dead)) {
+    dead = tap->next;
+    demux_ts_tap_free (tap);
+  }
+}
+
+/* demux thread only. */
+static void demux_ts_tap_union (demux_ts_t *this) {
+  demux_ts_tap_t *tap;
+  unsigned int i;
+
+  memset (this->tap_pids, 0, sizeof (this->tap_pids));
+  for (tap = this->taps; tap; tap = tap->next) {
+    for (i = 0; i < sizeof (this->tap_pids); i++)
+      this->tap_pids[i] |= tap->pids[i];
+  }
+}
+
+/* with tap->mutex held. */
+static void demux_ts_tap_add_loss (demux_ts_tap_t *tap) {
+  if ((tap->loss_put != tap->loss_get) &&
+    (tap->loss_pos[(tap->loss_put - 1) & (TS_TAP_LOSS_MAX - 1)] == tap->wr))
+    return;
+  if (tap->loss_put - tap->loss_get < TS_TAP_LOSS_MAX)
+    tap->loss_pos[tap->loss_put++ & (TS_TAP_LOSS_MAX - 1)] = tap->wr;
+}
+
+static void demux_ts_tap_put (demux_ts_tap_t *tap, const uint8_t *pkt) {
+  pthread_mutex_lock (&tap->mutex);
+  if (tap->wr - tap->rd <= TS_TAP_RING_SIZE - PKT_SIZE) {
+    /* ring size is a multiple of PKT_SIZE, packets never wrap. */
+    memcpy (tap->ring + (tap->wr % TS_TAP_RING_SIZE), pkt, PKT_SIZE);
+    tap->wr += PKT_SIZE;
+    pthread_cond_signal (&tap->cond);
+  } else {
+    /* reader is too slow. drop, and tell its demux. */
+    demux_ts_tap_add_loss (tap);
+  }
+  pthread_mutex_unlock (&tap->mutex);
+}
+
+/* a PAT listing just the tapped program. */
+static void demux_ts_tap_pat (demux_ts_t *this, demux_ts_tap_t *tap) {
+  uint8_t  pkt[PKT_SIZE], *sec = pkt + 5;
+  uint32_t crc;
+
+  pkt[0]  = SYNC_BYTE;
+  pkt[1]  = TSP_payload_unit_start >> 16;
+  pkt[2]  = 0x00;
+  pkt[3]  = (TSP_adaptation_field_0 | (tap->pat_cc++ & TSP_continuity_counter));
+  pkt[4]  = 0x00; /* pointer */
+  sec[0]  = 0x00; /* table id */
+  sec[1]  = 0xb0; /* section syntax, length 13 */
+  sec[2]  = 13;
+  sec[3]  = this->transport_stream_id >> 8;
+  sec[4]  = this->transport_stream_id;
+  sec[5]  = 0xc1; /* version 0, current */
+  sec[6]  = 0x00;
+  sec[7]  = 0x00;
+  sec[8]  = tap->program >> 8;
+  sec[9]  = tap->program;
+  sec[10] = 0xe0 | (tap->pmt_pid >> 8);
+  sec[11] = tap->pmt_pid;
+  crc = xine_crc32_ieee (0xffffffff, sec, 12);
+  memcpy (sec + 12, &crc, 4);
+  memset (sec + 16, 0xff, PKT_SIZE - 5 - 16);
+  demux_ts_tap_put (tap, pkt);
+}
+
+static void demux_ts_tap_packet (demux_ts_t *this, const uint8_t *pkt, uint32_t pid, uint32_t tsp_head) {
+  demux_ts_tap_t *tap;
+
+  for (tap = this->taps; tap; tap = tap->next) {
+    if (pid == 0) {
+      if ((tsp_head & TSP_payload_unit_start) && (tap->pmt_pid != INVALID_PID))
+        demux_ts_tap_pat (this, tap);
+    } else if (tap->pids[pid >> 3] & (1 << (pid & 7))) {
+      demux_ts_tap_put (tap, pkt);
+    }
+  }
+}
+
+/* a new PAT. find the pmt pids of the tapped programs. */
+static void demux_ts_tap_parse_pat (demux_ts_t *this, const uint8_t *pkt, unsigned int section_length) {
+  demux_ts_tap_t *tap;
+
+  if (!this->taps)
+    return;
+  for (tap = this->taps; tap; tap = tap->next) {
+    const uint8_t *program;
+    tap->pmt_pid = INVALID_PID;
+    memset (tap->pids, 0, sizeof (tap->pids));
+    for (program = pkt + 8; program < pkt + section_length - 4; program += 4) {
+      uint32_t v = _X_BE_32 (program);
+      if ((v >> 16) == tap->program) {
+        tap->pmt_pid = v & 0x1fff;
+        tap->pids[tap->pmt_pid >> 3] |= 1 << (tap->pmt_pid & 7);
+        break;
+      }
+    }
+  }
+  demux_ts_tap_union (this);
+}
+
+/* a new PMT. if the program is tapped, follow its pids, and return 1. */
+static int demux_ts_tap_parse_pmt (demux_ts_t *this, const uint8_t *pkt, unsigned int section_length, uint32_t pid) {
+  demux_ts_tap_t *tap;
+  uint32_t program = ((uint32_t)pkt[3] << 8) | pkt[4];
+  int found = 0;
+
+  if (!this->taps)
+    return 0;
+  for (tap = this->taps; tap; tap = tap->next) {
+    const uint8_t *p, *end = pkt + section_length - 4;
+    uint32_t u;
+    if (tap->program != program)
+      continue;
+    found = 1;
+    memset (tap->pids, 0, sizeof (tap->pids));
+    tap->pids[pid >> 3] |= 1 << (pid & 7);
+    u = _X_BE_32 (pkt + 6) & 0x1fff;
+    tap->pids[u >> 3] |= 1 << (u & 7);
+    p = pkt + 12 + (_X_BE_16 (pkt + 10) & 0x0fff);
+    while (p + 5 <= end) {
+      u = _X_BE_16 (p + 1) & 0x1fff;
+      tap->pids[u >> 3] |= 1 << (u & 7);
+      p += 5 + (_X_BE_16 (p + 3) & 0x0fff);
+    }
+  }
+  if (found)
+    demux_ts_tap_union (this);
+  return found;
+}
+
+#if TS_PACKET_READER == 2
+static void demux_ts_tap_loss (demux_ts_t *this) {
+  demux_ts_tap_t *tap;
+
+  for (tap = this->taps; tap; tap = tap->next) {
+    pthread_mutex_lock (&tap->mutex);
+    demux_ts_tap_add_loss (tap);
+    pthread_mutex_unlock (&tap->mutex);
+  }
+}
+#endif
+
+/* a tap came or went. take over new taps, release closed ones, and start
+ * over with program tables, so we drop or resume our own use of a program. */
+static void demux_ts_tap_check (demux_ts_t *this) {
+  demux_ts_tap_t *tap, **t, *dead = NULL;
+
+  pthread_mutex_lock (&this->tap_reg->lock);
+  this->tap_changed = 0;
+  while ((tap = this->tap_new)) {
+    this->tap_new = tap->next;
+    tap->next = this->taps;
+    this->taps = tap;
+  }
+  t = &this->taps;
+  while ((tap = *t)) {
+    if (tap->closed) {
+      *t = tap->next;
+      tap->master = NULL;
+      if (--tap->refs == 0) {
+        tap->next = dead;
+        dead = tap;
+      }
+    } else {
+      t = &tap->next;
+    }
+  }
+  pthread_mutex_unlock (&this->tap_reg->lock);
+  while ((tap = dead)) {
+    dead = tap->next;
+    demux_ts_tap_free (tap);
+  }
+
+  demux_ts_tap_union (this);
+  demux_ts_dynamic_pmt_clear (this);
+  this->pat_length = 0;
+  this->pat_crc = 0;
+}
+
 
 static void demux_ts_tbre_reset (demux_ts_t *this) {
   if (this->tbre_time <= TBRE_TIME) {
@@ -1308,6 +1721,8 @@ static void demux_ts_parse_pat (demux_ts_t*this, const uint8_t *pkt, unsigned in
   this->pat_length = section_length;
   this->pat_crc    = crc32;
 
+  demux_ts_tap_parse_pat (this, pkt, section_length);
+
   /* Unregister previous pmts. */
   for (program_count = 0; program_count < 0x2000; program_count++) {
     if (this->pid_index[program_count] & 0x80)
@@ -1465,7 +1880,13 @@ static int demux_ts_parse_pes_header (demux_ts_t *this, demux_ts_media *m,
 
   if ((m->pid == this->videoPid) && this->get_frametype) {
     frametype_t t = this->get_frametype (p + header_len, packet_len - header_len);
+    this->pes_frametype = t;
     if (t == FRAMETYPE_I) {
+      if (this->seek_index && pts) {
+        off_t pos = demux_ts_packet_pos (this);
+        _x_seek_index_add (this->seek_index, pos, pts, this->seek_index_prev);
+        this->seek_index_prev = pos;
+      }
       if (!this->last_keyframe_time) {
         this->last_keyframe_time = pts;
       } else if (pts) {
@@ -1660,6 +2081,23 @@ static void update_extra_info(demux_ts_t *this, demux_ts_media *m)
 /*
  *  buffer arriving pes data
  */
+/* keyframes only mode: drop main audio, and video up to the next keyframe.
+ * pes_frametype is still valid for the pes header just parsed. */
+static int demux_ts_keyframes_drop (demux_ts_t *this, demux_ts_media *m) {
+  if (this->videoPid == INVALID_PID)
+    return 0;
+  if (m->fifo == this->audio_fifo)
+    return 1;
+  if ((m->pid != this->videoPid) || !this->get_frametype)
+    return 0;
+  /* unknown: continuation of a split frame, or no picture start inside. */
+  if (this->pes_frametype == FRAMETYPE_I)
+    this->keyframes_keep = 1;
+  else if (this->pes_frametype != FRAMETYPE_UNKNOWN)
+    this->keyframes_keep = 0;
+  return !this->keyframes_keep;
+}
+
 static void demux_ts_buffer_pes (demux_ts_t*this, const uint8_t *ts,
   unsigned int mediaIndex, unsigned int tsp_head, unsigned int len) {
 
@@ -1711,6 +2149,8 @@ static void demux_ts_buffer_pes (demux_ts_t*this, const uint8_t *ts,
         this->tbre_pid = m->pid;
       if (m->pid == this->tbre_pid)
         demux_ts_tbre_update (this, TBRE_MODE_AUDIO_PTS, m->pts);
+      if (this->keyframes_only && demux_ts_keyframes_drop (this, m))
+        m->corrupted_pes = 1;
     }
   }
 
@@ -1977,6 +2417,10 @@ static void demux_ts_parse_pmt (demux_ts_t *this, const uint8_t *pkt,
   pmt->crc    = crc32;
   pmt->pid    = pid;
 
+  /* leave tapped programs to their own streams. */
+  if (demux_ts_tap_parse_pmt (this, pkt, section_length, pid))
+    return;
+
   /* dont "parse" the CRC */
   section_length -= 4;
 
@@ -2587,6 +3031,35 @@ static int sync_hdmv (const uint8_t *buf, int len) {
   return -1;
 }
 
+static void demux_ts_next_loss (demux_ts_t *this) {
+  if (this->input->get_optional_data (this->input, &this->loss_pos, INPUT_OPTIONAL_DATA_LOSS)
+    != INPUT_OPTIONAL_SUCCESS) {
+    this->loss_check = 0;
+    this->loss_pos = -1;
+  }
+}
+
+/* input lost some data before pos. drop everything that spans the gap. */
+static void demux_ts_loss (demux_ts_t *this, off_t pos) {
+  unsigned int i;
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "demux_ts: input lost data at %" PRId64 ", resyncing.\n", (int64_t)this->loss_pos);
+  demux_ts_tap_loss (this);
+  this->seek_index_prev = -1;
+  for (i = 0; i < this->media_num; i++) {
+    demux_ts_media *m = &this->media[i];
+    if (m->buf)
+      m->buf->free_buffer (m->buf);
+    m->buf = NULL;
+    m->counter = INVALID_CC;
+    m->corrupted_pes = 1;
+  }
+  do {
+    demux_ts_next_loss (this);
+  } while ((this->loss_pos >= 0) && (this->loss_pos < pos));
+}
+
 static const uint8_t *sync_next (demux_ts_t *this) {
   int reread = 3;
   int rescan = 8;
@@ -2699,6 +3172,10 @@ static const uint8_t *sync_next (demux_ts_t *this) {
           this->status = DEMUX_FINISHED;
           return NULL;
         }
+      } else {
+        this->buf_end_pos = this->frame_pos + n;
+        if (this->loss_check && (this->loss_pos < 0))
+          demux_ts_next_loss (this);
       }
       this->buf_size += n;
     }
@@ -2706,26 +3183,31 @@ static const uint8_t *sync_next (demux_ts_t *this) {
 }
 #endif
 
+#if TS_PACKET_READER == 2
+/* the packet just taken from buf. returns 1 if it is a mix of 2 different
+ * packets due to input data loss. */
+static int demux_ts_check_loss (demux_ts_t *this) {
+  if (this->loss_pos >= 0) {
+    off_t end = this->buf_end_pos - this->buf_size + this->buf_pos;
+    if (end > this->loss_pos) {
+      off_t start = end - (this->hdmv > 0 ? 192 : PKT_SIZE);
+      int broken = start < this->loss_pos;
+      demux_ts_loss (this, end);
+      return broken;
+    }
+  }
+  return 0;
+}
+#endif
+
 /* transport stream packet layer */
-static void demux_ts_parse_packet (demux_ts_t*this) {
+static void demux_ts_parse_tsp (demux_ts_t *this, const uint8_t *originalPkt, uint32_t tsp_head) {
 
-  const uint8_t *originalPkt;
-  uint32_t       tsp_head;
   uint32_t       pid;
   unsigned int   data_offset;
   unsigned int   data_len;
   uint32_t       index;
 
-  /* get next synchronised packet, or NULL */
-#if TS_PACKET_READER == 2
-  originalPkt = sync_next (this);
-#elif TS_PACKET_READER == 1
-  originalPkt = demux_synchronise(this);
-#endif
-  if (originalPkt == NULL)
-    return;
-
-  tsp_head = _X_BE_32 (originalPkt);
   pid      = (tsp_head & TSP_pid) >> 8;
 
 #ifdef TS_HEADER_LOG
@@ -2753,6 +3235,9 @@ static void demux_ts_parse_packet (demux_ts_t*this) {
       "demux_ts: error! invalid ts sync byte %.2x\n", tsp_head >> 24);
     return;
   }
+
+  if (demux_ts_tapped (this, pid) || (!pid && this->taps))
+    demux_ts_tap_packet (this, originalPkt, pid, tsp_head);
   if (tsp_head & TSP_transport_error) {
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, "demux_ts: error! transport error\n");
     return;
@@ -2781,11 +3266,12 @@ static void demux_ts_parse_packet (demux_ts_t*this) {
       return;
     }
 
-    if (adaptation_field_length > 0) {
+    /* only pcr is used, and only from 2 pids. */
+    if ((adaptation_field_length > 0) && ((pid == this->pcr_pid) || (pid == this->tbre_pid))) {
       int64_t pcr = demux_ts_adaptation_field_parse (originalPkt+5, adaptation_field_length);
       if (pid == this->pcr_pid)
         demux_ts_tbre_update (this, TBRE_MODE_PCR, pcr);
-      else if (pid == this->tbre_pid)
+      else
         demux_ts_tbre_update (this, TBRE_MODE_AUDIO_PCR, pcr);
     }
     /*
@@ -2862,6 +3348,76 @@ static void demux_ts_parse_packet (demux_ts_t*this) {
   }
 }
 
+#if TS_PACKET_READER == 2
+/* Whole transponder captures carry a lot of pids we dont use. Instead of
+ * taking packets one by one, check all complete packets already in buf,
+ * fetch their headers in one go, and drop unused ones right there.
+ * The rest is parsed in original order, so output does not change. */
+#define TS_BATCH (BUF_SIZE / PKT_SIZE)
+
+/* count the packets at p, p + size, ... that fit before end and have a
+ * sync byte, and fetch their headers. */
+static unsigned int demux_ts_batch_heads (const uint8_t *p, const uint8_t *end, unsigned int size, uint32_t *heads) {
+  unsigned int n = (end - p) / size, i;
+  if (n > TS_BATCH)
+    n = TS_BATCH;
+  for (i = 0; i < n; i++) {
+    uint32_t h = _X_BE_32 (p);
+    if ((h >> 24) != SYNC_BYTE)
+      break;
+    heads[i] = h;
+    p += size;
+  }
+  return i;
+}
+
+static void demux_ts_parse_packets (demux_ts_t *this) {
+  uint32_t       heads[TS_BATCH];
+  const uint8_t *pkt;
+  unsigned int   size, n, i;
+
+  /* get next synchronised packet, or NULL */
+  pkt = sync_next (this);
+  if (pkt == NULL)
+    return;
+
+  size = this->hdmv > 0 ? 192 : PKT_SIZE;
+  n = demux_ts_batch_heads (pkt, this->buf + this->buf_size, size, heads);
+  if (!n) {
+    heads[0] = _X_BE_32 (pkt);
+    n = 1;
+  }
+
+  for (i = 0; i < n; i++, pkt += size) {
+    uint32_t head = heads[i], pid = (head & TSP_pid) >> 8;
+    if (i) {
+      /* same as sync_next () fast path */
+      this->buf_pos   += size;
+      this->frame_pos += size;
+    }
+    if (demux_ts_check_loss (this))
+      continue;
+    /* unused, and no side effects in demux_ts_parse_tsp () either. */
+    if ((this->pid_index[pid] == 0xff) && pid &&
+      (pid != this->pcr_pid) && (pid != this->tbre_pid) && !demux_ts_tapped (this, pid) &&
+      !(head & (TSP_transport_error | TSP_scrambling_control)) &&
+      (!(head & TSP_adaptation_field_1) || (pkt[4] <= PKT_SIZE - 5)))
+      continue;
+    demux_ts_parse_tsp (this, pkt, head);
+  }
+}
+#endif
+
+#if TS_PACKET_READER == 1
+static void demux_ts_parse_packet (demux_ts_t *this) {
+  /* get next synchronised packet, or NULL */
+  const uint8_t *originalPkt = demux_synchronise (this);
+  if (originalPkt == NULL)
+    return;
+  demux_ts_parse_tsp (this, originalPkt, _X_BE_32 (originalPkt));
+}
+#endif
+
 /* 0 (go on), 1 (recheck), 2 (stop) */
 static int demux_ts_parse_pat_pmt_packet (demux_ts_t*this) {
 
@@ -3016,7 +3572,16 @@ static int demux_ts_send_chunk (demux_plugin_t *this_gen) {
 
   demux_ts_event_handler (this);
 
+  if (this->tap_changed)
+    demux_ts_tap_check (this);
+
+  this->keyframes_only = _x_stream_info_get (this->stream, XINE_STREAM_INFO_KEYFRAMES_ONLY) ? 1 : 0;
+
+#if TS_PACKET_READER == 2
+  demux_ts_parse_packets (this);
+#elif TS_PACKET_READER == 1
   demux_ts_parse_packet(this);
+#endif
 
   /* DVBSUB: check if channel has changed.  Dunno if I should, or
    * even could, lock the xine object. */
@@ -3027,10 +3592,139 @@ static int demux_ts_send_chunk (demux_plugin_t *this_gen) {
   return this->status;
 }
 
+/*
+ * background seek index builder. reads the file through a private input clone,
+ * looks at the video pes heads only, and adds all keyframes it finds.
+ */
+
+#define TS_INDEX_READ 1024 /* packets */
+
+static void *demux_ts_index_loop (void *data) {
+  demux_ts_t *this = (demux_ts_t *)data;
+  input_plugin_t *input = this->index_input;
+  frametype_t (*get_frametype)(const uint8_t *f, uint32_t len) = this->get_frametype;
+  uint32_t psize = this->hdmv > 0 ? 192 : PKT_SIZE;
+  uint32_t want_phead = (SYNC_BYTE << 24) | TSP_payload_unit_start | (this->videoPid << 8) | TSP_adaptation_field_0;
+  uint8_t *buf;
+  off_t pos = 0, prev = 0;
+
+  buf = malloc (psize * TS_INDEX_READ);
+  if (!buf)
+    return NULL;
+  if (input->seek (input, 0, SEEK_SET) != 0) {
+    free (buf);
+    return NULL;
+  }
+
+  while (!this->index_stop) {
+    off_t n = input->read (input, buf, psize * TS_INDEX_READ), i;
+
+    if (n < (off_t)psize) {
+      if (n >= 0) {
+        _x_seek_index_set_complete (this->seek_index);
+        xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+          "demux_ts: seek index: indexed %" PRId64 " bytes.\n", (int64_t)pos);
+      }
+      break;
+    }
+    for (i = 0; i + psize <= n; i += psize) {
+      const uint8_t *p = buf + i + psize - PKT_SIZE;
+      uint32_t phead, len = PKT_SIZE;
+
+      if (p[0] != SYNC_BYTE) {
+        /* resync: need 2 sync bytes in a row. */
+        off_t j;
+        for (j = i + 1; j + psize + PKT_SIZE <= n; j++) {
+          if ((buf[j + psize - PKT_SIZE] == SYNC_BYTE) && (buf[j + 2 * psize - PKT_SIZE] == SYNC_BYTE))
+            break;
+        }
+        prev = -1;
+        i = j;
+        break;
+      }
+      phead = _X_BE_32 (p);
+      if ((phead & (TSP_sync_byte | TSP_transport_error | TSP_payload_unit_start
+                   | TSP_pid | TSP_scrambling_control | TSP_adaptation_field_0)) != want_phead)
+        continue;
+      p += 4;
+      len -= 4;
+      if (phead & TSP_adaptation_field_1) {
+        uint32_t al = 1 + p[0];
+        if (len < al)
+          continue;
+        p += al;
+        len -= al;
+      }
+      /* pes head with pts */
+      if ((len < 14) || ((_X_BE_32 (p) >> 8) != 1) || !(p[7] & 0x80))
+        continue;
+      {
+        uint32_t el = 9 + p[8];
+        int64_t pts;
+        if (len < el)
+          continue;
+        pts = (int64_t)(p[9] & 0x0e) << 29;
+        pts |= _X_BE_16 (p + 10) >> 1 << 15;
+        pts |= _X_BE_16 (p + 12) >> 1;
+        if (!pts || (get_frametype (p + el, len - el) != FRAMETYPE_I))
+          continue;
+        _x_seek_index_add (this->seek_index, pos + i, pts, prev);
+        prev = pos + i;
+      }
+    }
+    pos += i;
+    if (i != n) {
+      if (input->seek (input, pos, SEEK_SET) != pos)
+        break;
+    }
+  }
+
+  free (buf);
+  return NULL;
+}
+
+static void demux_ts_index_start (demux_ts_t *this) {
+  input_plugin_t *in2 = NULL;
+
+  if (this->index_running || !_x_seek_index_prebuild (this->seek_index))
+    return;
+  if ((this->videoPid == INVALID_PID) || !this->get_frametype)
+    return;
+  if (this->input->get_optional_data (this->input, &in2, INPUT_OPTIONAL_DATA_CLONE) != INPUT_OPTIONAL_SUCCESS)
+    return;
+  if (!in2)
+    return;
+  this->index_input = in2;
+  this->index_stop  = 0;
+  if (pthread_create (&this->index_thread, NULL, demux_ts_index_loop, this)) {
+    in2->dispose (in2);
+    this->index_input = NULL;
+    return;
+  }
+  this->index_running = 1;
+}
+
+static void demux_ts_index_stop (demux_ts_t *this) {
+  if (this->index_running) {
+    void *dummy;
+    this->index_stop = 1;
+    pthread_join (this->index_thread, &dummy);
+    this->index_running = 0;
+  }
+  if (this->index_input) {
+    this->index_input->dispose (this->index_input);
+    this->index_input = NULL;
+  }
+}
+
 static void demux_ts_dispose (demux_plugin_t *this_gen) {
   int i;
   demux_ts_t*this = (demux_ts_t*)this_gen;
 
+  demux_ts_tap_unregister (this);
+  demux_ts_index_stop (this);
+  _x_seek_index_close (&this->seek_index);
+
   for (i = 0; this->programs[i] != INVALID_PROGRAM; i++) {
     if (this->pmts[i] != NULL) {
       free (this->pmts[i]);
@@ -3086,6 +3780,11 @@ static void demux_ts_send_headers (demux_plugin_t *this_gen) {
 
   _x_demux_control_start (this->stream);
 
+  demux_ts_index_stop (this);
+  _x_seek_index_close (&this->seek_index);
+  this->seek_index = _x_seek_index_open (this->stream, this->input, "ts");
+  this->seek_index_prev = -1;
+
   this->input->seek (this->input, 0, SEEK_SET);
 
   this->send_newpts = 1;
@@ -3103,6 +3802,9 @@ static void demux_ts_send_headers (demux_plugin_t *this_gen) {
   _x_stream_info_set (this->stream, XINE_STREAM_INFO_HAS_AUDIO, 1);
 
   demux_ts_scan_pat_pmt (this);
+  if (this->input->get_current_pos (this->input) == 0)
+    this->seek_index_prev = 0;
+  demux_ts_index_start (this);
 }
 
 static int demux_ts_seek (demux_plugin_t *this_gen,
@@ -3146,8 +3848,16 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
       }
       this->input->seek_time (this->input, start_time, SEEK_SET);
     } else {
+      off_t idx_pos;
+      int idx_time = start_time;
       start_pos = (off_t)((double)start_pos / 65535 * this->input->get_length (this->input));
-      if ((!start_pos) && (start_time)) {
+      /* known keyframe positions are better than any estimate. */
+      idx_pos = ((!start_pos) && (start_time)) ? -1 : start_pos;
+      if (_x_seek_index_find (this->seek_index, &idx_pos, &idx_time) >= 0) {
+        xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+          "demux_ts: seek: using index pos %" PRId64 ".\n", (int64_t)idx_pos);
+        this->input->seek (this->input, idx_pos, SEEK_SET);
+      } else if ((!start_pos) && (start_time)) {
         if (this->input->seek_time) {
           this->input->seek_time (this->input, start_time, SEEK_SET);
         } else {
@@ -3162,6 +3872,7 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
     this->buf_pos  = 0;
     this->buf_size = 0;
 #endif
+    this->seek_index_prev = this->input->get_current_pos (this->input) == 0 ? 0 : -1;
     /* Ideally, we seek to video keyframes.
      * Unfortunately, they are marked in a codec specific way,
      * and may even hide behind escape codes.
@@ -3271,6 +3982,7 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
     m->pts            = 0;
     m->resume         = 0;
   }
+  this->keyframes_keep = 0;
 
   if( !playing ) {
 
@@ -3472,6 +4184,9 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen,
   this->last_pat_time      = 0;
   this->last_keyframe_time = 0;
   this->get_frametype      = NULL;
+  this->pes_frametype      = FRAMETYPE_UNKNOWN;
+  this->keyframes_only     = 0;
+  this->keyframes_keep     = 0;
   this->bounce_left        = 0;
   this->first_pts          = 0;
   this->apts               = 0;
@@ -3484,10 +4199,19 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen,
 #  endif
   this->enlarge_total      = 0;
   this->enlarge_ok         = 0;
+  this->next_master        = NULL;
+  this->tap_new            = NULL;
+  this->taps               = NULL;
+  this->tap_changed        = 0;
+  this->seek_index         = NULL;
+  this->index_input        = NULL;
+  this->index_running      = 0;
 #endif
 
 #  if TS_PACKET_READER == 2
   this->buf_max   = (input->get_capabilities (input) & INPUT_CAP_SEEKABLE) ? BUF_SIZE : SMALL_BUF_SIZE;
+  this->loss_pos   = -1;
+  this->loss_check = 1;
 #  endif
 
   this->stream    = stream;
@@ -3502,6 +4226,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen,
   this->demux_plugin.get_capabilities  = demux_ts_get_capabilities;
   this->demux_plugin.get_optional_data = demux_ts_get_optional_data;
   this->demux_plugin.demux_class       = class_gen;
+  this->tap_reg                        = ((demux_ts_class_t *)class_gen)->tap_reg;
 
   /*
    * Initialise our specialised data.
@@ -3564,29 +4289,359 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen,
   this->vhdfile = fopen ("video_heads.log", "rb+");
 #endif
 
+  /* offer our programs to other streams, unless we are fed by a tap ourselves. */
+  {
+    const char *mrl = input->get_mrl (input);
+    if (!mrl || strncasecmp (mrl, TS_TAP_MRL, sizeof (TS_TAP_MRL) - 1))
+      demux_ts_tap_register (this);
+  }
+
   return &this->demux_plugin;
 }
 
+/*
+ * program tap input plugin
+ */
+
+/* with tap->mutex held. */
+static void demux_ts_tap_wait (demux_ts_tap_t *tap, int ms) {
+  struct timespec ts = {0, 0};
+
+  xine_gettime (&ts);
+  ts.tv_sec  += ms / 1000;
+  ts.tv_nsec += (ms % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_nsec -= 1000000000;
+    ts.tv_sec  += 1;
+  }
+  pthread_cond_timedwait (&tap->cond, &tap->mutex, &ts);
+}
+
+/* with tap->mutex held. */
+static void demux_ts_tap_copy (demux_ts_tap_t *tap, uint8_t *buf, off_t len) {
+  off_t pos = tap->rd;
+
+  while (len > 0) {
+    off_t offs = pos % TS_TAP_RING_SIZE, n = TS_TAP_RING_SIZE - offs;
+    if (n > len)
+      n = len;
+    memcpy (buf, tap->ring + offs, n);
+    buf += n;
+    pos += n;
+    len -= n;
+  }
+}
+
+static int demux_ts_tap_open (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 1;
+}
+
+static uint32_t demux_ts_tap_get_capabilities (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return INPUT_CAP_PREVIEW | INPUT_CAP_NO_CACHE;
+}
+
+static off_t demux_ts_tap_read (input_plugin_t *this_gen, void *buf, off_t len) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+  int tries = 10;
+
+  if (len <= 0)
+    return 0;
+  pthread_mutex_lock (&tap->mutex);
+  while (tap->wr == tap->rd) {
+    if (!tap->master) {
+      pthread_mutex_unlock (&tap->mutex);
+      return 0;
+    }
+    /* dont block demux_loop () for too long. */
+    if (!--tries || _x_action_pending (tap->stream)) {
+      pthread_mutex_unlock (&tap->mutex);
+      errno = EAGAIN;
+      return -1;
+    }
+    demux_ts_tap_wait (tap, 100);
+  }
+  if (len > tap->wr - tap->rd)
+    len = tap->wr - tap->rd;
+  demux_ts_tap_copy (tap, buf, len);
+  tap->rd += len;
+  pthread_mutex_unlock (&tap->mutex);
+  return len;
+}
+
+static buf_element_t *demux_ts_tap_read_block (input_plugin_t *this_gen, fifo_buffer_t *fifo, off_t todo) {
+  (void)this_gen;
+  (void)fifo;
+  (void)todo;
+  return NULL;
+}
+
+static off_t demux_ts_tap_seek (input_plugin_t *this_gen, off_t offset, int origin) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+  off_t pos;
+
+  pthread_mutex_lock (&tap->mutex);
+  pos = tap->rd;
+  pthread_mutex_unlock (&tap->mutex);
+  /* live feed, no way back or forth. */
+  if (((origin == SEEK_SET) && (offset == pos)) || ((origin == SEEK_CUR) && !offset))
+    return pos;
+  return -1;
+}
+
+static off_t demux_ts_tap_get_current_pos (input_plugin_t *this_gen) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+  off_t pos;
+
+  pthread_mutex_lock (&tap->mutex);
+  pos = tap->rd;
+  pthread_mutex_unlock (&tap->mutex);
+  return pos;
+}
+
+static off_t demux_ts_tap_get_length (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 0;
+}
+
+static uint32_t demux_ts_tap_get_blocksize (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 0;
+}
+
+static const char *demux_ts_tap_get_mrl (input_plugin_t *this_gen) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+  return tap->mrl;
+}
+
+static int demux_ts_tap_get_optional_data (input_plugin_t *this_gen, void *data, int data_type) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+
+  if (!data)
+    return INPUT_OPTIONAL_UNSUPPORTED;
+
+  if (data_type == INPUT_OPTIONAL_DATA_LOSS) {
+    off_t *pos = (off_t *)data;
+    pthread_mutex_lock (&tap->mutex);
+    *pos = (tap->loss_get != tap->loss_put) ? tap->loss_pos[tap->loss_get++ & (TS_TAP_LOSS_MAX - 1)] : -1;
+    pthread_mutex_unlock (&tap->mutex);
+    return INPUT_OPTIONAL_SUCCESS;
+  }
+
+  if (data_type == INPUT_OPTIONAL_DATA_PREVIEW) {
+    /* the master needs to see a PAT and a PMT first. give it some seconds. */
+    int tries = 50;
+    off_t n;
+    pthread_mutex_lock (&tap->mutex);
+    while ((tap->wr - tap->rd < TS_TAP_PREVIEW) && tap->master && --tries)
+      demux_ts_tap_wait (tap, 100);
+    n = tap->wr - tap->rd;
+    if (n > MAX_PREVIEW_SIZE)
+      n = MAX_PREVIEW_SIZE;
+    demux_ts_tap_copy (tap, data, n);
+    pthread_mutex_unlock (&tap->mutex);
+    return n;
+  }
+
+  return INPUT_OPTIONAL_UNSUPPORTED;
+}
+
+static void demux_ts_tap_dispose (input_plugin_t *this_gen) {
+  demux_ts_tap_t *tap = (demux_ts_tap_t *)this_gen;
+  demux_ts_t     *master;
+  int             refs;
+
+  pthread_mutex_lock (&tap->reg->lock);
+  tap->closed = 1;
+  master = tap->master;
+  if (master) {
+    demux_ts_tap_t **t;
+    /* not yet in use, just take it back. */
+    for (t = &master->tap_new; *t; t = &(*t)->next) {
+      if (*t == tap) {
+        *t = tap->next;
+        tap->master = NULL;
+        tap->refs--;
+        break;
+      }
+    }
+    /* let the demux thread drop it. */
+    if (tap->master)
+      master->tap_changed = 1;
+  }
+  refs = --tap->refs;
+  pthread_mutex_unlock (&tap->reg->lock);
+
+  if (!refs)
+    demux_ts_tap_free (tap);
+}
+
+static input_plugin_t *demux_ts_tap_get_instance (input_class_t *cls_gen, xine_stream_t *stream, const char *mrl) {
+  demux_ts_tap_class_t *cls = (demux_ts_tap_class_t *)cls_gen;
+  demux_ts_tap_t *tap;
+  demux_ts_t     *master, *m;
+  const char     *key;
+  unsigned long   program;
+  char           *end;
+  int             n;
+
+  if (strncasecmp (mrl, TS_TAP_MRL, sizeof (TS_TAP_MRL) - 1))
+    return NULL;
+  program = strtoul (mrl + sizeof (TS_TAP_MRL) - 1, &end, 10);
+  if ((end == mrl + sizeof (TS_TAP_MRL) - 1) || !program || (program > 0xffff))
+    return NULL;
+  /* optional master mrl */
+  key = ((end[0] == '/') && end[1]) ? end + 1 : NULL;
+  if (!cls->tap_reg)
+    return NULL;
+
+  tap = calloc (1, sizeof (*tap));
+  if (!tap)
+    return NULL;
+  tap->mrl = strdup (mrl);
+  if (!tap->mrl) {
+    free (tap);
+    return NULL;
+  }
+
+#ifndef HAVE_ZERO_SAFE_MEM
+  tap->next     = NULL;
+  tap->closed   = 0;
+  tap->master   = NULL;
+  tap->rd       = 0;
+  tap->wr       = 0;
+  tap->loss_get = 0;
+  tap->loss_put = 0;
+  tap->pat_cc   = 0;
+#endif
+  tap->stream  = stream;
+  tap->reg     = cls->tap_reg;
+  tap->refs    = 1;
+  tap->program = program;
+  tap->pmt_pid = INVALID_PID;
+  pthread_mutex_init (&tap->mutex, NULL);
+  pthread_cond_init (&tap->cond, NULL);
+
+  tap->input_plugin.open              = demux_ts_tap_open;
+  tap->input_plugin.get_capabilities  = demux_ts_tap_get_capabilities;
+  tap->input_plugin.read              = demux_ts_tap_read;
+  tap->input_plugin.read_block        = demux_ts_tap_read_block;
+  tap->input_plugin.seek              = demux_ts_tap_seek;
+  tap->input_plugin.get_current_pos   = demux_ts_tap_get_current_pos;
+  tap->input_plugin.get_length        = demux_ts_tap_get_length;
+  tap->input_plugin.get_blocksize     = demux_ts_tap_get_blocksize;
+  tap->input_plugin.get_mrl           = demux_ts_tap_get_mrl;
+  tap->input_plugin.get_optional_data = demux_ts_tap_get_optional_data;
+  tap->input_plugin.dispose           = demux_ts_tap_dispose;
+  tap->input_plugin.input_class       = cls_gen;
+
+  /* attach to the master playing that mrl, or to the only one there is.
+   * the master picks up the tap with its next send_chunk (). */
+  pthread_mutex_lock (&tap->reg->lock);
+  master = NULL;
+  n = 0;
+  for (m = tap->reg->masters; m; m = m->next_master) {
+    if (key) {
+      const char *mmrl = m->input->get_mrl (m->input);
+      if (mmrl && !strcmp (mmrl, key)) {
+        master = m;
+        break;
+      }
+    } else {
+      master = m;
+      n++;
+    }
+  }
+  if (n > 1)
+    master = NULL;
+  if (master) {
+    tap->master = master;
+    tap->refs++;
+    tap->next = master->tap_new;
+    master->tap_new = tap;
+    master->tap_changed = 1;
+  }
+  pthread_mutex_unlock (&tap->reg->lock);
+  if (!master) {
+    if (n > 1)
+      xprintf (stream->xine, XINE_VERBOSITY_LOG,
+        "demux_ts: %s: %d transport streams playing, use " TS_TAP_MRL "%u/<mrl>.\n",
+        tap->mrl, n, (unsigned int)program);
+    else
+      xprintf (stream->xine, XINE_VERBOSITY_LOG,
+        "demux_ts: %s: no such transport stream playing.\n", tap->mrl);
+    demux_ts_tap_dispose (&tap->input_plugin);
+    return NULL;
+  }
+
+  return &tap->input_plugin;
+}
+
+static void demux_ts_tap_class_dispose (input_class_t *this_gen) {
+  demux_ts_tap_class_t *this = (demux_ts_tap_class_t *)this_gen;
+
+  demux_ts_tap_reg_put (this->tap_reg);
+  free (this);
+}
+
+void *input_tsprog_init_class (xine_t *xine, const void *data) {
+  demux_ts_tap_class_t *this;
+
+  (void)data;
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
+
+  this->input_class.get_instance      = demux_ts_tap_get_instance;
+  this->input_class.identifier        = "tsprog";
+  this->input_class.description       = N_("MPEG transport stream program tap");
+  this->input_class.get_dir           = NULL;
+  this->input_class.get_autoplay_list = NULL;
+  this->input_class.dispose           = demux_ts_tap_class_dispose;
+  this->input_class.eject_media       = NULL;
+
+  /* taps need to find the masters of this xine instance. */
+  this->tap_reg = demux_ts_tap_reg_get (xine);
+  if (!this->tap_reg) {
+    free (this);
+    return NULL;
+  }
+
+  return this;
+}
+
 /*
  * ts demuxer class
  */
+static void demux_ts_class_dispose (demux_class_t *this_gen) {
+  demux_ts_class_t *this = (demux_ts_class_t *)this_gen;
+
+  demux_ts_tap_reg_put (this->tap_reg);
+  free (this);
+}
+
 void *demux_ts_init_class (xine_t *xine, const void *data) {
-  (void)xine;
+  demux_ts_class_t *this;
+
   (void)data;
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
 
-  static const demux_class_t demux_ts_class = {
-    .open_plugin     = open_plugin,
-    .description     = N_("MPEG Transport Stream demuxer"),
-    .identifier      = "MPEG_TS",
-    .mimetypes       = "video/mp2t: m2t: MPEG2 transport stream;",
+  this->demux_class.open_plugin = open_plugin;
+  this->demux_class.description = N_("MPEG Transport Stream demuxer");
+  this->demux_class.identifier  = "MPEG_TS";
+  this->demux_class.mimetypes   = "video/mp2t: m2t: MPEG2 transport stream;";
+  /* accept dvb streams; also handle the special dvbs,dvbt and dvbc
+   * mrl formats: the content is exactly the same but the input plugin
+   * uses a different tuning algorithm [Pragma]
+   */
+  this->demux_class.extensions  = "ts m2t trp m2ts mts dvb:// dvbs:// dvbc:// dvbt:// " TS_TAP_MRL;
+  this->demux_class.dispose     = demux_ts_class_dispose;
 
-    /* accept dvb streams; also handle the special dvbs,dvbt and dvbc
-     * mrl formats: the content is exactly the same but the input plugin
-     * uses a different tuning algorithm [Pragma]
-     */
-    .extensions      = "ts m2t trp m2ts mts dvb:// dvbs:// dvbc:// dvbt://",
-    .dispose         = NULL,
-  };
+  /* offer programs to taps of this xine instance. without, we just play. */
+  this->tap_reg = demux_ts_tap_reg_get (xine);
 
-  return (void *)&demux_ts_class;
+  return this;
 }
@@ -58,6 +58,7 @@ const plugin_info_t xine_plugin_info[] EXPORTED = {
   { PLUGIN_DEMUX, 27, "vc1es",      XINE_VERSION_CODE, &demux_info_plus__0, demux_vc1es_init_class },
   { PLUGIN_DEMUX, 27, "yuv_frames", XINE_VERSION_CODE, &demux_info_plus__0, demux_yuv_frames_init_class },
   { PLUGIN_DEMUX, 27, "yuv4mpeg2",  XINE_VERSION_CODE, &demux_info_plus_10, demux_yuv4mpeg2_init_class },
+  { PLUGIN_INPUT, 18, "tsprog",     XINE_VERSION_CODE, NULL,                input_tsprog_init_class },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
 
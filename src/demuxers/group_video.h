@@ -40,5 +40,7 @@ void *demux_vc1es_init_class       (xine_t *xine, const void *data);
 void *demux_yuv_frames_init_class  (xine_t *xine, const void *data);
 void *demux_yuv4mpeg2_init_class   (xine_t *xine, const void *data);
 
+void *input_tsprog_init_class       (xine_t *xine, const void *data);
+
 #endif
 
@@ -39,6 +39,16 @@
 #include <sys/mman.h>
 #endif
 
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_MMAN_H)
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <sys/uio.h>
+#  include <linux/io_uring.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#    define HAVE_FILE_URING 1
+#  endif
+#endif
+
 #define LOG_MODULE "input_file"
 #define LOG_VERBOSE
 /*
@@ -71,8 +81,60 @@ typedef struct {
   int               mrls_allocated_entries;
   xine_mrl_t      **mrls;
 
+  int               uring_depth;
+  int               uring_direct;
+
 } file_input_class_t;
 
+#ifdef HAVE_FILE_URING
+/* size and alignment of a single read ahead request.
+ * a multiple of any sane logical block size, as needed by O_DIRECT. */
+#define FILE_URING_BLOCK     (256 << 10)
+#define FILE_URING_MAX_DEPTH 32
+
+typedef struct {
+  uint8_t             *buf;
+  off_t                block;
+  enum {
+    URING_SLOT_FREE = 0,
+    URING_SLOT_BUSY,
+    URING_SLOT_DONE
+  }                    state;
+  int                  len;
+  /* 0, or -errno of the last request. len stays valid then. */
+  int                  err;
+  struct iovec         iov;
+} file_uring_slot_t;
+
+typedef struct {
+  int                  ring_fd;
+  /* the descriptor the requests go to. may be an extra O_DIRECT one. */
+  int                  fd;
+  int                  fd_own;
+  unsigned int         depth;
+  unsigned int         busy;
+  unsigned int         queued;
+  off_t                pos;
+  off_t                size;
+
+  uint8_t             *mem;
+  size_t               mem_size;
+
+  void                *sq_ring;
+  size_t               sq_ring_size;
+  unsigned int        *sq_head, *sq_tail, *sq_mask, *sq_array;
+  struct io_uring_sqe *sqes;
+  size_t               sqes_size;
+
+  void                *cq_ring;
+  size_t               cq_ring_size;
+  unsigned int        *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  file_uring_slot_t    slots[FILE_URING_MAX_DEPTH];
+} file_uring_t;
+#endif
+
 typedef struct {
   input_plugin_t    input_plugin;
 
@@ -90,12 +152,24 @@ typedef struct {
   uint8_t          *mmap_base;
   uint8_t          *mmap_curr;
   off_t             mmap_len;
+#endif
+#ifdef HAVE_FILE_URING
+  file_uring_t     *uring;
 #endif
   char             *mrl;
 
 } file_input_plugin_t;
 
+#ifdef HAVE_FILE_URING
+static void file_uring_stop (file_input_plugin_t *this);
+#endif
+
 static void file_input_size (file_input_plugin_t *this, const struct stat *sbuf) {
+#ifdef HAVE_FILE_URING
+  /* read ahead does not know about file updates, fall back to plain read (). */
+  if (this->uring && (sbuf->st_size != this->uring->size))
+    file_uring_stop (this);
+#endif
   if ((sbuf->st_size != this->size) &&
 #ifdef HAVE_MMAP
     !this->mmap_on &&
@@ -168,6 +242,371 @@ static int file_input_check_mmap (file_input_plugin_t *this) {
 }
 #endif
 
+#ifdef HAVE_FILE_URING
+/*
+ * Linux io_uring read ahead.
+ * We keep up to depth aligned FILE_URING_BLOCK reads in flight in front of
+ * the current position, so the demuxer rarely waits for the disk itself.
+ * Everything is done with raw syscalls, there is no liburing dependency.
+ */
+
+static int file_uring_sys_setup (unsigned int entries, struct io_uring_params *p) {
+  return syscall (__NR_io_uring_setup, entries, p);
+}
+
+static int file_uring_sys_enter (int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+  return syscall (__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static void file_uring_submit (file_uring_t *u, file_uring_slot_t *slot) {
+  unsigned int tail = *u->sq_tail;
+  unsigned int idx = tail & *u->sq_mask;
+  struct io_uring_sqe *sqe = &u->sqes[idx];
+
+  /* continue behind what we already got. */
+  slot->iov.iov_base = slot->buf + slot->len;
+  slot->iov.iov_len = FILE_URING_BLOCK - slot->len;
+
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = u->fd;
+  sqe->addr = (uintptr_t)&slot->iov;
+  sqe->len = 1;
+  sqe->off = slot->block * FILE_URING_BLOCK + slot->len;
+  sqe->user_data = slot - u->slots;
+
+  u->sq_array[idx] = idx;
+  __atomic_store_n (u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  u->queued++;
+}
+
+static void file_uring_reap (file_uring_t *u) {
+  unsigned int head = *u->cq_head;
+  unsigned int tail = __atomic_load_n (u->cq_tail, __ATOMIC_ACQUIRE);
+
+  while (head != tail) {
+    const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+    if (cqe->user_data < u->depth) {
+      file_uring_slot_t *slot = &u->slots[cqe->user_data];
+      if (cqe->res < 0) {
+        slot->err = cqe->res;
+      } else if (cqe->res > 0) {
+        off_t want = u->size - slot->block * FILE_URING_BLOCK;
+        if (want > FILE_URING_BLOCK)
+          want = FILE_URING_BLOCK;
+        slot->len += cqe->res;
+        /* short read before block or file end, like plain read () may do
+         * on network file systems. just ask for the rest. O_DIRECT would
+         * refuse that unaligned request, so keep the part there, and let
+         * plain read () do the rest. */
+        if ((slot->len < want) && !u->fd_own) {
+          file_uring_submit (u, slot);
+          head++;
+          continue;
+        }
+      }
+      /* 0 bytes: real end of file, keep what we have. */
+      slot->state = URING_SLOT_DONE;
+      u->busy--;
+    }
+    head++;
+  }
+  __atomic_store_n (u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* return 0 (OK), or -errno. */
+static int file_uring_enter (file_uring_t *u, unsigned int min_complete) {
+  while (u->queued || min_complete) {
+    int r = file_uring_sys_enter (u->ring_fd, u->queued, min_complete,
+      min_complete ? IORING_ENTER_GETEVENTS : 0);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return -errno;
+    }
+    u->queued -= (unsigned int)r <= u->queued ? (unsigned int)r : u->queued;
+    if (!r && !min_complete)
+      return -EAGAIN;
+    if (min_complete) {
+      file_uring_reap (u);
+      break;
+    }
+  }
+  return 0;
+}
+
+static void file_uring_queue (file_uring_t *u, file_uring_slot_t *slot, off_t block) {
+  slot->block = block;
+  slot->state = URING_SLOT_BUSY;
+  slot->len = 0;
+  slot->err = 0;
+  file_uring_submit (u, slot);
+  u->busy++;
+}
+
+static file_uring_slot_t *file_uring_find (file_uring_t *u, off_t block) {
+  unsigned int i;
+
+  for (i = 0; i < u->depth; i++) {
+    if ((u->slots[i].state != URING_SLOT_FREE) && (u->slots[i].block == block))
+      return &u->slots[i];
+  }
+  return NULL;
+}
+
+/* make sure the blocks [pos, pos + depth) are either there or on their way. */
+static int file_uring_fill (file_uring_t *u) {
+  off_t first = u->pos / FILE_URING_BLOCK;
+  off_t last = (u->size + FILE_URING_BLOCK - 1) / FILE_URING_BLOCK;
+  off_t block;
+  unsigned int i;
+
+  if (last > first + (off_t)u->depth)
+    last = first + u->depth;
+
+  for (block = first; block < last; block++) {
+    file_uring_slot_t *slot;
+
+    if (file_uring_find (u, block))
+      continue;
+    /* recycle a slot that is idle and outside the window. */
+    slot = NULL;
+    for (i = 0; i < u->depth; i++) {
+      file_uring_slot_t *s = &u->slots[i];
+      if (s->state == URING_SLOT_BUSY)
+        continue;
+      if ((s->state == URING_SLOT_FREE) || (s->block < first) || (s->block >= first + (off_t)u->depth)) {
+        slot = s;
+        break;
+      }
+    }
+    if (!slot)
+      break;
+    file_uring_queue (u, slot, block);
+  }
+
+  return file_uring_enter (u, 0);
+}
+
+static void file_uring_close (file_uring_t *u) {
+  /* the kernel may still write to our buffers. */
+  while (u->busy) {
+    if (file_uring_enter (u, 1) < 0)
+      break;
+  }
+  if (u->mem)
+    munmap (u->mem, u->mem_size);
+  if (u->sqes)
+    munmap (u->sqes, u->sqes_size);
+  if (u->cq_ring && (u->cq_ring != u->sq_ring))
+    munmap (u->cq_ring, u->cq_ring_size);
+  if (u->sq_ring)
+    munmap (u->sq_ring, u->sq_ring_size);
+  if (u->ring_fd >= 0)
+    close (u->ring_fd);
+  if (u->fd_own)
+    close (u->fd);
+  free (u);
+}
+
+static file_uring_t *file_uring_open (file_input_plugin_t *this, const char *filename, off_t size) {
+  file_input_class_t *cls = (file_input_class_t *)this->input_plugin.input_class;
+  struct io_uring_params p;
+  file_uring_t *u;
+  unsigned int i, depth = cls->uring_depth;
+
+  if (depth < 1)
+    return NULL;
+  if (depth < 2)
+    depth = 2;
+  if (depth > FILE_URING_MAX_DEPTH)
+    depth = FILE_URING_MAX_DEPTH;
+
+  u = calloc (1, sizeof (*u));
+  if (!u)
+    return NULL;
+  u->fd = this->fh;
+  u->depth = depth;
+  u->size = size;
+
+  memset (&p, 0, sizeof (p));
+  u->ring_fd = file_uring_sys_setup (depth, &p);
+  if (u->ring_fd < 0) {
+    int e = errno;
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": io_uring not available (%s), using plain read ().\n", strerror (e));
+    free (u);
+    return NULL;
+  }
+
+  do {
+    u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned int);
+    u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      if (u->cq_ring_size > u->sq_ring_size)
+        u->sq_ring_size = u->cq_ring_size;
+      u->cq_ring_size = u->sq_ring_size;
+    }
+#endif
+    u->sq_ring = mmap (NULL, u->sq_ring_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) {
+      u->sq_ring = NULL;
+      break;
+    }
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      u->cq_ring = u->sq_ring;
+    } else
+#endif
+    {
+      u->cq_ring = mmap (NULL, u->cq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+      if (u->cq_ring == MAP_FAILED) {
+        u->cq_ring = NULL;
+        break;
+      }
+    }
+    u->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+    u->sqes = mmap (NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+      u->sqes = NULL;
+      break;
+    }
+    u->sq_head  = (unsigned int *)((uint8_t *)u->sq_ring + p.sq_off.head);
+    u->sq_tail  = (unsigned int *)((uint8_t *)u->sq_ring + p.sq_off.tail);
+    u->sq_mask  = (unsigned int *)((uint8_t *)u->sq_ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned int *)((uint8_t *)u->sq_ring + p.sq_off.array);
+    u->cq_head  = (unsigned int *)((uint8_t *)u->cq_ring + p.cq_off.head);
+    u->cq_tail  = (unsigned int *)((uint8_t *)u->cq_ring + p.cq_off.tail);
+    u->cq_mask  = (unsigned int *)((uint8_t *)u->cq_ring + p.cq_off.ring_mask);
+    u->cqes     = (struct io_uring_cqe *)((uint8_t *)u->cq_ring + p.cq_off.cqes);
+
+    /* page aligned, as needed by O_DIRECT. */
+    u->mem_size = (size_t)depth * FILE_URING_BLOCK;
+    u->mem = mmap (NULL, u->mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->mem == MAP_FAILED) {
+      u->mem = NULL;
+      break;
+    }
+    for (i = 0; i < depth; i++) {
+      u->slots[i].buf = u->mem + (size_t)i * FILE_URING_BLOCK;
+      u->slots[i].block = -1;
+    }
+
+#ifdef O_DIRECT
+    if (cls->uring_direct) {
+      int fd = xine_open_cloexec (filename, O_RDONLY | O_BINARY | O_DIRECT);
+      if (fd >= 0) {
+        u->fd = fd;
+        u->fd_own = 1;
+      } else {
+        int e = errno;
+        xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+          LOG_MODULE ": O_DIRECT not supported here (%s).\n", strerror (e));
+      }
+    }
+#else
+    (void)filename;
+#endif
+
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": using io_uring read ahead, %u x %d kbytes%s.\n",
+      depth, FILE_URING_BLOCK >> 10, u->fd_own ? ", O_DIRECT" : "");
+    return u;
+  } while (0);
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": io_uring setup failed, using plain read ().\n");
+  file_uring_close (u);
+  return NULL;
+}
+
+/* leave read ahead mode, and continue with plain read () at the same position. */
+static void file_uring_stop (file_input_plugin_t *this) {
+  file_uring_t *u = this->uring;
+
+  if (!u)
+    return;
+  this->uring = NULL;
+  lseek (this->fh, u->pos, SEEK_SET);
+  file_uring_close (u);
+}
+
+/* on failure, this switches back to plain read (), and returns what we got so far. */
+static off_t file_uring_read (file_input_plugin_t *this, uint8_t *buf, off_t len) {
+  file_uring_t *u = this->uring;
+  off_t done = 0;
+  int e = 0, part = 0;
+
+  while ((len > 0) && (u->pos < u->size)) {
+    off_t block = u->pos / FILE_URING_BLOCK;
+    file_uring_slot_t *slot;
+    off_t offs, n;
+
+    while (1) {
+      e = file_uring_fill (u);
+      if (e < 0)
+        break;
+      slot = file_uring_find (u, block);
+      if (slot || !u->busy)
+        break;
+      /* after a seek, all slots may still be busy with stale requests. */
+      e = file_uring_enter (u, 1);
+      if (e < 0)
+        break;
+    }
+    if (e < 0)
+      break;
+    if (!slot) {
+      e = -EAGAIN;
+      break;
+    }
+    while (slot->state == URING_SLOT_BUSY) {
+      e = file_uring_enter (u, 1);
+      if (e < 0)
+        break;
+    }
+    if (e < 0)
+      break;
+    offs = u->pos - block * FILE_URING_BLOCK;
+    if (offs >= slot->len) {
+      /* failed, or a partial block. */
+      e = slot->err;
+      part = 1;
+      break;
+    }
+    n = slot->len - offs;
+    if (n > len)
+      n = len;
+    memcpy (buf, slot->buf + offs, n);
+    buf += n;
+    len -= n;
+    done += n;
+    u->pos += n;
+  }
+
+  if (e < 0) {
+    xprintf (this->stream->xine, XINE_VERBOSITY_LOG,
+      LOG_MODULE ": io_uring read failed (%s), using plain read ().\n", strerror (-e));
+    file_uring_stop (this);
+    return done;
+  }
+  if (part) {
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": io_uring short read, using plain read ().\n");
+    file_uring_stop (this);
+    return done;
+  }
+  /* keep the disk busy while the demuxer works. */
+  if (u->pos < u->size)
+    file_uring_fill (u);
+  return done;
+}
+#endif
+
 static off_t file_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
   file_input_plugin_t *this = (file_input_plugin_t *) this_gen;
   uint8_t *b;
@@ -193,6 +632,15 @@ static off_t file_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
   b = (uint8_t *)buf;
   left = len;
   r = 0;
+#ifdef HAVE_FILE_URING
+  if (this->uring) {
+    off_t n = file_uring_read (this, b, left);
+    if (this->uring)
+      return n;
+    b += n;
+    left -= n;
+  }
+#endif
   while (left > 0) {
     r = read (this->fh, b, left);
     if (r <= 0)
@@ -300,6 +748,28 @@ static off_t file_input_seek (input_plugin_t *this_gen, off_t offset, int origin
   }
 #endif
 
+#ifdef HAVE_FILE_URING
+  if (this->uring) {
+    file_uring_t *u = this->uring;
+    off_t new_pos;
+    switch (origin) {
+    case SEEK_SET: new_pos = offset; break;
+    case SEEK_CUR: new_pos = u->pos + offset; break;
+    case SEEK_END: new_pos = u->size + offset; break;
+    default:
+      errno = EINVAL;
+      return (off_t)-1;
+    }
+    if (new_pos < 0) {
+      errno = EINVAL;
+      return (off_t)-1;
+    }
+    /* stale requests will just be recycled later. */
+    u->pos = new_pos;
+    return new_pos;
+  }
+#endif
+
   return lseek (this->fh, offset, origin);
 }
 
@@ -313,6 +783,10 @@ static off_t file_input_get_current_pos (input_plugin_t *this_gen){
   if ( file_input_check_mmap(this) )
     return (this->mmap_curr - this->mmap_base);
 #endif
+#ifdef HAVE_FILE_URING
+  if (this->uring)
+    return this->uring->pos;
+#endif
 
   return lseek (this->fh, 0, SEEK_CUR);
 }
@@ -367,6 +841,10 @@ static void file_input_dispose (input_plugin_t *this_gen ) {
   if ( this->mmap_base )
     munmap(this->mmap_base, this->mmap_len);
 #endif
+#ifdef HAVE_FILE_URING
+  if (this->uring)
+    file_uring_close (this->uring);
+#endif
 
   if (this->fh != -1)
     close(this->fh);
@@ -406,8 +884,8 @@ static int file_input_open (input_plugin_t *this_gen ) {
     return -1;
 
   this->fh = xine_open_cloexec (filename, O_RDONLY | O_BINARY);
-  _x_freep (&filename);
   if (this->fh == -1) {
+    _x_freep (&filename);
     if (errno == EACCES) {
       _x_message(this->stream, XINE_MSG_PERMISSION_ERROR, this->mrl, NULL);
       xine_log (this->stream->xine, XINE_LOG_MSG,
@@ -443,14 +921,27 @@ static int file_input_open (input_plugin_t *this_gen ) {
 #endif
 
   /* don't check length of fifo or character device node */
-  if (!sres && !S_ISREG (sbuf.st_mode))
+  if (!sres && !S_ISREG (sbuf.st_mode)) {
+    _x_freep (&filename);
     return 1;
+  }
+
+#ifdef HAVE_FILE_URING
+  this->uring = NULL;
+  if (!sres && (this->state == FILE_STATIC) && (sbuf.st_size > 0))
+    this->uring = file_uring_open (this, filename, sbuf.st_size);
+#endif
+  _x_freep (&filename);
 
 #ifdef HAVE_MMAP
   this->mmap_base = NULL;
   do {
     uint8_t *mmap_base;
     size_t tmp_size;
+#ifdef HAVE_FILE_URING
+    if (this->uring)
+      break;
+#endif
     /* may cause truncation - if it does, DON'T mmap! */
     tmp_size = (size_t)sbuf.st_size;
     if ((off_t)tmp_size != sbuf.st_size)
@@ -582,6 +1073,18 @@ static void file_input_origin_change_cb (void *data, xine_cfg_entry_t *cfg) {
   this->origin_path = cfg->str_value;
 }
 
+static void file_input_uring_depth_change_cb (void *data, xine_cfg_entry_t *cfg) {
+  file_input_class_t *this = (file_input_class_t *) data;
+
+  this->uring_depth = cfg->num_value;
+}
+
+static void file_input_uring_direct_change_cb (void *data, xine_cfg_entry_t *cfg) {
+  file_input_class_t *this = (file_input_class_t *) data;
+
+  this->uring_direct = cfg->num_value;
+}
+
 /*
  * Sorting function, it comes from GNU fileutils package.
  */
@@ -1078,6 +1581,21 @@ static void *file_input_init_plugin (xine_t *xine, const void *data) {
 						0, file_input_origin_change_cb, (void *) this);
   }
 
+  this->uring_depth = config->register_range (config, "media.files.io_uring_depth", 0, 0, 32,
+    _("number of read ahead requests (Linux io_uring)"),
+    _("Read local files through Linux io_uring, and keep this many aligned "
+      "256 kbyte reads in flight ahead of the current position.\n"
+      "This helps when the disk is slow or busy with other streams.\n"
+      "0 disables this, and xine will use mmap () or plain read () as usual."),
+    20, file_input_uring_depth_change_cb, (void *) this);
+
+  this->uring_direct = config->register_bool (config, "media.files.io_uring_direct", 0,
+    _("bypass the page cache for read ahead"),
+    _("Open files with O_DIRECT when io_uring read ahead is enabled.\n"
+      "This avoids polluting the page cache with data that is only used once, "
+      "but it is not supported by all file systems."),
+    20, file_input_uring_direct_change_cb, (void *) this);
+
   _x_input_register_show_hidden_files(config);
 
   return this;
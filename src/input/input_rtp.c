@@ -85,6 +85,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 #include <stdlib.h>
 #include <net/if.h>
 #include <sys/select.h>
@@ -117,7 +118,78 @@
   }
 #endif
 
-#define BUFFER_SIZE (1024*1024)
+/* socket receive buffer. 4 MB is about 400 ms of a 80 Mbit/s stream. */
+#define RCVBUF_SIZE (4*1024*1024)
+
+/* the ring between receive thread and reader holds whole datagrams.
+ * slots are big enough for jumbo frames, larger datagrams are dropped. */
+#define RTP_SLOT_SIZE  9216
+#define RTP_RING_SLOTS 512
+#define RTP_RING_MASK  (RTP_RING_SLOTS - 1)
+/* max datagrams per recvmmsg () call. */
+#define RTP_BATCH      32
+/* max reorder depth, and recently published sequence numbers we remember. */
+#define RTP_JB_MAX     256
+#define RTP_JB_MASK    (RTP_JB_MAX - 1)
+#define RTP_HIST_MASK  RTP_RING_MASK
+/* all packet buffers: ring + jitter buffer + receive batch with some spare. */
+#define RTP_NUM_PKTS   (RTP_RING_SLOTS + RTP_JB_MAX + 2 * RTP_BATCH)
+/* a gap is given up after this time without new data [us]. */
+#define RTP_JB_TIMEOUT 50000
+/* SMPTE 2022-1 FEC packets we keep. */
+#define RTP_FEC_MAX    64
+/* FEC payload type, and max matrix size L x D. */
+#define RTP_FEC_PT     96
+#define RTP_FEC_L_MAX  20
+#define RTP_FEC_D_MAX  20
+#define RTP_FEC_LD_MAX 100
+/* unread loss positions. */
+#define RTP_LOSS_MAX   32
+
+/* ring indices are shared between 2 threads without a lock.
+ * we need sequential consistency for the reader_waiting handshake. */
+#if (HAVE_ATOMIC_VARS == 1) || (HAVE_ATOMIC_VARS == 2)
+#  define RTP_AT_GET(v)   __atomic_load_n (&(v), __ATOMIC_SEQ_CST)
+#  define RTP_AT_SET(v,n) __atomic_store_n (&(v), (n), __ATOMIC_SEQ_CST)
+#  define RTP_AT_ADD(v,n) __atomic_fetch_add (&(v), (n), __ATOMIC_SEQ_CST)
+#elif (HAVE_ATOMIC_VARS == 3)
+#  define RTP_AT_GET(v)   __sync_fetch_and_add (&(v), 0)
+#  define RTP_AT_SET(v,n) do { __sync_synchronize (); (v) = (n); __sync_synchronize (); } while (0)
+#  define RTP_AT_ADD(v,n) __sync_fetch_and_add (&(v), (n))
+#else
+#  define RTP_AT_GET(v)   (*(volatile __typeof__ (v) *)&(v))
+#  define RTP_AT_SET(v,n) (*(volatile __typeof__ (v) *)&(v) = (n))
+#  define RTP_AT_ADD(v,n) ((*(volatile __typeof__ (v) *)&(v)) += (n))
+#endif
+
+typedef struct {
+  int64_t           stamp;        /* kernel receive time [us], or 0 */
+  int               start;        /* payload offset */
+  int               len;          /* payload length, 0 = skip */
+  uint32_t          lost_before;  /* datagrams missing right before this one */
+  uint16_t          seq;          /* rtp sequence number */
+  uint8_t           data[RTP_SLOT_SIZE];
+} rtp_packet_t;
+
+/* SMPTE 2022-1 (RFC 2733 style) FEC packet. */
+typedef struct {
+  uint16_t          snbase;       /* first protected sequence number */
+  uint16_t          len_rec;      /* xor of protected payload lengths */
+  uint8_t           offset;       /* distance of protected packets: L (column) or 1 (row) */
+  uint8_t           na;           /* number of protected packets */
+  int               len;          /* FEC payload length, 0 = unused */
+  uint8_t           data[RTP_SLOT_SIZE];
+} rtp_fec_t;
+
+typedef struct {
+  input_class_t     input_class;
+
+  xine_t           *xine;
+
+  int               busy_poll;
+  int               jb_depth;
+  int               fec;
+} rtp_input_class_t;
 
 typedef struct {
   input_plugin_t    input_plugin;
@@ -133,13 +205,48 @@ typedef struct {
   int               is_rtp;
 
   int               fh;
-
-  unsigned char    *buffer;	  /* circular buffer */
-  unsigned char	   *buffer_get_ptr;  /* get pointer used by reader */
-  unsigned char	   *buffer_put_ptr;  /* put pointer used by writer */
-  long              buffer_count; /* number of bytes in the buffer */
-
-  unsigned char     packet_buffer[65536];
+  int               fec_fh[2];    /* column and row FEC streams at port + 2, port + 4 */
+
+  rtp_packet_t     *pkts;
+
+  /* single producer (receive thread), single consumer (rtp_plugin_read).
+   * published packets stay readable for the producer until it recycles
+   * their slot. this allows FEC recovery without keeping extra copies. */
+  rtp_packet_t    **ring;
+  uint32_t          ring_put;     /* written by receive thread only */
+  uint32_t          ring_get;     /* written by reader only */
+  int               get_offs;     /* reader position inside ring[ring_get] */
+  int               reader_waiting;
+
+  /* receive thread private */
+  rtp_packet_t     *spare[RTP_NUM_PKTS];
+  int               num_spare;
+  /* reorder buffer, indexed by sequence number */
+  rtp_packet_t     *jb[RTP_JB_MAX];
+  int               jb_depth;
+  int               jb_fill;
+  int               jb_started;
+  uint16_t          jb_next;      /* next sequence number to publish */
+  uint16_t          jb_last;      /* highest sequence number seen */
+  uint32_t          pending_lost;
+  uint32_t          hist_pos[RTP_HIST_MASK + 1]; /* ring position of a published seq */
+  rtp_fec_t        *fec;
+  int               fec_next;
+  uint32_t          seq_lost;
+  uint32_t          fec_recovered;
+  uint32_t          reordered;
+
+  /* reader private: positions of lost data in the output stream */
+  off_t             loss_pos[RTP_LOSS_MAX];
+  uint32_t          loss_get, loss_put;
+
+  /* drop statistics, in datagrams */
+  uint32_t          kernel_drops; /* socket queue overflow, as told by SO_RXQ_OVFL */
+  uint32_t          input_drops;  /* ring full, or datagram too large */
+  uint32_t          reported_kernel_drops;
+  uint32_t          reported_input_drops;
+  uint32_t          reported_seq_events;
+  time_t            last_report;
 
   int               last_input_error;
   int               input_eof;
@@ -156,7 +263,6 @@ typedef struct {
   nbc_t		   *nbc;
 
   pthread_mutex_t   buffer_ring_mut;
-  pthread_cond_t    writer_cond;
   pthread_cond_t    reader_cond;
 } rtp_input_plugin_t;
 
@@ -168,7 +274,7 @@ typedef struct {
  *
  */
 static int host_connect_attempt(struct in_addr ia, int port,
-				const char *interface,
+				const char *interface, int busy_poll,
 				xine_t *xine) {
   int s = xine_socket_cloexec(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
   union {
@@ -194,8 +300,8 @@ static int host_connect_attempt(struct in_addr ia, int port,
   }
 
 
-  /* Try to increase receive buffer to 1MB to avoid dropping packets */
-  optval = BUFFER_SIZE;
+  /* Try to increase receive buffer to avoid dropping packets */
+  optval = RCVBUF_SIZE;
   if ((setsockopt(s, SOL_SOCKET, SO_RCVBUF,
 		  &optval, sizeof(optval))) < 0) {
     LOG_MSG(xine, _("setsockopt(SO_RCVBUF): %s.\n"), strerror(errno));
@@ -203,6 +309,30 @@ static int host_connect_attempt(struct in_addr ia, int port,
     return -1;
   }
 
+  /* The following are nice to have only. */
+#ifdef SO_TIMESTAMP
+  /* kernel receive time stamps */
+  optval = 1;
+  if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &optval, sizeof(optval)) < 0)
+    xprintf(xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": setsockopt(SO_TIMESTAMP): %s.\n", strerror(errno));
+#endif
+#ifdef SO_RXQ_OVFL
+  /* socket queue drop counter */
+  optval = 1;
+  if (setsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, &optval, sizeof(optval)) < 0)
+    xprintf(xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": setsockopt(SO_RXQ_OVFL): %s.\n", strerror(errno));
+#endif
+#ifdef SO_BUSY_POLL
+  /* let the kernel poll the nic for this many us instead of waiting for an interrupt */
+  if (busy_poll > 0) {
+    optval = busy_poll;
+    if (setsockopt(s, SOL_SOCKET, SO_BUSY_POLL, &optval, sizeof(optval)) < 0)
+      LOG_MSG(xine, _("setsockopt(SO_BUSY_POLL): %s.\n"), strerror(errno));
+  }
+#else
+  (void)busy_poll;
+#endif
+
   /* If multicast we allow multiple readers to open the same address */
   if (multicast) {
     if ((setsockopt(s, SOL_SOCKET, SO_REUSEADDR,
@@ -268,7 +398,7 @@ static int host_connect_attempt(struct in_addr ia, int port,
  *
  */
 static int host_connect(const char *host, int port,
-			const char *interface,
+			const char *interface, int busy_poll,
 			xine_t *xine)
 {
   struct hostent *h;
@@ -284,25 +414,404 @@ static int host_connect(const char *host, int port,
   for(i=0; h->h_addr_list[i]; i++) {
     struct in_addr ia;
     memcpy(&ia, h->h_addr_list[i],4);
-    s = host_connect_attempt(ia, port, interface, xine);
+    s = host_connect_attempt(ia, port, interface, busy_poll, xine);
     if (s != -1) return s;
   }
   LOG_MSG(xine, _("unable to bind to '%s'.\n"), host);
   return -1;
 }
 
+/*
+ * Do minimal RTP parsing to extract payload.  See
+ * RFC 3550 section 5.1 for header format.
+ */
+static void rtp_parse_packet(rtp_packet_t *pkt) {
+  const uint8_t *data = pkt->data + pkt->start;
+  int length = pkt->len;
+  int hlen;
+
+  if (length < 12) {
+    pkt->len = 0;
+    return;
+  }
+
+  pkt->seq = (data[2] << 8) | data[3];
+
+  /* fixed header and csrc list */
+  hlen = 12 + (data[0] & 0x0f) * 4;
+
+  /* header extension: 16 bit profile, 16 bit length in 32 bit words */
+  if (data[0] & 0x10) {
+    if (length < hlen + 4) {
+      pkt->len = 0;
+      return;
+    }
+    hlen += 4 + ((data[hlen + 2] << 8) | data[hlen + 3]) * 4;
+  }
+
+  /* the last padding byte counts all padding bytes including itself */
+  if (data[0] & 0x20)
+    length -= data[length - 1];
+
+  length -= hlen;
+  pkt->start += hlen;
+  pkt->len = length > 0 ? length : 0;
+}
+
+/*
+ * Update public drop statistics, at most once a second unless forced.
+ */
+static void rtp_report_drops(rtp_input_plugin_t *this, int force) {
+  time_t now;
+
+  if ((this->kernel_drops == this->reported_kernel_drops) &&
+      (this->input_drops == this->reported_input_drops) &&
+      (this->seq_lost + this->fec_recovered == this->reported_seq_events))
+    return;
+
+  now = time(NULL);
+  if ((now == this->last_report) && !force)
+    return;
+  this->last_report = now;
+
+  xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": lost %u datagrams in socket queue, %u in input ring so far. "
+    "%u sequence numbers missing, %u recovered by FEC, %u reordered.\n",
+    (unsigned int)this->kernel_drops, (unsigned int)this->input_drops,
+    (unsigned int)this->seq_lost, (unsigned int)this->fec_recovered, (unsigned int)this->reordered);
+  _x_stream_info_set(this->stream, XINE_STREAM_INFO_NET_KERNEL_DROPS, this->kernel_drops);
+  _x_stream_info_set(this->stream, XINE_STREAM_INFO_NET_INPUT_DROPS, this->input_drops);
+  this->reported_kernel_drops = this->kernel_drops;
+  this->reported_input_drops = this->input_drops;
+  this->reported_seq_events = this->seq_lost + this->fec_recovered;
+}
+
+/*
+ * Hand a packet over to the reader. On overflow, the packet is lost,
+ * and the loss is told along with the next one.
+ */
+static void rtp_publish(rtp_input_plugin_t *this, rtp_packet_t *pkt) {
+  uint32_t put = this->ring_put;
+
+  pkt->lost_before = this->pending_lost;
+  if (put - RTP_AT_GET(this->ring_get) >= RTP_RING_SLOTS) {
+    this->input_drops++;
+    this->pending_lost++;
+    this->spare[this->num_spare++] = pkt;
+    return;
+  }
+  this->pending_lost = 0;
+  /* the slot still holds a packet the reader is done with. */
+  this->spare[this->num_spare++] = this->ring[put & RTP_RING_MASK];
+  this->ring[put & RTP_RING_MASK] = pkt;
+  this->hist_pos[pkt->seq & RTP_HIST_MASK] = put;
+  RTP_AT_SET(this->ring_put, put + 1);
+}
+
+static void rtp_wake_reader(rtp_input_plugin_t *this) {
+  if (RTP_AT_GET(this->reader_waiting)) {
+    pthread_mutex_lock(&this->buffer_ring_mut);
+    pthread_cond_signal(&this->reader_cond);
+    pthread_mutex_unlock(&this->buffer_ring_mut);
+  }
+}
+
+/*
+ * Find a received packet by sequence number, either still in the
+ * reorder buffer or already published.
+ */
+static const rtp_packet_t *rtp_find_seq(rtp_input_plugin_t *this, uint16_t seq) {
+  const rtp_packet_t *pkt;
+  int16_t d = seq - this->jb_next;
+
+  if (d >= 0) {
+    if (d >= RTP_JB_MAX)
+      return NULL;
+    pkt = this->jb[seq & RTP_JB_MASK];
+  } else {
+    uint32_t pos = this->hist_pos[seq & RTP_HIST_MASK];
+    /* the oldest slot will be recycled by the next publish. */
+    if (this->ring_put - pos - 1 >= RTP_RING_SLOTS - 1)
+      return NULL;
+    pkt = this->ring[pos & RTP_RING_MASK];
+  }
+  return (pkt && (pkt->seq == seq)) ? pkt : NULL;
+}
+
+/*
+ * Try to rebuild a missing packet from one FEC packet and the other
+ * packets it protects. We assume plain payloads without csrc list,
+ * header extension or padding, as used for MPEG-TS over RTP.
+ */
+static rtp_packet_t *rtp_fec_recover(rtp_input_plugin_t *this, uint16_t seq) {
+  int i;
+
+  if (!this->fec || !this->num_spare)
+    return NULL;
+
+  for (i = 0; i < RTP_FEC_MAX; i++) {
+    const rtp_fec_t *f = &this->fec[i];
+    rtp_packet_t *pkt;
+    uint16_t k;
+    unsigned int j, len;
+
+    if (!f->len || !f->offset || !f->na)
+      continue;
+    k = seq - f->snbase;
+    if ((k % f->offset) || (k / f->offset >= f->na))
+      continue;
+
+    /* all others must be there. */
+    for (j = 0; j < f->na; j++) {
+      uint16_t s = f->snbase + j * f->offset;
+      if ((s != seq) && !rtp_find_seq(this, s))
+        break;
+    }
+    if (j < f->na)
+      continue;
+
+    pkt = this->spare[--this->num_spare];
+    memcpy(pkt->data, f->data, f->len);
+    len = f->len_rec;
+    for (j = 0; j < f->na; j++) {
+      uint16_t s = f->snbase + j * f->offset;
+      const rtp_packet_t *p;
+      const uint8_t *src;
+      int n;
+      if (s == seq)
+        continue;
+      p = rtp_find_seq(this, s);
+      src = p->data + p->start;
+      n = p->len < f->len ? p->len : f->len;
+      while (--n >= 0)
+        pkt->data[n] ^= src[n];
+      len ^= p->len;
+    }
+    if (len > (unsigned int)f->len) {
+      this->spare[this->num_spare++] = pkt;
+      continue;
+    }
+    pkt->stamp = 0;
+    pkt->start = 0;
+    pkt->len = len;
+    pkt->seq = seq;
+    this->fec_recovered++;
+    return pkt;
+  }
+  return NULL;
+}
+
+/*
+ * Publish everything up to seq end (excluding), and give up waiting
+ * for the gaps.
+ */
+static void rtp_jb_advance(rtp_input_plugin_t *this, uint16_t end) {
+  while (this->jb_next != end) {
+    uint16_t seq = this->jb_next;
+    rtp_packet_t *pkt = this->jb[seq & RTP_JB_MASK];
+
+    if (pkt) {
+      this->jb[seq & RTP_JB_MASK] = NULL;
+      this->jb_fill--;
+    } else {
+      pkt = rtp_fec_recover(this, seq);
+    }
+    this->jb_next++;
+    if (pkt) {
+      rtp_publish(this, pkt);
+    } else {
+      this->pending_lost++;
+      this->seq_lost++;
+    }
+  }
+}
+
+/* publish the contiguous part. */
+static void rtp_jb_flush_ready(rtp_input_plugin_t *this) {
+  rtp_packet_t *pkt;
+
+  while ((pkt = this->jb[this->jb_next & RTP_JB_MASK]) != NULL) {
+    this->jb[this->jb_next & RTP_JB_MASK] = NULL;
+    this->jb_fill--;
+    this->jb_next++;
+    rtp_publish(this, pkt);
+  }
+}
+
+/*
+ * Put a received RTP packet into sequence.
+ */
+static void rtp_jb_put(rtp_input_plugin_t *this, rtp_packet_t *pkt) {
+  int window = this->jb_depth > 0 ? this->jb_depth : 1;
+  int16_t d;
+
+  if (!this->jb_started) {
+    this->jb_started = 1;
+    this->jb_next = pkt->seq;
+    this->jb_last = pkt->seq;
+  }
+
+  d = pkt->seq - this->jb_next;
+
+  if ((d < -RTP_RING_SLOTS) || (d >= RTP_JB_MAX + window)) {
+    /* sender restart, or we missed a lot. */
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": sequence jump %u -> %u.\n", (unsigned int)this->jb_next, (unsigned int)pkt->seq);
+    rtp_jb_advance(this, this->jb_last + 1);
+    this->pending_lost++;
+    this->jb_next = pkt->seq;
+    this->jb_last = pkt->seq;
+    d = 0;
+  }
+
+  if (d < 0) {
+    /* too late, or duplicate. */
+    this->spare[this->num_spare++] = pkt;
+    return;
+  }
+
+  if (d >= window) {
+    /* make room. */
+    rtp_jb_advance(this, pkt->seq - window + 1);
+  }
+
+  if (this->jb[pkt->seq & RTP_JB_MASK]) {
+    /* duplicate. */
+    this->spare[this->num_spare++] = pkt;
+    return;
+  }
+
+  if ((int16_t)(pkt->seq - this->jb_last) > 0)
+    this->jb_last = pkt->seq;
+  else if (pkt->seq != this->jb_next)
+    this->reordered++;
+
+  this->jb[pkt->seq & RTP_JB_MASK] = pkt;
+  this->jb_fill++;
+  rtp_jb_flush_ready(this);
+}
+
+/*
+ * Receive a SMPTE 2022-1 FEC packet. Anything else may arrive at these
+ * ports as well, so check it carefully before we xor it into media.
+ * row is 0 for column FEC (port + 2), 1 for row FEC (port + 4).
+ */
+static void rtp_fec_receive(rtp_input_plugin_t *this, int fh, int row) {
+  rtp_fec_t *f = &this->fec[this->fec_next];
+  uint8_t buf[RTP_SLOT_SIZE + 28];
+  const uint8_t *h;
+  ssize_t len;
+  int hlen, plen;
+  unsigned int snbase, len_rec, offset, na, m;
+
+  len = recv(fh, buf, sizeof(buf), MSG_DONTWAIT);
+  if (len < 12 + 16)
+    return;
+  /* RTP version 2, no padding or extension. */
+  if ((buf[0] & 0xf0) != 0x80)
+    return;
+  if ((buf[1] & 0x7f) != RTP_FEC_PT)
+    return;
+  hlen = 12 + (buf[0] & 0x0f) * 4;
+  if (len < hlen + 16)
+    return;
+  plen = len - hlen - 16;
+  if ((plen <= 0) || (plen > RTP_SLOT_SIZE))
+    return;
+  h = buf + hlen;
+  /* E set, mask 0, no extended (N) headers, xor type only,
+   * D matches the port, index and SNBase ext 0. */
+  if (!(h[4] & 0x80) || h[5] || h[6] || h[7] || (h[12] != (row ? 0x40 : 0x00)) || h[15])
+    return;
+
+  snbase  = (h[0] << 8) | h[1];
+  len_rec = (h[2] << 8) | h[3];
+  offset  = h[13];
+  na      = h[14];
+  if (row) {
+    if ((offset != 1) || (na < 1) || (na > RTP_FEC_L_MAX))
+      return;
+  } else {
+    if ((offset < 1) || (offset > RTP_FEC_L_MAX) || (na < 1) || (na > RTP_FEC_D_MAX) ||
+        (offset * na > RTP_FEC_LD_MAX))
+      return;
+  }
+  /* the xor of lengths up to plen cannot have a higher bit. */
+  m = 1;
+  while (m <= (unsigned int)plen)
+    m <<= 1;
+  if (len_rec >= m)
+    return;
+  /* must protect something we still wait for, and not too far ahead. */
+  if (!this->jb_started)
+    return;
+  if ((int16_t)(snbase + offset * (na - 1) - this->jb_next) < 0)
+    return;
+  if ((int16_t)(snbase - this->jb_last) >= RTP_JB_MAX)
+    return;
+
+  f->snbase  = snbase;
+  f->len_rec = len_rec;
+  f->offset  = offset;
+  f->na      = na;
+  f->len     = plen;
+  memcpy(f->data, h + 16, f->len);
+  this->fec_next = (this->fec_next + 1) % RTP_FEC_MAX;
+}
+
+/* control message space for receive time and drop counter */
+#define RTP_CMSG_SIZE 128
+
+static void rtp_parse_cmsg(rtp_input_plugin_t *this, struct msghdr *msg, rtp_packet_t *pkt) {
+  struct cmsghdr *cm;
+
+  pkt->stamp = 0;
+  for (cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(msg, cm)) {
+    if (cm->cmsg_level != SOL_SOCKET)
+      continue;
+#ifdef SO_TIMESTAMP
+    if (cm->cmsg_type == SCM_TIMESTAMP) {
+      struct timeval tv;
+      memcpy(&tv, CMSG_DATA(cm), sizeof(tv));
+      pkt->stamp = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    }
+#endif
+#ifdef SO_RXQ_OVFL
+    if (cm->cmsg_type == SO_RXQ_OVFL) {
+      uint32_t drops;
+      memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+      this->kernel_drops = drops;
+    }
+#endif
+  }
+}
+
 /*
  *
  */
 static void * input_plugin_read_loop(void *arg) {
 
   rtp_input_plugin_t *this  = (rtp_input_plugin_t *) arg;
-  unsigned char *data;
-  long length;
+  rtp_packet_t *pkts[RTP_BATCH];
+  struct iovec iov[RTP_BATCH];
+  union {
+    struct cmsghdr hdr;
+    uint8_t        b[RTP_CMSG_SIZE];
+  } ctrl[RTP_BATCH];
+#ifdef HAVE_RECVMMSG
+  struct mmsghdr msgs[RTP_BATCH];
+#else
+  struct {
+    struct msghdr msg_hdr;
+    unsigned int  msg_len;
+  } msgs[1];
+#endif
   fd_set read_fds;
 
   while (1) {
 
+    int i, n;
+
     /* System calls are not a thread cancellation point in Linux
      * pthreads.  However, the RT signal sent to cancel the thread
      * will cause recv() to return with EINTR, and we can manually
@@ -312,138 +821,146 @@ static void * input_plugin_read_loop(void *arg) {
     pthread_testcancel();
     {
     struct timeval recv_timeout;
-    int rc;
+    int rc, maxfh = this->fh;
 
-    recv_timeout.tv_sec = 2;
-    recv_timeout.tv_usec = 0;
+    /* dont wait too long for a missing packet. */
+    recv_timeout.tv_sec = this->jb_fill ? 0 : 2;
+    recv_timeout.tv_usec = this->jb_fill ? RTP_JB_TIMEOUT : 0;
 
     FD_ZERO( &read_fds );
     FD_SET( this->fh, &read_fds );
+    for (i = 0; i < 2; i++) {
+      if (this->fec_fh[i] >= 0) {
+        FD_SET(this->fec_fh[i], &read_fds);
+        if (this->fec_fh[i] > maxfh)
+          maxfh = this->fec_fh[i];
+      }
+    }
 
     /* wait for a packet to arrive - but do not hang! */
-    rc = select( this->fh+1, &read_fds, NULL, NULL, &recv_timeout );
-    if( rc > 0 )
-    {
-        length = recv(this->fh, this->packet_buffer,
-                    sizeof(this->packet_buffer), 0);
-    }
-    else if( rc == 0 )
-        length = 0;
-    else
-        length = -1;
-    }
+    rc = select( maxfh+1, &read_fds, NULL, NULL, &recv_timeout );
     pthread_testcancel();
-
-    if (length < 0) {
+    if (rc < 0) {
       if (errno != EINTR) {
-	LOG_MSG(this->stream->xine, _("recv(): %s.\n"), strerror(errno));
-	return NULL;
+        LOG_MSG(this->stream->xine, _("select(): %s.\n"), strerror(errno));
+        return NULL;
       }
+      continue;
+    }
+    if (rc == 0) {
+      if (this->jb_fill) {
+        rtp_jb_advance(this, this->jb_last + 1);
+        rtp_wake_reader(this);
+      }
+      rtp_report_drops(this, 1);
+      continue;
+    }
     }
-    else {
-      data = this->packet_buffer;
-
-      if (this->is_rtp) {
-	int pad, ext;
-	int csrc;
-
-	/* Do minimal RTP parsing to extract payload.  See
-	 * http://www.faqs.org/rfcs/rfc1889.html for header format.
-	 *
-	 * WARNING: wholly untested code.  I don't have any RTP sender.
-	 */
-
-	if (length < 12) continue;
-
-	pad = data[0] & 0x20;
-	ext = data[0] & 0x10;
-	csrc = data[0] & 0x0f;
-
-	data += 12 + csrc * 4;
-	length -= 12 + csrc * 4;
-
-	if (ext) {
-	  long hlen;
-
-	  if (length < 4) continue;
 
-	  hlen = (data[2] << 8) | data[3];
-	  data += hlen;
-	  length -= hlen;
-	}
+    for (i = 0; i < 2; i++) {
+      if ((this->fec_fh[i] >= 0) && FD_ISSET(this->fec_fh[i], &read_fds))
+        rtp_fec_receive(this, this->fec_fh[i], i);
+    }
+    if (!FD_ISSET(this->fh, &read_fds))
+      continue;
 
-	if (pad) {
-	  if (length < 1)
-	    continue;
+    /* receive directly into spare packets. */
+    n = RTP_BATCH;
+#ifndef HAVE_RECVMMSG
+    n = 1;
+#endif
+    for (i = 0; i < n; i++) {
+      rtp_packet_t *pkt = pkts[i] = this->spare[this->num_spare - 1 - i];
+      iov[i].iov_base = pkt->data;
+      iov[i].iov_len  = sizeof(pkt->data);
+      memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+      msgs[i].msg_hdr.msg_iov        = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen     = 1;
+      msgs[i].msg_hdr.msg_control    = ctrl[i].b;
+      msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i].b);
+    }
+#ifdef HAVE_RECVMMSG
+    n = recvmmsg(this->fh, msgs, n, MSG_DONTWAIT, NULL);
+#else
+    {
+      ssize_t r = recvmsg(this->fh, &msgs[0].msg_hdr, MSG_DONTWAIT);
+      msgs[0].msg_len = r;
+      n = r < 0 ? -1 : 1;
+    }
+#endif
+    pthread_testcancel();
 
-	  /* FIXME: is the pad length byte included in the
-	   * length value or not?  We assume it is not.
-	   */
-	  length -= data[length - 1] + 1;
-	}
+    if (n < 0) {
+      if ((errno != EINTR) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+	LOG_MSG(this->stream->xine, _("recv(): %s.\n"), strerror(errno));
+	return NULL;
       }
-
-      /* insert data into cyclic buffer */
-      if (length > 0) {
-
-	/*
-	 * if the buffer is full, wait for the reader
-	 * to signal
-	 */
-
-        pthread_mutex_lock(&this->buffer_ring_mut);
-        /* wait for enough space to write the whole of the recv'ed data */
-	while( (BUFFER_SIZE - this->buffer_count) < length )
-        {
-          struct timeval tv;
-          struct timespec timeout;
-
-          gettimeofday(&tv, NULL);
-
-          timeout.tv_nsec = tv.tv_usec * 1000;
-          timeout.tv_sec = tv.tv_sec + 2;
-
-          if( pthread_cond_timedwait(&this->writer_cond, &this->buffer_ring_mut, &timeout) != 0 )
-          {
-            fprintf( stdout, "input_rtp: buffer ring not read within 2 seconds!\n" );
-          }
-        }
-
-	/* Now there's enough space to write some bytes into the buffer
-	 * determine how many bytes can be written. If the buffer wraps
-	 * around, write in two pieces: from the head pointer to the
-	 * end of the buffer and from the base to the remaining number
-	 * of bytes.
-	 */
-
-        {
-        long buffer_space_remaining = BUFFER_SIZE - (this->buffer_put_ptr - this->buffer);
-
-	if( buffer_space_remaining >= length )
-        {
-            /* data fits inside the buffer */
-            memcpy(this->buffer_put_ptr, data, length);
-            this->buffer_put_ptr += length;
+      continue;
     }
-	else
-        {
-            /* data wrapped around the end of the buffer */
-            memcpy(this->buffer_put_ptr, data, buffer_space_remaining);
-            memcpy(this->buffer, &data[buffer_space_remaining], length - buffer_space_remaining);
-            this->buffer_put_ptr = &this->buffer[ length - buffer_space_remaining ];
-        }
-        }
-
-	this->buffer_count += length;
-
-	/* signal the reader that there is new data	*/
-	pthread_cond_signal(&this->reader_cond);
-	pthread_mutex_unlock(&this->buffer_ring_mut);
+    this->num_spare -= n;
+
+    for (i = 0; i < n; i++) {
+      rtp_packet_t *pkt = pkts[i];
+      pkt->start = 0;
+      pkt->len = msgs[i].msg_len;
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+        this->input_drops++;
+        pkt->len = 0;
       }
+      rtp_parse_cmsg(this, &msgs[i].msg_hdr, pkt);
+      if (this->is_rtp && pkt->len)
+        rtp_parse_packet(pkt);
+      if (!pkt->len)
+        this->spare[this->num_spare++] = pkt;
+      else if (this->is_rtp)
+        rtp_jb_put(this, pkt);
+      else
+        rtp_publish(this, pkt);
     }
+
+    rtp_wake_reader(this);
+    rtp_report_drops(this, 0);
   }
 }
 
+/*
+ * Put all packets back to the initial places. Receive thread must not run.
+ */
+static void rtp_reset_buffers(rtp_input_plugin_t *this) {
+  int i;
+
+  for (i = 0; i < RTP_RING_SLOTS; i++) {
+    this->ring[i] = &this->pkts[i];
+    this->ring[i]->len = 0;
+    this->ring[i]->lost_before = 0;
+  }
+  for (i = 0; i < RTP_NUM_PKTS - RTP_RING_SLOTS; i++)
+    this->spare[i] = &this->pkts[RTP_RING_SLOTS + i];
+  this->num_spare = i;
+  memset(this->jb, 0, sizeof(this->jb));
+  this->jb_fill = 0;
+  this->jb_started = 0;
+  this->pending_lost = 0;
+  if (this->fec)
+    memset(this->fec, 0, RTP_FEC_MAX * sizeof(*this->fec));
+  this->fec_next = 0;
+
+  this->ring_put = 0;
+  this->ring_get = 0;
+  this->get_offs = 0;
+  this->curpos = 0;
+  this->loss_get = this->loss_put = 0;
+
+  this->kernel_drops = 0;
+  this->input_drops = 0;
+  this->reported_kernel_drops = 0;
+  this->reported_input_drops = 0;
+  this->reported_seq_events = 0;
+  this->seq_lost = 0;
+  this->fec_recovered = 0;
+  this->reordered = 0;
+}
+
 /* ***************************************************************** */
 /*                         END OF PRIVATES                           */
 /* ***************************************************************** */
@@ -453,8 +970,6 @@ static off_t rtp_plugin_read (input_plugin_t *this_gen,
   rtp_input_plugin_t *this = (rtp_input_plugin_t *) this_gen;
   char *buf = (char *)buf_gen;
 
-  struct timeval tv;
-  struct timespec timeout;
   off_t copied = 0;
 
   if (length < 0)
@@ -462,63 +977,60 @@ static off_t rtp_plugin_read (input_plugin_t *this_gen,
 
   while(length > 0) {
 
+    uint32_t get = this->ring_get;
+    rtp_packet_t *pkt;
     off_t n;
 
-    pthread_mutex_lock(&this->buffer_ring_mut);
-
-    /*
-     * if nothing in the buffer, wait for data for 5 seconds. If
-     * no data is received within this timeout, return the number
-     * of bytes already received (which is likely to be 0)
-     */
-
-    if(this->buffer_count == 0) {
-      gettimeofday(&tv, NULL);
-      timeout.tv_nsec = tv.tv_usec * 1000;
-      timeout.tv_sec = tv.tv_sec + 5;
+    if (get == RTP_AT_GET(this->ring_put)) {
+      /*
+       * if nothing in the buffer, wait for data for 5 seconds. If
+       * no data is received within this timeout, return the number
+       * of bytes already received (which is likely to be 0)
+       */
+      int err = 0;
+
+      pthread_mutex_lock(&this->buffer_ring_mut);
+      RTP_AT_SET(this->reader_waiting, 1);
+      if (get == RTP_AT_GET(this->ring_put)) {
+        struct timeval tv;
+        struct timespec timeout;
+
+        gettimeofday(&tv, NULL);
+        timeout.tv_nsec = tv.tv_usec * 1000;
+        timeout.tv_sec = tv.tv_sec + 5;
+        err = pthread_cond_timedwait(&this->reader_cond, &this->buffer_ring_mut, &timeout);
+      }
+      RTP_AT_SET(this->reader_waiting, 0);
+      pthread_mutex_unlock(&this->buffer_ring_mut);
 
-      if(pthread_cond_timedwait(&this->reader_cond, &this->buffer_ring_mut, &timeout) != 0)
-	{
-	  /* we timed out, no data available */
-	  pthread_mutex_unlock(&this->buffer_ring_mut);
-	  return copied;
-	}
+      /* we timed out, no data available */
+      if (err == ETIMEDOUT)
+        break;
+      continue;
     }
 
-    /* Now determine how many bytes can be read. If the buffer
-     * will wrap the buffer is read in two pieces, first read
-     * to the end of the buffer, wrap the tail pointer and
-     * update the buffer count. Finally read the second piece
-     * from the base to the remaining count
-     */
-    if(length  > this->buffer_count) {
-      n = this->buffer_count;
+    /* copy from the current datagram, and release it when done. */
+    pkt = this->ring[get & RTP_RING_MASK];
+    if (!this->get_offs && pkt->lost_before) {
+      /* tell demuxer where the stream is broken. */
+      if (this->loss_put - this->loss_get < RTP_LOSS_MAX)
+        this->loss_pos[this->loss_put++ & (RTP_LOSS_MAX - 1)] = this->curpos + copied;
+      pkt->lost_before = 0;
     }
-    else {
+    n = pkt->len - this->get_offs;
+    if (n > length)
       n = length;
+    if (n > 0) {
+      memcpy(buf, pkt->data + pkt->start + this->get_offs, n);
+      buf += n;
+      copied += n;
+      length -= n;
+      this->get_offs += n;
     }
-
-    if(((this->buffer_get_ptr - this->buffer) + n) > BUFFER_SIZE) {
-      n = BUFFER_SIZE - (this->buffer_get_ptr - this->buffer);
+    if (this->get_offs >= pkt->len) {
+      this->get_offs = 0;
+      RTP_AT_SET(this->ring_get, get + 1);
     }
-
-    /* the actual read */
-    memcpy(buf, this->buffer_get_ptr, n);
-
-    buf += n;
-    copied += n;
-    length -= n;
-
-    /* update the tail pointer, watch for wrap arounds */
-    this->buffer_get_ptr += n;
-    if(this->buffer_get_ptr - this->buffer >= BUFFER_SIZE)
-      this->buffer_get_ptr = this->buffer;
-
-    this->buffer_count -= n;
-
-    /* signal the writer that there's space in the buffer again */
-    pthread_cond_signal(&this->writer_cond);
-    pthread_mutex_unlock(&this->buffer_ring_mut);
   }
 
   this->curpos += copied;
@@ -581,6 +1093,14 @@ static int rtp_plugin_get_optional_data (input_plugin_t *this_gen,
    * The first packet is only used for the preview.
    */
 
+  if (data_type == INPUT_OPTIONAL_DATA_LOSS) {
+    off_t *pos = (off_t *)data;
+    if (!pos)
+      return INPUT_OPTIONAL_UNSUPPORTED;
+    *pos = (this->loss_get != this->loss_put) ? this->loss_pos[this->loss_get++ & (RTP_LOSS_MAX - 1)] : -1;
+    return INPUT_OPTIONAL_SUCCESS;
+  }
+
   if (data_type == INPUT_OPTIONAL_DATA_PREVIEW) {
     if (!this->preview_read_done) {
       this->preview_size = rtp_plugin_read(this_gen, this->preview, MAX_PREVIEW_SIZE);
@@ -612,18 +1132,22 @@ static void rtp_plugin_dispose (input_plugin_t *this_gen ) {
   }
 
   if (this->fh != -1) close(this->fh);
+  if (this->fec_fh[0] != -1) close(this->fec_fh[0]);
+  if (this->fec_fh[1] != -1) close(this->fec_fh[1]);
 
   pthread_mutex_destroy(&this->buffer_ring_mut);
   pthread_cond_destroy(&this->reader_cond);
-  pthread_cond_destroy(&this->writer_cond);
 
-  _x_freep(&this->buffer);
+  _x_freep(&this->fec);
+  _x_freep(&this->ring);
+  _x_freep(&this->pkts);
   _x_freep(&this->mrl);
   free(this);
 }
 
 static int rtp_plugin_open (input_plugin_t *this_gen ) {
   rtp_input_plugin_t *this = (rtp_input_plugin_t *) this_gen;
+  rtp_input_class_t  *cls = (rtp_input_class_t *) this->input_plugin.input_class;
   int                 err;
 
   _x_assert(this->fh == -1);
@@ -635,14 +1159,28 @@ static int rtp_plugin_open (input_plugin_t *this_gen ) {
 	  this->port,
 	  this->interface);
 
+  this->jb_depth = cls->jb_depth;
+
   this->fh = host_connect(this->address, this->port,
-			  this->interface, this->stream->xine);
+			  this->interface, cls->busy_poll, this->stream->xine);
 
   if (this->fh == -1) return 0;
 
+  if (this->is_rtp && cls->fec && (this->port < 65532)) {
+    if (!this->fec)
+      this->fec = calloc(RTP_FEC_MAX, sizeof(*this->fec));
+    if (this->fec) {
+      /* these are optional. */
+      this->fec_fh[0] = host_connect(this->address, this->port + 2, this->interface, 0, this->stream->xine);
+      this->fec_fh[1] = host_connect(this->address, this->port + 4, this->interface, 0, this->stream->xine);
+    }
+  }
+
   this->last_input_error = 0;
   this->input_eof = 0;
-  this->curpos = 0;
+  rtp_reset_buffers(this);
+  _x_stream_info_set(this->stream, XINE_STREAM_INFO_NET_KERNEL_DROPS, 0);
+  _x_stream_info_set(this->stream, XINE_STREAM_INFO_NET_INPUT_DROPS, 0);
   this->rtp_running = 1;
 
   if ((err = pthread_create(&this->reader_thread, NULL,
@@ -650,6 +1188,9 @@ static int rtp_plugin_open (input_plugin_t *this_gen ) {
     LOG_MSG(this->stream->xine, _("input_rtp: can't create new thread (%s)\n"), strerror(err));
     close(this->fh);
     this->fh = -1;
+    if (this->fec_fh[0] != -1) close(this->fec_fh[0]);
+    if (this->fec_fh[1] != -1) close(this->fec_fh[1]);
+    this->fec_fh[0] = this->fec_fh[1] = -1;
     this->rtp_running = 0;
     return 0;
   }
@@ -727,13 +1268,14 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   pthread_mutex_init(&this->buffer_ring_mut, NULL);
 
   pthread_cond_init(&this->reader_cond, NULL);
-  pthread_cond_init(&this->writer_cond, NULL);
 
-  this->buffer = malloc(BUFFER_SIZE);
-  this->buffer_put_ptr = this->buffer;
-  this->buffer_get_ptr = this->buffer;
-  this->buffer_count = 0;
-  this->curpos = 0;
+  this->fec_fh[0]     = -1;
+  this->fec_fh[1]     = -1;
+
+  this->pkts = malloc(RTP_NUM_PKTS * sizeof(*this->pkts));
+  this->ring = malloc(RTP_RING_SLOTS * sizeof(*this->ring));
+  if (this->pkts && this->ring)
+    rtp_reset_buffers(this);
 
   this->input_plugin.open              = rtp_plugin_open;
   this->input_plugin.get_capabilities  = _x_input_get_capabilities_preview;
@@ -751,8 +1293,9 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   this->nbc = NULL;
   this->nbc = nbc_init(this->stream);
 
-  if (!this->buffer) {
+  if (!this->pkts || !this->ring) {
     rtp_plugin_dispose(&this->input_plugin);
+    return NULL;
   }
 
   return &this->input_plugin;
@@ -762,21 +1305,78 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
 /*
  *  net plugin class
  */
+
+static void rtp_busy_poll_change_cb (void *data, xine_cfg_entry_t *cfg) {
+  rtp_input_class_t *this = (rtp_input_class_t *) data;
+
+  this->busy_poll = cfg->num_value;
+}
+
+static void rtp_reorder_depth_change_cb (void *data, xine_cfg_entry_t *cfg) {
+  rtp_input_class_t *this = (rtp_input_class_t *) data;
+
+  this->jb_depth = cfg->num_value;
+}
+
+static void rtp_fec_change_cb (void *data, xine_cfg_entry_t *cfg) {
+  rtp_input_class_t *this = (rtp_input_class_t *) data;
+
+  this->fec = cfg->num_value;
+}
+
+static void rtp_class_dispose (input_class_t *this_gen) {
+  rtp_input_class_t *this = (rtp_input_class_t *) this_gen;
+  config_values_t   *config = this->xine->config;
+
+  config->unregister_callbacks (config, NULL, NULL, this, sizeof (*this));
+  free (this);
+}
+
 static void *init_class (xine_t *xine, const void *data) {
+  rtp_input_class_t *this;
+  config_values_t   *config = xine->config;
 
-  static const input_class_t input_rtp_class = {
-    .get_instance      = rtp_class_get_instance,
-    .description       = N_("RTP and UDP input plugin as shipped with xine"),
-    .identifier        = "RTP/UDP",
-    .get_dir           = NULL,
-    .get_autoplay_list = NULL,
-    .dispose           = NULL,
-    .eject_media       = NULL,
-  };
-
-  (void)xine;
   (void)data;
-  return (void *)&input_rtp_class;
+  this = calloc(1, sizeof(*this));
+  if (!this)
+    return NULL;
+
+  this->xine = xine;
+
+  this->input_class.get_instance      = rtp_class_get_instance;
+  this->input_class.description       = N_("RTP and UDP input plugin as shipped with xine");
+  this->input_class.identifier        = "RTP/UDP";
+  this->input_class.get_dir           = NULL;
+  this->input_class.get_autoplay_list = NULL;
+  this->input_class.dispose           = rtp_class_dispose;
+  this->input_class.eject_media       = NULL;
+
+  this->busy_poll = config->register_num(config, "media.network.udp_busy_poll", 0,
+    _("UDP socket busy poll time"),
+    _("The time in microseconds the kernel may busy poll the network device "
+      "for new RTP/UDP datagrams, instead of waiting for an interrupt.\n"
+      "This lowers latency and drop risk at high bit rates, at the cost of CPU "
+      "load. It needs a kernel and driver supporting SO_BUSY_POLL, and may need "
+      "extra privileges. 0 disables this."),
+    20, rtp_busy_poll_change_cb, this);
+
+  this->jb_depth = config->register_range(config, "media.network.rtp_reorder_depth", 32, 0, RTP_JB_MAX,
+    _("RTP reorder buffer depth"),
+    _("The number of RTP packets to hold back while waiting for a late or "
+      "missing one. Larger values survive more network reordering, and give "
+      "FEC more time to repair losses, at the cost of latency.\n"
+      "0 passes packets through as soon as they arrive."),
+    20, rtp_reorder_depth_change_cb, this);
+
+  this->fec = config->register_bool(config, "media.network.rtp_fec", 0,
+    _("Use RTP forward error correction"),
+    _("Listen for SMPTE 2022-1 FEC streams on the two ports following the "
+      "media port (column FEC at port + 2, row FEC at port + 4), and use them "
+      "to recover lost RTP packets.\n"
+      "Enable this only when the sender provides FEC there."),
+    20, rtp_fec_change_cb, this);
+
+  return this;
 }
 
 /*
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Loopback test for the RTP reorder buffer, FEC recovery and loss signalling.
+ * Packets are sent to 127.0.0.1 in a scrambled order, with some of them
+ * missing. The plugin is built right into this test, so we can look at its
+ * counters as well.
+ */
+
+#include "input_rtp.c"
+
+#define TEST_PACKETS  80
+/* reversed send order runs. */
+#define TEST_SWAP_1    2
+#define TEST_SWAP_2   10
+/* dropped, but protected by row FEC over [TEST_FEC_BASE, TEST_FEC_BASE + TEST_FEC_NA). */
+#define TEST_FEC_LOST 22
+#define TEST_FEC_BASE 20
+#define TEST_FEC_NA    4
+/* dropped for good. */
+#define TEST_LOST     50
+/* exercise sequence number wrap. */
+#define TEST_SEQ0     65500
+
+static int test_len (int i) {
+  return 100 + (i % 5) * 10;
+}
+
+static void test_payload (uint8_t *p, int i) {
+  int j, n = test_len (i);
+  for (j = 0; j < n; j++)
+    p[j] = (i * 7 + j) & 0xff;
+}
+
+static void test_rtp_header (uint8_t *h, uint16_t seq, int pt) {
+  memset (h, 0, 12);
+  h[0] = 0x80;
+  h[1] = pt;
+  h[2] = seq >> 8;
+  h[3] = seq;
+}
+
+static void test_send (int s, int port, const uint8_t *buf, int len) {
+  union {
+    struct sockaddr_in in;
+    struct sockaddr sa;
+  } saddr;
+
+  memset (&saddr, 0, sizeof (saddr));
+  saddr.in.sin_family = AF_INET;
+  saddr.in.sin_port = htons (port);
+  saddr.in.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (sendto (s, buf, len, 0, &saddr.sa, sizeof (saddr.in)) != len)
+    perror ("sendto");
+}
+
+static void test_send_media (int s, int port, int i) {
+  uint8_t buf[12 + 200];
+
+  test_rtp_header (buf, TEST_SEQ0 + i, 33);
+  test_payload (buf + 12, i);
+  test_send (s, port, buf, 12 + test_len (i));
+}
+
+/* SMPTE 2022-1 row FEC packet, sent to port + 4. */
+static void test_send_fec (int s, int port) {
+  uint8_t buf[12 + 16 + 200], p[200];
+  uint16_t snbase = TEST_SEQ0 + TEST_FEC_BASE;
+  int i, j, len_rec = 0, max = 0;
+
+  memset (buf, 0, sizeof (buf));
+  test_rtp_header (buf, 0, 96);
+  for (i = TEST_FEC_BASE; i < TEST_FEC_BASE + TEST_FEC_NA; i++) {
+    int n = test_len (i);
+    test_payload (p, i);
+    for (j = 0; j < n; j++)
+      buf[12 + 16 + j] ^= p[j];
+    len_rec ^= n;
+    if (n > max)
+      max = n;
+  }
+  buf[12 + 0] = snbase >> 8;
+  buf[12 + 1] = snbase;
+  buf[12 + 2] = len_rec >> 8;
+  buf[12 + 3] = len_rec;
+  buf[12 + 4] = 0x80;         /* E */
+  buf[12 + 12] = 0x40;        /* D: row */
+  buf[12 + 13] = 1;           /* offset: row */
+  buf[12 + 14] = TEST_FEC_NA;
+  test_send (s, port + 4, buf, 12 + 16 + max);
+}
+
+/* random RTP at the FEC port, and a would be FEC packet before any media. */
+static void test_send_bogus (int s, int port) {
+  uint8_t buf[12 + 16 + 200];
+  int i, len_rec = 0;
+
+  for (i = TEST_FEC_BASE; i < TEST_FEC_BASE + TEST_FEC_NA; i++)
+    len_rec ^= test_len (i);
+  memset (buf, 0x55, sizeof (buf));
+  test_rtp_header (buf, 0, 33);
+  test_send (s, port + 4, buf, sizeof (buf));
+  memset (buf + 12, 0, 16);
+  test_rtp_header (buf, 0, 96);
+  buf[12 + 0] = (uint16_t)(TEST_SEQ0 + TEST_FEC_BASE) >> 8;
+  buf[12 + 1] = (uint8_t)(TEST_SEQ0 + TEST_FEC_BASE);
+  buf[12 + 2] = len_rec >> 8;
+  buf[12 + 3] = len_rec;
+  buf[12 + 4] = 0x80;
+  buf[12 + 12] = 0x40;
+  buf[12 + 13] = 1;
+  buf[12 + 14] = TEST_FEC_NA;
+  test_send (s, port + 4, buf, sizeof (buf));
+}
+
+/* k-th packet to send: 2 runs of 3 in reverse order. */
+static int test_order (int k) {
+  if ((k >= TEST_SWAP_1) && (k <= TEST_SWAP_1 + 2))
+    return 2 * TEST_SWAP_1 + 2 - k;
+  if ((k >= TEST_SWAP_2) && (k <= TEST_SWAP_2 + 2))
+    return 2 * TEST_SWAP_2 + 2 - k;
+  return k;
+}
+
+int main (void) {
+  static uint8_t want[TEST_PACKETS * 200], got[TEST_PACKETS * 200];
+  xine_t *xine;
+  xine_stream_t *stream;
+  input_class_t *cls;
+  input_plugin_t *input = NULL;
+  rtp_input_plugin_t *rtp;
+  int s, k, port = 0, want_len = 0, loss_at = -1, errors = 0;
+  off_t n, pos;
+
+  xine = xine_new ();
+  xine_init (xine);
+  stream = xine_stream_new (xine, NULL, NULL);
+  cls = init_class (xine, NULL);
+  if (!stream || !cls) {
+    fprintf (stderr, "test_input_rtp: no stream.\n");
+    return 1;
+  }
+  xine->config->update_num (xine->config, "media.network.rtp_fec", 1);
+
+  /* we need port, port + 2 and port + 4. */
+  srand (getpid ());
+  for (k = 0; k < 20; k++) {
+    char mrl[64];
+    port = 20000 + (rand () % 20000) * 2;
+    sprintf (mrl, "rtp://127.0.0.1:%d", port);
+    input = cls->get_instance (cls, stream, mrl);
+    if (!input)
+      break;
+    rtp = (rtp_input_plugin_t *)input;
+    if (input->open (input) && (rtp->fec_fh[0] >= 0) && (rtp->fec_fh[1] >= 0))
+      break;
+    input->dispose (input);
+    input = NULL;
+  }
+  if (!input) {
+    fprintf (stderr, "test_input_rtp: cannot open loopback ports.\n");
+    return 77;
+  }
+  rtp = (rtp_input_plugin_t *)input;
+
+  s = socket (PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  /* not FEC, and FEC for sequence numbers that are not there yet.
+   * these must not be used. */
+  test_send_bogus (s, port);
+  usleep (20000);
+  for (k = 0; k < TEST_PACKETS; k++) {
+    int i = test_order (k);
+    if ((i != TEST_FEC_LOST) && (i != TEST_LOST))
+      test_send_media (s, port, i);
+    /* FEC follows its row, as the sender would do. */
+    if (i == TEST_FEC_BASE + TEST_FEC_NA - 1) {
+      usleep (2000);
+      test_send_fec (s, port);
+    }
+    if (!(k & 7))
+      usleep (1000);
+  }
+  close (s);
+
+  for (k = 0; k < TEST_PACKETS; k++) {
+    if (k == TEST_LOST) {
+      loss_at = want_len;
+      continue;
+    }
+    test_payload (want + want_len, k);
+    want_len += test_len (k);
+  }
+
+  n = input->read (input, got, want_len);
+  if (n != want_len) {
+    fprintf (stderr, "test_input_rtp: got %d of %d bytes.\n", (int)n, want_len);
+    errors++;
+  } else if (memcmp (got, want, want_len)) {
+    fprintf (stderr, "test_input_rtp: data out of order or damaged.\n");
+    errors++;
+  }
+
+  /* the receiver is idle now. */
+  if (rtp->reordered < 2) {
+    fprintf (stderr, "test_input_rtp: %u reordered, expected at least 2.\n", (unsigned int)rtp->reordered);
+    errors++;
+  }
+  if (rtp->fec_recovered != 1) {
+    fprintf (stderr, "test_input_rtp: %u recovered by FEC, expected 1.\n", (unsigned int)rtp->fec_recovered);
+    errors++;
+  }
+  if (rtp->seq_lost != 1) {
+    fprintf (stderr, "test_input_rtp: %u lost, expected 1.\n", (unsigned int)rtp->seq_lost);
+    errors++;
+  }
+
+  pos = -2;
+  if (input->get_optional_data (input, &pos, INPUT_OPTIONAL_DATA_LOSS) != INPUT_OPTIONAL_SUCCESS || pos != loss_at) {
+    fprintf (stderr, "test_input_rtp: loss reported at %d, expected %d.\n", (int)pos, loss_at);
+    errors++;
+  }
+  pos = -2;
+  input->get_optional_data (input, &pos, INPUT_OPTIONAL_DATA_LOSS);
+  if (pos != -1) {
+    fprintf (stderr, "test_input_rtp: extra loss reported at %d.\n", (int)pos);
+    errors++;
+  }
+
+  input->dispose (input);
+  cls->dispose (cls);
+  xine_dispose (stream);
+  xine_exit (xine);
+
+  return errors ? 1 : 0;
+}
@@ -52,6 +52,10 @@ typedef struct dav1d_decoder_s {
   uint8_t           dri;
   uint8_t           video_open;
   uint8_t           meta_set;
+  uint8_t           key_flags;       /* demuxer marks keyframes */
+  uint8_t           key_frame;       /* current incoming frame is a keyframe */
+  int               decode_hint;     /* VO_DECODE_HINT_* from last draw */
+  int               width, height;   /* last decoded size */
   int64_t           pts;             /* current incoming pts */
   double            ratio;
 
@@ -62,14 +66,31 @@ typedef struct dav1d_decoder_s {
 
 /*
  * frame allocator for DRI
+ *
+ * The callbacks run in dav1d worker threads, and pictures from both
+ * allocators may be alive at the same time (eg. when a 4:2:0 stream
+ * switches to 4:4:4, or the video out temporarily is out of frames).
+ * Thus, the decision is made per picture, and fallback pictures are
+ * tagged by setting bit 0 of their allocator_data.
  */
 
+#define _DEFAULT_PIC_TAG(p)   ((void *)((uintptr_t)(p) | 1))
+#define _DEFAULT_PIC_UNTAG(p) ((void *)((uintptr_t)(p) & ~(uintptr_t)1))
+#define _IS_DEFAULT_PIC(pic)  ((uintptr_t)(pic)->allocator_data & 1)
+
+#ifdef DAV1D_PICTURE_ALIGNMENT
+#  define _PIC_ALIGN DAV1D_PICTURE_ALIGNMENT
+#else
+#  define _PIC_ALIGN 32
+#endif
+
 static void _free_frame_cb(Dav1dPicture *pic, void *cookie)
 {
   dav1d_decoder_t *this = cookie;
   vo_frame_t      *img;
 
-  if (!this->dri || !pic->allocator_data || pic->allocator_data == pic->data[0]) {
+  if (_IS_DEFAULT_PIC(pic)) {
+    pic->allocator_data = _DEFAULT_PIC_UNTAG(pic->allocator_data);
     this->default_allocator.release_picture_callback(pic, this->default_allocator.cookie);
     return;
   }
@@ -78,6 +99,15 @@ static void _free_frame_cb(Dav1dPicture *pic, void *cookie)
   img->free(img);
 }
 
+static int _alloc_default(dav1d_decoder_t *this, Dav1dPicture *pic)
+{
+  int r = this->default_allocator.alloc_picture_callback(pic, this->default_allocator.cookie);
+
+  if (r >= 0)
+    pic->allocator_data = _DEFAULT_PIC_TAG(pic->allocator_data);
+  return r;
+}
+
 static int _alloc_frame_cb(Dav1dPicture *pic, void *cookie)
 {
   dav1d_decoder_t *this = cookie;
@@ -85,33 +115,29 @@ static int _alloc_frame_cb(Dav1dPicture *pic, void *cookie)
   int width, height, format, flags = 0;
   int i;
 
+  if (this->ratio < 0.01)
+    this->ratio = (double)pic->p.w / (double)pic->p.h;
+
   if (!this->dri)
-    return this->default_allocator.alloc_picture_callback(pic, this->default_allocator.cookie);
+    return _alloc_default(this, pic);
 
   switch (pic->p.layout) {
     case DAV1D_PIXEL_LAYOUT_I400:  /* monochrome */
     case DAV1D_PIXEL_LAYOUT_I420:  /* 4:2:0 planar */
-      this->dri = (pic->p.bpc == 8 || this->cap_deep);
-      break;
+      if (pic->p.bpc == 8 || this->cap_deep)
+        break;
+      /* fall thru */
     case DAV1D_PIXEL_LAYOUT_I422:  /* 4:2:2 planar */
     case DAV1D_PIXEL_LAYOUT_I444:  /* 4:4:4 planar */
-      this->dri = 0;
-      break;
+      /* unsupported frame format, need to copy ... */
+      return _alloc_default(this, pic);
     default:
       xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
               "get_frame() failed: unknown layout %d\n", pic->p.layout);
       return -1;
   }
 
-  if (this->ratio < 0.01)
-    this->ratio = (double)pic->p.w / (double)pic->p.h;
-
-  if (!this->dri) {
-    /* unsupported frame format, need to copy ... */
-    return this->default_allocator.alloc_picture_callback(pic, this->default_allocator.cookie);
-  }
-
-  /* The data[0], data[1] and data[2] must be 32 bytes aligned and with a
+  /* The data[0], data[1] and data[2] must be _PIC_ALIGN bytes aligned and with a
    * pixel width/height multiple of 128 pixels.
    * data[1] and data[2] must share the same stride[1].
    */
@@ -128,18 +154,20 @@ static int _alloc_frame_cb(Dav1dPicture *pic, void *cookie)
                                             width, height, this->ratio, format,
                                             VO_BOTH_FIELDS | VO_GET_FRAME_MAY_FAIL | flags);
 
+  /* if video out cannot help, decode into our own memory. */
   if (!img || img->width < width || img->height < height) {
-    xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "get_frame(%dx%d) failed\n", width, height);
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
+            "get_frame(%dx%d) failed, using default allocator\n", width, height);
     if (img)
       img->free(img);
-    return -1;
+    return _alloc_default(this, pic);
   }
-  if (format == XINE_IMGFMT_YV12 && img->pitches[1] != img->pitches[2]) {
-    xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE ": "
-            "get_frame(%dx%d) returned incompatible frame\n", width, height);
+  if (img->pitches[1] != img->pitches[2] ||
+      (((uintptr_t)img->base[0] | (uintptr_t)img->base[1] | (uintptr_t)img->base[2]) & (_PIC_ALIGN - 1))) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
+            "get_frame(%dx%d) returned incompatible frame, using default allocator\n", width, height);
     img->free(img);
-    return -1;
+    return _alloc_default(this, pic);
   }
 
   img->crop_right  = width - pic->p.w;
@@ -150,8 +178,8 @@ static int _alloc_frame_cb(Dav1dPicture *pic, void *cookie)
 
   pic->stride[0] = img->pitches[0];
   pic->stride[1] = img->pitches[1];
-  _x_assert(img->pitches[1] == img->pitches[2]);
 
+  img->drawn = 0;
   pic->allocator_data = img;
 
   return 0;
@@ -301,6 +329,7 @@ static vo_frame_t * _copy_image(dav1d_decoder_t *this, Dav1dPicture *pic)
 static void _draw_image(dav1d_decoder_t *this, Dav1dPicture *pic)
 {
   vo_frame_t *img;
+  int         direct;
 
   if (!this->meta_set) {
     this->meta_set = 1;
@@ -311,8 +340,12 @@ static void _draw_image(dav1d_decoder_t *this, Dav1dPicture *pic)
     _x_stream_info_set(this->stream, XINE_STREAM_INFO_VIDEO_RATIO,  this->ratio*10000);
   }
 
-  if (this->dri) {
+  /* a picture shown again (show_existing_frame) may still wait for display
+   * in its vo frame, so it needs a copy. */
+  direct = !_IS_DEFAULT_PIC(pic) && !((vo_frame_t *)pic->allocator_data)->drawn;
+  if (direct) {
     img = pic->allocator_data;
+    img->drawn = 1;
   } else {
     img = _copy_image(this, pic);
   }
@@ -340,15 +373,37 @@ static void _draw_image(dav1d_decoder_t *this, Dav1dPicture *pic)
   img->bad_frame = 0;
   img->progressive_frame = 1;
 
+  this->width  = pic->p.w;
+  this->height = pic->p.h;
+
   img->draw(img, this->stream);
+  this->decode_hint = _x_video_decode_hint (this->stream);
 
   /* when using dri, frame may still be used as a reference frame inside decoder.
    * it is freed in free_frame_cb().
    */
-  if (!this->dri)
+  if (!direct)
     img->free(img);
 }
 
+/* a frame skipped to catch up. keep video out informed about timing. */
+static void _draw_skipped(dav1d_decoder_t *this)
+{
+  vo_frame_t *img;
+
+  img = this->stream->video_out->get_frame (this->stream->video_out,
+                                            this->width, this->height, this->ratio, XINE_IMGFMT_YV12,
+                                            VO_BOTH_FIELDS | VO_GET_FRAME_MAY_FAIL);
+  if (!img)
+    return;
+
+  img->pts       = 0;
+  img->bad_frame = 1;
+  img->draw(img, this->stream);
+  this->decode_hint = _x_video_decode_hint (this->stream);
+  img->free(img);
+}
+
 static void _decode(dav1d_decoder_t *this, Dav1dData *data)
 {
   Dav1dPicture pic;
@@ -411,6 +466,11 @@ static void _dav1d_decode_data(video_decoder_t *this_gen, buf_element_t *buf)
     this->pts = buf->pts;
   }
 
+  if (buf->decoder_flags & BUF_FLAG_KEYFRAME) {
+    this->key_flags = 1;
+    this->key_frame = 1;
+  }
+
   /* collect data */
 
   if (this->size + buf->size > this->bufsize) {
@@ -428,6 +488,16 @@ static void _dav1d_decode_data(video_decoder_t *this_gen, buf_element_t *buf)
     return;
   }
 
+  /* far too late: skip to next keyframe. we rely on demuxer flags here,
+   * and only when the demuxer has set them at all. */
+  if (this->decode_hint >= VO_DECODE_HINT_NONKEY && this->key_flags && !this->key_frame && this->width > 0) {
+    this->size = 0;
+    _draw_skipped(this);
+    this->pts = 0;
+    return;
+  }
+  this->key_frame = 0;
+
   /* wrap gathered data */
   r = dav1d_data_wrap(&data, this->buf, this->size, _data_free_wrapper, this->buf);
   this->size = 0;
@@ -467,6 +537,8 @@ static void _dav1d_discontinuity(video_decoder_t *this_gen)
 
   this->pts  = 0;
   this->size = 0;
+  this->key_frame   = 0;
+  this->decode_hint = VO_DECODE_HINT_NONE;
 }
 
 static void _dav1d_reset(video_decoder_t *this_gen)
@@ -486,6 +558,8 @@ static void _dav1d_reset(video_decoder_t *this_gen)
 
   this->pts  = 0;
   this->size = 0;
+  this->key_frame   = 0;
+  this->decode_hint = VO_DECODE_HINT_NONE;
 }
 
 static void _dav1d_dispose(video_decoder_t *this_gen)
@@ -59,6 +59,28 @@ typedef struct image_decoder_s {
 
 } image_decoder_t;
 
+/* let the loader scale while decoding (the jpeg loader uses DCT scaling)
+ * instead of converting a full size multi megapixel image. */
+static void _size_prepared (GdkPixbufLoader *loader, gint width, gint height, gpointer data) {
+  image_decoder_t *this = (image_decoder_t *)data;
+  int win_w, win_h;
+
+  win_w = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_WIDTH);
+  win_h = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_HEIGHT);
+  if (win_w <= 0 || win_h <= 0 || (width <= win_w && height <= win_h))
+    return;
+
+  /* fit into window, keep aspect */
+  if ((int64_t)width * win_h > (int64_t)height * win_w) {
+    height = (int64_t)height * win_w / width;
+    width  = win_w;
+  } else {
+    width  = (int64_t)width * win_h / height;
+    height = win_h;
+  }
+  gdk_pixbuf_loader_set_size (loader, width > 1 ? width : 2, height > 0 ? height : 1);
+}
+
 
 static void image_decode_data (video_decoder_t *this_gen, buf_element_t *buf) {
   image_decoder_t *this = (image_decoder_t *) this_gen;
@@ -82,6 +104,7 @@ static void image_decode_data (video_decoder_t *this_gen, buf_element_t *buf) {
 
   if (this->loader == NULL) {
     this->loader = gdk_pixbuf_loader_new ();
+    g_signal_connect (this->loader, "size-prepared", G_CALLBACK (_size_prepared), this);
   }
 
   if (gdk_pixbuf_loader_write (this->loader, buf->mem, buf->size, &error) == FALSE) {
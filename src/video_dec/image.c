@@ -109,6 +109,18 @@ static vo_frame_t *_image_decode_data (image_decoder_t *this, unsigned char *dat
     MagickWandGenesis();
 #endif
     wand = NewMagickWand();
+#if MAGICK_VERSION >= 0x661
+    {
+      /* lets the jpeg coder use DCT scaling. result is still at least window size. */
+      int win_w = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_WIDTH);
+      int win_h = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_HEIGHT);
+      if (win_w > 0 && win_h > 0) {
+        char hint[32];
+        snprintf (hint, sizeof (hint), "%dx%d", win_w, win_h);
+        MagickSetOption (wand, "jpeg:size", hint);
+      }
+    }
+#endif
     status = MagickReadImageBlob (wand, data, size);
 
     if (!status) {
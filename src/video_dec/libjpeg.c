@@ -59,6 +59,7 @@ typedef struct jpeg_decoder_s {
   int               index;
 
   int               enable_downscaling;
+  int               scale_to_window;
   int               video_open;
 
 } jpeg_decoder_t;
@@ -117,6 +118,49 @@ static void jpeg_memory_src (j_decompress_ptr cinfo, const JOCTET *data, size_t
   cinfo->src->next_input_byte = data;
 }
 
+/*
+ * pick the smallest DCT scale factor that still fills the output window.
+ * libjpeg then skips most of the IDCT and colour conversion work,
+ * which is what makes large photos slow. never scales up, and never
+ * undoes a stronger scaling already requested for vo size limits.
+ */
+static void _jpeg_scale_to_window (jpeg_decoder_t *this, struct jpeg_decompress_struct *cinfo) {
+  int win_w, win_h, num, denom;
+
+  win_w = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_WIDTH);
+  win_h = this->stream->video_out->get_property (this->stream->video_out, VO_PROP_WINDOW_HEIGHT);
+  if (win_w <= 0 || win_h <= 0)
+    return;
+
+  /* image is fitted to window: num / denom >= min (win_w / image_width, win_h / image_height). */
+#if JPEG_LIB_VERSION >= 70 || defined(LIBJPEG_TURBO_VERSION)
+  denom = 8;
+  for (num = 1; num < 8; num++) {
+    if ((unsigned int)num * cinfo->image_width  >= (unsigned int)denom * win_w ||
+        (unsigned int)num * cinfo->image_height >= (unsigned int)denom * win_h)
+      break;
+  }
+#else
+  /* plain libjpeg 6b only does 1/1, 1/2, 1/4 and 1/8. */
+  num = 1;
+  for (denom = 8; denom > 1; denom >>= 1) {
+    if (cinfo->image_width  >= (unsigned int)denom * win_w ||
+        cinfo->image_height >= (unsigned int)denom * win_h)
+      break;
+  }
+#endif
+  if ((unsigned int)num * cinfo->scale_denom >= cinfo->scale_num * (unsigned int)denom)
+    return;
+
+  cinfo->scale_num   = num;
+  cinfo->scale_denom = denom;
+  jpeg_calc_output_dimensions (cinfo);
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": scaling image by %d:%d to %dx%d for %dx%d window\n",
+    num, denom, cinfo->output_width, cinfo->output_height, win_w, win_h);
+}
+
 /*
  * xine-lib decoder interface
  */
@@ -187,6 +231,10 @@ static vo_frame_t *_jpeg_decode_data (jpeg_decoder_t *this, const char *data, si
       }
     }
 
+    /* no need to decode more pixels than the window can show */
+    if (this->scale_to_window)
+      _jpeg_scale_to_window (this, &cinfo);
+
     /* start decompress */
 
     jpeg_start_decompress(&cinfo);
@@ -489,6 +537,10 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen,
   if (cfg_entry) {
     this->enable_downscaling = cfg_entry->num_value;
   }
+  cfg_entry = stream->xine->config->lookup_entry(stream->xine->config, "video.processing.libjpeg_scale_to_window");
+  if (cfg_entry) {
+    this->scale_to_window = cfg_entry->num_value;
+  }
 
   return &this->video_decoder;
 }
@@ -519,6 +571,15 @@ static void *init_class (xine_t *xine, const void *data) {
 	"If scaling is disabled, images will be cropped."),
       10, NULL, NULL);
 
+  xine->config->register_bool(xine->config,
+      "video.processing.libjpeg_scale_to_window", 1,
+      _("decode JPEG images at output window size"),
+      _("If enabled, large JPEG images are decoded directly at a reduced size "
+	"that still fills the current video window. This makes slideshows of "
+	"big photos a lot faster, but zooming in or enlarging the window "
+	"afterwards will show the reduced resolution until the next image."),
+      10, NULL, NULL);
+
   lprintf("class opened\n");
 
   return (void *)&decode_video_libjpeg_class;
@@ -79,6 +79,7 @@ void mpeg2_init (mpeg2dec_t * mpeg2dec,
     mpeg2dec->is_sequence_needed = 1;
     mpeg2dec->is_wait_for_ip_frames = 2;
     mpeg2dec->frames_to_drop = 0;
+    mpeg2dec->decode_hint = VO_DECODE_HINT_NONE;
     mpeg2dec->drop_frame = 0;
     mpeg2dec->in_slice = 0;
     mpeg2dec->output = output;
@@ -286,12 +287,14 @@ static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
 
 	      get_frame_duration(mpeg2dec, picture->current_frame);
 	      mpeg2dec->frames_to_drop = picture->current_frame->draw (picture->current_frame, mpeg2dec->stream);
+	      mpeg2dec->decode_hint = _x_video_decode_hint (mpeg2dec->stream);
 	      picture->current_frame->drawn = 1;
 	    }
 	  } else if (picture->forward_reference_frame && !picture->forward_reference_frame->drawn) {
 	    get_frame_duration(mpeg2dec, picture->forward_reference_frame);
 	    mpeg2dec->frames_to_drop = picture->forward_reference_frame->draw (picture->forward_reference_frame,
 									       mpeg2dec->stream);
+	    mpeg2dec->decode_hint = _x_video_decode_hint (mpeg2dec->stream);
 	    picture->forward_reference_frame->drawn = 1;
 	  }
 	}
@@ -318,9 +321,9 @@ static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
 	    
 	    lprintf ("B-Frame\n");
 
-	    if (mpeg2dec->frames_to_drop>1) {
-	      lprintf ("dropping b-frame because frames_to_drop==%d\n",
-		       mpeg2dec->frames_to_drop);
+	    if ((mpeg2dec->frames_to_drop>1) || (mpeg2dec->decode_hint >= VO_DECODE_HINT_NONREF)) {
+	      lprintf ("dropping b-frame because frames_to_drop==%d, hint %d\n",
+		       mpeg2dec->frames_to_drop, mpeg2dec->decode_hint);
 	      mpeg2dec->drop_frame = 1;
 	    } else if (!picture->forward_reference_frame || picture->forward_reference_frame->bad_frame 
 		       || !picture->backward_reference_frame || picture->backward_reference_frame->bad_frame) {
@@ -348,10 +351,12 @@ static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
 	    
 	    lprintf ("P-Frame\n");
 
-	    if (mpeg2dec->frames_to_drop>2) {
+	    /* dropping a p-frame makes all following ones up to the next i-frame
+	     * bad as well, which is exactly what VO_DECODE_HINT_NONKEY asks for. */
+	    if ((mpeg2dec->frames_to_drop>2) || (mpeg2dec->decode_hint >= VO_DECODE_HINT_NONKEY)) {
 	      mpeg2dec->drop_frame = 1;
-	      lprintf ("dropping p-frame because frames_to_drop==%d\n",
-		       mpeg2dec->frames_to_drop);
+	      lprintf ("dropping p-frame because frames_to_drop==%d, hint %d\n",
+		       mpeg2dec->frames_to_drop, mpeg2dec->decode_hint);
 	    } else if (!picture->backward_reference_frame || picture->backward_reference_frame->bad_frame) {
 	      mpeg2dec->drop_frame = 1;
 #ifdef LOG
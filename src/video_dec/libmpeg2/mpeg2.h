@@ -38,6 +38,7 @@ typedef struct mpeg2dec_s {
     int is_sequence_needed;
     int is_wait_for_ip_frames;
     int frames_to_drop, drop_frame;
+    int decode_hint; /* VO_DECODE_HINT_* */
     int in_slice;
     int seek_mode, is_frame_needed;
 
@@ -33,11 +33,13 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "./include/mpeg2.h"
 #include <xine/xine_internal.h>
 #include <xine/video_out.h>
 #include <xine/buffer.h>
+#include <xine/xineutils.h>
 
 /*
 #define LOG
@@ -49,12 +51,44 @@
 #undef _x_abort
 #define _x_abort() do {} while (0)
 
+#define MAX_THREADS 8
+
+typedef struct {
+  video_decoder_class_t decoder_class;
+  xine_t               *xine;
+  int                   thread_count;
+} mpeg2_video_class_t;
+
 typedef struct {
   uint32_t id;
   vo_frame_t * img;
 } img_state_t;
 
-typedef struct mpeg2_video_decoder_s {
+typedef struct mpeg2_video_decoder_s mpeg2_video_decoder_t;
+
+/* Slice threading: every worker runs its own libmpeg2 instance on the same
+ * data and frame buffers, restricted to its own band of slice rows with
+ * mpeg2_slice_region (). All instances walk through the same sequence of
+ * parser states. They meet at each picture start and end, where the main
+ * instance allocates or draws the frame. */
+typedef enum {
+  POOL_CMD_NONE = 0,
+  POOL_CMD_BUFFER,    /* take new data, then parse */
+  POOL_CMD_SET_BUF,   /* take new frame, then parse */
+  POOL_CMD_CONTINUE,  /* parse */
+  POOL_CMD_RESET,     /* reset, do not parse */
+  POOL_CMD_QUIT
+} pool_cmd_t;
+
+typedef struct {
+  mpeg2_video_decoder_t *this;
+  mpeg2dec_t            *mpeg2dec;
+  pthread_t              thread;
+  int                    index;
+  mpeg2_state_t          state;     /* where this worker stopped */
+} slice_worker_t;
+
+struct mpeg2_video_decoder_s {
   video_decoder_t  video_decoder;
   mpeg2dec_t      *mpeg2dec;
   xine_stream_t   *stream;
@@ -65,7 +99,22 @@ typedef struct mpeg2_video_decoder_s {
   uint32_t	  frame_number;
   uint32_t        rff_pattern;
 
-} mpeg2_video_decoder_t;
+  struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  go;
+    pthread_cond_t  done;
+    uint32_t        gen;
+    int             pending;
+    pool_cmd_t      cmd;
+    uint8_t        *start, *end;
+    uint8_t        *base[3];
+    void           *id;
+    int             rows;
+    int             num;      /* total number of instances including main */
+    int             active;   /* 0 while out of step, until next reset */
+    slice_worker_t  workers[MAX_THREADS - 1];
+  } pool;
+};
 
 #ifndef LOG_FRAME_ALLOC_FREE
 inline static void mpeg2_video_print_bad_state(img_state_t * img_state) {}
@@ -115,6 +164,165 @@ static void mpeg2_video_print_fbuf(const mpeg2_fbuf_t * fbuf) {
 }
 #endif
 
+/* states where all instances need to meet. */
+static int mpeg2_video_pool_barrier (mpeg2_state_t state) {
+  switch (state) {
+    case STATE_PICTURE:
+    case STATE_SLICE_1ST:
+    case STATE_PICTURE_2ND:
+    case STATE_SLICE:
+    case STATE_END:
+    case STATE_INVALID_END:
+    case STATE_BUFFER:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static void mpeg2_video_pool_region (mpeg2dec_t *mpeg2dec, int rows, int index, int num) {
+  int start = 1 + rows * index / num;
+  int end   = (index == num - 1) ? 0xb0 : 1 + rows * (index + 1) / num;
+  mpeg2_slice_region (mpeg2dec, start, end);
+}
+
+static void *mpeg2_video_slice_worker (void *data) {
+  slice_worker_t        *w = (slice_worker_t *)data;
+  mpeg2_video_decoder_t *this = w->this;
+  uint32_t               gen = 0;
+
+  pthread_mutex_lock (&this->pool.mutex);
+  while (1) {
+    pool_cmd_t cmd;
+    mpeg2_state_t state = STATE_BUFFER;
+
+    while (gen == this->pool.gen)
+      pthread_cond_wait (&this->pool.go, &this->pool.mutex);
+    gen = this->pool.gen;
+    cmd = this->pool.cmd;
+    if (cmd == POOL_CMD_QUIT)
+      break;
+    pthread_mutex_unlock (&this->pool.mutex);
+
+    switch (cmd) {
+      case POOL_CMD_BUFFER:
+        mpeg2_buffer (w->mpeg2dec, this->pool.start, this->pool.end);
+        break;
+      case POOL_CMD_SET_BUF:
+        mpeg2_set_buf (w->mpeg2dec, this->pool.base, this->pool.id);
+        mpeg2_video_pool_region (w->mpeg2dec, this->pool.rows, w->index, this->pool.num);
+        break;
+      case POOL_CMD_RESET:
+        mpeg2_reset (w->mpeg2dec, 1);
+        mpeg2_custom_fbuf (w->mpeg2dec, 1);
+        break;
+      default: ;
+    }
+    if (cmd != POOL_CMD_RESET) {
+      do {
+        state = mpeg2_parse (w->mpeg2dec);
+      } while (!mpeg2_video_pool_barrier (state));
+    }
+
+    pthread_mutex_lock (&this->pool.mutex);
+    w->state = state;
+    if (--this->pool.pending == 0)
+      pthread_cond_signal (&this->pool.done);
+  }
+  pthread_mutex_unlock (&this->pool.mutex);
+
+  return NULL;
+}
+
+/* hand out next step to all workers. pool.start/end/base/id are set by caller. */
+static void mpeg2_video_pool_run (mpeg2_video_decoder_t *this, pool_cmd_t cmd) {
+  pthread_mutex_lock (&this->pool.mutex);
+  this->pool.cmd     = cmd;
+  this->pool.pending = this->pool.num - 1;
+  this->pool.gen++;
+  pthread_cond_broadcast (&this->pool.go);
+  pthread_mutex_unlock (&this->pool.mutex);
+}
+
+/* wait for all workers to finish their step, and check they stopped at main state. */
+static int mpeg2_video_pool_wait (mpeg2_video_decoder_t *this, mpeg2_state_t state) {
+  int i, ok = 1;
+
+  pthread_mutex_lock (&this->pool.mutex);
+  while (this->pool.pending > 0)
+    pthread_cond_wait (&this->pool.done, &this->pool.mutex);
+  pthread_mutex_unlock (&this->pool.mutex);
+
+  for (i = 0; i < this->pool.num - 1; i++)
+    if (this->pool.workers[i].state != state)
+      ok = 0;
+
+  if (!ok) {
+    /* should not happen: same data, same parser. do not try to catch up
+     * within the stream, just let main instance decode everything until
+     * next reset. */
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      "libmpeg2new: slice threads out of step, decoding single threaded until next reset.\n");
+    this->pool.active = 0;
+    mpeg2_slice_region (this->mpeg2dec, 1, 0xb0);
+  }
+  return ok;
+}
+
+static void mpeg2_video_pool_init (mpeg2_video_decoder_t *this, int num) {
+  int i;
+
+  this->pool.num    = 1;
+  this->pool.active = 0;
+  if (num > MAX_THREADS)
+    num = MAX_THREADS;
+  if (num < 2)
+    return;
+
+  pthread_mutex_init (&this->pool.mutex, NULL);
+  pthread_cond_init (&this->pool.go, NULL);
+  pthread_cond_init (&this->pool.done, NULL);
+
+  for (i = 0; i < num - 1; i++) {
+    slice_worker_t *w = &this->pool.workers[i];
+
+    w->this  = this;
+    w->index = i + 1;
+    w->state = STATE_BUFFER;
+    w->mpeg2dec = mpeg2_init ();
+    if (!w->mpeg2dec)
+      break;
+    mpeg2_custom_fbuf (w->mpeg2dec, 1);
+    if (pthread_create (&w->thread, NULL, mpeg2_video_slice_worker, w)) {
+      mpeg2_close (w->mpeg2dec);
+      break;
+    }
+  }
+  this->pool.num    = i + 1;
+  this->pool.active = (this->pool.num > 1);
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "libmpeg2new: using %d slice threads.\n", this->pool.num);
+}
+
+static void mpeg2_video_pool_dispose (mpeg2_video_decoder_t *this) {
+  int i;
+
+  if (this->pool.num < 2)
+    return;
+
+  mpeg2_video_pool_run (this, POOL_CMD_QUIT);
+  for (i = 0; i < this->pool.num - 1; i++) {
+    pthread_join (this->pool.workers[i].thread, NULL);
+    mpeg2_close (this->pool.workers[i].mpeg2dec);
+  }
+  this->pool.num = 1;
+
+  pthread_cond_destroy (&this->pool.done);
+  pthread_cond_destroy (&this->pool.go);
+  pthread_mutex_destroy (&this->pool.mutex);
+}
+
 static void mpeg2_video_decode_data (video_decoder_t *this_gen, buf_element_t *buf_element) {
   mpeg2_video_decoder_t *this = (mpeg2_video_decoder_t *) this_gen;
   uint8_t * current = buf_element->content;
@@ -146,10 +354,24 @@ static void mpeg2_video_decode_data (video_decoder_t *this_gen, buf_element_t *b
 #endif
 
   mpeg2_buffer (this->mpeg2dec, current, end);
+  if (this->pool.active) {
+    this->pool.start = current;
+    this->pool.end   = end;
+    mpeg2_video_pool_run (this, POOL_CMD_BUFFER);
+  }
 
   info = mpeg2_info (this->mpeg2dec);
 
-  while ((state = mpeg2_parse (this->mpeg2dec)) != STATE_BUFFER) {
+  while (1) {
+    pool_cmd_t next = POOL_CMD_CONTINUE;
+
+    state = mpeg2_parse (this->mpeg2dec);
+    /* workers must be done with previous picture, and with this buffer. */
+    if (this->pool.active && mpeg2_video_pool_barrier (state))
+      mpeg2_video_pool_wait (this, state);
+    if (state == STATE_BUFFER)
+      break;
+
     switch (state) {
       case STATE_SEQUENCE:
         /* might set nb fbuf, convert format, stride */
@@ -234,6 +456,15 @@ static void mpeg2_video_decode_data (video_decoder_t *this_gen, buf_element_t *b
         this->img_state[img->id].img = img;
 
         mpeg2_set_buf (this->mpeg2dec, img->base, img);
+        if (this->pool.active) {
+          this->pool.base[0] = img->base[0];
+          this->pool.base[1] = img->base[1];
+          this->pool.base[2] = img->base[2];
+          this->pool.id      = img;
+          this->pool.rows    = (info->sequence->height + 15) >> 4;
+          mpeg2_video_pool_region (this->mpeg2dec, this->pool.rows, 0, this->pool.num);
+          next = POOL_CMD_SET_BUF;
+        }
         break;
       case STATE_SLICE:
       case STATE_END:
@@ -296,6 +527,8 @@ static void mpeg2_video_decode_data (video_decoder_t *this_gen, buf_element_t *b
         break;
    }
 
+    if (this->pool.active && mpeg2_video_pool_barrier (state))
+      mpeg2_video_pool_run (this, next);
  }
 #ifdef LOG_ENTRY
   printf ("libmpeg2: decode_data: exit\n");
@@ -325,6 +558,12 @@ static void mpeg2_video_reset (video_decoder_t *this_gen) {
   printf ("libmpeg2: reset\n");
 #endif
   mpeg2_reset (this->mpeg2dec, 1); /* 1 for full reset */
+  mpeg2_custom_fbuf (this->mpeg2dec, 1); /* full reset clears this */
+  if (this->pool.num > 1) {
+    mpeg2_video_pool_run (this, POOL_CMD_RESET);
+    mpeg2_video_pool_wait (this, STATE_BUFFER);
+    this->pool.active = 1;
+  }
   mpeg2_video_free_all(this->img_state);
 
 
@@ -443,6 +682,7 @@ static void mpeg2_video_dispose (video_decoder_t *this_gen) {
   printf ("libmpeg2: close\n");
 #endif
 
+  mpeg2_video_pool_dispose (this);
   mpeg2_close (this->mpeg2dec);
 
   this->stream->video_out->close(this->stream->video_out, this->stream);
@@ -451,10 +691,13 @@ static void mpeg2_video_dispose (video_decoder_t *this_gen) {
 }
 
 static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stream_t *stream) {
+  mpeg2_video_class_t *class = (mpeg2_video_class_t *) class_gen;
   mpeg2_video_decoder_t *this ;
   int32_t n;
 
   this = (mpeg2_video_decoder_t *) calloc(1, sizeof(mpeg2_video_decoder_t));
+  if (!this)
+    return NULL;
 
   this->video_decoder.decode_data         = mpeg2_video_decode_data;
   this->video_decoder.flush               = mpeg2_video_flush;
@@ -471,22 +714,54 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stre
   this->force_aspect = this->force_pan_scan = 0;
   for(n=0;n<30;n++) this->img_state[n].id=0;
 
+  mpeg2_video_pool_init (this, class->thread_count > 0 ? class->thread_count : xine_cpu_count ());
+
   return &this->video_decoder;
 }
 
 /*
  * mpeg2 plugin class
  */
-static void *init_plugin (xine_t *xine, const void *data) {
+static void thread_count_cb (void *user_data, xine_cfg_entry_t *entry) {
+  mpeg2_video_class_t *class = (mpeg2_video_class_t *) user_data;
 
-  static const video_decoder_class_t decode_video_mpeg2new_class = {
-    .open_plugin     = open_plugin,
-    .identifier      = "mpeg2new",
-    .description     = N_("mpeg2 based video decoder plugin"),
-    .dispose         = NULL,
-  };
+  class->thread_count = entry->num_value;
+}
 
-  return (void *)&decode_video_mpeg2new_class;
+static void dispose_class (video_decoder_class_t *this_gen) {
+  mpeg2_video_class_t *this = (mpeg2_video_class_t *) this_gen;
+  config_values_t *config = this->xine->config;
+
+  config->unregister_callbacks (config, NULL, NULL, this, sizeof (*this));
+
+  free (this);
+}
+
+static void *init_plugin (xine_t *xine, const void *data) {
+  mpeg2_video_class_t *this;
+
+  (void)data;
+
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
+
+  this->decoder_class.open_plugin = open_plugin;
+  this->decoder_class.identifier  = "mpeg2new";
+  this->decoder_class.description = N_("mpeg2 based video decoder plugin");
+  this->decoder_class.dispose     = dispose_class;
+  this->xine                      = xine;
+
+  this->thread_count = xine->config->register_range (xine->config,
+    "video.processing.libmpeg2new_thread_count", 0, 0, MAX_THREADS,
+    _("libmpeg2new video decoding thread count"),
+    _("You can adjust the number of video decoding threads which libmpeg2new may use. "
+      "Each thread decodes its own band of slices.\n"
+      "0 means one thread per logical CPU.\n"
+      "A change of this setting will take effect with playing the next stream."),
+    10, thread_count_cb, this);
+
+  return this;
 }
 /*
  * exported plugin catalog entry
@@ -33,6 +33,20 @@
 #include <xine/xine_internal.h>
 #include <xine/video_out.h>
 #include <xine/buffer.h>
+#include <xine/xineutils.h>
+
+#define MAX_THREADS 8
+
+/* libOpenHevcInit () thread_type values */
+static const char *const thread_type_names[] = {"frame+slice", "frame", "slice", NULL};
+static const int thread_type_values[] = {4, 1, 2};
+
+typedef struct {
+  video_decoder_class_t decoder_class;
+  xine_t               *xine;
+  int                   thread_count;
+  int                   thread_type;
+} hevc_class_t;
 
 typedef struct hevc_decoder_s {
   video_decoder_t   video_decoder;  /* parent video decoder structure */
@@ -51,6 +65,69 @@ typedef struct hevc_decoder_s {
 
 } hevc_decoder_t;
 
+/* with frame threads, pictures come out some calls later,
+ * but always in display order and with their own time stamp. */
+static void hevc_output_picture (hevc_decoder_t *this)
+{
+  vo_frame_t         *img;
+  OpenHevc_Frame_cpy  frame;
+  OpenHevc_FrameInfo *info = &frame.frameInfo;
+  float               ratio;
+
+  memset(&frame, 0, sizeof(frame));
+  libOpenHevcGetPictureInfo(this->handle, info);
+
+  if (info->nBitDepth != 8) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+            LOG_MODULE": Unsupported bit depth %d\n", info->nBitDepth);
+    return;
+  }
+  if (info->chromat_format != YUV420) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+            LOG_MODULE": Unsupported colour space %d\n", info->chromat_format);
+    return;
+  }
+
+  ratio = (float)info->sample_aspect_ratio.num / (float)info->sample_aspect_ratio.den;
+  ratio = ratio * (float)info->nWidth / (float)info->nHeight,
+
+  img = this->stream->video_out->get_frame (this->stream->video_out,
+                                            info->nWidth, info->nHeight,
+                                            ratio, XINE_IMGFMT_YV12,
+                                            this->frame_flags | VO_BOTH_FIELDS);
+
+  if (!img || img->width < info->nWidth || img->height < info->nHeight) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+            LOG_MODULE": get_frame(%dx%d) failed\n", info->nWidth, info->nHeight);
+    if (img) {
+      img->free(img);
+    }
+    return;
+  }
+
+  img->pts = info->nTimeStamp;
+  img->bad_frame = 0;
+  img->progressive_frame = 1;
+  img->width = info->nWidth;
+  img->height = info->nHeight;
+
+  frame.frameInfo.nYPitch = img->pitches[0];
+  frame.frameInfo.nUPitch = img->pitches[1];
+  frame.frameInfo.nVPitch = img->pitches[2];
+  frame.pvY = (void*) img->base[0];
+  frame.pvU = (void*) img->base[1];
+  frame.pvV = (void*) img->base[2];
+
+  if (!libOpenHevcGetOutputCpy(this->handle, 1, &frame)) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE": libOpenHevcGetOutputCpy failed\n");
+    img->free(img);
+    return;
+  }
+
+  img->draw(img, this->stream);
+  img->free(img);
+}
+
 
 static void hevc_decode_data (video_decoder_t *this_gen, buf_element_t *buf)
 {
@@ -103,79 +180,31 @@ static void hevc_decode_data (video_decoder_t *this_gen, buf_element_t *buf)
   int got_pic = libOpenHevcDecode(this->handle, this->buf, this->size, this->pts);
   this->size = 0;
 
-  if (got_pic > 0) {
-    vo_frame_t         *img;
-    OpenHevc_Frame_cpy  frame;
-    OpenHevc_FrameInfo *info = &frame.frameInfo;
-    float               ratio;
-
-    memset(&frame, 0, sizeof(frame));
-    libOpenHevcGetPictureInfo(this->handle, info);
-
-    if (info->nBitDepth != 8) {
-      xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
-              LOG_MODULE": Unsupported bit depth %d\n", info->nBitDepth);
-      return;
-    }
-    if (info->chromat_format != YUV420) {
-      xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
-              LOG_MODULE": Unsupported colour space %d\n", info->chromat_format);
-      return;
-    }
-
-    ratio = (float)info->sample_aspect_ratio.num / (float)info->sample_aspect_ratio.den;
-    ratio = ratio * (float)info->nWidth / (float)info->nHeight,
-
-    img = this->stream->video_out->get_frame (this->stream->video_out,
-                                              info->nWidth, info->nHeight,
-                                              ratio, XINE_IMGFMT_YV12,
-                                              this->frame_flags | VO_BOTH_FIELDS);
-
-    if (!img || img->width < info->nWidth || img->height < info->nHeight) {
-      xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
-              LOG_MODULE": get_frame(%dx%d) failed\n", info->nWidth, info->nHeight);
-      if (img) {
-        img->free(img);
-      }
-      return;
-    }
-
-    img->pts = info->nTimeStamp;
-    img->bad_frame = 0;
-    img->progressive_frame = 1;
-    img->width = info->nWidth;
-    img->height = info->nHeight;
-
-    frame.frameInfo.nYPitch = img->pitches[0];
-    frame.frameInfo.nUPitch = img->pitches[1];
-    frame.frameInfo.nVPitch = img->pitches[2];
-    frame.pvY = (void*) img->base[0];
-    frame.pvU = (void*) img->base[1];
-    frame.pvV = (void*) img->base[2];
-
-    if (!libOpenHevcGetOutputCpy(this->handle, 1, &frame)) {
-      xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE": libOpenHevcGetOutputCpy failed\n");
-      img->free(img);
-      return;
-    }
-
-    img->draw(img, this->stream);
-    img->free(img);
-  }
+  if (got_pic > 0)
+    hevc_output_picture(this);
 }
 
 static void hevc_flush (video_decoder_t *this_gen)
 {
   hevc_decoder_t *this = (hevc_decoder_t *) this_gen;
+  int i;
 
-  libOpenHevcFlush(this->handle);
+  if (!this->decoder_ok)
+    return;
+
+  /* drain pictures delayed by frame threads */
+  for (i = 0; i < 2 * MAX_THREADS + 16; i++) {
+    if (libOpenHevcDecode(this->handle, NULL, 0, 0) <= 0)
+      break;
+    hevc_output_picture(this);
+  }
 }
 
 static void hevc_reset (video_decoder_t *this_gen)
 {
   hevc_decoder_t *this = (hevc_decoder_t *) this_gen;
 
-  hevc_flush(this_gen);
+  libOpenHevcFlush(this->handle);
 
   this->size = 0;
 }
@@ -203,9 +232,9 @@ static void hevc_dispose (video_decoder_t *this_gen)
 
 static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stream_t *stream)
 {
+  hevc_class_t    *class = (hevc_class_t *) class_gen;
   hevc_decoder_t  *this;
-
-  (void)class_gen;
+  int              threads;
 
   this = (hevc_decoder_t *) calloc(1, sizeof(hevc_decoder_t));
   if (!this) {
@@ -220,7 +249,11 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stre
 
   this->stream       = stream;
 
-  this->handle = libOpenHevcInit(0, 0); //int nb_pthreads, int thread_type);
+  threads = class->thread_count > 0 ? class->thread_count : xine_cpu_count();
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+
+  this->handle = libOpenHevcInit(threads > 1 ? threads : 0, threads > 1 ? thread_type_values[class->thread_type] : 0);
   if (!this->handle) {
     xprintf(this->stream->xine, XINE_VERBOSITY_LOG, LOG_MODULE": libOpenHevcInit failed\n");
     free(this);
@@ -230,23 +263,72 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stre
   xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
           LOG_MODULE": Using libOpenHevc version %s\n",
           libOpenHevcVersion(this->handle));
+  xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+          LOG_MODULE": Using %d %s threads\n",
+          threads, thread_type_names[class->thread_type]);
 
   return &this->video_decoder;
 }
 
+static void thread_count_cb (void *user_data, xine_cfg_entry_t *entry)
+{
+  hevc_class_t *class = (hevc_class_t *) user_data;
+
+  class->thread_count = entry->num_value;
+}
+
+static void thread_type_cb (void *user_data, xine_cfg_entry_t *entry)
+{
+  hevc_class_t *class = (hevc_class_t *) user_data;
+
+  class->thread_type = entry->num_value;
+}
+
+static void dispose_class (video_decoder_class_t *this_gen)
+{
+  hevc_class_t    *this = (hevc_class_t *) this_gen;
+  config_values_t *config = this->xine->config;
+
+  config->unregister_callbacks (config, NULL, NULL, this, sizeof (*this));
+
+  free (this);
+}
+
 static void *init_plugin (xine_t *xine, const void *data)
 {
-  static const video_decoder_class_t decode_video_openhevc_class = {
-    .open_plugin     = open_plugin,
-    .identifier      = "libopenhevc",
-    .description     = N_("HEVC video decoder plugin"),
-    .dispose         = NULL,
-  };
-
-  (void)xine;
+  hevc_class_t    *this;
+  config_values_t *config = xine->config;
+
   (void)data;
 
-  return (void *)&decode_video_openhevc_class;
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
+
+  this->decoder_class.open_plugin = open_plugin;
+  this->decoder_class.identifier  = "libopenhevc";
+  this->decoder_class.description = N_("HEVC video decoder plugin");
+  this->decoder_class.dispose     = dispose_class;
+  this->xine                      = xine;
+
+  this->thread_count = config->register_range (config, "video.processing.libopenhevc_thread_count", 0,
+    0, MAX_THREADS,
+    _("libOpenHevc video decoding thread count"),
+    _("You can adjust the number of video decoding threads which libOpenHevc may use.\n"
+      "0 means one thread per logical CPU.\n"
+      "A change of this setting will take effect with playing the next stream."),
+    10, thread_count_cb, this);
+
+  this->thread_type = config->register_enum (config, "video.processing.libopenhevc_thread_type", 0,
+    (char **)thread_type_names,
+    _("libOpenHevc threading method"),
+    _("Frame threads decode several pictures at once, at the cost of some delay. "
+      "Slice threads split each picture, this only helps with streams using many "
+      "slices or wavefront parallel processing.\n"
+      "A change of this setting will take effect with playing the next stream."),
+    20, thread_type_cb, this);
+
+  return this;
 }
 
 /*
@@ -49,7 +49,11 @@ typedef struct vpx_decoder_s {
 
   int64_t              pts;
   struct vpx_codec_ctx ctx;
+  const struct vpx_codec_iface *iface;
   int                  decoder_ok;  /* current decoder status */
+  int                  vp_version;
+  int                  decode_hint;      /* VO_DECODE_HINT_* from last draw */
+  int                  skip_loop_filter; /* currently set in decoder */
 
   unsigned char    *buf;         /* the accumulated buffer data */
   int               bufsize;     /* the maximum size of buf */
@@ -144,13 +148,46 @@ static void vpx_decode_data (video_decoder_t *this_gen, buf_element_t *buf)
     return;
   }
 
-  /* decode */
-
   struct vpx_codec_ctx *ctx = &this->ctx;
   vpx_codec_err_t err;
   vo_frame_t *img;
   int64_t pts, *p_pts;
 
+  /* far too late: skip to next keyframe */
+  if (this->decode_hint >= VO_DECODE_HINT_NONKEY) {
+    vpx_codec_stream_info_t si;
+    si.sz = sizeof(si);
+    si.is_kf = 0;
+    if (vpx_codec_peek_stream_info(this->iface, this->buf, this->size, &si) == VPX_CODEC_OK && !si.is_kf) {
+      this->size = 0;
+      img = this->stream->video_out->get_frame (this->stream->video_out,
+                                                this->width, this->height,
+                                                this->ratio, XINE_IMGFMT_YV12,
+                                                this->frame_flags | VO_BOTH_FIELDS | VO_GET_FRAME_MAY_FAIL);
+      if (img) {
+        img->pts       = 0;
+        img->bad_frame = 1;
+        img->draw(img, this->stream);
+        this->decode_hint = _x_video_decode_hint (this->stream);
+        img->free(img);
+      }
+      this->pts = 0;
+      return;
+    }
+  }
+
+#ifdef VPX_CTRL_VP9_SET_SKIP_LOOP_FILTER
+  if (this->vp_version == 9) {
+    int skip = (this->decode_hint >= VO_DECODE_HINT_LOOP_FILTER);
+    if (skip != this->skip_loop_filter) {
+      this->skip_loop_filter = skip;
+      vpx_codec_control(ctx, VP9_SET_SKIP_LOOP_FILTER, skip);
+    }
+  }
+#endif
+
+  /* decode */
+
   p_pts = malloc(sizeof(*p_pts));
   *p_pts = this->pts;
   err = vpx_codec_decode(ctx, this->buf, this->size, p_pts, 0);
@@ -218,6 +255,7 @@ static void vpx_decode_data (video_decoder_t *this_gen, buf_element_t *buf)
   img->progressive_frame = 1;
 
   img->draw(img, this->stream);
+  this->decode_hint = _x_video_decode_hint (this->stream);
   img->free(img);
 }
 
@@ -242,6 +280,7 @@ static void vpx_reset (video_decoder_t *this_gen)
   }
 
   this->size = 0;
+  this->decode_hint = VO_DECODE_HINT_NONE;
 }
 
 static void vpx_discontinuity (video_decoder_t *this_gen)
@@ -323,6 +362,8 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stre
   this->size                              = 0;
 
   this->stream                            = stream;
+  this->iface                             = iface;
+  this->vp_version                        = vp_version;
 
   this->decoder_ok    = 0;
   this->buf           = NULL;
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for VA context reuse in vaapi_util.c, on a mock VA display.
+ * The libva entry points used there are implemented right here, so this
+ * needs the libva headers, but neither libva itself nor any hardware.
+ */
+
+#include "vaapi_util.c"
+
+#include <stdio.h>
+
+static struct {
+  int      create_surfaces, destroy_surfaces, sync_surface;
+  int      create_config, destroy_config;
+  int      create_context, destroy_context;
+  int      fail_context;
+  unsigned next_id;
+} mock;
+
+static int mock_display;
+
+/*
+ * mock VA display
+ */
+
+static void mock_display_dispose (xine_va_display_t **va_display) {
+  *va_display = NULL;
+}
+
+static xine_va_display_t mock_va_display = {
+  .va_display = &mock_display,
+  .dispose    = mock_display_dispose,
+};
+
+xine_va_display_t *_x_va_display_open (xine_t *xine, unsigned visual_type, const void *visual, unsigned flags) {
+  (void)xine;
+  (void)visual_type;
+  (void)visual;
+  (void)flags;
+  return &mock_va_display;
+}
+
+const char *vaErrorStr (VAStatus error_status) {
+  return error_status == VA_STATUS_SUCCESS ? "success" : "mock error";
+}
+
+const char *vaQueryVendorString (VADisplay dpy) {
+  (void)dpy;
+  return "mock";
+}
+
+int vaMaxNumImageFormats (VADisplay dpy) {
+  (void)dpy;
+  return 1;
+}
+
+VAStatus vaQueryImageFormats (VADisplay dpy, VAImageFormat *format_list, int *num_formats) {
+  (void)dpy;
+  memset (format_list, 0, sizeof (*format_list));
+  format_list->fourcc = VA_FOURCC ('Y', 'V', '1', '2');
+  *num_formats = 1;
+  return VA_STATUS_SUCCESS;
+}
+
+int vaMaxNumProfiles (VADisplay dpy) {
+  (void)dpy;
+  return 1;
+}
+
+VAStatus vaQueryConfigProfiles (VADisplay dpy, VAProfile *profile_list, int *num_profiles) {
+  (void)dpy;
+  profile_list[0] = VAProfileH264High;
+  *num_profiles = 1;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateSurfaces (VADisplay dpy, unsigned int format, unsigned int width, unsigned int height,
+                           VASurfaceID *surfaces, unsigned int num_surfaces,
+                           VASurfaceAttrib *attrib_list, unsigned int num_attribs) {
+  unsigned int i;
+  (void)dpy;
+  (void)format;
+  (void)width;
+  (void)height;
+  (void)attrib_list;
+  (void)num_attribs;
+  for (i = 0; i < num_surfaces; i++)
+    surfaces[i] = ++mock.next_id;
+  mock.create_surfaces++;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroySurfaces (VADisplay dpy, VASurfaceID *surfaces, int num_surfaces) {
+  (void)dpy;
+  (void)surfaces;
+  mock.destroy_surfaces += num_surfaces;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaSyncSurface (VADisplay dpy, VASurfaceID render_target) {
+  (void)dpy;
+  (void)render_target;
+  mock.sync_surface++;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaQuerySurfaceStatus (VADisplay dpy, VASurfaceID render_target, VASurfaceStatus *status) {
+  (void)dpy;
+  (void)render_target;
+  *status = VASurfaceReady;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaGetConfigAttributes (VADisplay dpy, VAProfile profile, VAEntrypoint entrypoint,
+                                VAConfigAttrib *attrib_list, int num_attribs) {
+  (void)dpy;
+  (void)profile;
+  (void)entrypoint;
+  (void)num_attribs;
+  attrib_list[0].value = VA_RT_FORMAT_YUV420;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateConfig (VADisplay dpy, VAProfile profile, VAEntrypoint entrypoint,
+                         VAConfigAttrib *attrib_list, int num_attribs, VAConfigID *config_id) {
+  (void)dpy;
+  (void)profile;
+  (void)entrypoint;
+  (void)attrib_list;
+  (void)num_attribs;
+  *config_id = ++mock.next_id;
+  mock.create_config++;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyConfig (VADisplay dpy, VAConfigID config_id) {
+  (void)dpy;
+  (void)config_id;
+  mock.destroy_config++;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateContext (VADisplay dpy, VAConfigID config_id, int picture_width, int picture_height,
+                          int flag, VASurfaceID *render_targets, int num_render_targets, VAContextID *context) {
+  (void)dpy;
+  (void)config_id;
+  (void)picture_width;
+  (void)picture_height;
+  (void)flag;
+  (void)render_targets;
+  (void)num_render_targets;
+  if (mock.fail_context)
+    return VA_STATUS_ERROR_ALLOCATION_FAILED;
+  *context = ++mock.next_id;
+  mock.create_context++;
+  return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyContext (VADisplay dpy, VAContextID context) {
+  (void)dpy;
+  (void)context;
+  mock.destroy_context++;
+  return VA_STATUS_SUCCESS;
+}
+
+/* not reached by this test. */
+
+VAStatus vaDestroyImage (VADisplay dpy, VAImageID image) {
+  (void)dpy;
+  (void)image;
+  return VA_STATUS_ERROR_UNKNOWN;
+}
+
+VAStatus vaDeriveImage (VADisplay dpy, VASurfaceID surface, VAImage *image) {
+  (void)dpy;
+  (void)surface;
+  (void)image;
+  return VA_STATUS_ERROR_UNKNOWN;
+}
+
+VAStatus vaCreateImage (VADisplay dpy, VAImageFormat *format, int width, int height, VAImage *image) {
+  (void)dpy;
+  (void)format;
+  (void)width;
+  (void)height;
+  (void)image;
+  return VA_STATUS_ERROR_UNKNOWN;
+}
+
+VAStatus vaMapBuffer (VADisplay dpy, VABufferID buf_id, void **pbuf) {
+  (void)dpy;
+  (void)buf_id;
+  (void)pbuf;
+  return VA_STATUS_ERROR_UNKNOWN;
+}
+
+VAStatus vaUnmapBuffer (VADisplay dpy, VABufferID buf_id) {
+  (void)dpy;
+  (void)buf_id;
+  return VA_STATUS_ERROR_UNKNOWN;
+}
+
+/*
+ * test
+ */
+
+static int errors = 0;
+
+#define TEST_CHECK(cond) do { \
+  if (!(cond)) { \
+    fprintf (stderr, "test_vaapi_util: line %d: %s failed.\n", __LINE__, #cond); \
+    errors++; \
+  } \
+} while (0)
+
+static void test_render_surface (vo_frame_t *frame, ff_vaapi_surface_t *va_surface) {
+  (void)frame;
+  (void)va_surface;
+}
+
+static const struct vaapi_accel_funcs_s test_guarded_funcs = {
+  .render_vaapi_surface = test_render_surface,
+};
+
+static const struct vaapi_accel_funcs_s test_plain_funcs = {
+  .render_vaapi_surface = NULL,
+};
+
+int main (void) {
+  xine_t               *xine;
+  vaapi_context_impl_t *va;
+  ff_vaapi_surface_t   *s1, *s2;
+  VASurfaceID           ids[RENDER_SURFACES];
+  vaapi_accel_t         accel[2];
+  vo_frame_t            frames[2];
+  int                   i, n;
+
+  xine = xine_new ();
+  xine_init (xine);
+
+  va = _x_va_new (xine, XINE_VISUAL_TYPE_NONE, NULL, 0);
+  if (!va) {
+    fprintf (stderr, "test_vaapi_util: no context.\n");
+    return 1;
+  }
+
+  /* first stream */
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1920, 1080));
+  TEST_CHECK (_x_va_init (va, VAProfileH264High, 1920, 1080) == VA_STATUS_SUCCESS);
+  TEST_CHECK (mock.create_surfaces == 1 && mock.create_config == 1 && mock.create_context == 1);
+  TEST_CHECK (_x_va_context_matches (va, VAProfileH264High, 1920, 1080));
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1280, 720));
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264Main, 1920, 1080));
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileHEVCMain10, 1920, 1080));
+  memcpy (ids, va->c.va_surface_ids, sizeof (ids));
+
+  /* leave surfaces in use, and frames bound to them. */
+  s1 = _x_va_alloc_surface (va);
+  s2 = _x_va_alloc_surface (va);
+  _x_va_render_surface (va, s2);
+  memset (frames, 0, sizeof (frames));
+  accel[0].f = &test_guarded_funcs;
+  accel[0].index = s2->index;
+  frames[0].accel_data = &accel[0];
+  va->frames[0] = &frames[0];
+  accel[1].f = &test_plain_funcs;
+  accel[1].index = 1;
+  frames[1].accel_data = &accel[1];
+  va->frames[1] = &frames[1];
+  va->num_frames = 2;
+  TEST_CHECK (s1->status == SURFACE_ALOC && s2->status == SURFACE_RENDER);
+
+  /* same key: recycle, do not rebuild. */
+  mock.sync_surface = 0;
+  TEST_CHECK (_x_va_init (va, VAProfileH264High, 1920, 1080) == VA_STATUS_SUCCESS);
+  TEST_CHECK (mock.create_surfaces == 1 && mock.create_config == 1 && mock.create_context == 1);
+  TEST_CHECK (mock.destroy_surfaces == 0 && mock.destroy_config == 0 && mock.destroy_context == 0);
+  TEST_CHECK (mock.sync_surface == RENDER_SURFACES);
+  TEST_CHECK (!memcmp (ids, va->c.va_surface_ids, sizeof (ids)));
+  for (i = n = 0; i < RENDER_SURFACES; i++) {
+    ff_vaapi_surface_t *s = &va->c.va_render_surfaces[i];
+    if ((s->status != SURFACE_FREE) || (s->index != (unsigned int)i) || (s->va_surface_id != ids[i]))
+      n++;
+  }
+  TEST_CHECK (n == 0);
+  TEST_CHECK (va->va_head == 0);
+  TEST_CHECK (accel[0].index == RENDER_SURFACES);
+  TEST_CHECK (accel[1].index == 1);
+  TEST_CHECK (va->c.valid_context);
+
+  /* new size: rebuild. */
+  TEST_CHECK (_x_va_init (va, VAProfileH264High, 1280, 720) == VA_STATUS_SUCCESS);
+  TEST_CHECK (mock.create_surfaces == 2 && mock.create_config == 2 && mock.create_context == 2);
+  TEST_CHECK (mock.destroy_surfaces == RENDER_SURFACES && mock.destroy_config == 1 && mock.destroy_context == 1);
+  TEST_CHECK (memcmp (ids, va->c.va_surface_ids, sizeof (ids)));
+  TEST_CHECK (_x_va_context_matches (va, VAProfileH264High, 1280, 720));
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1920, 1080));
+
+  /* a failed init must not leave a context to be reused. */
+  mock.fail_context = 1;
+  TEST_CHECK (_x_va_init (va, VAProfileH264High, 1920, 1080) != VA_STATUS_SUCCESS);
+  TEST_CHECK (!va->c.valid_context);
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1920, 1080));
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1280, 720));
+  mock.fail_context = 0;
+  TEST_CHECK (_x_va_init (va, VAProfileH264High, 1920, 1080) == VA_STATUS_SUCCESS);
+  TEST_CHECK (mock.create_context == 3);
+
+  /* all VA objects go away. */
+  _x_va_close (va);
+  TEST_CHECK (!_x_va_context_matches (va, VAProfileH264High, 1920, 1080));
+  TEST_CHECK (mock.destroy_context == mock.create_context);
+  TEST_CHECK (mock.destroy_config == mock.create_config);
+  TEST_CHECK (mock.destroy_surfaces == mock.create_surfaces * RENDER_SURFACES);
+
+  va->num_frames = 0;
+  va->frames[0] = va->frames[1] = NULL;
+  _x_va_free (&va);
+  xine_exit (xine);
+
+  return errors ? 1 : 0;
+}
@@ -335,12 +335,90 @@ void _x_va_close(vaapi_context_impl_t *va_context)
   pthread_mutex_unlock(&va_context->ctx_lock);
 }
 
+static unsigned _x_va_rt_format(int va_profile)
+{
+#if VA_CHECK_VERSION(0, 37, 0) && defined (VA_RT_FORMAT_YUV420_10BPP)
+  if (va_profile == VAProfileHEVCMain10)
+    return VA_RT_FORMAT_YUV420_10BPP;
+#else
+  (void)va_profile;
+#endif
+  return VA_RT_FORMAT_YUV420;
+}
+
+/* hand all surfaces back to the pool and unbind frames from them.
+ * caller holds ctx_lock. */
+static void _x_va_reset_surfaces(vaapi_context_impl_t *va_context)
+{
+  size_t i;
+
+  pthread_mutex_lock(&va_context->surfaces_lock);
+
+  /* assign surfaces */
+  for (i = 0; i < RENDER_SURFACES; i++) {
+    ff_vaapi_surface_t *va_surface  = &va_context->c.va_render_surfaces[i];
+    va_surface->index               = i;
+    va_surface->status              = SURFACE_FREE;
+    va_surface->va_surface_id       = va_context->c.va_surface_ids[i];
+  }
+  va_context->va_head = 0;
+
+  pthread_mutex_unlock(&va_context->surfaces_lock);
+
+  /* unbind frames from surfaces */
+  for (i = 0; i < RENDER_SURFACES; i++) {
+    if (va_context->frames[i]) {
+      vaapi_accel_t *accel = va_context->frames[i]->accel_data;
+      if (!accel->f->render_vaapi_surface) {
+        _x_assert(accel->index == i);
+      } else {
+        accel->index = RENDER_SURFACES;
+      }
+    }
+  }
+}
+
+int _x_va_context_matches(vaapi_context_impl_t *va_context, int va_profile, int width, int height)
+{
+  int match;
+
+  pthread_mutex_lock(&va_context->ctx_lock);
+  match = va_context->c.valid_context &&
+          va_context->va_profile   == va_profile &&
+          va_context->va_rt_format == _x_va_rt_format(va_profile) &&
+          va_context->c.width      == width &&
+          va_context->c.height     == height;
+  pthread_mutex_unlock(&va_context->ctx_lock);
+
+  return match;
+}
+
 VAStatus _x_va_init(vaapi_context_impl_t *va_context, int va_profile, int width, int height)
 {
   VAConfigAttrib va_attrib;
   VAStatus       vaStatus;
+  unsigned       rt_format = _x_va_rt_format(va_profile);
   size_t         i;
 
+  /* stream change with same profile and geometry (ex. dvb channel zapping).
+   * creating 50 surfaces and a new context can take hundreds of ms,
+   * and they are not bound to the stream. just recycle them. */
+  if (_x_va_context_matches(va_context, va_profile, width, height)) {
+    pthread_mutex_lock(&va_context->ctx_lock);
+    for (i = 0; i < RENDER_SURFACES; i++) {
+      if (va_context->c.va_surface_ids[i] != VA_INVALID_SURFACE) {
+        vaStatus = vaSyncSurface(va_context->c.va_display, va_context->c.va_surface_ids[i]);
+        _x_va_check_status(va_context, vaStatus, "vaSyncSurface()");
+      }
+    }
+    _x_va_reset_surfaces(va_context);
+    pthread_mutex_unlock(&va_context->ctx_lock);
+
+    xprintf(va_context->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": "
+            "Reusing context width %d height %d\n", width, height);
+    return VA_STATUS_SUCCESS;
+  }
+
   _x_va_close(va_context);
 
   pthread_mutex_lock(&va_context->ctx_lock);
@@ -352,12 +430,6 @@ VAStatus _x_va_init(vaapi_context_impl_t *va_context, int va_profile, int width,
           "Context width %d height %d\n", va_context->c.width, va_context->c.height);
 
   /* allocate decoding surfaces */
-  unsigned rt_format = VA_RT_FORMAT_YUV420;
-#if VA_CHECK_VERSION(0, 37, 0) && defined (VA_RT_FORMAT_YUV420_10BPP)
-  if (va_profile == VAProfileHEVCMain10) {
-    rt_format = VA_RT_FORMAT_YUV420_10BPP;
-  }
-#endif
   vaStatus = vaCreateSurfaces(va_context->c.va_display, rt_format, va_context->c.width, va_context->c.height, va_context->c.va_surface_ids, RENDER_SURFACES, NULL, 0);
   if (!_x_va_check_status(va_context, vaStatus, "vaCreateSurfaces()"))
     goto error;
@@ -392,31 +464,10 @@ VAStatus _x_va_init(vaapi_context_impl_t *va_context, int va_profile, int width,
     }
   }
 
-  pthread_mutex_lock(&va_context->surfaces_lock);
-
-  /* assign surfaces */
-  for (i = 0; i < RENDER_SURFACES; i++) {
-    ff_vaapi_surface_t *va_surface  = &va_context->c.va_render_surfaces[i];
-    va_surface->index               = i;
-    va_surface->status              = SURFACE_FREE;
-    va_surface->va_surface_id       = va_context->c.va_surface_ids[i];
-  }
-  va_context->va_head = 0;
-
-  pthread_mutex_unlock(&va_context->surfaces_lock);
-
-  /* unbind frames from surfaces */
-  for (i = 0; i < RENDER_SURFACES; i++) {
-    if (va_context->frames[i]) {
-      vaapi_accel_t *accel = va_context->frames[i]->accel_data;
-      if (!accel->f->render_vaapi_surface) {
-        _x_assert(accel->index == i);
-      } else {
-        accel->index = RENDER_SURFACES;
-      }
-    }
-  }
+  _x_va_reset_surfaces(va_context);
 
+  va_context->va_profile      = va_profile;
+  va_context->va_rt_format    = rt_format;
   va_context->c.valid_context = 1;
 
   pthread_mutex_unlock(&va_context->ctx_lock);
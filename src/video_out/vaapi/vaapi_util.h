@@ -64,6 +64,11 @@ struct vaapi_context_impl {
   unsigned int        num_frames;
   vo_frame_t         *frames[RENDER_SURFACES];
 
+  /* key of the current context. _x_va_init () keeps context and surfaces
+   * when a new stream asks for the same profile, size and format. */
+  int                 va_profile;
+  unsigned            va_rt_format;
+
   pthread_mutex_t     surfaces_lock;
   unsigned            va_head;
   ff_vaapi_surface_t  va_render_surfaces_storage[RENDER_SURFACES + 1];
@@ -86,6 +91,7 @@ int _x_va_profile_from_imgfmt(vaapi_context_impl_t *va_context, unsigned format)
 
 void _x_va_close(vaapi_context_impl_t *va_context);
 VAStatus _x_va_init(vaapi_context_impl_t *va_context, int va_profile, int width, int height);
+int _x_va_context_matches(vaapi_context_impl_t *va_context, int va_profile, int width, int height);
 
 ff_vaapi_surface_t *_x_va_alloc_surface(vaapi_context_impl_t *va_context);
 void _x_va_render_surface(vaapi_context_impl_t *va_context, ff_vaapi_surface_t *va_surface);
@@ -1444,6 +1444,14 @@ static int _flush_recent_frames (vaapi_driver_t *this) {
 static VAStatus vaapi_init_internal(vaapi_driver_t *this, int va_profile, int width, int height) {
   VAStatus            vaStatus;
 
+  /* same profile and geometry as before: keep context, decoder
+   * surfaces and soft surfaces, _x_va_init () only recycles them. */
+  if (_x_va_context_matches(this->va, va_profile, width, height) &&
+      this->sw_width == width && this->sw_height == height) {
+    _flush_recent_frames (this);
+    return _x_va_init(this->va, va_profile, width, height);
+  }
+
   vaapi_close(this);
 
   _flush_recent_frames (this);
@@ -43,6 +43,530 @@
 #include <xine/xineutils.h>
 #include "xine_private.h"
 
+/*
+ * parallel decoding of more audio tracks, see "engine.decoder.audio_track_workers".
+ * every track gets a hidden host stream. its own audio decoder thread does
+ * the work, and writes to a track port. the track port keeps a small ring
+ * of decoded buffers, and forwards to the real port while its track is
+ * the selected one. switching tracks just moves that forward flag, and
+ * the decoder does not need to resync.
+ */
+#define AUDIO_TRACK_WORKERS_MAX 8
+#define AUDIO_TRACK_RING        8
+#define AUDIO_TRACK_BUF_SIZE    32768
+/* how many bufs the selected worker may lag behind. this also keeps
+ * the others close to playback, for a seamless switch. */
+#define AUDIO_TRACK_AHEAD       4
+
+typedef struct {
+  xine_audio_port_t      port;
+
+  xine_stream_private_t *master;
+  xine_stream_t         *host;
+
+  /* lock guards the ring, out_lock the real port and the format. */
+  pthread_mutex_t        lock, out_lock;
+  pthread_cond_t         ring_free, drained;
+  /* physical (buf->type & 0xffff) and logical channel number, or -1. */
+  int                    chan, logical;
+  int                    active, open, out_open;
+  uint32_t               bits, rate;
+  int                    mode;
+  /* ring state: 0 free, 1 at decoder, 2 filled. */
+  uint32_t               seq;
+  uint32_t               ring_seq[AUDIO_TRACK_RING];
+  uint8_t                ring_state[AUDIO_TRACK_RING];
+  audio_buffer_t         ring[AUDIO_TRACK_RING];
+  extra_info_t           ring_ei[AUDIO_TRACK_RING];
+} audio_track_t;
+
+struct xine_audio_tracks_s {
+  pthread_mutex_t        lock;
+  int                    max, num, active;
+  audio_track_t         *track[AUDIO_TRACK_WORKERS_MAX];
+};
+
+static xine_audio_port_t *_audio_track_out (audio_track_t *t) {
+  return t->master->s.audio_out;
+}
+
+/* copy the codec name, decoders set it on the host stream. */
+static void _audio_track_info (audio_track_t *t) {
+  const char *s = _x_meta_info_get (t->host, XINE_META_INFO_AUDIOCODEC);
+  if (s)
+    _x_meta_info_set_utf8 (&t->master->s, XINE_META_INFO_AUDIOCODEC, s);
+}
+
+static uint32_t _audio_track_get_capabilities (xine_audio_port_t *port) {
+  audio_track_t *t = (audio_track_t *)port;
+  xine_audio_port_t *out = _audio_track_out (t);
+  return out->get_capabilities (out);
+}
+
+static int _audio_track_get_property (xine_audio_port_t *port, int property) {
+  audio_track_t *t = (audio_track_t *)port;
+  xine_audio_port_t *out = _audio_track_out (t);
+  return out->get_property (out, property);
+}
+
+static int _audio_track_set_property (xine_audio_port_t *port, int property, int value) {
+  audio_track_t *t = (audio_track_t *)port;
+  xine_audio_port_t *out = _audio_track_out (t);
+  return t->active ? out->set_property (out, property, value) : value;
+}
+
+static int _audio_track_open (xine_audio_port_t *port, xine_stream_t *stream,
+  uint32_t bits, uint32_t rate, int mode) {
+  audio_track_t *t = (audio_track_t *)port;
+  int r = rate;
+
+  (void)stream;
+  pthread_mutex_lock (&t->out_lock);
+  t->bits = bits;
+  t->rate = rate;
+  t->mode = mode;
+  t->open = 1;
+  if (t->active) {
+    xine_audio_port_t *out = _audio_track_out (t);
+    if (t->out_open)
+      out->close (out, &t->master->s);
+    r = out->open (out, &t->master->s, bits, rate, mode);
+    t->out_open = r > 0;
+    _audio_track_info (t);
+  }
+  pthread_mutex_unlock (&t->out_lock);
+  return r;
+}
+
+static audio_buffer_t *_audio_track_get_buffer (xine_audio_port_t *port) {
+  audio_track_t *t = (audio_track_t *)port;
+  int i, best;
+
+  pthread_mutex_lock (&t->lock);
+  while (1) {
+    /* free slot, or the oldest filled one. */
+    best = -1;
+    for (i = 0; i < AUDIO_TRACK_RING; i++) {
+      if (t->ring_state[i] == 0) {
+        best = i;
+        break;
+      }
+      if ((t->ring_state[i] == 2) && ((best < 0) || ((int32_t)(t->ring_seq[i] - t->ring_seq[best]) < 0)))
+        best = i;
+    }
+    if (best >= 0)
+      break;
+    pthread_cond_wait (&t->ring_free, &t->lock);
+  }
+  t->ring_state[best] = 1;
+  pthread_mutex_unlock (&t->lock);
+
+  t->ring[best].num_frames = 0;
+  t->ring[best].vpts = 0;
+  t->ring[best].stream = NULL;
+  _x_extra_info_reset (t->ring[best].extra_info);
+  return &t->ring[best];
+}
+
+static void _audio_track_put_buffer (xine_audio_port_t *port, audio_buffer_t *buf, xine_stream_t *stream) {
+  audio_track_t *t = (audio_track_t *)port;
+  int i = buf - t->ring;
+
+  (void)stream;
+  pthread_mutex_lock (&t->out_lock);
+  buf->format.bits = t->bits;
+  buf->format.rate = t->rate;
+  buf->format.mode = t->mode;
+  if (t->active && t->out_open && (buf->num_frames > 0)) {
+    xine_audio_port_t *out = _audio_track_out (t);
+    audio_buffer_t *ob = out->get_buffer (out);
+    int fsize = _x_ao_mode2channels (buf->format.mode) * ((buf->format.bits + 7) >> 3);
+    int n = buf->num_frames;
+
+    if (fsize > 0 && n * fsize > ob->mem_size)
+      n = ob->mem_size / fsize;
+    memcpy (ob->mem, buf->mem, n * fsize);
+    ob->num_frames         = n;
+    ob->vpts               = buf->vpts;
+    ob->frame_header_count = buf->frame_header_count;
+    ob->first_access_unit  = buf->first_access_unit;
+    out->put_buffer (out, ob, &t->master->s);
+  }
+  pthread_mutex_unlock (&t->out_lock);
+
+  pthread_mutex_lock (&t->lock);
+  t->ring_seq[i] = ++t->seq;
+  t->ring_state[i] = buf->num_frames > 0 ? 2 : 0;
+  pthread_cond_signal (&t->ring_free);
+  pthread_mutex_unlock (&t->lock);
+}
+
+static void _audio_track_close (xine_audio_port_t *port, xine_stream_t *stream) {
+  audio_track_t *t = (audio_track_t *)port;
+
+  (void)stream;
+  pthread_mutex_lock (&t->out_lock);
+  t->open = 0;
+  if (t->out_open) {
+    xine_audio_port_t *out = _audio_track_out (t);
+    out->close (out, &t->master->s);
+    t->out_open = 0;
+  }
+  pthread_mutex_unlock (&t->out_lock);
+}
+
+static void _audio_track_exit (xine_audio_port_t *port) {
+  (void)port;
+}
+
+static int _audio_track_control (xine_audio_port_t *port, int cmd, ...) {
+  audio_track_t *t = (audio_track_t *)port;
+  xine_audio_port_t *out = _audio_track_out (t);
+  va_list args;
+  void *arg;
+  int r = 0;
+
+  va_start (args, cmd);
+  arg = va_arg (args, void *);
+  if (t->active)
+    r = out->control (out, cmd, arg);
+  va_end (args);
+  return r;
+}
+
+static void _audio_track_flush (xine_audio_port_t *port) {
+  (void)port;
+}
+
+static int _audio_track_status (xine_audio_port_t *port, xine_stream_t *stream,
+  uint32_t *bits, uint32_t *rate, int *mode) {
+  audio_track_t *t = (audio_track_t *)port;
+  int r;
+
+  (void)stream;
+  pthread_mutex_lock (&t->out_lock);
+  *bits = t->bits;
+  *rate = t->rate;
+  *mode = t->mode;
+  r = t->open;
+  pthread_mutex_unlock (&t->out_lock);
+  return r;
+}
+
+static void _audio_track_set_active (audio_track_t *t, int active) {
+  xine_audio_port_t *out = _audio_track_out (t);
+
+  pthread_mutex_lock (&t->out_lock);
+  if (active && !t->active) {
+    if (t->open && !t->out_open) {
+      t->out_open = out->open (out, &t->master->s, t->bits, t->rate, t->mode) > 0;
+      _audio_track_info (t);
+    }
+  } else if (!active && t->active) {
+    if (t->out_open) {
+      out->close (out, &t->master->s);
+      t->out_open = 0;
+    }
+  }
+  t->active = active;
+  pthread_mutex_unlock (&t->out_lock);
+}
+
+/* runs with fifo locked. */
+static void _audio_track_get_cb (fifo_buffer_t *fifo, buf_element_t *buf, void *data) {
+  audio_track_t *t = (audio_track_t *)data;
+
+  (void)buf;
+  if (fifo->fifo_size <= AUDIO_TRACK_AHEAD) {
+    pthread_mutex_lock (&t->lock);
+    pthread_cond_signal (&t->drained);
+    pthread_mutex_unlock (&t->lock);
+  }
+}
+
+static audio_track_t *_audio_track_new (xine_stream_private_t *stream) {
+  audio_track_t *t = calloc (1, sizeof (*t));
+  uint8_t *mem;
+  int i;
+
+  if (!t)
+    return NULL;
+  mem = malloc (AUDIO_TRACK_RING * AUDIO_TRACK_BUF_SIZE);
+  if (!mem) {
+    free (t);
+    return NULL;
+  }
+  t->port.get_capabilities = _audio_track_get_capabilities;
+  t->port.get_property     = _audio_track_get_property;
+  t->port.set_property     = _audio_track_set_property;
+  t->port.open             = _audio_track_open;
+  t->port.get_buffer       = _audio_track_get_buffer;
+  t->port.put_buffer       = _audio_track_put_buffer;
+  t->port.close            = _audio_track_close;
+  t->port.exit             = _audio_track_exit;
+  t->port.control          = _audio_track_control;
+  t->port.flush            = _audio_track_flush;
+  t->port.status           = _audio_track_status;
+  t->master  = stream;
+  t->chan    = -1;
+  t->logical = -1;
+  for (i = 0; i < AUDIO_TRACK_RING; i++) {
+    t->ring[i].mem        = (int16_t *)(mem + i * AUDIO_TRACK_BUF_SIZE);
+    t->ring[i].mem_size   = AUDIO_TRACK_BUF_SIZE;
+    t->ring[i].extra_info = &t->ring_ei[i];
+  }
+  pthread_mutex_init (&t->lock, NULL);
+  pthread_mutex_init (&t->out_lock, NULL);
+  pthread_cond_init (&t->ring_free, NULL);
+  pthread_cond_init (&t->drained, NULL);
+
+  t->host = xine_stream_new (stream->s.xine, &t->port, NULL);
+  if (!t->host) {
+    pthread_cond_destroy (&t->drained);
+    pthread_cond_destroy (&t->ring_free);
+    pthread_mutex_destroy (&t->out_lock);
+    pthread_mutex_destroy (&t->lock);
+    free (mem);
+    free (t);
+    return NULL;
+  }
+  t->host->audio_fifo->register_get_cb (t->host->audio_fifo, _audio_track_get_cb, t);
+  return t;
+}
+
+static void _audio_track_delete (audio_track_t *t) {
+  xine_dispose (t->host);
+  pthread_cond_destroy (&t->drained);
+  pthread_cond_destroy (&t->ring_free);
+  pthread_mutex_destroy (&t->out_lock);
+  pthread_mutex_destroy (&t->lock);
+  free (t->ring[0].mem);
+  free (t);
+}
+
+/* copy a control buf to all workers. they must not miss any,
+ * so wait for a free buf if needed. */
+static void _audio_tracks_put_ctrl (struct xine_audio_tracks_s *tracks, xine_ticket_t *ticket, buf_element_t *buf) {
+  int i;
+
+  for (i = 0; i < tracks->num; i++) {
+    fifo_buffer_t *fifo = tracks->track[i]->host->audio_fifo;
+    buf_element_t *nb = fifo->buffer_pool_try_alloc (fifo);
+
+    if (!nb) {
+      /* the worker needs the ticket to free its bufs. */
+      ticket->release (ticket, 0);
+      nb = fifo->buffer_pool_alloc (fifo);
+      ticket->acquire (ticket, 0);
+    }
+    nb->type          = buf->type;
+    nb->decoder_flags = buf->decoder_flags;
+    nb->pts           = buf->pts;
+    nb->disc_off      = buf->disc_off;
+    nb->size          = 0;
+    memcpy (nb->decoder_info, buf->decoder_info, sizeof (nb->decoder_info));
+    fifo->put (fifo, nb);
+  }
+}
+
+/* find or assign the worker for a track. */
+static audio_track_t *_audio_tracks_get (xine_stream_private_t *stream, uint32_t chan, int add) {
+  struct xine_audio_tracks_s *tracks = stream->audio_tracks;
+  audio_track_t *t;
+  int i;
+
+  for (i = 0; i < tracks->num; i++) {
+    if (tracks->track[i]->chan == (int)chan)
+      return tracks->track[i];
+  }
+  if (!add)
+    return NULL;
+  for (i = 0; i < tracks->num; i++) {
+    t = tracks->track[i];
+    if (t->chan < 0) {
+      pthread_mutex_lock (&tracks->lock);
+      t->chan = chan;
+      pthread_mutex_unlock (&tracks->lock);
+      return t;
+    }
+  }
+  if (tracks->num >= tracks->max)
+    return NULL;
+  t = _audio_track_new (stream);
+  if (!t) {
+    tracks->max = tracks->num;
+    return NULL;
+  }
+  t->chan = chan;
+  pthread_mutex_lock (&tracks->lock);
+  tracks->track[tracks->num++] = t;
+  pthread_mutex_unlock (&tracks->lock);
+  xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
+    "audio_decoder: track #%u now decoded by worker %d.\n", (unsigned int)chan, tracks->num - 1);
+  return t;
+}
+
+static int _audio_tracks_index (struct xine_audio_tracks_s *tracks, audio_track_t *t) {
+  int i;
+
+  for (i = 0; tracks->track[i] != t; i++) ;
+  return i;
+}
+
+/* logical channel numbers follow the track map. */
+static void _audio_tracks_map (struct xine_audio_tracks_s *tracks, const uint32_t *map, int entries) {
+  int i, j;
+
+  pthread_mutex_lock (&tracks->lock);
+  for (i = 0; i < tracks->num; i++) {
+    audio_track_t *t = tracks->track[i];
+    t->logical = -1;
+    for (j = 0; j < entries; j++) {
+      if ((int)(map[j] & 0x0000ffff) == t->chan) {
+        t->logical = j;
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock (&tracks->lock);
+}
+
+static void _audio_tracks_select (struct xine_audio_tracks_s *tracks, int index) {
+  if (tracks->active == index)
+    return;
+  if (tracks->active >= 0)
+    _audio_track_set_active (tracks->track[tracks->active], 0);
+  tracks->active = index;
+  if (index >= 0)
+    _audio_track_set_active (tracks->track[index], 1);
+}
+
+static void _audio_tracks_reset (struct xine_audio_tracks_s *tracks) {
+  int i;
+
+  _audio_tracks_select (tracks, -1);
+  pthread_mutex_lock (&tracks->lock);
+  for (i = 0; i < tracks->num; i++) {
+    tracks->track[i]->chan = -1;
+    tracks->track[i]->logical = -1;
+  }
+  pthread_mutex_unlock (&tracks->lock);
+}
+
+/* buffers still waiting for the selected worker. */
+static int _audio_tracks_pending (struct xine_audio_tracks_s *tracks) {
+  fifo_buffer_t *fifo;
+
+  if (!tracks || (tracks->active < 0))
+    return 0;
+  fifo = tracks->track[tracks->active]->host->audio_fifo;
+  return fifo->size (fifo);
+}
+
+/* let the selected worker catch up to max queued bufs. */
+static void _audio_tracks_wait (struct xine_audio_tracks_s *tracks, xine_ticket_t *ticket, int max) {
+  audio_track_t *t;
+
+  if (_audio_tracks_pending (tracks) <= max)
+    return;
+  t = tracks->track[tracks->active];
+  ticket->release (ticket, 0);
+  while (_audio_tracks_pending (tracks) > max) {
+    struct timespec ts = {0, 0};
+    /* the fifo size test is not atomic with the wait, dont hang on a missed signal. */
+    xine_gettime (&ts);
+    ts.tv_nsec += 10000000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_nsec -= 1000000000;
+      ts.tv_sec += 1;
+    }
+    pthread_mutex_lock (&t->lock);
+    pthread_cond_timedwait (&t->drained, &t->lock, &ts);
+    pthread_mutex_unlock (&t->lock);
+  }
+  ticket->acquire (ticket, 0);
+}
+
+/* drop queued data, keep control bufs. */
+static void _audio_tracks_flush (struct xine_audio_tracks_s *tracks) {
+  int i;
+
+  for (i = 0; i < tracks->num; i++) {
+    fifo_buffer_t *fifo = tracks->track[i]->host->audio_fifo;
+    fifo->clear (fifo);
+  }
+}
+
+int xine_get_audio_track_data (xine_stream_t *s, int channel, xine_audio_track_data_t *data) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  struct xine_audio_tracks_s *tracks;
+  audio_track_t *t = NULL;
+  int i, fsize, have, want, r = 0;
+
+  if (!stream || !data)
+    return 0;
+  stream = stream->side_streams[0];
+  tracks = stream->audio_tracks;
+  if (!tracks)
+    return 0;
+
+  pthread_mutex_lock (&tracks->lock);
+  for (i = 0; i < tracks->num; i++) {
+    if (tracks->track[i]->logical == channel) {
+      t = tracks->track[i];
+      break;
+    }
+  }
+  if (t) {
+    uint32_t order[AUDIO_TRACK_RING];
+    int n = 0, j;
+
+    pthread_mutex_lock (&t->lock);
+    /* filled slots, newest first. */
+    for (i = 0; i < AUDIO_TRACK_RING; i++) {
+      if (t->ring_state[i] != 2)
+        continue;
+      for (j = n; (j > 0) && ((int32_t)(t->ring_seq[i] - t->ring_seq[order[j - 1]]) > 0); j--)
+        order[j] = order[j - 1];
+      order[j] = i;
+      n++;
+    }
+    if (n > 0) {
+      audio_buffer_t *last = &t->ring[order[0]];
+
+      data->bits = last->format.bits;
+      data->rate = last->format.rate;
+      data->mode = last->format.mode;
+      data->pts  = last->vpts;
+      fsize = _x_ao_mode2channels (data->mode) * ((data->bits + 7) >> 3);
+      /* count the newest buffers of same format that fit. */
+      want = data->num_frames;
+      have = 0;
+      for (j = 0; j < n; j++) {
+        audio_buffer_t *b = &t->ring[order[j]];
+        if ((b->format.bits != last->format.bits) || (b->format.rate != last->format.rate)
+          || (b->format.mode != last->format.mode) || (have + b->num_frames > want))
+          break;
+        have += b->num_frames;
+      }
+      /* copy them in time order. */
+      data->num_frames = have;
+      if (data->data && fsize > 0) {
+        uint8_t *q = data->data;
+        while (--j >= 0) {
+          audio_buffer_t *b = &t->ring[order[j]];
+          memcpy (q, b->mem, b->num_frames * fsize);
+          q += b->num_frames * fsize;
+        }
+      }
+      r = 1;
+    }
+    pthread_mutex_unlock (&t->lock);
+  }
+  pthread_mutex_unlock (&tracks->lock);
+  return r;
+}
+
 static void *audio_decoder_loop (void *stream_gen) {
 
   xine_stream_private_t *stream = (xine_stream_private_t *)stream_gen;
@@ -101,7 +625,8 @@ static void *audio_decoder_loop (void *stream_gen) {
           break;
         xine_rwlock_rdlock (&stream->info_lock);
         handled = stream->stream_info[XINE_STREAM_INFO_AUDIO_HANDLED];
-        ignore  = stream->stream_info[XINE_STREAM_INFO_IGNORE_AUDIO];
+        ignore  = stream->stream_info[XINE_STREAM_INFO_IGNORE_AUDIO]
+               || (stream->stream_info[XINE_STREAM_INFO_KEYFRAMES_ONLY] && stream->stream_info[XINE_STREAM_INFO_HAS_VIDEO]);
         xine_rwlock_unlock (&stream->info_lock);
         (void)handled; /* dont optimize away the read. */
         if (ignore)
@@ -114,6 +639,7 @@ static void *audio_decoder_loop (void *stream_gen) {
           uint32_t audio_type = 0;
           int      i;
           uint32_t chan;
+          audio_track_t *track = NULL;
           /* printf ("audio_decoder: buf_type=%08x auto=%08x user=%08x\n",
                buf->type, stream->audio_channel_auto, audio_channel_user); */
 
@@ -135,6 +661,8 @@ static void *audio_decoder_loop (void *stream_gen) {
             }
             audio_track_map[i] = buf->type;
             stream->audio_track_map_entries++;
+            if (stream->audio_tracks)
+              _audio_tracks_map (stream->audio_tracks, audio_track_map, stream->audio_track_map_entries);
             /* implicit channel change - reopen decoder below */
             if ((i == 0) && (audio_channel_user == -1) && (stream->s.audio_channel_auto < 0))
               stream->audio_decoder_streamtype = -1;
@@ -163,14 +691,51 @@ static void *audio_decoder_loop (void *stream_gen) {
                 audio_type = -1;
             }
 
+            /* tracks with a worker bypass the local decoder. */
+            if (stream->audio_tracks) {
+              struct xine_audio_tracks_s *tracks = stream->audio_tracks;
+              track = _audio_tracks_get (stream, chan, !headers_replay);
+              if (track) {
+                if (track->logical < 0)
+                  _audio_tracks_map (tracks, audio_track_map, stream->audio_track_map_entries);
+                /* the worker already has these. */
+                if (headers_replay) {
+                  xine_profiler_stop_count (prof_audio_decode);
+                  break;
+                }
+                if ((buf->type != audio_type) && (tracks->active >= 0) && (tracks->track[tracks->active] == track))
+                  _audio_tracks_select (tracks, -1);
+              }
+            }
+
             /* now, decode stream buffer if it's the right audio type */
             if (buf->type == audio_type) {
 
               int streamtype = (buf->type>>16) & 0xFF;
-              /* close old decoder of audio type has changed */
-              if (buf->type != buftype_unknown &&
+              if (track) {
+                /* the selected track is decoded by its worker. */
+                if (stream->audio_decoder_plugin) {
+                  _x_free_audio_decoder (&stream->s, stream->audio_decoder_plugin);
+                  stream->audio_decoder_plugin = NULL;
+                  stream->audio_decoder_streamtype = -1;
+                }
+                i = _audio_tracks_index (stream->audio_tracks, track);
+                if (stream->audio_tracks->active != i) {
+                  _audio_tracks_select (stream->audio_tracks, i);
+                  xine_rwlock_wrlock (&stream->info_lock);
+                  stream->stream_info[XINE_STREAM_INFO_AUDIO_HANDLED] = 1;
+                  xine_rwlock_unlock (&stream->info_lock);
+                  audio_br_lasttime = 0;
+                  audio_br_lastsize = 0;
+                  audio_br_time     = 1;
+                  audio_br_bytes    = 0;
+                  audio_br_num      = 20;
+                  audio_br_value    = 0;
+                }
+              } else if (buf->type != buftype_unknown &&
                 (stream->audio_decoder_streamtype != streamtype ||
                 !stream->audio_decoder_plugin)) {
+                /* close old decoder of audio type has changed */
                 if (stream->audio_decoder_plugin) {
                   _x_free_audio_decoder (&stream->s, stream->audio_decoder_plugin);
                 }
@@ -189,7 +754,7 @@ static void *audio_decoder_loop (void *stream_gen) {
                 audio_br_value    = 0;
               }
               if (audio_type != stream->audio_type) {
-                if (stream->audio_decoder_plugin) {
+                if (stream->audio_decoder_plugin || track) {
                   xine_event_t event;
                   stream->audio_type = audio_type;
                   event.type         = XINE_EVENT_UI_CHANNELS_CHANGED;
@@ -234,15 +799,18 @@ static void *audio_decoder_loop (void *stream_gen) {
               }
               audio_br_lastsize += buf->size;
 
+              if (stream->accurate_seek.audio && !(buf->decoder_flags & (BUF_FLAG_PREVIEW | BUF_FLAG_HEADER)))
+                xine_accurate_seek_map (stream, buf);
+
               /* finally - decode data */
-              if (stream->audio_decoder_plugin)
+              if (!track && stream->audio_decoder_plugin)
                 stream->audio_decoder_plugin->decode_data (stream->audio_decoder_plugin, buf);
 
               /* no need to lock again. it may have been reset from this thread inside
                * audio_decoder_plugin->decode_data (), if at all.
                * XXX: should we try a different decoder then? */
               handled = stream->stream_info[XINE_STREAM_INFO_AUDIO_HANDLED];
-              if (!handled && (buf->type != buftype_unknown)) {
+              if (!track && !handled && (buf->type != buftype_unknown)) {
                 const char *aname = _x_buf_audio_name (buf->type);
 
                 xine_log (stream->s.xine, XINE_LOG_MSG,
@@ -258,6 +826,14 @@ static void *audio_decoder_loop (void *stream_gen) {
               }
             }
           }
+
+          /* hand over without copy, it returns to our pool when done. */
+          if (track) {
+            fifo_buffer_t *fifo = track->host->audio_fifo;
+            fifo->put (fifo, buf);
+            buf = NULL;
+            _audio_tracks_wait (stream->audio_tracks, running_ticket, AUDIO_TRACK_AHEAD);
+          }
         }
         /* if (running_ticket->ticket_revoked)
          *   running_ticket->renew (running_ticket, 0);
@@ -296,6 +872,13 @@ static void *audio_decoder_loop (void *stream_gen) {
               stream->audio_type = 0;
               stream->keep_ao_driver_open = 0;
             }
+            if (stream->audio_tracks) {
+              _audio_tracks_put_ctrl (stream->audio_tracks, running_ticket, buf);
+              stream->keep_ao_driver_open = !!(buf->decoder_flags & BUF_FLAG_GAPLESS_SW);
+              _audio_tracks_reset (stream->audio_tracks);
+              stream->keep_ao_driver_open = 0;
+              stream->audio_type = 0;
+            }
             /* running_ticket->release(running_ticket, 0); */
             audio_track_map[0] = AUDIO_TRACK_MAP_END;
             stream->audio_track_map_entries = 0;
@@ -314,6 +897,8 @@ static void *audio_decoder_loop (void *stream_gen) {
             headers_add    = &headers_first;
             headers_replay = NULL;
             headers_num    = 0;
+            if (stream->audio_tracks)
+              _audio_tracks_wait (stream->audio_tracks, running_ticket, 0);
             /* wait the output fifos to run dry before sending the notification event
              * to the frontend. this test is only valid if there is only a single
              * stream attached to the current output port. */
@@ -380,6 +965,10 @@ static void *audio_decoder_loop (void *stream_gen) {
               stream->audio_decoder_plugin->reset (stream->audio_decoder_plugin);
               /* running_ticket->release(running_ticket, 0); */
             }
+            if (stream->audio_tracks) {
+              _audio_tracks_flush (stream->audio_tracks);
+              _audio_tracks_put_ctrl (stream->audio_tracks, running_ticket, buf);
+            }
             break;
 
           case BUFTYPE_SUB (BUF_CONTROL_DISCONTINUITY):
@@ -394,9 +983,16 @@ static void *audio_decoder_loop (void *stream_gen) {
               stream->audio_decoder_plugin->discontinuity (stream->audio_decoder_plugin);
               /* running_ticket->release(running_ticket, 0); */
             }
+            if (stream->audio_tracks) {
+              _audio_tracks_put_ctrl (stream->audio_tracks, running_ticket, buf);
+              /* decode the old pts before our metronom switches. */
+              _audio_tracks_wait (stream->audio_tracks, running_ticket, 0);
+            }
             running_ticket->release (running_ticket, 0);
             stream->s.metronom->handle_audio_discontinuity (stream->s.metronom, t, buf->disc_off);
             running_ticket->acquire (running_ticket, 0);
+            if (t == DISC_STREAMSEEK)
+              xine_accurate_seek_arm (stream, 2);
             /* audio_br_discontinuity */
             audio_br_lasttime = 0;
             audio_br_lastsize = 0;
@@ -413,6 +1009,8 @@ static void *audio_decoder_loop (void *stream_gen) {
               xine_event_t ui_event;
               audio_track_map[0] = AUDIO_TRACK_MAP_END;
               stream->audio_track_map_entries = 0;
+              if (stream->audio_tracks)
+                _audio_tracks_map (stream->audio_tracks, audio_track_map, 0);
               ui_event.type        = XINE_EVENT_UI_CHANNELS_CHANGED;
               ui_event.data_length = 0;
               xine_event_send (&stream->s, &ui_event);
@@ -459,8 +1057,11 @@ static void *audio_decoder_loop (void *stream_gen) {
           audio_track_map[0] = AUDIO_TRACK_MAP_END;
           stream->audio_track_map_entries = 0;
           stream->audio_type = 0;
+          if (stream->audio_tracks)
+            _audio_tracks_map (stream->audio_tracks, audio_track_map, 0);
         }
-        buf->free_buffer (buf);
+        if (buf)
+          buf->free_buffer (buf);
         headers_replay = headers_first;
         xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
           "audio_decoder: replaying %d headers.\n", headers_num);
@@ -468,7 +1069,9 @@ static void *audio_decoder_loop (void *stream_gen) {
         /* header buffers are never freed. instead they
          * are added to a list to allow replaying them
          * in case of a channel change. */
-        if (buf->decoder_flags & BUF_FLAG_HEADER) {
+        if (!buf) {
+          /* handed over to a track worker. */
+        } else if (buf->decoder_flags & BUF_FLAG_HEADER) {
           /* drop outdated headers. */
           int num = 0;
           buf_element_t *here = headers_first, **add = &headers_first;
@@ -560,9 +1163,36 @@ int _x_audio_decoder_init (xine_stream_t *s) {
     if (num_buffers > 2000)
       num_buffers = 2000;
 
+    if (stream->s.audio_out->open == _audio_track_open) {
+      /* a track worker. data bufs come from the master pool, we just need a few for control. */
+      num_buffers = 20;
+    } else {
+      int workers = stream->s.xine->config->register_range (stream->s.xine->config,
+        "engine.decoder.audio_track_workers", 0, 0, AUDIO_TRACK_WORKERS_MAX,
+        _("number of parallel audio track decoders"),
+        _("Decode up to this many audio tracks of a stream at the same time, "
+          "each in its own thread. Switching between them is then instant, "
+          "and frontends can monitor the tracks not being played.\n"
+          "0 decodes just the selected track, as usual."),
+        20, NULL, NULL);
+      if (workers > 0) {
+        stream->audio_tracks = calloc (1, sizeof (*stream->audio_tracks));
+        if (stream->audio_tracks) {
+          pthread_mutex_init (&stream->audio_tracks->lock, NULL);
+          stream->audio_tracks->max = workers;
+          stream->audio_tracks->active = -1;
+        }
+      }
+    }
+
     stream->s.audio_fifo = _x_fifo_buffer_new (num_buffers, 2048);
-    if (!stream->s.audio_fifo)
+    if (!stream->s.audio_fifo) {
+      if (stream->audio_tracks) {
+        pthread_mutex_destroy (&stream->audio_tracks->lock);
+        _x_freep (&stream->audio_tracks);
+      }
       return 0;
+    }
 
     stream->audio_channel_user = -1;
     stream->s.audio_channel_auto = -1;
@@ -590,6 +1220,10 @@ int _x_audio_decoder_init (xine_stream_t *s) {
       pthread_attr_destroy(&pth_attrs);
       stream->s.audio_fifo->dispose (stream->s.audio_fifo);
       stream->s.audio_fifo = NULL;
+      if (stream->audio_tracks) {
+        pthread_mutex_destroy (&stream->audio_tracks->lock);
+        _x_freep (&stream->audio_tracks);
+      }
       return 0;
     }
 
@@ -617,6 +1251,18 @@ void _x_audio_decoder_shutdown (xine_stream_t *s) {
     stream->audio_thread_created = 0;
   }
 
+  if (stream->audio_tracks) {
+    struct xine_audio_tracks_s *tracks = stream->audio_tracks;
+    int i;
+
+    _audio_tracks_select (tracks, -1);
+    for (i = 0; i < tracks->num; i++)
+      _audio_track_delete (tracks->track[i]);
+    pthread_mutex_destroy (&tracks->lock);
+    stream->audio_tracks = NULL;
+    free (tracks);
+  }
+
   if (stream->s.audio_fifo) {
     stream->s.audio_fifo->dispose (stream->s.audio_fifo);
     stream->s.audio_fifo = NULL;
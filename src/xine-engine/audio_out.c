@@ -2613,6 +2613,13 @@ static void ao_put_buffer (xine_audio_port_t *this_gen,
      * if decoder did set pts, use that here. */
     if ((buf->extra_info->input_time == -1) && pts)
       buf->extra_info->input_time = pts / 90;
+    if (((xine_stream_private_t *)stream)->accurate_seek.audio) {
+      int duration = buf->format.rate ? xine_uint_mul_div (buf->num_frames, 90000, buf->format.rate) : 0;
+      if (xine_accurate_seek_skip ((xine_stream_private_t *)stream, pts, duration, 2)) {
+        ao_free_fifo_append (this, buf);
+        return;
+      }
+    }
     buf->vpts = s->s.metronom->got_audio_samples (s->s.metronom, pts, buf->num_frames);
     if ((s->first_frame.flag >= 2) && !s->video_decoder_plugin) {
       pthread_mutex_lock (&s->first_frame.lock);
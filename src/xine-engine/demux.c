@@ -26,13 +26,17 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 #include <sched.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <dirent.h>
+#include <basedir.h>
 
 #define LOG_MODULE "demux"
 #define LOG_VERBOSE
@@ -44,6 +48,7 @@
 #include <xine/demux.h>
 #include <xine/buffer.h>
 #include "xine_private.h"
+#include "bswap.h"
 
 #ifdef WIN32
 #include <winsock.h>
@@ -648,6 +653,63 @@ int _x_demux_stop_thread (xine_stream_t *s) {
   return 0;
 }
 
+/* header bytes that _x_find_demux_plugin () has already read. there is
+ * rarely more than 1 probe in flight, so a few slots will do. */
+#define PROBE_HEADER_SLOTS 4
+static struct {
+  pthread_mutex_t lock;
+  struct {
+    input_plugin_t *input;
+    const uint8_t  *buf;
+    int             size;
+  } slot[PROBE_HEADER_SLOTS];
+} _probe_headers = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+void _x_demux_probe_header (input_plugin_t *input, const uint8_t *buf, int size) {
+  int i;
+
+  if (!input)
+    return;
+  pthread_mutex_lock (&_probe_headers.lock);
+  for (i = 0; i < PROBE_HEADER_SLOTS; i++) {
+    if (_probe_headers.slot[i].input == input)
+      break;
+  }
+  if (i >= PROBE_HEADER_SLOTS) {
+    for (i = 0; i < PROBE_HEADER_SLOTS; i++) {
+      if (!_probe_headers.slot[i].input)
+        break;
+    }
+  }
+  if (i < PROBE_HEADER_SLOTS) {
+    if (buf && (size > 0)) {
+      _probe_headers.slot[i].input = input;
+      _probe_headers.slot[i].buf   = buf;
+      _probe_headers.slot[i].size  = size;
+    } else {
+      _probe_headers.slot[i].input = NULL;
+    }
+  }
+  pthread_mutex_unlock (&_probe_headers.lock);
+}
+
+static int _probe_header_get (input_plugin_t *input, void *buffer, int size) {
+  int i, r = 0;
+
+  pthread_mutex_lock (&_probe_headers.lock);
+  for (i = 0; i < PROBE_HEADER_SLOTS; i++) {
+    if (_probe_headers.slot[i].input == input) {
+      if (size <= _probe_headers.slot[i].size) {
+        memcpy (buffer, _probe_headers.slot[i].buf, size);
+        r = size;
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock (&_probe_headers.lock);
+  return r;
+}
+
 int _x_demux_read_stream_header (xine_stream_t *stream, input_plugin_t *input, void *buffer, size_t size) {
   xine_stream_private_t *s = (xine_stream_private_t *)stream;
   int want_size = size;
@@ -659,6 +721,8 @@ int _x_demux_read_stream_header (xine_stream_t *stream, input_plugin_t *input, v
   caps = input->get_capabilities (input);
 
   if ((caps & INPUT_CAP_SIZED_PREVIEW) && (want_size >= (int)sizeof (want_size))) {
+    if (_probe_header_get (input, buffer, want_size))
+      return want_size;
     memcpy (buffer, &want_size, sizeof (want_size));
     return input->get_optional_data (input, buffer, INPUT_OPTIONAL_DATA_SIZED_PREVIEW);
   }
@@ -668,6 +732,12 @@ int _x_demux_read_stream_header (xine_stream_t *stream, input_plugin_t *input, v
 
     if (s && (s->id3v2_tag_size >= 0))
       start = s->id3v2_tag_size;
+    if (!start && _probe_header_get (input, buffer, want_size)) {
+      /* leave input where a real read would have left it. */
+      if ((input->get_current_pos (input) != 0) && (input->seek (input, 0, SEEK_SET) != 0))
+        return 0;
+      return want_size;
+    }
     if (input->seek (input, start, SEEK_SET) != start)
       return 0;
     want_size = input->read (input, buffer, want_size);
@@ -679,6 +749,8 @@ int _x_demux_read_stream_header (xine_stream_t *stream, input_plugin_t *input, v
   }
 
   if (caps & INPUT_CAP_PREVIEW) {
+    if (_probe_header_get (input, buffer, want_size))
+      return want_size;
     if (want_size < MAX_PREVIEW_SIZE) {
       int read_size;
       uint8_t *temp = malloc (MAX_PREVIEW_SIZE);
@@ -1001,3 +1073,460 @@ int _x_demux_seek (xine_stream_t *s, off_t start_pos, int start_time, int playin
   return ret;
 }
 
+
+/*
+ * persistent seek index
+ *
+ * a list of (byte pos, pts) of keyframes, sorted by pos. an entry is "linked" when
+ * the demuxer went there straight from the previous entry (or from the file start,
+ * for the first one), so there is no other keyframe in between. saved to and loaded from
+ * $XDG_CACHE_HOME/xine-lib/seek/<mrl crc>.<type>. that directory is kept below
+ * SEEK_INDEX_DIR_FILES and SEEK_INDEX_DIR_BYTES by dropping the oldest files.
+ */
+
+#define SEEK_INDEX_VERSION  1
+#define SEEK_INDEX_HEAD     4096
+#define SEEK_INDEX_MAX      (1 << 20)
+#define SEEK_INDEX_PTS      (((int64_t)1 << 33) - 1)
+#define SEEK_INDEX_LINKED   ((int64_t)1 << 62)
+#define SEEK_INDEX_COMPLETE 1
+#define SEEK_INDEX_DIR_FILES 256
+#define SEEK_INDEX_DIR_BYTES (64 << 20)
+
+typedef struct {
+  int64_t pos;
+  int64_t pts;    /* 33 bit pts | SEEK_INDEX_LINKED */
+} seek_index_entry_t;
+
+struct xine_seek_index_s {
+  xine_t             *xine;
+  pthread_mutex_t     lock;
+  seek_index_entry_t *e;
+  int64_t            *time;     /* pts relative to first entry, unwrapped */
+  int                 used, size;
+  int                 time_valid;
+  int                 changed;
+  int                 complete;
+  int                 prebuild;
+  off_t               length;
+  uint32_t            head_crc;
+  char                type[8];
+  char               *mrl;
+  char                filename[1024];
+};
+
+static void seek_index_put_32 (uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void seek_index_put_64 (uint8_t *p, uint64_t v) {
+  seek_index_put_32 (p, v >> 32);
+  seek_index_put_32 (p + 4, v);
+}
+
+static uint64_t seek_index_get_64 (const uint8_t *p) {
+  return ((uint64_t)_X_BE_32 (p) << 32) | _X_BE_32 (p + 4);
+}
+
+/* <cache>/xine-lib/seek/, optionally created. returns string length, or 0. */
+static size_t seek_index_dir (xine_t *xine, char *buf, size_t bsize, int createdir) {
+  const char *cache = xdgCacheHome (&xine->basedir_handle);
+  size_t l;
+
+  if (!cache)
+    return 0;
+  l = strlen (cache);
+  if (l + sizeof ("/" PACKAGE "/seek/") + 32 > bsize)
+    return 0;
+  memcpy (buf, cache, l);
+  if (createdir) {
+    buf[l] = 0;
+    mkdir (buf, 0700);
+  }
+  memcpy (buf + l, "/" PACKAGE, sizeof ("/" PACKAGE));
+  l += sizeof ("/" PACKAGE) - 1;
+  if (createdir)
+    mkdir (buf, 0700);
+  memcpy (buf + l, "/seek", sizeof ("/seek"));
+  l += sizeof ("/seek") - 1;
+  if (createdir && mkdir (buf, 0700) && (errno != EEXIST)) {
+    xprintf (xine, XINE_VERBOSITY_DEBUG, "seek_index: cannot create %s: %s.\n", buf, strerror (errno));
+    return 0;
+  }
+  buf[l++] = '/';
+  buf[l] = 0;
+  return l;
+}
+
+static int seek_index_grow (xine_seek_index_t *idx, int n) {
+  seek_index_entry_t *e;
+  int64_t *t;
+
+  if (n <= idx->size)
+    return 1;
+  if (n > SEEK_INDEX_MAX)
+    return 0;
+  n = (n + 1023) & ~1023;
+  e = realloc (idx->e, n * sizeof (*e));
+  if (!e)
+    return 0;
+  idx->e = e;
+  t = realloc (idx->time, n * sizeof (*t));
+  if (!t)
+    return 0;
+  idx->time = t;
+  idx->size = n;
+  return 1;
+}
+
+static void seek_index_load (xine_seek_index_t *idx) {
+  uint8_t head[48];
+  size_t  mlen = strlen (idx->mrl);
+  uint32_t n, i;
+  FILE *f;
+
+  f = fopen (idx->filename, "rb");
+  if (!f)
+    return;
+  do {
+    uint8_t *buf;
+    off_t length;
+    if (fread (head, 1, 36, f) != 36)
+      break;
+    if (memcmp (head, "XSIX", 4) || (_X_BE_32 (head + 4) != SEEK_INDEX_VERSION) ||
+      memcmp (head + 28, idx->type, 8) || (_X_BE_32 (head + 12) != idx->head_crc))
+      break;
+    /* a recording that has grown since is fine, a shorter file is not. */
+    length = seek_index_get_64 (head + 16);
+    if (length > idx->length)
+      break;
+    if (_X_BE_32 (head + 24) != mlen)
+      break;
+    {
+      char *m = malloc (mlen + 1);
+      int ok;
+      if (!m)
+        break;
+      ok = (fread (m, 1, mlen, f) == mlen) && !memcmp (m, idx->mrl, mlen);
+      free (m);
+      if (!ok)
+        break;
+    }
+    if (fread (head + 36, 1, 4, f) != 4)
+      break;
+    n = _X_BE_32 (head + 36);
+    if (!n || !seek_index_grow (idx, n))
+      break;
+    buf = malloc (n * 16);
+    if (!buf)
+      break;
+    if (fread (buf, 16, n, f) == n) {
+      for (i = 0; i < n; i++) {
+        idx->e[i].pos = seek_index_get_64 (buf + 16 * i);
+        idx->e[i].pts = seek_index_get_64 (buf + 16 * i + 8);
+      }
+      idx->used = n;
+      idx->complete = (length == idx->length) && (_X_BE_32 (head + 8) & SEEK_INDEX_COMPLETE);
+    }
+    free (buf);
+  } while (0);
+  fclose (f);
+  if (idx->used)
+    xprintf (idx->xine, XINE_VERBOSITY_DEBUG, "seek_index: loaded %d %skeyframes from %s.\n",
+      idx->used, idx->complete ? "(all) " : "", idx->filename);
+}
+
+/* remove the least recently saved files, but not keep. */
+static void seek_index_prune (xine_t *xine, const char *keep) {
+  char name[1024 + 256], oldest[1024 + 256];
+  size_t l = seek_index_dir (xine, name, sizeof (name) - 256, 0);
+
+  if (!l)
+    return;
+  while (1) {
+    struct dirent *d;
+    struct stat st;
+    DIR *dir;
+    off_t bytes = 0;
+    time_t otime = 0;
+    int files = 0;
+
+    oldest[0] = 0;
+    dir = opendir (name);
+    if (!dir)
+      return;
+    while ((d = readdir (dir)) != NULL) {
+      size_t n = strlen (d->d_name);
+      if ((d->d_name[0] == '.') || (n >= sizeof (name) - l))
+        continue;
+      memcpy (name + l, d->d_name, n + 1);
+      if (stat (name, &st) || !S_ISREG (st.st_mode))
+        continue;
+      files++;
+      bytes += st.st_size;
+      if (strcmp (name, keep) && (!oldest[0] || (st.st_mtime < otime))) {
+        otime = st.st_mtime;
+        memcpy (oldest, name, l + n + 1);
+      }
+    }
+    closedir (dir);
+    name[l] = 0;
+    if (((files <= SEEK_INDEX_DIR_FILES) && (bytes <= SEEK_INDEX_DIR_BYTES)) || !oldest[0])
+      return;
+    if (unlink (oldest))
+      return;
+    xprintf (xine, XINE_VERBOSITY_DEBUG, "seek_index: dropped %s.\n", oldest);
+  }
+}
+
+static void seek_index_save (xine_seek_index_t *idx) {
+  char newname[sizeof (idx->filename) + 4];
+  size_t mlen = strlen (idx->mrl), l;
+  uint8_t *buf;
+  FILE *f;
+  int i, ok;
+
+  if (!seek_index_dir (idx->xine, newname, sizeof (newname), 1))
+    return;
+  l = strlen (idx->filename);
+  memcpy (newname, idx->filename, l);
+  memcpy (newname + l, ".new", 5);
+
+  buf = malloc (40 + mlen + idx->used * 16);
+  if (!buf)
+    return;
+  memcpy (buf, "XSIX", 4);
+  seek_index_put_32 (buf + 4, SEEK_INDEX_VERSION);
+  seek_index_put_32 (buf + 8, idx->complete ? SEEK_INDEX_COMPLETE : 0);
+  seek_index_put_32 (buf + 12, idx->head_crc);
+  seek_index_put_64 (buf + 16, idx->length);
+  seek_index_put_32 (buf + 24, mlen);
+  memcpy (buf + 28, idx->type, 8);
+  memcpy (buf + 36, idx->mrl, mlen);
+  seek_index_put_32 (buf + 36 + mlen, idx->used);
+  for (i = 0; i < idx->used; i++) {
+    seek_index_put_64 (buf + 40 + mlen + 16 * i, idx->e[i].pos);
+    seek_index_put_64 (buf + 40 + mlen + 16 * i + 8, idx->e[i].pts);
+  }
+  ok = 0;
+  f = fopen (newname, "wb");
+  if (f) {
+    ok = fwrite (buf, 1, 40 + mlen + idx->used * 16, f) == 40 + mlen + idx->used * 16;
+    if (fclose (f))
+      ok = 0;
+  }
+  free (buf);
+  if (ok && !rename (newname, idx->filename)) {
+    xprintf (idx->xine, XINE_VERBOSITY_DEBUG, "seek_index: saved %d keyframes to %s.\n",
+      idx->used, idx->filename);
+    seek_index_prune (idx->xine, idx->filename);
+  } else {
+    xprintf (idx->xine, XINE_VERBOSITY_DEBUG, "seek_index: cannot write %s.\n", newname);
+    unlink (newname);
+  }
+}
+
+xine_seek_index_t *_x_seek_index_open (xine_stream_t *stream, input_plugin_t *input, const char *type) {
+  xine_private_t *xine;
+  xine_seek_index_t *idx;
+  uint8_t head[SEEK_INDEX_HEAD];
+  uint32_t caps;
+  size_t l;
+  off_t length;
+  int n;
+
+  if (!stream || !input || !type)
+    return NULL;
+  xine = (xine_private_t *)stream->xine;
+  if (!xine->seek_index)
+    return NULL;
+  /* plain local files mainly. */
+  caps = input->get_capabilities (input);
+  if (!(caps & INPUT_CAP_SEEKABLE) || (caps & INPUT_CAP_LIVE))
+    return NULL;
+  length = input->get_length (input);
+  if (length <= 0)
+    return NULL;
+  if (!input->get_mrl (input))
+    return NULL;
+  n = _x_demux_read_header (input, head, sizeof (head));
+  if (n <= 0)
+    return NULL;
+
+  idx = calloc (1, sizeof (*idx));
+  if (!idx)
+    return NULL;
+  idx->mrl = _x_mrl_remove_auth (input->get_mrl (input));
+  if (!idx->mrl) {
+    free (idx);
+    return NULL;
+  }
+  l = seek_index_dir (&xine->x, idx->filename, sizeof (idx->filename), 0);
+  if (!l) {
+    free (idx->mrl);
+    free (idx);
+    return NULL;
+  }
+  snprintf (idx->filename + l, sizeof (idx->filename) - l, "%08x.%s",
+    (unsigned int)xine_crc32_ieee (0, (const uint8_t *)idx->mrl, strlen (idx->mrl)), type);
+  l = strlen (type);
+  memcpy (idx->type, type, l < sizeof (idx->type) ? l : sizeof (idx->type) - 1);
+  idx->xine     = &xine->x;
+  idx->length   = length;
+  idx->head_crc = xine_crc32_ieee (0, head, n);
+  idx->prebuild = xine->seek_index > 1;
+  pthread_mutex_init (&idx->lock, NULL);
+
+  seek_index_load (idx);
+  return idx;
+}
+
+void _x_seek_index_close (xine_seek_index_t **pidx) {
+  xine_seek_index_t *idx;
+
+  if (!pidx || !(idx = *pidx))
+    return;
+  *pidx = NULL;
+  if (idx->changed && (idx->used > 1))
+    seek_index_save (idx);
+  pthread_mutex_destroy (&idx->lock);
+  free (idx->e);
+  free (idx->time);
+  free (idx->mrl);
+  free (idx);
+}
+
+void _x_seek_index_add (xine_seek_index_t *idx, off_t pos, int64_t pts, off_t prev) {
+  int a, e, m;
+
+  if (!idx || (pos < 0))
+    return;
+  pts &= SEEK_INDEX_PTS;
+  pthread_mutex_lock (&idx->lock);
+  /* find first entry >= pos. */
+  a = 0;
+  e = idx->used;
+  if (e && (idx->e[e - 1].pos < pos)) {
+    /* the common "playing along" case */
+    a = e;
+  } else {
+    while (a < e) {
+      m = (a + e) >> 1;
+      if (idx->e[m].pos < pos)
+        a = m + 1;
+      else
+        e = m;
+    }
+  }
+  if ((a < idx->used) && (idx->e[a].pos == pos)) {
+    if ((prev >= 0) && ((a > 0) ? (idx->e[a - 1].pos == prev) : !prev) && !(idx->e[a].pts & SEEK_INDEX_LINKED)) {
+      idx->e[a].pts |= SEEK_INDEX_LINKED;
+      idx->changed = 1;
+    }
+  } else if (seek_index_grow (idx, idx->used + 1)) {
+    if (a < idx->used)
+      memmove (idx->e + a + 1, idx->e + a, (idx->used - a) * sizeof (idx->e[0]));
+    idx->used++;
+    idx->e[a].pos = pos;
+    idx->e[a].pts = pts | (((prev >= 0) && ((a > 0) ? (idx->e[a - 1].pos == prev) : !prev)) ? SEEK_INDEX_LINKED : 0);
+    idx->time_valid = 0;
+    idx->changed = 1;
+  }
+  pthread_mutex_unlock (&idx->lock);
+}
+
+int _x_seek_index_find (xine_seek_index_t *idx, off_t *pos, int *msecs) {
+  int a, e, m, ret;
+  int64_t t = 0;
+
+  if (!idx || !pos || !msecs)
+    return -1;
+  pthread_mutex_lock (&idx->lock);
+  if (idx->used < 2) {
+    pthread_mutex_unlock (&idx->lock);
+    return -1;
+  }
+  if (!idx->time_valid) {
+    idx->time[0] = 0;
+    for (a = 1; a < idx->used; a++) {
+      int64_t d = ((idx->e[a].pts & SEEK_INDEX_PTS) - (idx->e[a - 1].pts & SEEK_INDEX_PTS)) & SEEK_INDEX_PTS;
+      /* pts discontinuity: dont go back in time. */
+      if (d > (SEEK_INDEX_PTS >> 1))
+        d = 0;
+      idx->time[a] = idx->time[a - 1] + d;
+    }
+    idx->time_valid = 1;
+  }
+  /* find last entry <= target. */
+  a = 0;
+  e = idx->used;
+  if (*pos >= 0) {
+    if (idx->e[0].pos > *pos) {
+      pthread_mutex_unlock (&idx->lock);
+      return -1;
+    }
+    while (e - a > 1) {
+      m = (a + e) >> 1;
+      if (idx->e[m].pos <= *pos)
+        a = m;
+      else
+        e = m;
+    }
+  } else {
+    /* time is counted from the first keyframe of the file. */
+    if (!(idx->e[0].pts & SEEK_INDEX_LINKED)) {
+      pthread_mutex_unlock (&idx->lock);
+      return -1;
+    }
+    t = (int64_t)*msecs * 90;
+    while (e - a > 1) {
+      m = (a + e) >> 1;
+      if (idx->time[m] <= t)
+        a = m;
+      else
+        e = m;
+    }
+  }
+  if ((a + 1 < idx->used) ? (idx->e[a + 1].pts & SEEK_INDEX_LINKED) : idx->complete) {
+    /* no gap, this is the keyframe. */
+    *pos = idx->e[a].pos;
+    *msecs = idx->time[a] / 90;
+    ret = 1;
+  } else if ((*pos < 0) && (a + 1 < idx->used) && (t >= idx->time[a])) {
+    /* unknown land between 2 entries. guess. */
+    int64_t dt = idx->time[a + 1] - idx->time[a];
+    *pos = idx->e[a].pos;
+    if (dt > 0)
+      *pos += (double)(idx->e[a + 1].pos - idx->e[a].pos) * (t - idx->time[a]) / dt;
+    ret = 0;
+  } else {
+    ret = -1;
+  }
+  pthread_mutex_unlock (&idx->lock);
+  return ret;
+}
+
+int _x_seek_index_prebuild (xine_seek_index_t *idx) {
+  int ret;
+
+  if (!idx)
+    return 0;
+  pthread_mutex_lock (&idx->lock);
+  ret = idx->prebuild && !idx->complete;
+  pthread_mutex_unlock (&idx->lock);
+  return ret;
+}
+
+void _x_seek_index_set_complete (xine_seek_index_t *idx) {
+  if (!idx)
+    return;
+  pthread_mutex_lock (&idx->lock);
+  if (!idx->complete) {
+    idx->complete = 1;
+    idx->changed = 1;
+  }
+  pthread_mutex_unlock (&idx->lock);
+}
@@ -1022,3 +1022,675 @@ input_plugin_t *_x_rip_plugin_get_instance (xine_stream_t *stream, const char *f
   return &this->input_plugin;
 }
 
+
+/*
+ * Timeshift Input Plugin
+ *
+ * It keeps the last part of a live stream in a memory mapped ring file.
+ * A separate thread feeds it from the main input, so pausing playback
+ * neither stalls the source nor loses data. Seeking inside the ring is
+ * free. Time seeks use a side index of TS PCR values, or of receive
+ * time for other formats.
+ *
+ * Usage:
+ *
+ * - activation:
+ *     xine stream_mrl#timeshift
+ *     xine stream_mrl#timeshift:size_in_MiB
+ *
+ * - or for all live inputs, set media.timeshift.live_inputs.
+ */
+
+#if defined(HAVE_SYS_MMAN_H) && !defined(WIN32)
+#  define HAVE_TIMESHIFT
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <stdlib.h>
+#  include <pthread.h>
+#endif
+
+#ifdef HAVE_TIMESHIFT
+
+#define TSHIFT_CHUNK      (64 << 10)
+#define TSHIFT_INDEX_MAX  32768 /* must be power of 2 */
+#define TSHIFT_INDEX_STEP 500   /* ms */
+#define TSHIFT_MAX_DIFF   (5 * 90000)
+
+typedef struct {
+  off_t             pos;
+  int32_t           time;              /* ms since join */
+} tshift_index_t;
+
+typedef struct {
+  input_plugin_t    input_plugin;      /* inherited structure */
+
+  input_plugin_t   *main_input_plugin; /* original input plugin */
+  xine_stream_t    *stream;
+
+  uint8_t          *ring;              /* mmap () of fd */
+  size_t            ring_size;
+  int               fd;
+
+  pthread_t         thread;
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;              /* wakes reader on new data */
+  int               running;
+
+  /* protected by mutex */
+  int               quit;
+  int               eof;               /* main input has ended */
+  off_t             startpos;          /* main input position at join */
+  off_t             wpos;              /* live edge */
+  off_t             wlimit;            /* data below (wlimit - ring_size) is gone */
+  tshift_index_t   *index;
+  uint32_t          index_get, index_put;
+
+  /* reader private */
+  off_t             curpos;
+
+  /* writer private */
+  off_t             scan_pos;
+  int               ts_mode;           /* -1 unknown, 0 no, 1 yes */
+  int               pcr_pid;
+  uint64_t          last_pcr;
+  int64_t           pcr_time;          /* 90kHz, unwrapped */
+  int32_t           last_index_time;
+  struct timeval    clock_start;
+} tshift_input_plugin_t;
+
+static off_t tshift_oldest (tshift_input_plugin_t *this) {
+  off_t p = this->wlimit - (off_t)this->ring_size;
+  return p < this->startpos ? this->startpos : p;
+}
+
+static void tshift_copy_out (tshift_input_plugin_t *this, uint8_t *buf, off_t pos, size_t len) {
+  size_t offs = pos % this->ring_size, n = this->ring_size - offs;
+  if (n > len)
+    n = len;
+  memcpy (buf, this->ring + offs, n);
+  if (len > n)
+    memcpy (buf + n, this->ring, len - n);
+}
+
+/* mutex must be held. */
+static void tshift_index_add (tshift_input_plugin_t *this, off_t pos, int32_t time) {
+  if ((this->index_put != this->index_get) && (time - this->last_index_time < TSHIFT_INDEX_STEP))
+    return;
+  if (this->index_put - this->index_get >= TSHIFT_INDEX_MAX)
+    this->index_get++;
+  this->index[this->index_put & (TSHIFT_INDEX_MAX - 1)].pos = pos;
+  this->index[this->index_put & (TSHIFT_INDEX_MAX - 1)].time = time;
+  this->index_put++;
+  this->last_index_time = time;
+}
+
+/* mutex must be held. find last entry at or before time, or the first one. */
+static const tshift_index_t *tshift_index_find_time (tshift_input_plugin_t *this, int32_t time) {
+  uint32_t b = this->index_get, e = this->index_put;
+  if (b == e)
+    return NULL;
+  while (e - b > 1) {
+    uint32_t m = b + ((e - b) >> 1);
+    if (this->index[m & (TSHIFT_INDEX_MAX - 1)].time <= time)
+      b = m;
+    else
+      e = m;
+  }
+  return &this->index[b & (TSHIFT_INDEX_MAX - 1)];
+}
+
+/* mutex must be held. interpolated time of pos, or -1. */
+static int32_t tshift_index_get_time (tshift_input_plugin_t *this, off_t pos) {
+  const tshift_index_t *e1, *e2;
+  uint32_t b = this->index_get, e = this->index_put;
+  if (b == e)
+    return -1;
+  while (e - b > 1) {
+    uint32_t m = b + ((e - b) >> 1);
+    if (this->index[m & (TSHIFT_INDEX_MAX - 1)].pos <= pos)
+      b = m;
+    else
+      e = m;
+  }
+  e1 = &this->index[b & (TSHIFT_INDEX_MAX - 1)];
+  if ((pos <= e1->pos) || (b + 1 == this->index_put))
+    return e1->time;
+  e2 = &this->index[(b + 1) & (TSHIFT_INDEX_MAX - 1)];
+  if (e2->pos <= e1->pos)
+    return e1->time;
+  return e1->time + (int32_t)((pos - e1->pos) * (e2->time - e1->time) / (e2->pos - e1->pos));
+}
+
+static int32_t tshift_clock_time (tshift_input_plugin_t *this) {
+  struct timeval tv;
+  xine_monotonic_clock (&tv, NULL);
+  return (tv.tv_sec - this->clock_start.tv_sec) * 1000 + (tv.tv_usec - this->clock_start.tv_usec) / 1000;
+}
+
+/* mutex must be held. look for PCR in new data up to end. */
+static void tshift_scan (tshift_input_plugin_t *this, off_t end) {
+  uint8_t p[12];
+
+  if (this->ts_mode < 0) {
+    int i;
+    if (end - this->scan_pos < 3 * 188)
+      return;
+    this->ts_mode = 0;
+    for (i = 0; i < 188; i++) {
+      uint8_t b[3];
+      tshift_copy_out (this, b, this->scan_pos + i, 1);
+      tshift_copy_out (this, b + 1, this->scan_pos + i + 188, 1);
+      tshift_copy_out (this, b + 2, this->scan_pos + i + 376, 1);
+      if ((b[0] == 0x47) && (b[1] == 0x47) && (b[2] == 0x47)) {
+        this->scan_pos += i;
+        this->ts_mode = 1;
+        break;
+      }
+    }
+    xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+      "input_timeshift: indexing by %s.\n", this->ts_mode ? "PCR" : "receive time");
+  }
+  if (!this->ts_mode) {
+    tshift_index_add (this, this->scan_pos, tshift_clock_time (this));
+    this->scan_pos = end;
+    return;
+  }
+
+  if (this->scan_pos < tshift_oldest (this))
+    this->scan_pos = tshift_oldest (this);
+  while (end - this->scan_pos >= 188) {
+    int pid;
+    tshift_copy_out (this, p, this->scan_pos, sizeof (p));
+    if (p[0] != 0x47) {
+      /* lost sync */
+      this->scan_pos++;
+      continue;
+    }
+    pid = ((p[1] & 0x1f) << 8) | p[2];
+    if ((p[3] & 0x20) && (p[4] >= 7) && (p[5] & 0x10) && ((this->pcr_pid < 0) || (pid == this->pcr_pid))) {
+      uint64_t pcr = ((uint64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1) | (p[10] >> 7);
+      if (this->pcr_pid < 0) {
+        this->pcr_pid = pid;
+      } else {
+        uint64_t d = (pcr - this->last_pcr) & (((uint64_t)1 << 33) - 1);
+        /* skip discontinuities */
+        if (d < TSHIFT_MAX_DIFF)
+          this->pcr_time += d;
+      }
+      this->last_pcr = pcr;
+      tshift_index_add (this, this->scan_pos, this->pcr_time / 90);
+    }
+    this->scan_pos += 188;
+  }
+}
+
+static void *tshift_loop (void *data) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)data;
+
+  while (1) {
+    off_t pos;
+    size_t offs, n;
+    off_t r;
+
+    pthread_mutex_lock (&this->mutex);
+    if (this->quit) {
+      pthread_mutex_unlock (&this->mutex);
+      break;
+    }
+    pos = this->wpos;
+    offs = pos % this->ring_size;
+    n = this->ring_size - offs;
+    if (n > TSHIFT_CHUNK)
+      n = TSHIFT_CHUNK;
+    this->wlimit = pos + n;
+    pthread_mutex_unlock (&this->mutex);
+
+    r = this->main_input_plugin->read (this->main_input_plugin, this->ring + offs, n);
+
+    pthread_mutex_lock (&this->mutex);
+    if (r <= 0) {
+      this->wlimit = this->wpos;
+      this->eof = 1;
+      pthread_cond_broadcast (&this->cond);
+      pthread_mutex_unlock (&this->mutex);
+      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+        "input_timeshift: end of main input at %" PRId64 ".\n", (int64_t)pos);
+      break;
+    }
+    this->wpos = pos + r;
+    this->wlimit = this->wpos;
+    while ((this->index_get != this->index_put)
+      && (this->index[this->index_get & (TSHIFT_INDEX_MAX - 1)].pos < tshift_oldest (this)))
+      this->index_get++;
+    tshift_scan (this, this->wpos);
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+  }
+  return NULL;
+}
+
+/* get data at pos, wait for it if needed. returns bytes copied, or -1 if pos is gone. */
+static off_t tshift_get (tshift_input_plugin_t *this, uint8_t *buf, off_t pos, off_t len) {
+  off_t have, oldest;
+
+  pthread_mutex_lock (&this->mutex);
+  while ((pos + len > this->wpos) && !this->eof && !this->quit) {
+    struct timespec ts;
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    ts.tv_sec = tv.tv_sec + 5;
+    ts.tv_nsec = tv.tv_usec * 1000;
+    if (pthread_cond_timedwait (&this->cond, &this->mutex, &ts) == ETIMEDOUT)
+      break;
+  }
+  have = this->wpos - pos;
+  oldest = tshift_oldest (this);
+  pthread_mutex_unlock (&this->mutex);
+
+  if (pos < oldest)
+    return -1;
+  if (have <= 0)
+    return 0;
+  if (have > len)
+    have = len;
+  tshift_copy_out (this, buf, pos, have);
+
+  /* writer may have been faster. */
+  pthread_mutex_lock (&this->mutex);
+  oldest = tshift_oldest (this);
+  pthread_mutex_unlock (&this->mutex);
+  return pos < oldest ? -1 : have;
+}
+
+static off_t tshift_plugin_read (input_plugin_t *this_gen, void *buf_gen, off_t len) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  uint8_t *buf = (uint8_t *)buf_gen;
+  off_t done = 0;
+
+  if (!buf || (len < 0))
+    return -1;
+
+  while (done < len) {
+    off_t n = tshift_get (this, buf + done, this->curpos, len - done);
+    if (n < 0) {
+      off_t oldest;
+      pthread_mutex_lock (&this->mutex);
+      oldest = tshift_oldest (this);
+      pthread_mutex_unlock (&this->mutex);
+      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+        "input_timeshift: fell out of buffer, skipping %" PRId64 " bytes.\n", (int64_t)(oldest - this->curpos));
+      this->curpos = oldest;
+      continue;
+    }
+    if (n == 0)
+      break;
+    this->curpos += n;
+    done += n;
+  }
+  return done;
+}
+
+static buf_element_t *tshift_plugin_read_block (input_plugin_t *this_gen, fifo_buffer_t *fifo, off_t todo) {
+  buf_element_t *buf;
+  off_t r;
+
+  if (!fifo || (todo <= 0))
+    return NULL;
+  buf = fifo->buffer_pool_alloc (fifo);
+  buf->content = buf->mem;
+  buf->type = BUF_DEMUX_BLOCK;
+  if (todo > buf->max_size)
+    todo = buf->max_size;
+  r = tshift_plugin_read (this_gen, buf->content, todo);
+  if (r <= 0) {
+    buf->free_buffer (buf);
+    return NULL;
+  }
+  buf->size = r;
+  return buf;
+}
+
+static off_t tshift_plugin_seek (input_plugin_t *this_gen, off_t offset, int origin) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  off_t oldest, newpos;
+
+  pthread_mutex_lock (&this->mutex);
+  switch (origin) {
+    case SEEK_SET: newpos = offset; break;
+    case SEEK_CUR: newpos = this->curpos + offset; break;
+    case SEEK_END: newpos = this->wpos + offset; break;
+    default: newpos = this->curpos;
+  }
+  oldest = tshift_oldest (this);
+  if (newpos < oldest)
+    newpos = oldest;
+  else if (newpos > this->wpos)
+    newpos = this->wpos;
+  pthread_mutex_unlock (&this->mutex);
+
+  this->curpos = newpos;
+  return newpos;
+}
+
+static off_t tshift_plugin_seek_time (input_plugin_t *this_gen, int time_offset, int origin) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  const tshift_index_t *e;
+  int32_t t;
+
+  pthread_mutex_lock (&this->mutex);
+  switch (origin) {
+    case SEEK_SET:
+      t = time_offset;
+      break;
+    case SEEK_CUR:
+      t = tshift_index_get_time (this, this->curpos);
+      t = t < 0 ? time_offset : t + time_offset;
+      break;
+    case SEEK_END:
+      /* relative to live edge */
+      t = this->last_index_time + time_offset;
+      break;
+    default:
+      t = -1;
+  }
+  e = (t >= 0) ? tshift_index_find_time (this, t) : NULL;
+  if (e) {
+    off_t oldest = tshift_oldest (this);
+    /* before first index entry means start of buffer. */
+    if ((e == &this->index[this->index_get & (TSHIFT_INDEX_MAX - 1)]) && (t < e->time + TSHIFT_INDEX_STEP))
+      this->curpos = oldest;
+    else
+      this->curpos = e->pos < oldest ? oldest : e->pos;
+  }
+  pthread_mutex_unlock (&this->mutex);
+
+  return this->curpos;
+}
+
+static uint32_t tshift_plugin_get_capabilities (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  uint32_t caps = this->main_input_plugin->get_capabilities (this->main_input_plugin);
+
+  /* we are no longer tied to real time, nor to block reading. */
+  caps &= ~(INPUT_CAP_LIVE | INPUT_CAP_BLOCK | INPUT_CAP_SLOW_SEEKABLE);
+  return caps | INPUT_CAP_SEEKABLE | INPUT_CAP_TIME_SEEKABLE | INPUT_CAP_PREVIEW | INPUT_CAP_SIZED_PREVIEW;
+}
+
+static off_t tshift_plugin_get_current_pos (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+
+  return this->curpos;
+}
+
+static int tshift_plugin_get_current_time (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  int32_t t;
+
+  pthread_mutex_lock (&this->mutex);
+  t = tshift_index_get_time (this, this->curpos);
+  pthread_mutex_unlock (&this->mutex);
+  return t;
+}
+
+static off_t tshift_plugin_get_length (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  off_t l;
+
+  pthread_mutex_lock (&this->mutex);
+  l = this->wpos;
+  pthread_mutex_unlock (&this->mutex);
+  return l;
+}
+
+static uint32_t tshift_plugin_get_blocksize (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 0;
+}
+
+static const char *tshift_plugin_get_mrl (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+
+  return this->main_input_plugin->get_mrl (this->main_input_plugin);
+}
+
+static int tshift_plugin_get_optional_data (input_plugin_t *this_gen, void *data, int data_type) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+  int r;
+
+  switch (data_type) {
+    case INPUT_OPTIONAL_DATA_PREVIEW:
+      if (!data)
+        return INPUT_OPTIONAL_UNSUPPORTED;
+      r = tshift_get (this, data, this->startpos, MAX_PREVIEW_SIZE);
+      return r > 0 ? r : 0;
+
+    case INPUT_OPTIONAL_DATA_SIZED_PREVIEW:
+      if (!data)
+        return INPUT_OPTIONAL_UNSUPPORTED;
+      memcpy (&r, data, sizeof (r));
+      if (r <= 0)
+        return INPUT_OPTIONAL_UNSUPPORTED;
+      r = tshift_get (this, data, this->startpos, r);
+      return r > 0 ? r : 0;
+
+    case INPUT_OPTIONAL_DATA_DURATION:
+      if (!data)
+        return INPUT_OPTIONAL_UNSUPPORTED;
+      pthread_mutex_lock (&this->mutex);
+      r = (this->index_get != this->index_put) ? this->last_index_time : -1;
+      pthread_mutex_unlock (&this->mutex);
+      if (r < 0)
+        return INPUT_OPTIONAL_UNSUPPORTED;
+      memcpy (data, &r, sizeof (r));
+      return INPUT_OPTIONAL_SUCCESS;
+
+    /* these would mess up the writer thread. */
+    case INPUT_OPTIONAL_DATA_CLONE:
+    case INPUT_OPTIONAL_DATA_NEW_MRL:
+    case INPUT_OPTIONAL_DATA_NEW_PREVIEW:
+    case INPUT_OPTIONAL_DATA_REWIND:
+    case INPUT_OPTIONAL_DATA_LOSS:
+      return INPUT_OPTIONAL_UNSUPPORTED;
+
+    default: ;
+  }
+  return this->main_input_plugin->get_optional_data (this->main_input_plugin, data, data_type);
+}
+
+static int tshift_plugin_open (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+
+  xine_log (this->stream->xine, XINE_LOG_MSG,
+    _("input_timeshift: open() function should never be called\n"));
+  return 0;
+}
+
+static void tshift_plugin_dispose (input_plugin_t *this_gen) {
+  tshift_input_plugin_t *this = (tshift_input_plugin_t *)this_gen;
+
+  if (this->running) {
+    pthread_mutex_lock (&this->mutex);
+    this->quit = 1;
+    pthread_cond_broadcast (&this->cond);
+    pthread_mutex_unlock (&this->mutex);
+    /* a live main input may wait for data that never comes.
+     * make its _x_io_* waits return now. */
+    _x_action_raise (this->stream);
+    pthread_join (this->thread, NULL);
+    _x_action_lower (this->stream);
+  }
+  pthread_cond_destroy (&this->cond);
+  pthread_mutex_destroy (&this->mutex);
+  if (this->ring)
+    munmap (this->ring, this->ring_size);
+  if (this->fd >= 0)
+    close (this->fd);
+  _x_freep (&this->index);
+  _x_free_input_plugin (this->stream, this->main_input_plugin);
+  free (this);
+}
+
+static int tshift_open_ring (xine_stream_t *stream, size_t size) {
+  config_values_t *config = stream->xine->config;
+  const char *dir;
+  char name[MAX_TARGET_LEN + 32];
+  int fd;
+
+  dir = config->register_filename (config, "media.timeshift.dir", "", XINE_CONFIG_STRING_IS_DIRECTORY_NAME,
+    _("directory for timeshift buffers"),
+    _("Timeshift keeps the recent part of live streams in a temporary file here. "
+      "It should be on a local disk with enough free space. "
+      "Leave empty to use TMPDIR, or /tmp."),
+    20, NULL, NULL);
+  if (!dir || !dir[0])
+    dir = getenv ("TMPDIR");
+  if (!dir || !dir[0])
+    dir = "/tmp";
+  if (strlen (dir) > MAX_TARGET_LEN)
+    return -1;
+  sprintf (name, "%s/xine-timeshift-XXXXXX", dir);
+
+  fd = mkstemp (name);
+  if (fd < 0) {
+    int e = errno;
+    xine_log (stream->xine, XINE_LOG_MSG,
+      _("input_timeshift: error opening file %s: %s\n"), name, strerror (e));
+    return -1;
+  }
+  /* nobody else needs to see this. */
+  unlink (name);
+  if (ftruncate (fd, size) < 0) {
+    int e = errno;
+    xine_log (stream->xine, XINE_LOG_MSG,
+      _("input_timeshift: error resizing file %s: %s\n"), name, strerror (e));
+    close (fd);
+    return -1;
+  }
+  return fd;
+}
+
+#endif /* HAVE_TIMESHIFT */
+
+/*
+ * create timeshift instance,
+ * optional ring size in MiB in 'size'
+ */
+input_plugin_t *_x_timeshift_plugin_get_instance (xine_stream_t *stream, const char *size) {
+#ifdef HAVE_TIMESHIFT
+  tshift_input_plugin_t *this;
+  input_plugin_t *main_plugin = stream->input_plugin;
+  config_values_t *config = stream->xine->config;
+  int mb, err;
+
+  if (!main_plugin) {
+    xine_log (stream->xine, XINE_LOG_MSG, _("input_timeshift: input plugin not defined!\n"));
+    return NULL;
+  }
+
+  mb = config->register_range (config, "media.timeshift.size", 512,
+    16, sizeof (void *) > 4 ? 65536 : 1024,
+    _("timeshift buffer size in MiB"),
+    _("How much of a live stream to keep for pausing and seeking back. "
+      "At 8 Mbit/s, 1024 MiB last about 17 minutes."),
+    20, NULL, NULL);
+  if (size && size[0]) {
+    int n = atoi (size);
+    if ((n >= 16) && (sizeof (void *) > 4 || n <= 1024))
+      mb = n;
+  }
+
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
+  this->index = malloc (TSHIFT_INDEX_MAX * sizeof (*this->index));
+  if (!this->index) {
+    free (this);
+    return NULL;
+  }
+
+  this->main_input_plugin = main_plugin;
+  this->stream            = stream;
+  this->ring_size         = (size_t)mb << 20;
+  this->ts_mode           = -1;
+  this->pcr_pid           = -1;
+#ifndef HAVE_ZERO_SAFE_MEM
+  this->ring              = NULL;
+  this->running           = 0;
+  this->quit              = 0;
+  this->eof               = 0;
+  this->index_get         = 0;
+  this->index_put         = 0;
+  this->pcr_time          = 0;
+  this->last_index_time   = 0;
+#endif
+  pthread_mutex_init (&this->mutex, NULL);
+  pthread_cond_init (&this->cond, NULL);
+  xine_monotonic_clock (&this->clock_start, NULL);
+
+  this->fd = tshift_open_ring (stream, this->ring_size);
+  if (this->fd >= 0) {
+    void *m = mmap (NULL, this->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (m != MAP_FAILED) {
+      this->ring = m;
+    } else {
+      int e = errno;
+      xine_log (stream->xine, XINE_LOG_MSG, _("input_timeshift: mmap failed: %s\n"), strerror (e));
+    }
+  }
+  if (!this->ring) {
+    this->main_input_plugin = NULL;
+    tshift_plugin_dispose (&this->input_plugin);
+    return NULL;
+  }
+
+  /* non seekable inputs may have consumed their preview already. */
+  this->wpos = main_plugin->get_current_pos (main_plugin);
+  if (this->wpos < 0)
+    this->wpos = 0;
+  this->startpos = this->wpos;
+  if ((this->wpos > 0) && (this->wpos <= MAX_PREVIEW_SIZE)
+    && (main_plugin->get_capabilities (main_plugin) & INPUT_CAP_PREVIEW)) {
+    uint8_t preview[MAX_PREVIEW_SIZE];
+    int n = main_plugin->get_optional_data (main_plugin, preview, INPUT_OPTIONAL_DATA_PREVIEW);
+    if (n == this->wpos) {
+      memcpy (this->ring, preview, n);
+      this->startpos = 0;
+    }
+  }
+  this->wlimit   = this->wpos;
+  this->curpos   = this->startpos;
+  this->scan_pos = this->startpos;
+
+  this->input_plugin.open                = tshift_plugin_open;
+  this->input_plugin.get_capabilities    = tshift_plugin_get_capabilities;
+  this->input_plugin.read                = tshift_plugin_read;
+  this->input_plugin.read_block          = tshift_plugin_read_block;
+  this->input_plugin.seek                = tshift_plugin_seek;
+  this->input_plugin.seek_time           = tshift_plugin_seek_time;
+  this->input_plugin.get_current_pos     = tshift_plugin_get_current_pos;
+  this->input_plugin.get_current_time    = tshift_plugin_get_current_time;
+  this->input_plugin.get_length          = tshift_plugin_get_length;
+  this->input_plugin.get_blocksize       = tshift_plugin_get_blocksize;
+  this->input_plugin.get_mrl             = tshift_plugin_get_mrl;
+  this->input_plugin.get_optional_data   = tshift_plugin_get_optional_data;
+  this->input_plugin.dispose             = tshift_plugin_dispose;
+  this->input_plugin.input_class         = main_plugin->input_class;
+
+  if ((err = pthread_create (&this->thread, NULL, tshift_loop, this)) != 0) {
+    xine_log (stream->xine, XINE_LOG_MSG,
+      _("input_timeshift: can't create new thread (%s)\n"), strerror (err));
+    this->main_input_plugin = NULL;
+    tshift_plugin_dispose (&this->input_plugin);
+    return NULL;
+  }
+  this->running = 1;
+
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+    "input_timeshift: keeping up to %d MiB of %s.\n", mb, main_plugin->get_mrl (main_plugin));
+  return &this->input_plugin;
+#else
+  (void)size;
+  xine_log (stream->xine, XINE_LOG_MSG, _("input_timeshift: not supported on this system.\n"));
+  return NULL;
+#endif
+}
@@ -54,30 +54,46 @@
 
 /* #define ENABLE_IPV6 */
 
-#ifndef ENABLE_IPV6
-static void reportIP (xine_stream_t *stream, const char *text, const uint8_t *p, int port) {
-  if (stream && (stream->xine->verbosity >= XINE_VERBOSITY_DEBUG)) {
-    char b[128], *q = b;
-    xine_uint32_2str (&q, p[0]);
-    *q++ = '.';
-    xine_uint32_2str (&q, p[1]);
-    *q++ = '.';
-    xine_uint32_2str (&q, p[2]);
-    *q++ = '.';
-    xine_uint32_2str (&q, p[3]);
-    *q++ = ':';
-    xine_uint32_2str (&q, port);
-    *q = 0;
-    xprintf (stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: %s %s.\n", text, b);
-  }
-}
-#else
-static void reportIP (xine_stream_t *stream, const char *text, struct addrinfo *addr) {
+/* RFC 8305 "happy eyeballs": start the next connection attempt after this
+ * time, without giving up the previous ones. */
+#define XIO_CONNECT_DELAY     250    /* msec */
+#define XIO_MAX_ADDRS         16
+/* name query cache. getaddrinfo () does not tell the real time to live,
+ * so we use a short fixed one. */
+#define XIO_DNS_CACHE_SIZE    16
+#define XIO_DNS_TTL           60     /* sec */
+
+typedef union {
+  struct sockaddr     sa;
+  struct sockaddr_in  sin;
+#ifdef ENABLE_IPV6
+  struct sockaddr_in6 sin6;
+#endif
+} xio_sockaddr_t;
+
+typedef struct {
+  xio_sockaddr_t      a;
+  socklen_t           len;
+} xio_addr_t;
+
+typedef struct {
+  char                host[256];
+  time_t              expires;
+  int                 num;
+  xio_addr_t          addrs[XIO_MAX_ADDRS];
+} xio_dns_entry_t;
+
+/* shared by all streams, and all xine instances. */
+static struct {
+  pthread_mutex_t     mutex;
+  xio_dns_entry_t     entries[XIO_DNS_CACHE_SIZE];
+} xio_dns_cache = { PTHREAD_MUTEX_INITIALIZER };
+
+static void reportIP (xine_stream_t *stream, const char *text, const xio_addr_t *addr) {
   if (stream && (stream->xine->verbosity >= XINE_VERBOSITY_DEBUG)) {
     char b[128], *q = b;
-    if (addr->ai_family == AF_INET) {
-      struct sockaddr_in *sa4 = (struct sockaddr_in *)addr->ai_addr;
-      uint8_t *p = (uint8_t *) &sa4->sin_addr;
+    if (addr->a.sa.sa_family == AF_INET) {
+      const uint8_t *p = (const uint8_t *)&addr->a.sin.sin_addr;
       xine_uint32_2str (&q, p[0]);
       *q++ = '.';
       xine_uint32_2str (&q, p[1]);
@@ -86,11 +102,12 @@ static void reportIP (xine_stream_t *stream, const char *text, struct addrinfo *
       *q++ = '.';
       xine_uint32_2str (&q, p[3]);
       *q++ = ':';
-      xine_uint32_2str (&q, ntohs (sa4->sin_port));
-    } else if (addr->ai_family == AF_INET6) {
+      xine_uint32_2str (&q, ntohs (addr->a.sin.sin_port));
+    }
+#ifdef ENABLE_IPV6
+    else if (addr->a.sa.sa_family == AF_INET6) {
       static const uint8_t tab_hex[16] = "0123456789abcdef";
-      struct sockaddr_in6 *sa6 = (struct sockaddr_in6 *)addr->ai_addr;
-      uint8_t *p = (uint8_t *) &sa6->sin6_addr;
+      const uint8_t *p = (const uint8_t *)&addr->a.sin6.sin6_addr;
       int i;
       *q++ = '[';
       for (i = 0; i < 16; i += 2) {
@@ -108,13 +125,19 @@ static void reportIP (xine_stream_t *stream, const char *text, struct addrinfo *
       if (q[-2] != ':') q--;
       *q++ = ']';
       *q++ = ':';
-      xine_uint32_2str (&q, ntohs (sa6->sin6_port));
+      xine_uint32_2str (&q, ntohs (addr->a.sin6.sin6_port));
     }
+#endif
     *q = 0;
     xprintf (stream->xine, XINE_VERBOSITY_DEBUG, "io_helper: %s %s.\n", text, b);
   }
 }
-#endif
+
+static uint32_t xio_msec (void) {
+  struct timeval tv;
+  xine_monotonic_clock (&tv, NULL);
+  return (uint32_t)tv.tv_sec * 1000u + tv.tv_usec / 1000;
+}
 
 /* win32 specific error messages */
 #ifdef WIN32
@@ -160,216 +183,340 @@ int _x_io_tcp_connect (xine_stream_t *stream, const char *host, int port) {
   return _x_io_tcp_handshake_connect (stream, host, port, NULL, NULL);
 }
 
-int _x_io_tcp_handshake_connect (xine_stream_t *stream, const char *host, int port,
-  xio_handshake_cb_t *handshake_cb, void *userdata) {
-#ifndef ENABLE_IPV6
-  struct hostent *h;
-  int i;
-#else
-  struct addrinfo hints, *res = NULL, *tmpaddr;
-  int ip_version;
-#endif
-  xine_private_t *xine = stream ? (xine_private_t *)stream->xine : NULL;
-  int same_retries;
+/* get the addresses of host, from cache if possible. returns count, or -1. */
+static int xio_resolve (xine_stream_t *stream, const char *host, xio_addr_t *addrs) {
+  xine_t *xine = stream ? stream->xine : NULL;
+  struct timeval tv;
+  size_t hlen = strlen (host);
+  int i, n = 0;
+
+  xine_monotonic_clock (&tv, NULL);
+
+  if (hlen < sizeof (xio_dns_cache.entries[0].host)) {
+    pthread_mutex_lock (&xio_dns_cache.mutex);
+    for (i = 0; i < XIO_DNS_CACHE_SIZE; i++) {
+      xio_dns_entry_t *e = &xio_dns_cache.entries[i];
+      if ((e->expires > tv.tv_sec) && !strcasecmp (e->host, host)) {
+        n = e->num;
+        memcpy (addrs, e->addrs, n * sizeof (*addrs));
+        break;
+      }
+    }
+    pthread_mutex_unlock (&xio_dns_cache.mutex);
+    if (n > 0) {
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: using cached address(es) of %s.\n", host);
+      return n;
+    }
+  }
 
-  /* resolve host ip(s) */
-  xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: resolving %s:%d...\n", host, port);
 #ifndef ENABLE_IPV6
-  h = gethostbyname (host);
-  if (h == NULL) {
-    int e = sock_errno;
-    xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: gethostbyname: %s (%d).\n", sock_strerror (e), e);
-    _x_message (stream, XINE_MSG_UNKNOWN_HOST, "unable to resolve", host, sock_strerror (e), NULL);
-    return -1;
+  {
+    struct hostent *h = gethostbyname (host);
+    if (h == NULL) {
+      int e = sock_errno;
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: gethostbyname: %s (%d).\n", sock_strerror (e), e);
+      _x_message (stream, XINE_MSG_UNKNOWN_HOST, "unable to resolve", host, sock_strerror (e), NULL);
+      return -1;
+    }
+    for (i = 0; h->h_addr_list[i] && (n < XIO_MAX_ADDRS); i++) {
+      memset (&addrs[n], 0, sizeof (addrs[n]));
+      addrs[n].a.sin.sin_family = AF_INET;
+      memcpy (&addrs[n].a.sin.sin_addr, h->h_addr_list[i], 4);
+      addrs[n].len = sizeof (addrs[n].a.sin);
+      n++;
+    }
   }
-  /* report found ip's */
-  for (i = 0; h->h_addr_list[i]; i++)
-    reportIP (stream, "found IP", h->h_addr_list[i], port);
 #else
-  memset (&hints, 0, sizeof (hints));
-  hints.ai_socktype = SOCK_STREAM;
-  hints.ai_family = PF_UNSPEC;
   {
-    char strport[32], *q = strport;
+    struct addrinfo hints, *res = NULL, *tmpaddr;
     int r;
-    xine_uint32_2str (&q, port);
-    r = getaddrinfo (host, strport, &hints, &res);
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_family = PF_UNSPEC;
+    r = getaddrinfo (host, NULL, &hints, &res);
     if (r != 0) {
-      xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: getaddrinfo: %s (%d).\n", gai_strerror (r), r);
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: getaddrinfo: %s (%d).\n", gai_strerror (r), r);
       _x_message (stream, XINE_MSG_UNKNOWN_HOST, "unable to resolve", host, gai_strerror (r), NULL);
       return -1;
     }
-    /* report ip's */
-    for (tmpaddr = res; tmpaddr; tmpaddr = tmpaddr->ai_next)
-      reportIP (stream, "found IP", tmpaddr);
+    for (tmpaddr = res; tmpaddr && (n < XIO_MAX_ADDRS); tmpaddr = tmpaddr->ai_next) {
+      if (((tmpaddr->ai_family != AF_INET) && (tmpaddr->ai_family != AF_INET6))
+        || (tmpaddr->ai_addrlen > sizeof (addrs[n].a)))
+        continue;
+      memset (&addrs[n], 0, sizeof (addrs[n]));
+      memcpy (&addrs[n].a, tmpaddr->ai_addr, tmpaddr->ai_addrlen);
+      addrs[n].len = tmpaddr->ai_addrlen;
+      n++;
+    }
+    freeaddrinfo (res);
   }
-  if (xine) {
-    static const uint8_t modes[4] = {0, 4, (6 << 4) | 4, (4 << 4) | 6};
-    ip_version = modes[xine->ip_pref & 3];
-  } else {
-    ip_version = 4;
+#endif
+
+  if ((n > 0) && (hlen < sizeof (xio_dns_cache.entries[0].host))) {
+    xio_dns_entry_t *e = &xio_dns_cache.entries[0];
+    pthread_mutex_lock (&xio_dns_cache.mutex);
+    /* replace the oldest one. */
+    for (i = 1; i < XIO_DNS_CACHE_SIZE; i++) {
+      if (xio_dns_cache.entries[i].expires < e->expires)
+        e = &xio_dns_cache.entries[i];
+    }
+    memcpy (e->host, host, hlen + 1);
+    e->num = n;
+    memcpy (e->addrs, addrs, n * sizeof (*addrs));
+    e->expires = tv.tv_sec + XIO_DNS_TTL;
+    pthread_mutex_unlock (&xio_dns_cache.mutex);
   }
+  return n;
+}
+
+/* put addresses into connection order, and set port. returns new count. */
+static int xio_sort_addrs (xine_private_t *xine, xio_addr_t *addrs, int n, int port) {
+  xio_addr_t list[2][XIO_MAX_ADDRS];
+  int num[2] = {0, 0}, first = 0, only = -1, i, j;
+
+  if (n <= 0)
+    return 0;
+  for (i = 0; i < n; i++) {
+    int f = addrs[i].a.sa.sa_family == AF_INET ? 0 : 1;
+    if (f == 0)
+      addrs[i].a.sin.sin_port = htons (port);
+#ifdef ENABLE_IPV6
+    else
+      addrs[i].a.sin6.sin6_port = htons (port);
+#endif
+    list[f][num[f]++] = addrs[i];
+  }
+#ifdef ENABLE_IPV6
+  if (!xine) {
+    only = 0;
+  } else switch (xine->ip_pref) {
+    case XINE_IP_PREF_4:   only = 0; break;
+    case XINE_IP_PREF_4_6: first = 0; break;
+    case XINE_IP_PREF_6_4: first = 1; break;
+    default:               first = addrs[0].a.sa.sa_family == AF_INET ? 0 : 1;
+  }
+#else
+  (void)xine;
+  only = 0;
 #endif
+  if (only >= 0) {
+    memcpy (addrs, list[only], num[only] * sizeof (*addrs));
+    return num[only];
+  }
+  /* interleave families. */
+  n = 0;
+  for (i = j = 0; (i < num[first]) || (j < num[first ^ 1]); ) {
+    if (i < num[first])
+      addrs[n++] = list[first][i++];
+    if (j < num[first ^ 1])
+      addrs[n++] = list[first ^ 1][j++];
+  }
+  return n;
+}
 
-  /* try to connect ip's */
-  same_retries = 5;
-#ifndef ENABLE_IPV6
-  i = 0;
+/* make a non blocking socket, and start connecting. returns fd, or -1. */
+static int xio_start_connect (xine_stream_t *stream, const xio_addr_t *addr, int *err) {
+  xine_t *xine = stream ? stream->xine : NULL;
+  int s, r;
+
+  s = xine_socket_cloexec (addr->a.sa.sa_family == AF_INET ? PF_INET : PF_INET6, SOCK_STREAM, IPPROTO_TCP);
+  if (s == -1) {
+    int e = sock_errno;
+    xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: socket: %s (%d).\n", sock_strerror (e), e);
+    _x_message (stream, XINE_MSG_CONNECTION_REFUSED, "failed to create socket", sock_strerror (e), NULL);
+    *err = e;
+    return -1;
+  }
+  /* try to turn off blocking, but dont require that.
+   * main io will work the same with and without, only connect () and close () may hang. */
+#ifndef WIN32
+  if (fcntl (s, F_SETFL, fcntl (s, F_GETFL) | O_NONBLOCK) == -1)
 #else
-  tmpaddr = res;
+  {
+    unsigned long non_block = 1;
+    r = ioctlsocket (s, FIONBIO, &non_block);
+  }
+  if (r == SOCKET_ERROR)
 #endif
+  {
+    int e = sock_errno;
+    xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: connect: %s (%d).\n", sock_strerror (e), e);
+    _x_message (stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", sock_strerror (e), NULL);
+  }
+  reportIP (stream, "connecting", addr);
+  r = connect (s, &addr->a.sa, addr->len);
+  if (r == -1) {
+    int e = sock_errno;
+    if (e != SOCK_EINPROGRESS) {
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "io_helper: connect: %s (%d).\n", sock_strerror (e), e);
+      _x_io_tcp_close (NULL, s);
+      *err = e;
+      return -1;
+    }
+  }
+  return s;
+}
+
+int _x_io_tcp_handshake_connect (xine_stream_t *stream, const char *host, int port,
+  xio_handshake_cb_t *handshake_cb, void *userdata) {
+  xine_private_t *xine = stream ? (xine_private_t *)stream->xine : NULL;
+  xio_addr_t addrs[XIO_MAX_ADDRS];
+  /* pending attempts */
+  int fds[XIO_MAX_ADDRS], idx[XIO_MAX_ADDRS], npend = 0;
+  int num, next = 0, same_retries = 5, last_err = 0, i;
+  uint32_t start, last_start = 0;
+  int timeout = xine ? xine->network_timeout * 1000 : 30000;
+
+  /* resolve host ip(s) */
+  xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: resolving %s:%d...\n", host, port);
+  num = xio_resolve (stream, host, addrs);
+  if (num < 0)
+    return -1;
+  num = xio_sort_addrs (xine, addrs, num, port);
+  if (num <= 0) {
+    _x_message (stream, XINE_MSG_UNKNOWN_HOST, "no usable address for", host, NULL);
+    return -1;
+  }
+  /* report ip's */
+  for (i = 0; i < num; i++)
+    reportIP (stream, "found IP", &addrs[i]);
+
+  start = xio_msec ();
   while (1) {
-    xio_handshake_status_t status = XIO_HANDSHAKE_OK;
-    int s;
-#ifndef ENABLE_IPV6
-    if (!h->h_addr_list[i])
-      break;
-#else
-    if (!tmpaddr) {
-      ip_version >>= 4;
-      if (ip_version) {
-        tmpaddr = res;
+    uint32_t now = xio_msec ();
+    int s = -1, n = -1;
+
+    /* start next attempt, if there is nothing to wait for, or if the others take too long. */
+    if ((next < num) && (!npend || ((int32_t)(now - last_start) >= XIO_CONNECT_DELAY))) {
+      s = xio_start_connect (stream, &addrs[next], &last_err);
+      n = next++;
+      if (s < 0)
         continue;
-      }
-      break;
+      last_start = now;
+      /* without stream, we cannot wait abortable.
+       * and when there is nothing else to try, let caller finish. */
+      if (!stream || (!handshake_cb && (next >= num) && !npend))
+        return s;
+      fds[npend] = s;
+      idx[npend] = n;
+      npend++;
+      s = -1;
     }
-    if (ip_version) {
-      if (((ip_version & 15) == 4) == (tmpaddr->ai_family != AF_INET)) {
-        tmpaddr = tmpaddr->ai_next;
+
+    if (!npend) {
+      if (next < num)
         continue;
-      }
+      break;
     }
-#endif
-    do {
-      int r;
-      /* make socket */
-#ifndef ENABLE_IPV6
-      s = xine_socket_cloexec (PF_INET, SOCK_STREAM, IPPROTO_TCP);
-#else
-      s = xine_socket_cloexec (tmpaddr->ai_family, SOCK_STREAM, IPPROTO_TCP);
-#endif
-      if (s == -1) {
-        int e = sock_errno;
-        xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: socket: %s (%d).\n", sock_strerror (e), e);
-        _x_message (stream, XINE_MSG_CONNECTION_REFUSED, "failed to create socket", sock_strerror (e), NULL);
-        /* XXX: does it make sense to retry this? */
-        status = XIO_HANDSHAKE_INTR;
-        break;
-      }
-      /* try to turn off blocking, but dont require that.
-       * main io will work the same with and without, only connect () and close () may hang. */
-#ifndef WIN32
-      if (fcntl (s, F_SETFL, fcntl (s, F_GETFL) | O_NONBLOCK) == -1)
-#else
-      {
-        unsigned long non_block = 1;
-        r = ioctlsocket (s, FIONBIO, &non_block);
+    if ((int32_t)(now - start) >= timeout) {
+      xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: connect: timeout.\n");
+      last_err = ETIMEDOUT;
+      break;
+    }
+
+    /* wait for any pending attempt */
+    {
+      struct timeval select_timeout = {0, XIO_POLLING_INTERVAL};
+      fd_set wset, eset;
+      int maxfd = -1, r;
+
+      if (next < num) {
+        int32_t d = XIO_CONNECT_DELAY - (int32_t)(now - last_start);
+        if (d < 0)
+          d = 0;
+        if (d * 1000 < XIO_POLLING_INTERVAL)
+          select_timeout.tv_usec = d * 1000;
       }
-      if (r == SOCKET_ERROR)
-#endif
-      {
-        int e = sock_errno;
-        xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: connect: %s (%d).\n", sock_strerror (e), e);
-        _x_message (stream, XINE_MSG_CONNECTION_REFUSED, "can't put socket in non-blocking mode", sock_strerror (e), NULL);
+      FD_ZERO (&wset);
+      FD_ZERO (&eset);
+      for (i = 0; i < npend; i++) {
+        FD_SET (fds[i], &wset);
+        FD_SET (fds[i], &eset);
+        if (fds[i] > maxfd)
+          maxfd = fds[i];
       }
-      /* connect now */
-#ifndef ENABLE_IPV6
-      {
-        struct in_addr ia;
-        union {
-          struct sockaddr_in sin;
-          struct sockaddr addr;
-        } a;
-        reportIP (stream, "connecting", h->h_addr_list[i], port);
-        memcpy (&ia, h->h_addr_list[i], 4);
-        a.sin.sin_family = AF_INET;
-        a.sin.sin_addr = ia;
-        a.sin.sin_port = htons (port);
-        r = connect (s, &a.addr, sizeof (a.sin));
+      r = select (maxfd + 1, NULL, &wset, &eset, &select_timeout);
+      if ((r == -1) && (errno != EINTR)) {
+        last_err = sock_errno;
+        break;
       }
-#else
-      reportIP (stream, "connecting", tmpaddr);
-      r = connect (s, tmpaddr->ai_addr, tmpaddr->ai_addrlen);
-#endif
-      if (r == -1) {
-        int e = sock_errno;
-        if (e != SOCK_EINPROGRESS) {
-          xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: socket: %s (%d).\n", sock_strerror (e), e);
-          _x_message (stream, XINE_MSG_CONNECTION_REFUSED, host, sock_strerror (e), NULL);
-          status = XIO_HANDSHAKE_TRY_NEXT;
-          break;
-        }
+      if (_x_action_pending (stream)) {
+        last_err = EINTR;
+        break;
       }
-#if 1
-      /* yes _x_io_tcp_connect_finish () does this below.
-       * however, if there are more IPs we can try, test this one now
-       * before we discard any alternatives.
-       * handshake_cb will also need this. */
-#  ifndef ENABLE_IPV6
-      if (stream && (handshake_cb || h->h_addr_list[i + 1]))
-#  else
-      if (stream && (handshake_cb || tmpaddr->ai_next))
-#  endif
-      {
-        r = _x_io_select (stream, s, XIO_WRITE_READY, xine ? xine->network_timeout * 1000 : 30000);
-        if (r == XIO_ABORTED) {
-          status = XIO_HANDSHAKE_INTR;
-          break;
-        }
-        if (r != XIO_READY) {
-          status = XIO_HANDSHAKE_TRY_NEXT;
-          break;
+      if (r <= 0)
+        continue;
+
+      /* reap finished attempts. first success wins. */
+      for (i = 0; i < npend; ) {
+        int e;
+        socklen_t len = sizeof (e);
+        if (!FD_ISSET (fds[i], &wset) && !FD_ISSET (fds[i], &eset)) {
+          i++;
+          continue;
         }
-        {
-          int e;
-          socklen_t len = sizeof (e);
-          if ((getsockopt (s, SOL_SOCKET, SO_ERROR, &e, &len)) == -1)
-            e = sock_errno;
-          if (e) {
-            xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: getsockopt: %s (%d).\n", sock_strerror (e), e);
-            status = XIO_HANDSHAKE_TRY_NEXT;
-            break;
-          }
+        if ((getsockopt (fds[i], SOL_SOCKET, SO_ERROR, (void *)&e, &len)) == -1)
+          e = sock_errno;
+        if (!e && (s < 0)) {
+          s = fds[i];
+          n = idx[i];
+        } else if (e) {
+          xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: getsockopt: %s (%d).\n", sock_strerror (e), e);
+          last_err = e;
+          _x_io_tcp_close (NULL, fds[i]);
+        } else {
+          i++;
+          continue;
         }
+        npend--;
+        fds[i] = fds[npend];
+        idx[i] = idx[npend];
       }
-#endif
-    } while (0);
-    if ((status == XIO_HANDSHAKE_OK) && handshake_cb)
-      status = handshake_cb (userdata, s);
-    if (status == XIO_HANDSHAKE_OK) {
-      /* done */
-#ifdef ENABLE_IPV6
-      freeaddrinfo (res);
-#endif
-      return s;
     }
-    if (s >= 0)
+    if (s < 0)
+      continue;
+
+    reportIP (stream, "connected", &addrs[n]);
+    {
+      xio_handshake_status_t status = handshake_cb ? handshake_cb (userdata, s) : XIO_HANDSHAKE_OK;
+
+      if (status == XIO_HANDSHAKE_OK) {
+        /* done, drop the slower ones. */
+        for (i = 0; i < npend; i++)
+          _x_io_tcp_close (NULL, fds[i]);
+        return s;
+      }
       _x_io_tcp_close (NULL, s);
-    if (status == XIO_HANDSHAKE_INTR)
-      break;
-    if (status == XIO_HANDSHAKE_TRY_SAME) {
-      if (--same_retries <= 0) {
+      if (status == XIO_HANDSHAKE_INTR) {
+        last_err = EINTR;
+        break;
+      }
+      if (status == XIO_HANDSHAKE_TRY_SAME) {
+        if (--same_retries <= 0) {
+          xprintf (&xine->x, XINE_VERBOSITY_DEBUG,
+            "_x_io_tcp_handshake_connect: too many XIO_HANDSHAKE_TRY_SAME, skipping.\n");
+        } else {
+          s = xio_start_connect (stream, &addrs[n], &last_err);
+          if (s >= 0) {
+            fds[npend] = s;
+            idx[npend] = n;
+            npend++;
+          }
+        }
+      } else if (status == XIO_HANDSHAKE_TRY_NEXT) {
+        same_retries = 5;
+      } else {
         xprintf (&xine->x, XINE_VERBOSITY_DEBUG,
-          "_x_io_tcp_handshake_connect: too many XIO_HANDSHAKE_TRY_SAME, skipping.\n");
-        status = XIO_HANDSHAKE_TRY_NEXT;
+          "_x_io_tcp_handshake_connect: unknown handshake status %d, leaving.\n", (int)status);
+        break;
       }
     }
-    if (status == XIO_HANDSHAKE_TRY_NEXT) {
-      same_retries = 5;
-#ifndef ENABLE_IPV6
-      i++;
-#else
-      tmpaddr = tmpaddr->ai_next;
-#endif
-    } else if (status != XIO_HANDSHAKE_TRY_SAME) {
-      xprintf (&xine->x, XINE_VERBOSITY_DEBUG,
-        "_x_io_tcp_handshake_connect: unknown handshake status %d, leaving.\n", (int)status);
-      break;
-    }
   }
-#ifdef ENABLE_IPV6
-  freeaddrinfo (res);
-#endif
+
+  for (i = 0; i < npend; i++)
+    _x_io_tcp_close (NULL, fds[i]);
+  if (last_err && (last_err != EINTR))
+    _x_message (stream, XINE_MSG_CONNECTION_REFUSED, host, sock_strerror (last_err), NULL);
   return -1;
 }
 
@@ -274,6 +274,66 @@ static int _mime_find (uint8_t *buf, const char *haystack) {
   return -1;
 }
 
+/* Demuxers that accept a stream by content only if it starts with a fixed
+ * magic. Alternatives for the same plugin id are listed next to each other.
+ * Matching is (header[offs + i] & mask) == (magic[i] & mask), so 0xdf folds
+ * ascii case. A table hit is no guarantee, the plugin still does its own
+ * check. A miss however lets _x_find_demux_plugin () skip open_plugin ()
+ * and whatever reads and seeks that would cost.
+ * Never add demuxers here that also sniff further into the stream, or that
+ * handle reference files/playlists by content. */
+typedef struct {
+  char    id[12];
+  uint8_t offs, len, mask;
+  char    magic[21];
+} demux_signature_t;
+
+static const demux_signature_t _demux_signatures[] = {
+  { "aiff",       0,  4, 0xff, "FORM" },
+  { "avi",        0,  4, 0xdf, "RIFF" },
+  { "avi",        0,  4, 0xdf, "ON2 " },
+  { "flac",       0,  4, 0xff, "fLaC" },
+  { "flac",       0,  3, 0xff, "ID3" },
+  { "flashvideo", 0,  4, 0xff, "FLV\x01" },
+  { "ipmovie",    0, 20, 0xff, "Interplay MVE File\x1a" },
+  { "matroska",   0,  4, 0xff, "\x1a\x45\xdf\xa3" },
+  { "nsfdemux",   0,  5, 0xff, "NESM\x1a" },
+  { "ogg",        0,  4, 0xff, "OggS" },
+  { "realaudio",  0,  3, 0xff, ".ra" },
+  { "smjpeg",     0,  8, 0xff, "\x00\x0aSMJPEG" },
+  { "voc",        0, 20, 0xff, "Creative Voice File\x1a" },
+  { "wav",        0,  4, 0xff, "RIFF" },
+  { "yuv4mpeg2",  0,  9, 0xff, "YUV4MPEG2" }
+};
+
+/* 1 if demux id may accept header by content, 0 if it will not. */
+static int _demux_signature_check (const char *id, const uint8_t *header, int size) {
+  const demux_signature_t *sig = _demux_signatures;
+  const demux_signature_t *e = sig + sizeof (_demux_signatures) / sizeof (_demux_signatures[0]);
+  int known = 0;
+
+  if (size <= 0)
+    return 1;
+  for (; sig < e; sig++) {
+    const uint8_t *p, *m;
+    int i;
+    if (strcmp (sig->id, id))
+      continue;
+    known = 1;
+    if ((int)sig->offs + (int)sig->len > size)
+      continue;
+    p = header + sig->offs;
+    m = (const uint8_t *)sig->magic;
+    for (i = 0; i < (int)sig->len; i++) {
+      if ((p[i] ^ m[i]) & sig->mask)
+        break;
+    }
+    if (i == (int)sig->len)
+      return 1;
+  }
+  return !known;
+}
+
 static const char * const *_build_list_typed_plugins (xine_t *xine, int type, uint64_t mask) {
   plugin_catalog_t *catalog = xine->plugin_catalog;
   xine_sarray_t    *a, *list;
@@ -2174,7 +2234,8 @@ void _x_free_input_plugin (xine_stream_t *stream, input_plugin_t *input) {
 
 demux_plugin_t *_x_find_demux_plugin (xine_stream_t *stream, input_plugin_t *input) {
   uint8_t           mbuf[256];
-  int               methods[3], i;
+  uint8_t           header[MAX_PREVIEW_SIZE];
+  int               methods[3], i, header_size;
   plugin_catalog_t *catalog;
   demux_plugin_t   *plugin;
   const char       *mime_type = "";
@@ -2219,6 +2280,10 @@ demux_plugin_t *_x_find_demux_plugin (xine_stream_t *stream, input_plugin_t *inp
   }
   _mime_set (mbuf, sizeof (mbuf), mime_type);
 
+  /* read the header once, and let all probes below share it. */
+  header_size = _x_demux_read_header (input, header, sizeof (header));
+  _x_demux_probe_header (input, header, header_size);
+
   plugin = NULL;
   catalog = stream->xine->plugin_catalog;
 
@@ -2253,6 +2318,12 @@ demux_plugin_t *_x_find_demux_plugin (xine_stream_t *stream, input_plugin_t *inp
         if ((stream->content_detection_method == METHOD_BY_MRL) &&
             !_x_demux_check_extension (input->get_mrl (input), class->extensions))
           continue;
+        if ((stream->content_detection_method == METHOD_BY_CONTENT) &&
+            !_demux_signature_check (node->info->id, header, header_size)) {
+          xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+            "load_plugins: demux '%s' skipped by signature\n", node->info->id);
+          continue;
+        }
 
         if ((plugin = class->open_plugin (class, stream, input))) {
 	  inc_node_ref(node);
@@ -2265,6 +2336,8 @@ demux_plugin_t *_x_find_demux_plugin (xine_stream_t *stream, input_plugin_t *inp
     pthread_mutex_unlock (&catalog->lock);
   }
 
+  _x_demux_probe_header (input, NULL, 0);
+
   if (input == stream->input_plugin) {
     xine_stream_private_t *s = (xine_stream_private_t *)stream;
     s->demux.input_caps = input->get_capabilities (input);
@@ -53,6 +53,8 @@
 #define MAX_SCR_PROVIDERS        10
 #define MAX_SPEED_CHANGE_CALLBACKS 16
 #define VIDEO_DRIFT_TOLERANCE 45000
+/* frame spacing in keyframes only mode (10 ms). */
+#define KEYFRAMES_ONLY_DURATION 900
 #define AUDIO_DRIFT_TOLERANCE 45000
 
 /* metronom video modes */
@@ -465,6 +467,7 @@ typedef struct {
     int           img_duration;
     int           img_cpt;
     int           mode;
+    int           keyframes_only;
   } video;
 
   /* subtitle */
@@ -894,6 +897,19 @@ static void metronom_got_video_frame (metronom_t *this_gen, vo_frame_t *img) {
 
   pthread_mutex_lock (&this->lock);
 
+  if (this->video.keyframes_only) {
+    /* unthrottled: due now, or right after the previous frame. */
+    int64_t now = this->xine->clock->get_current_time (this->xine->clock);
+    if (this->video.vpts < now)
+      this->video.vpts = now;
+    img->vpts = this->video.vpts;
+    this->video.vpts += KEYFRAMES_ONLY_DURATION;
+    this->video.last_pts = pts;
+    this->video.force_jump = 1;
+    pthread_mutex_unlock (&this->lock);
+    return;
+  }
+
   if (this->master) {
     this->master->set_option(this->master, METRONOM_LOCK, 1);
 
@@ -1317,6 +1333,16 @@ static void metronom_set_option (metronom_t *this_gen, int option, int64_t value
   case METRONOM_VDR_TRICK_PTS:
     metronom_handle_vdr_trick_pts (this, value);
     break;
+  case METRONOM_SEEK_TARGET:
+    this->vpts_offset = this->video.vpts - value;
+    xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+      "metronom: seek target pts %" PRId64 ", vpts %" PRId64 ".\n", value, this->video.vpts);
+    break;
+  case METRONOM_KEYFRAMES_ONLY:
+    this->video.keyframes_only = !!value;
+    xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+      "metronom: keyframes only mode %s.\n", value ? "on" : "off");
+    break;
   default:
     xprintf(this->xine, XINE_VERBOSITY_NONE,
       "metronom: unknown option in set_option: %d.\n", option);
@@ -1392,6 +1418,9 @@ static int64_t metronom_get_option (metronom_t *this_gen, int option) {
   case METRONOM_VDR_TRICK_PTS:
     result = this->video.vpts;
     break;
+  case METRONOM_KEYFRAMES_ONLY:
+    result = this->video.keyframes_only;
+    break;
   default:
     result = 0;
     xprintf (this->xine, XINE_VERBOSITY_NONE,
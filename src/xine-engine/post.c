@@ -65,6 +65,7 @@ static void post_frame_proc_slice (vo_frame_t *vo_img, uint8_t **src);
 static void post_frame_proc_frame (vo_frame_t *vo_img);
 static void post_frame_field      (vo_frame_t *vo_img, int which_field);
 static int  post_frame_draw       (vo_frame_t *vo_img, xine_stream_t *stream);
+static int  post_frame_draw_filter (vo_frame_t *vo_img, xine_stream_t *stream);
 static void post_frame_free       (vo_frame_t *vo_img);
 static void post_frame_dispose    (vo_frame_t *vo_img);
 
@@ -112,7 +113,7 @@ static vo_frame_t *post_intercept_video_frame (post_video_port_t *port, vo_frame
   new_frame->frame.proc_frame = port->new_frame->proc_frame ? port->new_frame->proc_frame : NULL;
   new_frame->frame.proc_slice = port->new_frame->proc_slice ? port->new_frame->proc_slice : NULL;
   new_frame->frame.field      = port->new_frame->field      ? port->new_frame->field      : post_frame_field;
-  new_frame->frame.draw       = port->new_frame->draw       ? port->new_frame->draw       : post_frame_draw;
+  new_frame->frame.draw       = port->new_frame->draw       ? post_frame_draw_filter      : post_frame_draw;
   new_frame->frame.lock       = port->new_frame->lock       ? port->new_frame->lock       : post_frame_lock;
   new_frame->frame.free       = port->new_frame->free       ? port->new_frame->free       : post_frame_free;
   new_frame->frame.dispose    = port->new_frame->dispose    ? port->new_frame->dispose    : post_frame_dispose;
@@ -627,6 +628,17 @@ static int post_frame_draw(vo_frame_t *vo_img, xine_stream_t *stream) {
   return skip;
 }
 
+/* dont waste filter work on frames that accurate seek will drop anyway. */
+static int post_frame_draw_filter(vo_frame_t *vo_img, xine_stream_t *stream) {
+  post_video_port_t *port = _x_post_video_frame_to_port(vo_img);
+  xine_stream_private_t *s = (xine_stream_private_t *)stream;
+
+  if (s && (stream != XINE_ANON_STREAM) && s->accurate_seek.video &&
+    xine_accurate_seek_skip (s, vo_img->pts, vo_img->duration, 1))
+    return 0;
+  return port->new_frame->draw(vo_img, stream);
+}
+
 static void post_frame_lock(vo_frame_t *vo_img) {
   post_video_port_t *port = _x_post_video_frame_to_port(vo_img);
 
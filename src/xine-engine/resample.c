@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2000-2009 the xine project
+ * Copyright (C) 2000-2020 the xine project
  *
  * This file is part of xine, a free video player.
  *
@@ -24,9 +24,18 @@
 
 #include <string.h>
 #include <inttypes.h>
+#include <math.h>
 #include <xine/attributes.h>
 #include <xine/resample.h>
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define RESAMPLE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define RESAMPLE_NEON
+#endif
+
 /* contributed by paul flinders */
 
 void _x_audio_out_resample_mono(int16_t *last_sample,
@@ -359,3 +368,244 @@ void _x_audio_out_resample_stereotomono(int16_t* input_samples,
     *output_samples++ = os;
   }
 }
+
+/* round to nearest even, like the biased float trick of liba52 users. */
+static inline int16_t _float_to_s16 (float v) {
+  if (v >= (float)32767)
+    return 32767;
+  if (v <= (float)-32768)
+    return -32768;
+  return lrintf (v);
+}
+
+#ifdef RESAMPLE_SSE2
+/* 8 samples, scaled, rounded, and saturated. */
+static inline __m128i _float8_to_s16 (const float *p, __m128 gain) {
+  const __m128 hi = _mm_set1_ps ((float)32767), lo = _mm_set1_ps ((float)-32768);
+  __m128 a = _mm_mul_ps (_mm_loadu_ps (p), gain);
+  __m128 b = _mm_mul_ps (_mm_loadu_ps (p + 4), gain);
+  /* clamp first, cvt yields 0x80000000 on overflow. */
+  a = _mm_max_ps (_mm_min_ps (a, hi), lo);
+  b = _mm_max_ps (_mm_min_ps (b, hi), lo);
+  return _mm_packs_epi32 (_mm_cvtps_epi32 (a), _mm_cvtps_epi32 (b));
+}
+#endif
+
+#ifdef RESAMPLE_NEON
+static inline int32x4_t _float4_to_s32 (float32x4_t v) {
+#  if defined(__aarch64__) || (defined(__ARM_ARCH) && (__ARM_ARCH >= 8))
+  return vcvtnq_s32_f32 (v);
+#  else
+  /* armv7 vcvt truncates. adding 1.5 * 2^23 rounds to integer, safe for |v| < 2^22. */
+  const float32x4_t magic = vdupq_n_f32 ((float)12582912);
+  v = vmaxq_f32 (vminq_f32 (v, vdupq_n_f32 ((float)32767)), vdupq_n_f32 ((float)-32768));
+  return vcvtq_s32_f32 (vsubq_f32 (vaddq_f32 (v, magic), magic));
+#  endif
+}
+
+static inline int16x8_t _float8_to_s16 (const float *p, float32x4_t gain) {
+  /* vcvt and vqmovn both saturate. */
+  int32x4_t a = _float4_to_s32 (vmulq_f32 (vld1q_f32 (p), gain));
+  int32x4_t b = _float4_to_s32 (vmulq_f32 (vld1q_f32 (p + 4), gain));
+  return vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b));
+}
+#endif
+
+void _x_audio_out_float_to_s16 (int16_t *output_samples, const float * const *input_planes,
+  uint32_t channels, uint32_t frames, float gain) {
+  uint32_t i = 0, c;
+
+#if defined(RESAMPLE_SSE2) || defined(RESAMPLE_NEON)
+  {
+#  ifdef RESAMPLE_SSE2
+    const __m128 g = _mm_set1_ps (gain);
+#  else
+    const float32x4_t g = vdupq_n_f32 (gain);
+#  endif
+    if ((channels == 1) && input_planes[0]) {
+      const float *m = input_planes[0];
+      for (; i + 8 <= frames; i += 8) {
+#  ifdef RESAMPLE_SSE2
+        _mm_storeu_si128 ((__m128i *)(output_samples + i), _float8_to_s16 (m + i, g));
+#  else
+        vst1q_s16 (output_samples + i, _float8_to_s16 (m + i, g));
+#  endif
+      }
+    } else if ((channels == 2) && input_planes[0] && input_planes[1]) {
+      const float *l = input_planes[0], *r = input_planes[1];
+      for (; i + 8 <= frames; i += 8) {
+#  ifdef RESAMPLE_SSE2
+        __m128i vl = _float8_to_s16 (l + i, g);
+        __m128i vr = _float8_to_s16 (r + i, g);
+        _mm_storeu_si128 ((__m128i *)(output_samples + 2 * i), _mm_unpacklo_epi16 (vl, vr));
+        _mm_storeu_si128 ((__m128i *)(output_samples + 2 * i + 8), _mm_unpackhi_epi16 (vl, vr));
+#  else
+        int16x8x2_t v;
+        v.val[0] = _float8_to_s16 (l + i, g);
+        v.val[1] = _float8_to_s16 (r + i, g);
+        vst2q_s16 (output_samples + 2 * i, v);
+#  endif
+      }
+    } else if (channels <= RESAMPLE_MAX_CHANNELS) {
+      /* convert 8 frames per channel, then interleave. */
+      int16_t tmp[RESAMPLE_MAX_CHANNELS][8];
+      for (; i + 8 <= frames; i += 8) {
+        int16_t *q = output_samples + i * channels;
+        uint32_t j;
+        for (c = 0; c < channels; c++) {
+#  ifdef RESAMPLE_SSE2
+          _mm_storeu_si128 ((__m128i *)tmp[c],
+            input_planes[c] ? _float8_to_s16 (input_planes[c] + i, g) : _mm_setzero_si128 ());
+#  else
+          vst1q_s16 (tmp[c], input_planes[c] ? _float8_to_s16 (input_planes[c] + i, g) : vdupq_n_s16 (0));
+#  endif
+        }
+        for (j = 0; j < 8; j++)
+          for (c = 0; c < channels; c++)
+            *q++ = tmp[c][j];
+      }
+    }
+  }
+#endif
+
+  for (c = 0; c < channels; c++) {
+    const float *p = input_planes[c];
+    int16_t *q = output_samples + i * channels + c;
+    uint32_t n;
+    if (p) {
+      for (n = i; n < frames; n++) {
+        *q = _float_to_s16 (p[n] * gain);
+        q += channels;
+      }
+    } else {
+      for (n = i; n < frames; n++) {
+        *q = 0;
+        q += channels;
+      }
+    }
+  }
+}
+
+void _x_audio_out_float_mix (float *output_samples, const float *input_samples,
+  uint32_t samples, float gain) {
+  uint32_t i = 0;
+
+#if defined(RESAMPLE_SSE2)
+  {
+    const __m128 g = _mm_set1_ps (gain);
+    for (; i + 4 <= samples; i += 4)
+      _mm_storeu_ps (output_samples + i,
+        _mm_add_ps (_mm_loadu_ps (output_samples + i), _mm_mul_ps (_mm_loadu_ps (input_samples + i), g)));
+  }
+#elif defined(RESAMPLE_NEON)
+  for (; i + 4 <= samples; i += 4)
+    vst1q_f32 (output_samples + i,
+      vmlaq_n_f32 (vld1q_f32 (output_samples + i), vld1q_f32 (input_samples + i), gain));
+#endif
+
+  for (; i < samples; i++)
+    output_samples[i] += input_samples[i] * gain;
+}
+
+#ifdef RESAMPLE_SSE2
+/* 4 samples with peak tracking, declip, and rounding. */
+static inline __m128i _fixed4_to_s32 (const int32_t *p, __m128i *peak, __m128i rnd, __m128i shift, int declip) {
+  __m128i v = _mm_loadu_si128 ((const __m128i *)p);
+  __m128i s = _mm_srai_epi32 (v, 31);
+  __m128i a = _mm_sub_epi32 (_mm_xor_si128 (v, s), s);
+  __m128i m = _mm_cmpgt_epi32 (a, *peak);
+  *peak = _mm_or_si128 (_mm_and_si128 (m, a), _mm_andnot_si128 (m, *peak));
+  if (declip)
+    v = _mm_sub_epi32 (v, _mm_srai_epi32 (v, 2));
+  return _mm_sra_epi32 (_mm_add_epi32 (v, rnd), shift);
+}
+#define _fixed8_to_s16(p) \
+  _mm_packs_epi32 (_fixed4_to_s32 (p, &vpeak, rnd, shift, declip), _fixed4_to_s32 (p + 4, &vpeak, rnd, shift, declip))
+#endif
+
+#ifdef RESAMPLE_NEON
+static inline int32x4_t _fixed4_to_s32 (const int32_t *p, int32x4_t *peak, int32x4_t rnd, int32x4_t shift, int declip) {
+  int32x4_t v = vld1q_s32 (p);
+  *peak = vmaxq_s32 (*peak, vabsq_s32 (v));
+  if (declip)
+    v = vsubq_s32 (v, vshrq_n_s32 (v, 2));
+  /* shift left by a negative count is an arithmetic shift right. */
+  return vshlq_s32 (vaddq_s32 (v, rnd), shift);
+}
+#define _fixed8_to_s16(p) \
+  vcombine_s16 (vqmovn_s32 (_fixed4_to_s32 (p, &vpeak, rnd, shift, declip)), \
+    vqmovn_s32 (_fixed4_to_s32 (p + 4, &vpeak, rnd, shift, declip)))
+#endif
+
+int32_t _x_audio_out_fixed_to_s16 (int16_t *output_samples, const int32_t * const *input_planes,
+  uint32_t channels, uint32_t frames, int fracbits, int declip, int32_t peak) {
+  const int32_t round = 1 << (fracbits - 16);
+  uint32_t i = 0, c;
+
+#if defined(RESAMPLE_SSE2) || defined(RESAMPLE_NEON)
+  if ((channels == 1) || (channels == 2)) {
+#  ifdef RESAMPLE_SSE2
+    const __m128i rnd = _mm_set1_epi32 (round);
+    const __m128i shift = _mm_cvtsi32_si128 (fracbits - 15);
+    __m128i vpeak = _mm_set1_epi32 (peak);
+#  else
+    const int32x4_t rnd = vdupq_n_s32 (round);
+    const int32x4_t shift = vdupq_n_s32 (15 - fracbits);
+    int32x4_t vpeak = vdupq_n_s32 (peak);
+#  endif
+    int32_t t[4];
+
+    if (channels == 1) {
+      const int32_t *m = input_planes[0];
+      for (; i + 8 <= frames; i += 8) {
+#  ifdef RESAMPLE_SSE2
+        _mm_storeu_si128 ((__m128i *)(output_samples + i), _fixed8_to_s16 (m + i));
+#  else
+        vst1q_s16 (output_samples + i, _fixed8_to_s16 (m + i));
+#  endif
+      }
+    } else {
+      const int32_t *l = input_planes[0], *r = input_planes[1];
+      for (; i + 8 <= frames; i += 8) {
+#  ifdef RESAMPLE_SSE2
+        __m128i vl = _fixed8_to_s16 (l + i);
+        __m128i vr = _fixed8_to_s16 (r + i);
+        _mm_storeu_si128 ((__m128i *)(output_samples + 2 * i), _mm_unpacklo_epi16 (vl, vr));
+        _mm_storeu_si128 ((__m128i *)(output_samples + 2 * i + 8), _mm_unpackhi_epi16 (vl, vr));
+#  else
+        int16x8x2_t v;
+        v.val[0] = _fixed8_to_s16 (l + i);
+        v.val[1] = _fixed8_to_s16 (r + i);
+        vst2q_s16 (output_samples + 2 * i, v);
+#  endif
+      }
+    }
+#  ifdef RESAMPLE_SSE2
+    _mm_storeu_si128 ((__m128i *)t, vpeak);
+#  else
+    vst1q_s32 (t, vpeak);
+#  endif
+    for (c = 0; c < 4; c++)
+      if (t[c] > peak)
+        peak = t[c];
+  }
+#  undef _fixed8_to_s16
+#endif
+
+  for (c = 0; c < channels; c++) {
+    const int32_t *p = input_planes[c];
+    int16_t *q = output_samples + i * channels + c;
+    uint32_t n;
+    for (n = i; n < frames; n++) {
+      int32_t v = p[n], a = v < 0 ? -v : v;
+      if (a > peak)
+        peak = a;
+      if (declip)
+        v -= v >> 2;
+      v = (v + round) >> (fracbits - 15);
+      *q = ((v + 0x8000) & 0xffff0000) ? (v >> 31) ^ 0x7fff : v;
+      q += channels;
+    }
+  }
+  return peak;
+}
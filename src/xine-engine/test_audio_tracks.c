@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for parallel audio track decoding, see "engine.decoder.audio_track_workers".
+ * 2 tracks of a trivial PCM format go through a test decoder into a counting
+ * audio port. We check that only the selected track is played, that
+ * xine_get_audio_track_data () sees both, that no control buf gets lost on
+ * the way to the workers, and that switching tracks works.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <xine/xine_internal.h>
+#include <xine/audio_decoder.h>
+#include <xine/audio_out.h>
+#include <xine/buffer.h>
+
+#define TEST_TRACKS  2
+#define TEST_FRAMES  64
+#define TEST_BUFS    20
+#define TEST_RESETS  30
+#define TEST_TYPE    BUF_AUDIO_LPCM_LE
+
+/* sample values tell track and buf number. */
+static int16_t test_value (int chan, int seq) {
+  return chan * 1000 + seq;
+}
+
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+static int test_resets[TEST_TRACKS];
+
+/* the test decoder. */
+
+typedef struct {
+  audio_decoder_t  audio_decoder;
+  xine_stream_t   *stream;
+  int              chan, output_open;
+} test_decoder_t;
+
+static void test_decode_data (audio_decoder_t *this_gen, buf_element_t *buf) {
+  test_decoder_t *this = (test_decoder_t *)this_gen;
+  xine_audio_port_t *port = this->stream->audio_out;
+  audio_buffer_t *ab;
+
+  this->chan = buf->type & 0xffff;
+  if ((buf->decoder_flags & BUF_FLAG_HEADER) || (buf->size <= 0))
+    return;
+  if (!this->output_open)
+    this->output_open = port->open (port, this->stream, 16, 48000, AO_CAP_MODE_MONO) > 0;
+  if (!this->output_open)
+    return;
+  ab = port->get_buffer (port);
+  memcpy (ab->mem, buf->content, buf->size);
+  ab->num_frames = buf->size / 2;
+  ab->vpts = buf->pts;
+  port->put_buffer (port, ab, this->stream);
+}
+
+static void test_reset (audio_decoder_t *this_gen) {
+  test_decoder_t *this = (test_decoder_t *)this_gen;
+
+  /* be slow, so the worker fifos run full. */
+  usleep (1000);
+  pthread_mutex_lock (&test_lock);
+  if ((this->chan >= 0) && (this->chan < TEST_TRACKS))
+    test_resets[this->chan]++;
+  pthread_mutex_unlock (&test_lock);
+}
+
+static void test_discontinuity (audio_decoder_t *this_gen) {
+  (void)this_gen;
+}
+
+static void test_dispose (audio_decoder_t *this_gen) {
+  test_decoder_t *this = (test_decoder_t *)this_gen;
+
+  if (this->output_open)
+    this->stream->audio_out->close (this->stream->audio_out, this->stream);
+  free (this);
+}
+
+static audio_decoder_t *test_open_plugin (audio_decoder_class_t *class_gen, xine_stream_t *stream) {
+  test_decoder_t *this = calloc (1, sizeof (*this));
+
+  (void)class_gen;
+  if (!this)
+    return NULL;
+  this->audio_decoder.decode_data   = test_decode_data;
+  this->audio_decoder.reset         = test_reset;
+  this->audio_decoder.discontinuity = test_discontinuity;
+  this->audio_decoder.dispose       = test_dispose;
+  this->stream = stream;
+  this->chan   = -1;
+  return &this->audio_decoder;
+}
+
+static void *test_init_plugin (xine_t *xine, const void *data) {
+  static const audio_decoder_class_t this = {
+    .open_plugin = test_open_plugin,
+    .identifier  = "testpcm",
+    .description = "test decoder",
+    .dispose     = NULL
+  };
+  (void)xine;
+  (void)data;
+  return (void *)&this;
+}
+
+static const uint32_t test_types[] = { TEST_TYPE, 0 };
+
+static const decoder_info_t test_dec_info = {
+  .supported_types = test_types,
+  .priority        = 1,
+};
+
+static const plugin_info_t test_plugin_info[] = {
+  { PLUGIN_AUDIO_DECODER, AUDIO_DECODER_IFACE_VERSION, "testpcm", XINE_VERSION_CODE, &test_dec_info, test_init_plugin },
+  { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
+};
+
+/* the counting audio port. */
+
+typedef struct {
+  xine_audio_port_t port;
+  audio_buffer_t    buf;
+  extra_info_t      ei;
+  int16_t           mem[4096];
+  int               open;
+  /* frames played per track, and the last sample. */
+  int               frames[TEST_TRACKS];
+  int               last[TEST_TRACKS];
+  int               bad;
+} test_port_t;
+
+static uint32_t test_port_get_capabilities (xine_audio_port_t *port) {
+  (void)port;
+  return AO_CAP_MODE_MONO | AO_CAP_16BITS;
+}
+
+static int test_port_get_property (xine_audio_port_t *port, int property) {
+  (void)port;
+  (void)property;
+  return 0;
+}
+
+static int test_port_set_property (xine_audio_port_t *port, int property, int value) {
+  (void)port;
+  (void)property;
+  return value;
+}
+
+static int test_port_open (xine_audio_port_t *port, xine_stream_t *stream, uint32_t bits, uint32_t rate, int mode) {
+  test_port_t *this = (test_port_t *)port;
+
+  (void)stream;
+  (void)bits;
+  (void)mode;
+  pthread_mutex_lock (&test_lock);
+  this->open++;
+  pthread_mutex_unlock (&test_lock);
+  return rate;
+}
+
+/* the track ports serialize their forwards. */
+static audio_buffer_t *test_port_get_buffer (xine_audio_port_t *port) {
+  test_port_t *this = (test_port_t *)port;
+
+  pthread_mutex_lock (&test_lock);
+  this->buf.mem = this->mem;
+  this->buf.mem_size = sizeof (this->mem);
+  this->buf.num_frames = 0;
+  this->buf.extra_info = &this->ei;
+  return &this->buf;
+}
+
+static void test_port_put_buffer (xine_audio_port_t *port, audio_buffer_t *buf, xine_stream_t *stream) {
+  test_port_t *this = (test_port_t *)port;
+  int chan = buf->mem[0] / 1000, i;
+
+  (void)stream;
+  if ((chan < 0) || (chan >= TEST_TRACKS)) {
+    this->bad++;
+  } else {
+    for (i = 0; i < buf->num_frames; i++) {
+      if (buf->mem[i] != buf->mem[0])
+        this->bad++;
+    }
+    this->frames[chan] += buf->num_frames;
+    this->last[chan] = buf->mem[0];
+  }
+  pthread_mutex_unlock (&test_lock);
+}
+
+static void test_port_close (xine_audio_port_t *port, xine_stream_t *stream) {
+  test_port_t *this = (test_port_t *)port;
+
+  (void)stream;
+  pthread_mutex_lock (&test_lock);
+  this->open--;
+  pthread_mutex_unlock (&test_lock);
+}
+
+static void test_port_exit (xine_audio_port_t *port) {
+  (void)port;
+}
+
+static int test_port_control (xine_audio_port_t *port, int cmd, ...) {
+  (void)port;
+  (void)cmd;
+  return 0;
+}
+
+static void test_port_flush (xine_audio_port_t *port) {
+  (void)port;
+}
+
+static int test_port_status (xine_audio_port_t *port, xine_stream_t *stream, uint32_t *bits, uint32_t *rate, int *mode) {
+  (void)port;
+  (void)stream;
+  *bits = 16;
+  *rate = 48000;
+  *mode = AO_CAP_MODE_MONO;
+  return 0;
+}
+
+/* feeding and waiting. */
+
+static void test_put_data (xine_stream_t *stream, int chan, int seq) {
+  fifo_buffer_t *fifo = stream->audio_fifo;
+  buf_element_t *buf = fifo->buffer_pool_alloc (fifo);
+  int16_t *p = (int16_t *)buf->content;
+  int i;
+
+  for (i = 0; i < TEST_FRAMES; i++)
+    p[i] = test_value (chan, seq);
+  buf->type = TEST_TYPE | chan;
+  buf->size = TEST_FRAMES * 2;
+  buf->pts = (int64_t)(seq + 1) * 1200;
+  buf->decoder_flags = BUF_FLAG_FRAME_END;
+  fifo->put (fifo, buf);
+}
+
+static void test_put_ctrl (xine_stream_t *stream, uint32_t type) {
+  fifo_buffer_t *fifo = stream->audio_fifo;
+  buf_element_t *buf = fifo->buffer_pool_alloc (fifo);
+
+  buf->type = type;
+  buf->size = 0;
+  fifo->put (fifo, buf);
+}
+
+static int test_port_played (test_port_t *port, int chan, int frames, int last) {
+  int r;
+
+  pthread_mutex_lock (&test_lock);
+  r = (port->frames[chan] == frames) && (port->last[chan] == last);
+  pthread_mutex_unlock (&test_lock);
+  return r;
+}
+
+/* newest decoded sample of a track, or -1. */
+static int test_track_last (xine_stream_t *stream, int channel) {
+  int16_t mem[8 * TEST_FRAMES];
+  xine_audio_track_data_t data;
+
+  memset (&data, 0, sizeof (data));
+  data.num_frames = sizeof (mem) / 2;
+  data.data = mem;
+  if (!xine_get_audio_track_data (stream, channel, &data))
+    return -1;
+  if ((data.bits != 16) || (data.rate != 48000) || (data.mode != AO_CAP_MODE_MONO) || (data.num_frames <= 0))
+    return -1;
+  return mem[data.num_frames - 1];
+}
+
+static int test_resets_done (void) {
+  int i, r = 1;
+
+  pthread_mutex_lock (&test_lock);
+  for (i = 0; i < TEST_TRACKS; i++)
+    r &= test_resets[i] == TEST_RESETS;
+  pthread_mutex_unlock (&test_lock);
+  return r;
+}
+
+#define TEST_WAIT(cond) do { \
+  int _n = 500; \
+  while (!(cond) && --_n > 0) \
+    usleep (10000); \
+} while (0)
+
+int main (void) {
+  static test_port_t port;
+  xine_t *xine;
+  xine_stream_t *stream;
+  int i, chan, errors = 0;
+
+  port.port.get_capabilities = test_port_get_capabilities;
+  port.port.get_property     = test_port_get_property;
+  port.port.set_property     = test_port_set_property;
+  port.port.open             = test_port_open;
+  port.port.get_buffer       = test_port_get_buffer;
+  port.port.put_buffer       = test_port_put_buffer;
+  port.port.close            = test_port_close;
+  port.port.exit             = test_port_exit;
+  port.port.control          = test_port_control;
+  port.port.flush            = test_port_flush;
+  port.port.status           = test_port_status;
+
+  xine = xine_new ();
+  xine_init (xine);
+  xine->config->register_range (xine->config, "engine.decoder.audio_track_workers", 0, 0, 8,
+    "", NULL, 20, NULL, NULL);
+  xine->config->update_num (xine->config, "engine.decoder.audio_track_workers", TEST_TRACKS);
+  xine_register_plugins (xine, test_plugin_info);
+  /* this also maps the new decoder, before the installed ones. */
+  xine->config->update_num (xine->config, "engine.decoder_priorities.testpcm", 1000);
+
+  stream = xine_stream_new (xine, &port.port, NULL);
+  if (!stream) {
+    fprintf (stderr, "test_audio_tracks: no stream.\n");
+    return 1;
+  }
+
+  /* track 0 is selected by default. */
+  for (i = 0; i < TEST_BUFS; i++) {
+    for (chan = 0; chan < TEST_TRACKS; chan++)
+      test_put_data (stream, chan, i);
+  }
+  TEST_WAIT (test_port_played (&port, 0, TEST_BUFS * TEST_FRAMES, test_value (0, TEST_BUFS - 1)));
+  for (chan = 0; chan < TEST_TRACKS; chan++) {
+    int last;
+    TEST_WAIT (test_track_last (stream, chan) == test_value (chan, TEST_BUFS - 1));
+    last = test_track_last (stream, chan);
+    if (last != test_value (chan, TEST_BUFS - 1)) {
+      fprintf (stderr, "test_audio_tracks: track %d data ends with %d, expected %d.\n",
+        chan, last, test_value (chan, TEST_BUFS - 1));
+      errors++;
+    }
+  }
+  if (!test_port_played (&port, 0, TEST_BUFS * TEST_FRAMES, test_value (0, TEST_BUFS - 1))
+    || !test_port_played (&port, 1, 0, 0)) {
+    fprintf (stderr, "test_audio_tracks: played %d/%d frames, expected %d/0.\n",
+      port.frames[0], port.frames[1], TEST_BUFS * TEST_FRAMES);
+    errors++;
+  }
+
+  /* more control bufs than a worker fifo holds. */
+  for (i = 0; i < TEST_RESETS; i++)
+    test_put_ctrl (stream, BUF_CONTROL_RESET_DECODER);
+  TEST_WAIT (test_resets_done ());
+  for (chan = 0; chan < TEST_TRACKS; chan++) {
+    if (test_resets[chan] != TEST_RESETS) {
+      fprintf (stderr, "test_audio_tracks: track %d saw %d of %d resets.\n",
+        chan, test_resets[chan], TEST_RESETS);
+      errors++;
+    }
+  }
+
+  /* switch to track 1. the nop lets the decoder loop see the new channel. */
+  xine_set_param (stream, XINE_PARAM_AUDIO_CHANNEL_LOGICAL, 1);
+  test_put_ctrl (stream, BUF_CONTROL_NOP);
+  for (i = TEST_BUFS; i < 2 * TEST_BUFS; i++) {
+    for (chan = 0; chan < TEST_TRACKS; chan++)
+      test_put_data (stream, chan, i);
+  }
+  TEST_WAIT (test_port_played (&port, 1, TEST_BUFS * TEST_FRAMES, test_value (1, 2 * TEST_BUFS - 1)));
+  TEST_WAIT (test_track_last (stream, 0) == test_value (0, 2 * TEST_BUFS - 1));
+  if (!test_port_played (&port, 0, TEST_BUFS * TEST_FRAMES, test_value (0, TEST_BUFS - 1))
+    || !test_port_played (&port, 1, TEST_BUFS * TEST_FRAMES, test_value (1, 2 * TEST_BUFS - 1))) {
+    fprintf (stderr, "test_audio_tracks: after switch, played %d/%d frames, expected %d/%d.\n",
+      port.frames[0], port.frames[1], TEST_BUFS * TEST_FRAMES, TEST_BUFS * TEST_FRAMES);
+    errors++;
+  }
+  if (test_track_last (stream, 0) != test_value (0, 2 * TEST_BUFS - 1)) {
+    fprintf (stderr, "test_audio_tracks: track 0 no longer decoded after switch.\n");
+    errors++;
+  }
+  if (port.bad) {
+    fprintf (stderr, "test_audio_tracks: %d damaged samples.\n", port.bad);
+    errors++;
+  }
+
+  xine_dispose (stream);
+  if (port.open) {
+    fprintf (stderr, "test_audio_tracks: port left open %d times.\n", port.open);
+    errors++;
+  }
+  xine_exit (xine);
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for _x_video_decode_hint (). 2 streams share a video port, one of
+ * them in XINE_PARAM_KEYFRAMES_ONLY mode. Only that one shall get the
+ * keyframe hint, and only while the param is set.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <xine/xine_internal.h>
+#include <xine/video_out.h>
+
+static void test_draw (xine_video_port_t *port, xine_stream_t *stream) {
+  vo_frame_t *img = port->get_frame (port, 64, 64, 1.0, XINE_IMGFMT_YV12, VO_BOTH_FIELDS);
+
+  img->pts = 0;
+  img->duration = 3000;
+  img->draw (img, stream);
+  img->free (img);
+}
+
+static int test_check (xine_stream_t *stream, const char *name, int want) {
+  int have = _x_video_decode_hint (stream);
+
+  if (have == want)
+    return 0;
+  fprintf (stderr, "test_decode_hint: %s: hint %d, expected %d.\n", name, have, want);
+  return 1;
+}
+
+int main (void) {
+  xine_t *xine;
+  xine_video_port_t *port;
+  xine_stream_t *thumb, *play;
+  int i, errors = 0;
+
+  xine = xine_new ();
+  xine_init (xine);
+  port = xine_open_video_driver (xine, "none", XINE_VISUAL_TYPE_NONE, NULL);
+  if (!port) {
+    fprintf (stderr, "test_decode_hint: no video driver.\n");
+    xine_exit (xine);
+    return 77;
+  }
+  thumb = xine_stream_new (xine, NULL, port);
+  play = xine_stream_new (xine, NULL, port);
+  if (!thumb || !play) {
+    fprintf (stderr, "test_decode_hint: no stream.\n");
+    return 1;
+  }
+  port->open (port, thumb);
+  port->open (port, play);
+
+  xine_set_param (thumb, XINE_PARAM_KEYFRAMES_ONLY, 1);
+  for (i = 0; i < 4; i++) {
+    test_draw (port, thumb);
+    test_draw (port, play);
+  }
+  errors += test_check (thumb, "thumbnail stream", VO_DECODE_HINT_NONKEY);
+  errors += test_check (play, "playing stream", VO_DECODE_HINT_NONE);
+
+  xine_set_param (thumb, XINE_PARAM_KEYFRAMES_ONLY, 0);
+  test_draw (port, thumb);
+  errors += test_check (thumb, "thumbnail stream after reset", VO_DECODE_HINT_NONE);
+
+  /* per stream, and gone with the stream. */
+  xine_set_param (play, XINE_PARAM_KEYFRAMES_ONLY, 1);
+  errors += test_check (play, "playing stream in thumbnail mode", VO_DECODE_HINT_NONKEY);
+  errors += test_check (thumb, "thumbnail stream after other", VO_DECODE_HINT_NONE);
+
+  port->close (port, play);
+  port->close (port, thumb);
+  xine_dispose (play);
+  xine_dispose (thumb);
+  play = xine_stream_new (xine, NULL, port);
+  errors += test_check (play, "new stream", VO_DECODE_HINT_NONE);
+  xine_dispose (play);
+
+  xine_close_video_driver (xine, port);
+  xine_exit (xine);
+
+  return errors ? 1 : 0;
+}
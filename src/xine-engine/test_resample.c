@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for _x_audio_out_float_to_s16 (). Output must be bit exact to the
+ * float_to_int () that the a52 decoder used before: liba52 adds a bias
+ * of 384.0 to each sample, and the result is read as IEEE float bits.
+ * The converter is built right into this test, so we cover the SIMD path
+ * that this compiler targets, plus the scalar tail.
+ */
+
+#include "resample.c"
+
+#include <stdio.h>
+
+#define TEST_FRAMES 1037
+#define TEST_CHANS  6
+
+static int16_t test_a52_old (float x) {
+  union {float s; int32_t i;} u;
+  int32_t v;
+
+  u.s = x + (float)384;
+  v = u.i - 0x43c00000;
+  return (v + 0x8000) & ~0xffff ? (v >> 31) ^ 0x7fff : v;
+}
+
+static uint32_t test_seed = 1;
+
+/* level 1 samples, with some clipping, and exact halves of 1 LSB. */
+static float test_sample (void) {
+  int32_t r;
+
+  test_seed = test_seed * 1103515245 + 12345;
+  r = (int32_t)(test_seed >> 1) % (5 << 16);
+  if (test_seed & 0x80000000)
+    r = -r;
+  if (test_seed & 0x100)
+    return (float)(r >> 1) / (float)65536;
+  return (float)r / (float)(1 << 18);
+}
+
+static int test_layout (uint32_t channels, int mute) {
+  static float mem[TEST_CHANS][TEST_FRAMES];
+  static int16_t out[TEST_CHANS * TEST_FRAMES];
+  const float *planes[TEST_CHANS];
+  uint32_t c, i;
+  int errors = 0;
+
+  for (c = 0; c < channels; c++) {
+    for (i = 0; i < TEST_FRAMES; i++)
+      mem[c][i] = test_sample ();
+    planes[c] = ((int)c == mute) ? NULL : mem[c];
+  }
+  _x_audio_out_float_to_s16 (out, planes, channels, TEST_FRAMES, 32768.0);
+
+  for (c = 0; c < channels; c++) {
+    for (i = 0; i < TEST_FRAMES; i++) {
+      int16_t want = planes[c] ? test_a52_old (mem[c][i]) : 0;
+      int16_t have = out[i * channels + c];
+      if (have != want) {
+        if (errors < 5)
+          fprintf (stderr, "test_resample: %u channels, [%u][%u] = %.9g: got %d, expected %d.\n",
+            (unsigned int)channels, (unsigned int)c, (unsigned int)i, mem[c][i], have, want);
+        errors++;
+      }
+    }
+  }
+  return errors;
+}
+
+int main (void) {
+  int n, errors = 0;
+
+  for (n = 0; n < 20; n++) {
+    errors += test_layout (1, -1);
+    errors += test_layout (2, -1);
+    errors += test_layout (6, -1);
+    errors += test_layout (6, 3);
+  }
+  if (errors)
+    fprintf (stderr, "test_resample: %d samples differ.\n", errors);
+  return errors ? 1 : 0;
+}
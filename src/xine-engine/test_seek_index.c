@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for the seek index cache size limit. We fill a private cache
+ * directory with too many old files, and too many bytes (sparse files),
+ * then save a new index. The oldest files shall go, the new one shall stay.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include <xine/xine_internal.h>
+#include <xine/input_plugin.h>
+
+#define TEST_OLD_FILES 300
+
+static char test_dir[256];
+
+static int test_put_file (const char *name, off_t size, time_t mtime) {
+  char path[1024];
+  struct utimbuf t;
+  int fd;
+
+  snprintf (path, sizeof (path), "%s/xine-lib/seek/%s", test_dir, name);
+  fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    return 1;
+  if (ftruncate (fd, size)) {
+    close (fd);
+    return 1;
+  }
+  close (fd);
+  t.actime = t.modtime = mtime;
+  return utime (path, &t) ? 1 : 0;
+}
+
+static int test_exists (const char *name) {
+  char path[1024];
+  struct stat st;
+
+  snprintf (path, sizeof (path), "%s/xine-lib/seek/%s", test_dir, name);
+  return !stat (path, &st);
+}
+
+static void test_scan (int *files, off_t *bytes) {
+  char path[1024];
+  struct dirent *d;
+  DIR *dir;
+
+  *files = 0;
+  *bytes = 0;
+  snprintf (path, sizeof (path), "%s/xine-lib/seek", test_dir);
+  dir = opendir (path);
+  if (!dir)
+    return;
+  while ((d = readdir (dir)) != NULL) {
+    struct stat st;
+    if (d->d_name[0] == '.')
+      continue;
+    snprintf (path, sizeof (path), "%s/xine-lib/seek/%s", test_dir, d->d_name);
+    if (!stat (path, &st)) {
+      (*files)++;
+      *bytes += st.st_size;
+    }
+  }
+  closedir (dir);
+}
+
+static void test_rmdir (const char *sub) {
+  char path[1024];
+  struct dirent *d;
+  DIR *dir;
+
+  snprintf (path, sizeof (path), "%s%s", test_dir, sub);
+  dir = opendir (path);
+  if (dir) {
+    while ((d = readdir (dir)) != NULL) {
+      if (!strcmp (d->d_name, ".") || !strcmp (d->d_name, ".."))
+        continue;
+      snprintf (path, sizeof (path), "%s%s/%s", test_dir, sub, d->d_name);
+      unlink (path);
+    }
+    closedir (dir);
+  }
+  snprintf (path, sizeof (path), "%s%s", test_dir, sub);
+  rmdir (path);
+}
+
+/* the engine puts its plugin cache there as well. */
+static void test_cleanup (void) {
+  test_rmdir ("/xine-lib/seek");
+  test_rmdir ("/xine-lib");
+  test_rmdir ("");
+}
+
+int main (void) {
+  char path[1024], name[32];
+  time_t now = time (NULL);
+  xine_t *xine;
+  xine_stream_t *stream;
+  input_plugin_t *input;
+  xine_seek_index_t *idx;
+  FILE *f;
+  off_t bytes;
+  int i, files, errors = 0;
+
+  strcpy (test_dir, "/tmp/xine-test-seek-XXXXXX");
+  if (!mkdtemp (test_dir))
+    return 77;
+  setenv ("XDG_CACHE_HOME", test_dir, 1);
+  snprintf (path, sizeof (path), "%s/xine-lib", test_dir);
+  mkdir (path, 0700);
+  snprintf (path, sizeof (path), "%s/xine-lib/seek", test_dir);
+  mkdir (path, 0700);
+
+  /* too many files, the 2 oldest ones too large. */
+  errors += test_put_file ("big1.ts", 40 << 20, now - 100000);
+  errors += test_put_file ("big2.ts", 40 << 20, now - 99999);
+  for (i = 0; i < TEST_OLD_FILES; i++) {
+    sprintf (name, "%08x.ts", i);
+    errors += test_put_file (name, 1000, now - 90000 + i);
+  }
+
+  /* a file to index, old enough to be static. */
+  snprintf (path, sizeof (path), "%s/media.ts", test_dir);
+  f = fopen (path, "wb");
+  if (f) {
+    static uint8_t pkt[188];
+    pkt[0] = 0x47;
+    for (i = 0; i < 1000; i++)
+      fwrite (pkt, 1, sizeof (pkt), f);
+    fclose (f);
+  }
+  {
+    struct utimbuf t;
+    t.actime = t.modtime = now - 1000;
+    utime (path, &t);
+  }
+  if (errors) {
+    fprintf (stderr, "test_seek_index: cannot set up cache directory.\n");
+    test_cleanup ();
+    return 77;
+  }
+
+  xine = xine_new ();
+  xine_init (xine);
+  stream = xine_stream_new (xine, NULL, NULL);
+  input = stream ? _x_find_input_plugin (stream, path) : NULL;
+  if (!input || !input->open (input)) {
+    fprintf (stderr, "test_seek_index: cannot open %s.\n", path);
+    test_cleanup ();
+    return 1;
+  }
+  idx = _x_seek_index_open (stream, input, "ts");
+  if (!idx) {
+    fprintf (stderr, "test_seek_index: no seek index.\n");
+    test_cleanup ();
+    return 1;
+  }
+  _x_seek_index_add (idx, 0, 90000, -1);
+  _x_seek_index_add (idx, 188 * 500, 2 * 90000, 0);
+  _x_seek_index_close (&idx);
+
+  test_scan (&files, &bytes);
+  if ((files > 256) || (bytes > (64 << 20))) {
+    fprintf (stderr, "test_seek_index: %d files, %d bytes left.\n", files, (int)bytes);
+    errors++;
+  }
+  if (test_exists ("big1.ts") || test_exists ("big2.ts") || test_exists ("00000000.ts")) {
+    fprintf (stderr, "test_seek_index: oldest files still there.\n");
+    errors++;
+  }
+  sprintf (name, "%08x.ts", TEST_OLD_FILES - 1);
+  if (!test_exists (name)) {
+    fprintf (stderr, "test_seek_index: newest old file dropped.\n");
+    errors++;
+  }
+  if (files != 256) {
+    fprintf (stderr, "test_seek_index: new index not saved, or too much dropped (%d files).\n", files);
+    errors++;
+  }
+
+  _x_free_input_plugin (stream, input);
+  xine_dispose (stream);
+  xine_exit (xine);
+  test_cleanup ();
+
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2000-2026 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ *
+ * Test for closing a timeshift over a live input without data, like
+ * DVB after signal loss. The main input waits a minute in _x_io_select (),
+ * dispose must not. The plugin is built right into this test.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/* see the libxine api from outside, but get the private parts as well. */
+#include <xine/attributes.h>
+#define XINE_LIBRARY_COMPILE
+#include "input_rip.c"
+
+#include <sys/time.h>
+#include <xine/io_helper.h>
+
+#ifdef HAVE_TIMESHIFT
+
+typedef struct {
+  input_plugin_t  input_plugin;
+  xine_stream_t  *stream;
+  int             fd[2];
+} test_input_t;
+
+static off_t test_read (input_plugin_t *this_gen, void *buf, off_t len) {
+  test_input_t *this = (test_input_t *)this_gen;
+
+  if (_x_io_select (this->stream, this->fd[0], XIO_READ_READY, 60000) != XIO_READY)
+    return -1;
+  return read (this->fd[0], buf, len);
+}
+
+static uint32_t test_get_capabilities (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return INPUT_CAP_LIVE;
+}
+
+static off_t test_get_current_pos (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 0;
+}
+
+static int test_get_optional_data (input_plugin_t *this_gen, void *data, int data_type) {
+  (void)this_gen;
+  (void)data;
+  (void)data_type;
+  return INPUT_OPTIONAL_UNSUPPORTED;
+}
+
+static void test_dispose (input_plugin_t *this_gen) {
+  test_input_t *this = (test_input_t *)this_gen;
+
+  close (this->fd[0]);
+  close (this->fd[1]);
+}
+
+int main (void) {
+  static test_input_t main_input;
+  xine_t *xine;
+  xine_stream_t *stream;
+  input_plugin_t *tshift;
+  struct timeval t1, t2;
+  int ms;
+
+  xine = xine_new ();
+  xine_init (xine);
+  stream = xine_stream_new (xine, NULL, NULL);
+  if (!stream || pipe (main_input.fd)) {
+    fprintf (stderr, "test_timeshift: no stream.\n");
+    return 1;
+  }
+  main_input.stream = stream;
+  main_input.input_plugin.read              = test_read;
+  main_input.input_plugin.get_capabilities  = test_get_capabilities;
+  main_input.input_plugin.get_current_pos   = test_get_current_pos;
+  main_input.input_plugin.get_optional_data = test_get_optional_data;
+  main_input.input_plugin.dispose           = test_dispose;
+  stream->input_plugin = &main_input.input_plugin;
+
+  tshift = _x_timeshift_plugin_get_instance (stream, "16");
+  if (!tshift) {
+    fprintf (stderr, "test_timeshift: no ring buffer file.\n");
+    return 77;
+  }
+  /* let the writer start waiting. */
+  usleep (200000);
+
+  gettimeofday (&t1, NULL);
+  tshift->dispose (tshift);
+  gettimeofday (&t2, NULL);
+  ms = (t2.tv_sec - t1.tv_sec) * 1000 + (t2.tv_usec - t1.tv_usec) / 1000;
+
+  stream->input_plugin = NULL;
+  xine_dispose (stream);
+  xine_exit (xine);
+
+  if (ms > 2000) {
+    fprintf (stderr, "test_timeshift: dispose took %d ms.\n", ms);
+    return 1;
+  }
+  return 0;
+}
+
+#else
+
+int main (void) {
+  return 77;
+}
+
+#endif
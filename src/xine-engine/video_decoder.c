@@ -277,6 +277,9 @@ static void *video_decoder_loop (void *stream_gen) {
         }
         video_br_lastsize += buf->size;
 
+        if (stream->accurate_seek.video && !(buf->decoder_flags & (BUF_FLAG_PREVIEW | BUF_FLAG_HEADER)))
+          xine_accurate_seek_map (stream, buf);
+
         if (stream->video_decoder_plugin)
           stream->video_decoder_plugin->decode_data (stream->video_decoder_plugin, buf);
 
@@ -540,6 +543,8 @@ static void *video_decoder_loop (void *stream_gen) {
             running_ticket->release (running_ticket, 0);
             stream->s.metronom->handle_video_discontinuity (stream->s.metronom, t, buf->disc_off);
             running_ticket->acquire (running_ticket, 0);
+            if (t == DISC_STREAMSEEK)
+              xine_accurate_seek_arm (stream, 1);
             /* video_br_discontinuity */
             video_br_lasttime = 0;
             video_br_lastsize = 0;
@@ -55,6 +55,14 @@
 #define NUM_FRAME_BUFFERS          15
 #define DEFAULT_FRAME_DURATION   3000    /* 30 frames per second */
 
+/* decoder degradation hint (VO_PROP_DECODE_HINT):
+ * step up after this many frames in a row with less than 1 frame of headroom,
+ * jump to VO_DECODE_HINT_NONKEY when more than this many frames late,
+ * step down after this many frames in a row in time. */
+#define DECODE_HINT_RAISE           4
+#define DECODE_HINT_FAR_LATE        4
+#define DECODE_HINT_RELAX          50
+
 /* wait this delay if the first frame is still referenced */
 #define FIRST_FRAME_POLL_DELAY   3000
 #define FIRST_FRAME_MAX_POLL       10    /* poll n times at most */
@@ -112,6 +120,11 @@ typedef struct {
     int                     num_buffers;
     int                     num_buffers_max;
     int                     locked_for_read;
+    /* lock free entry. any thread may push frames here without taking mutex.
+     * readers move them to the list above while holding it. */
+    vo_frame_t             *pending;
+    int                     num_pending;
+    int                     num_waiters;
   } free_queue;
 
   struct {
@@ -121,7 +134,10 @@ typedef struct {
     vo_frame_t             *first;
     vo_frame_t            **add;
     int                     num_buffers;
-    int                     locked_for_read;
+    /* lock free entry for decoder threads, see free_queue. */
+    vo_frame_t             *pending;
+    int                     num_pending;
+    int                     num_waiters;
     /* The flush protocol. */
     int                     discard_frames;
     int                     flushed;
@@ -228,6 +244,10 @@ typedef struct {
   int                       frame_drop_cpt;
   int                       frame_drop_suggested;
 
+  int                       decode_hint;
+  int                       decode_hint_late;
+  int                       decode_hint_good;
+
   int                       crop_left, crop_right, crop_top, crop_bottom;
 
   struct {
@@ -250,6 +270,152 @@ typedef struct {
 } vos_t;
 
 
+/********************************************************************
+ * lock free helpers.                                               *
+ * vo_frame_t is public, so lock_counter and next stay plain types. *
+ * Frame lists are stacks that readers always take as a whole,     *
+ * so there is no ABA problem.                                      *
+ *******************************************************************/
+
+#if (HAVE_ATOMIC_VARS > 0) && defined (__ATOMIC_SEQ_CST)
+
+static inline int vo_at_add (int *v, int n) {
+  return __atomic_add_fetch (v, n, __ATOMIC_SEQ_CST);
+}
+
+static inline int vo_at_get (int *v) {
+  return __atomic_load_n (v, __ATOMIC_SEQ_CST);
+}
+
+static inline int vo_at_cas (int *v, int o, int n) {
+  return __atomic_compare_exchange_n (v, &o, n, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline vo_frame_t *vo_at_list_get (vo_frame_t **head) {
+  return __atomic_load_n (head, __ATOMIC_SEQ_CST);
+}
+
+static inline void vo_at_list_push (vo_frame_t **head, vo_frame_t *first, vo_frame_t **add) {
+  vo_frame_t *o = __atomic_load_n (head, __ATOMIC_RELAXED);
+  do {
+    *add = o;
+  } while (!__atomic_compare_exchange_n (head, &o, first, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+}
+
+static inline vo_frame_t *vo_at_list_take (vo_frame_t **head) {
+  return __atomic_exchange_n (head, NULL, __ATOMIC_SEQ_CST);
+}
+
+#elif (HAVE_ATOMIC_VARS == 3)
+
+static inline int vo_at_add (int *v, int n) {
+  return __sync_add_and_fetch (v, n);
+}
+
+static inline int vo_at_get (int *v) {
+  return __sync_fetch_and_add (v, 0);
+}
+
+static inline int vo_at_cas (int *v, int o, int n) {
+  return __sync_bool_compare_and_swap (v, o, n);
+}
+
+static inline vo_frame_t *vo_at_list_get (vo_frame_t **head) {
+  return __sync_val_compare_and_swap (head, NULL, NULL);
+}
+
+static inline void vo_at_list_push (vo_frame_t **head, vo_frame_t *first, vo_frame_t **add) {
+  vo_frame_t *o;
+  do {
+    o = *(vo_frame_t * volatile *)head;
+    *add = o;
+  } while (!__sync_bool_compare_and_swap (head, o, first));
+}
+
+static inline vo_frame_t *vo_at_list_take (vo_frame_t **head) {
+  vo_frame_t *o;
+  do {
+    o = *(vo_frame_t * volatile *)head;
+  } while (o && !__sync_bool_compare_and_swap (head, o, NULL));
+  return o;
+}
+
+#else
+
+/* no atomics, serialize through a single mutex. */
+static pthread_mutex_t vo_at_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int vo_at_add (int *v, int n) {
+  pthread_mutex_lock (&vo_at_mutex);
+  n = (*v += n);
+  pthread_mutex_unlock (&vo_at_mutex);
+  return n;
+}
+
+static int vo_at_get (int *v) {
+  int n;
+  pthread_mutex_lock (&vo_at_mutex);
+  n = *v;
+  pthread_mutex_unlock (&vo_at_mutex);
+  return n;
+}
+
+static int vo_at_cas (int *v, int o, int n) {
+  int r;
+  pthread_mutex_lock (&vo_at_mutex);
+  r = (*v == o);
+  if (r)
+    *v = n;
+  pthread_mutex_unlock (&vo_at_mutex);
+  return r;
+}
+
+static vo_frame_t *vo_at_list_get (vo_frame_t **head) {
+  vo_frame_t *o;
+  pthread_mutex_lock (&vo_at_mutex);
+  o = *head;
+  pthread_mutex_unlock (&vo_at_mutex);
+  return o;
+}
+
+static void vo_at_list_push (vo_frame_t **head, vo_frame_t *first, vo_frame_t **add) {
+  pthread_mutex_lock (&vo_at_mutex);
+  *add = *head;
+  *head = first;
+  pthread_mutex_unlock (&vo_at_mutex);
+}
+
+static vo_frame_t *vo_at_list_take (vo_frame_t **head) {
+  vo_frame_t *o;
+  pthread_mutex_lock (&vo_at_mutex);
+  o = *head;
+  *head = NULL;
+  pthread_mutex_unlock (&vo_at_mutex);
+  return o;
+}
+
+#endif
+
+/* move all frames from stack *pending to the end of list **add, in push order.
+ * return their count. */
+static int vo_at_list_fetch (vo_frame_t **pending, vo_frame_t ***add) {
+  vo_frame_t *f = vo_at_list_take (pending), *list = NULL, *last = f;
+  int n = 0;
+
+  if (!f)
+    return 0;
+  do {
+    vo_frame_t *next = f->next;
+    f->next = list;
+    list = f;
+    f = next;
+    n++;
+  } while (f);
+  **add = list;
+  *add = &last->next;
+  return n;
+}
+
 /********************************************************************
  * streams register.                                                *
  * Reading is way more speed relevant here.                         *
@@ -395,13 +561,8 @@ static void vo_unref_obsolete (vos_t *this) {
     if (*open_stream)
       continue;
     f = this->display_queue.frames[i];
-    if (pthread_mutex_trylock (&f->mutex))
-      continue;
-    if ((f->lock_counter != 0) || (f->id != i)) {
-      pthread_mutex_unlock (&f->mutex);
+    if ((vo_at_get (&f->lock_counter) != 0) || (f->id != i))
       continue;
-    }
-    pthread_mutex_unlock (&f->mutex);
     this->display_queue.img_streams[i] = NULL;
     *a++ = img_stream;
     if (a > d + sizeof (d) / sizeof (d[0]) - 2)
@@ -430,6 +591,9 @@ static void vo_free_queue_open (vos_t *this) {
   this->free_queue.num_buffers     = 0;
   this->free_queue.num_buffers_max = 0;
   this->free_queue.locked_for_read = 0;
+  this->free_queue.pending         = NULL;
+  this->free_queue.num_pending     = 0;
+  this->free_queue.num_waiters     = 0;
 #endif
   this->free_queue.add             = &this->free_queue.first;
   pthread_mutex_init (&this->free_queue.mutex, NULL);
@@ -440,7 +604,9 @@ static void vo_display_queue_open (vos_t *this) {
 #ifndef HAVE_ZERO_SAFE_MEM
   this->display_queue.first             = NULL;
   this->display_queue.num_buffers       = 0;
-  this->display_queue.locked_for_read   = 0;
+  this->display_queue.pending           = NULL;
+  this->display_queue.num_pending       = 0;
+  this->display_queue.num_waiters       = 0;
   this->display_queue.discard_frames    = 0;
   this->display_queue.flushed           = 0;
   this->display_queue.flush_extra       = 0;
@@ -456,7 +622,6 @@ static void vo_free_queue_close (vos_t *this) {
 #if 0 /* not yet needed */
   this->display_queue.first             = NULL;
   this->display_queue.num_buffers       = 0;
-  this->display_queue.locked_for_read   = 0;
   this->display_queue.discard_frames    = 0;
   this->display_queue.flushed           = 0;
   this->display_queue.flush_extra       = 0;
@@ -480,10 +645,36 @@ static void vo_display_queue_close (vos_t *this) {
   pthread_cond_destroy (&this->display_queue.done_flushing);
 }
 
+/* have free_queue.mutex locked!! */
+static void vo_free_queue_fetch (vos_t *this) {
+  int n = this->free_queue.first ? this->free_queue.num_buffers : 0;
+  int m = vo_at_list_fetch (&this->free_queue.pending, &this->free_queue.add);
+  if (m) {
+    vo_at_add (&this->free_queue.num_pending, -m);
+    this->free_queue.num_buffers = n + m;
+  }
+}
+
+/* have display_queue.mutex locked!! */
+static void vo_display_queue_fetch (vos_t *this) {
+  int n = this->display_queue.first ? this->display_queue.num_buffers : 0;
+  int m = vo_at_list_fetch (&this->display_queue.pending, &this->display_queue.add);
+  if (m) {
+    vo_at_add (&this->display_queue.num_pending, -m);
+    this->display_queue.num_buffers = n + m;
+  }
+}
+
+/* unlocked test, no freshness guarantee. */
+static int vo_display_queue_used (vos_t *this) {
+  return this->display_queue.first || vo_at_list_get (&this->display_queue.pending);
+}
+
 static vo_frame_t *vo_free_queue_get_all (vos_t *this) {
   vo_frame_t *list;
 
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_fetch (this);
   list = this->free_queue.first;
   this->free_queue.first = NULL;
   this->free_queue.add   = &this->free_queue.first;
@@ -496,6 +687,7 @@ static vo_frame_t *vo_display_queue_get_all (vos_t *this) {
   vo_frame_t *list;
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_fetch (this);
   list = this->display_queue.first;
   this->display_queue.first = NULL;
   this->display_queue.add   = &this->display_queue.first;
@@ -522,6 +714,7 @@ static void vo_free_queue_read_lock (vos_t *this) {
 static void vo_free_queue_read_unlock (vos_t *this) {
   pthread_mutex_lock (&this->free_queue.mutex);
   this->free_queue.locked_for_read = 0;
+  vo_free_queue_fetch (this);
   if (this->free_queue.first)
     pthread_cond_signal (&this->free_queue.not_empty);
   pthread_mutex_unlock (&this->free_queue.mutex);
@@ -539,71 +732,57 @@ static void vo_display_reref_append (vos_t *this, vo_frame_t *img) {
   xine_stream_private_t **s, *olds, *news;
   /* img already enqueue? (serious leak) */
   _x_assert (img->next == NULL);
-  img->next = NULL;
   /* Paranoia? */
   s = ((img->id >= 0) && (img->id < this->frames_total))
     ? this->display_queue.img_streams + img->id
     : &news;
   news = (xine_stream_private_t *)img->stream;
-  pthread_mutex_lock (&this->display_queue.mutex);
-  olds = *s;
-  if (olds != news) {
-    int n;
+  /* most of the time, this frame had the same stream before. */
+  if (*s != news) {
+    pthread_mutex_lock (&this->display_queue.mutex);
+    olds = *s;
     *s = news;
-    if (news)
-      xine_refs_add (&news->refs, 1); /* this is fast. */
-    n = (this->display_queue.first ? this->display_queue.num_buffers : 0) + 1;
-    *(this->display_queue.add) = img;
-    this->display_queue.add    = &img->next;
-    this->display_queue.num_buffers = n;
-    if (n > this->display_queue.locked_for_read)
-      pthread_cond_signal (&this->display_queue.not_empty);
     pthread_mutex_unlock (&this->display_queue.mutex);
-    if (olds)
-      xine_refs_sub (&olds->refs, 1); /* this may involve stream dispose. */
-  } else {
-    int n = (this->display_queue.first ? this->display_queue.num_buffers : 0) + 1;
-    *(this->display_queue.add) = img;
-    this->display_queue.add    = &img->next;
-    this->display_queue.num_buffers = n;
-    if (n > this->display_queue.locked_for_read)
-      pthread_cond_signal (&this->display_queue.not_empty);
+    if (olds != news) {
+      if (news)
+        xine_refs_add (&news->refs, 1); /* this is fast. */
+      if (olds)
+        xine_refs_sub (&olds->refs, 1); /* this may involve stream dispose. */
+    }
+  }
+  vo_at_add (&this->display_queue.num_pending, 1);
+  vo_at_list_push (&this->display_queue.pending, img, &img->next);
+  if (vo_at_get (&this->display_queue.num_waiters)) {
+    pthread_mutex_lock (&this->display_queue.mutex);
+    pthread_cond_signal (&this->display_queue.not_empty);
     pthread_mutex_unlock (&this->display_queue.mutex);
   }
 }
 
 static void vo_free_append (vos_t *this, vo_frame_t *img) {
-  int n;
-
   /* img already enqueue? (serious leak) */
   _x_assert (img->next==NULL);
 
-  pthread_mutex_lock (&this->free_queue.mutex);
-  img->next = NULL;
-  n = (this->free_queue.first ? this->free_queue.num_buffers : 0) + 1;
-  *(this->free_queue.add) = img;
-  this->free_queue.add    = &img->next;
-  this->free_queue.num_buffers = n;
-  if (n > this->free_queue.locked_for_read)
+  vo_at_add (&this->free_queue.num_pending, 1);
+  vo_at_list_push (&this->free_queue.pending, img, &img->next);
+  if (vo_at_get (&this->free_queue.num_waiters)) {
+    pthread_mutex_lock (&this->free_queue.mutex);
     pthread_cond_signal (&this->free_queue.not_empty);
-  pthread_mutex_unlock (&this->free_queue.mutex);
+    pthread_mutex_unlock (&this->free_queue.mutex);
+  }
 }
 
 static void vo_free_append_list (vos_t *this, vo_frame_t *img, vo_frame_t **add, int n) {
   if (!img)
     return;
 
-  pthread_mutex_lock (&this->free_queue.mutex);
-
-  *(this->free_queue.add) = img;
-  this->free_queue.add    = add;
-
-  n += this->free_queue.num_buffers;
-  this->free_queue.num_buffers = n;
-
-  if (n > this->free_queue.locked_for_read)
+  vo_at_add (&this->free_queue.num_pending, n);
+  vo_at_list_push (&this->free_queue.pending, img, add);
+  if (vo_at_get (&this->free_queue.num_waiters)) {
+    pthread_mutex_lock (&this->free_queue.mutex);
     pthread_cond_broadcast (&this->free_queue.not_empty);
-  pthread_mutex_unlock (&this->free_queue.mutex);
+    pthread_mutex_unlock (&this->free_queue.mutex);
+  }
 }
 
 static vo_frame_t *vo_free_queue_pop_int (vos_t *this) {
@@ -642,6 +821,7 @@ static vo_frame_t *vo_get_unblock_frame (vos_t *this) {
   vo_frame_t *f, **add;
   /* Try 1: free queue reserve. */
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_fetch (this);
   if (this->free_queue.first) {
     f = vo_free_queue_pop_int (this);
     pthread_mutex_unlock (&this->free_queue.mutex);
@@ -651,9 +831,10 @@ static vo_frame_t *vo_get_unblock_frame (vos_t *this) {
   pthread_mutex_unlock (&this->free_queue.mutex);
   /* Try 2: shared display queue. */
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_fetch (this);
   add = &this->display_queue.first;
   while ((f = *add)) {
-    if (f->lock_counter <= 2)
+    if (vo_at_get (&f->lock_counter) <= 2)
       break;
     add = &f->next;
   }
@@ -684,6 +865,7 @@ static vo_frame_t *vo_free_queue_get (vos_t *this,
   pthread_mutex_lock (&this->free_queue.mutex);
 
   do {
+    vo_free_queue_fetch (this);
     add = &this->free_queue.first;
     if (this->free_queue.num_buffers > this->free_queue.locked_for_read) {
       img = *add;
@@ -751,7 +933,11 @@ static vo_frame_t *vo_free_queue_get (vos_t *this,
         struct timespec ts = {0, 0};
         xine_gettime (&ts);
         ts.tv_sec += 1;
-        pthread_cond_timedwait (&this->free_queue.not_empty, &this->free_queue.mutex, &ts);
+        /* announce before the final look, so vo_free_append () cannot miss us. */
+        vo_at_add (&this->free_queue.num_waiters, 1);
+        if (!vo_at_list_get (&this->free_queue.pending))
+          pthread_cond_timedwait (&this->free_queue.not_empty, &this->free_queue.mutex, &ts);
+        vo_at_add (&this->free_queue.num_waiters, -1);
       }
     }
   } while (!img);
@@ -776,6 +962,7 @@ static vo_frame_t *vo_free_get_dupl (vos_t *this, vo_frame_t *s) {
   vo_frame_t *img, **add;
 
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_fetch (this);
 
   add = &this->free_queue.first;
   while ((img = *add)) {
@@ -824,65 +1011,52 @@ static void vo_update_max_frame_rate (vos_t *this, int speed) {
  *******************************************************************/
 
 static void vo_frame_inc2_lock (vo_frame_t *img) {
-  int n;
-
-  pthread_mutex_lock (&img->mutex);
+  int n = vo_at_add (&img->lock_counter, 2);
 
-  n = (img->lock_counter += 2);
   if ((n == 3) || (n == 4)) {
     vos_t *this = (vos_t *)img->port;
     if (this->frames_extref < this->frames_total)
       this->frames_extref++;
   }
-
-  pthread_mutex_unlock (&img->mutex);
 }
 
 static void vo_frame_inc_lock (vo_frame_t *img) {
+  int n = vo_at_add (&img->lock_counter, 1);
 
-  pthread_mutex_lock (&img->mutex);
-
-  img->lock_counter++;
-  if (img->lock_counter == 3) {
+  if (n == 3) {
     vos_t *this = (vos_t *)img->port;
     if (this->frames_extref < this->frames_total)
       this->frames_extref++;
   }
-
-  pthread_mutex_unlock (&img->mutex);
 }
 
 static void vo_frame_dec_lock (vo_frame_t *img) {
+  int n = vo_at_add (&img->lock_counter, -1);
 
-  pthread_mutex_lock (&img->mutex);
-
-  img->lock_counter--;
-  if (!img->lock_counter) {
+  if (!n) {
     vos_t *this = (vos_t *) img->port;
     vo_free_append (this, img);
   } else
-  if (img->lock_counter == 2) {
+  if (n == 2) {
     vos_t *this = (vos_t *)img->port;
     if (this->frames_extref > 0)
       this->frames_extref--;
   }
-
-  pthread_mutex_unlock (&img->mutex);
 }
 
 static int vo_frame_dec2_lock_int (vos_t *this, vo_frame_t *img) {
-  int n;
-  pthread_mutex_lock (&img->mutex);
+  int o, n;
   img->next = NULL;
-  n = img->lock_counter - 2;
-  if (n <= 0) /* "<=" yields better code than "<" there. */
-    n = 0;
-  else if ((n == 1) || (n == 2)) {
+  do {
+    o = vo_at_get (&img->lock_counter);
+    n = o - 2;
+    if (n <= 0) /* "<=" yields better code than "<" there. */
+      n = 0;
+  } while (!vo_at_cas (&img->lock_counter, o, n));
+  if ((n == 1) || (n == 2)) {
     if (this->frames_extref > 0)
       this->frames_extref--;
   }
-  img->lock_counter = n;
-  pthread_mutex_unlock (&img->mutex);
   return n;
 }
 
@@ -904,7 +1078,7 @@ static void vo_wait_flush (vos_t *this) {
   this->trigger_drawing.draw = 1;
   pthread_cond_signal (&this->trigger_drawing.wake);
   pthread_mutex_unlock (&this->trigger_drawing.mutex);
-  while (this->display_queue.flush_extra || this->display_queue.first)
+  while (this->display_queue.flush_extra || vo_display_queue_used (this))
     pthread_cond_wait (&this->display_queue.done_flushing, &this->display_queue.mutex);
   this->display_queue.num_flush_waiters--;
 }
@@ -927,6 +1101,7 @@ static void vo_list_flush (vos_t *this, vo_frame_t *f) {
 static void vo_manual_flush (vos_t *this) {
   vo_frame_t *f;
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_fetch (this);
   f = this->display_queue.first;
   this->display_queue.first = NULL;
   this->display_queue.add   = &this->display_queue.first;
@@ -1361,8 +1536,8 @@ static vo_frame_t *vo_get_frame (xine_video_port_t *this_gen,
   {
     int frames_used;
     frames_used = this->frames_total;
-    frames_used -= this->free_queue.num_buffers;
-    frames_used -= this->display_queue.num_buffers;
+    frames_used -= this->free_queue.num_buffers + this->free_queue.num_pending;
+    frames_used -= this->display_queue.num_buffers + this->display_queue.num_pending;
     frames_used -= this->rp.ready_num;
     frames_used += this->frames_extref;
     if (frames_used > this->frames_peak_used)
@@ -1533,6 +1708,9 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
         this->num_frames_burst = 0;
       }
     }
+    /* accurate seek: drop frames before target, before any further work. */
+    if (stream->accurate_seek.video && xine_accurate_seek_skip (stream, img->pts, img->duration, 1))
+      return 0;
     img->stream = &stream->s;
     vo_set_img_ei (this, img);
     stream->s.metronom->got_video_frame (stream->s.metronom, img);
@@ -1592,7 +1770,8 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
     }
 
     /* do not skip decoding until output fifo frames are consumed */
-    if (this->display_queue.num_buffers + this->rp.ready_num < this->frame_drop_limit) {
+    if (this->display_queue.num_buffers + vo_at_get (&this->display_queue.num_pending)
+      + this->rp.ready_num < this->frame_drop_limit) {
       int duration = img->duration > 0 ? img->duration : DEFAULT_FRAME_DURATION;
       frames_to_skip = (this->last_delivery_pts - img->vpts) / duration;
       frames_to_skip = (frames_to_skip + this->frame_drop_limit) * 2;
@@ -1616,13 +1795,50 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
       }
     }
 
-    lprintf ("delivery diff : %" PRId64 ", current vpts is %" PRId64 ", %d frames to skip\n",
-      img->vpts - this->last_delivery_pts, this->last_delivery_pts, frames_to_skip);
+    /* Graded degradation for decoders that query VO_PROP_DECODE_HINT.
+     * Unlike frames_to_skip, this is a sticky level with hysteresis. It starts
+     * over after a seek, and stays put during the slow start above.
+     */
+    if (first_frame_flag >= 2) {
+      this->decode_hint      = VO_DECODE_HINT_NONE;
+      this->decode_hint_late = 0;
+      this->decode_hint_good = 0;
+    } else if (!this->frame_drop_cpt) {
+      int duration = img->duration > 0 ? img->duration : DEFAULT_FRAME_DURATION;
+      int64_t lag = this->last_delivery_pts - img->vpts;
+      if (lag > -duration) {
+        this->decode_hint_good = 0;
+        if (lag > DECODE_HINT_FAR_LATE * duration) {
+          this->decode_hint_late = 0;
+          if (this->decode_hint < VO_DECODE_HINT_NONKEY)
+            this->decode_hint = VO_DECODE_HINT_NONKEY;
+        } else if (++this->decode_hint_late >= DECODE_HINT_RAISE) {
+          this->decode_hint_late = 0;
+          if (this->decode_hint < VO_DECODE_HINT_LOWRES)
+            this->decode_hint++;
+        }
+      } else {
+        this->decode_hint_late = 0;
+        if (++this->decode_hint_good >= DECODE_HINT_RELAX) {
+          this->decode_hint_good = 0;
+          if (this->decode_hint > VO_DECODE_HINT_NONE)
+            this->decode_hint--;
+        }
+      }
+    }
+
+    lprintf ("delivery diff : %" PRId64 ", current vpts is %" PRId64 ", %d frames to skip, hint %d\n",
+      img->vpts - this->last_delivery_pts, this->last_delivery_pts, frames_to_skip, this->decode_hint);
 
   } else {
     frames_to_skip = 0;
   }
 
+  if (stream && stream->keyframes_only) {
+    /* thumbnail mode: never drop for lateness. the port may be shared,
+     * so decoders get the keyframe hint from _x_video_decode_hint (). */
+    frames_to_skip = 0;
+  }
 
   if (!img->bad_frame) {
 
@@ -1715,7 +1931,7 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
       vo_frame_inc2_lock (img);
     vo_display_reref_append (this, img);
 
-    if (img->is_first && (this->display_queue.first == img)) {
+    if (img->is_first) {
       /* wake up render thread */
       pthread_mutex_lock (&this->trigger_drawing.mutex);
       this->trigger_drawing.draw = 1;
@@ -1810,7 +2026,7 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
 
 #define ADD_READY_FRAMES \
   if (this->rp.ready_num < 2) { \
-    if (!this->rp.ready_num || this->display_queue.first) \
+    if (!this->rp.ready_num || vo_display_queue_used (this)) \
       vo_ready_refill (this); \
   }
 
@@ -1819,6 +2035,7 @@ static void vo_ready_refill (vos_t *this) {
 
   pthread_mutex_lock (&this->display_queue.mutex);
   this->rp.min_frame_duration = this->display_queue.min_frame_duration;
+  vo_display_queue_fetch (this);
   first = this->display_queue.first;
   if (!first) {
     this->display_queue.flush_extra = this->rp.ready_num;
@@ -1841,6 +2058,7 @@ static vo_frame_t *vo_ready_get_all (vos_t *this) {
   vo_frame_t *first;
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_fetch (this);
   first = this->display_queue.first;
   if (first) {
     this->display_queue.first = NULL;
@@ -1881,7 +2099,7 @@ static vo_frame_t *vo_ready_get_dupl (vos_t *this, vo_frame_t *s) {
 
   add = &this->rp.ready_first;
   while ((img = *add)) {
-    if ((img->lock_counter <= 2) && (img != s)) {
+    if ((vo_at_get (&img->lock_counter) <= 2) && (img != s)) {
       if ((img->format == s->format) && (img->width == s->width)
         && (img->height == s->height) && (img->ratio == s->ratio))
         break;
@@ -2027,7 +2245,7 @@ static void check_redraw_needed (vos_t *this, int64_t vpts) {
   /* calling the frontend's frame output hook (via driver->redraw_needed () here)
    * while flushing (xine_stop ()) may freeze.
    */
-  if (!(this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first))) {
+  if (!(this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_used (this)))) {
     if (this->driver->redraw_needed (this->driver))
       this->redraw_needed = 1;
   }
@@ -2160,7 +2378,7 @@ static vo_frame_t *next_frame (vos_t *this, int64_t *vpts) {
        * - We dont drop frames already decoded in time.
        * Finally, dont zero img->is_first so xine_play () gets woken up properly.
        */
-      if ((img->lock_counter <= 2) || (img->vpts <= *vpts) || (img->is_first == 1)) {
+      if ((vo_at_get (&img->lock_counter) <= 2) || (img->vpts <= *vpts) || (img->is_first == 1)) {
         img->vpts = *vpts;
         *vpts = img->vpts + (img->duration ? img->duration : DEFAULT_FRAME_DURATION);
         break;
@@ -2317,7 +2535,7 @@ static void overlay_and_display_frame (vos_t *this, vo_frame_t *img, int64_t vpt
   /* calling the frontend's frame output hook (via driver->display_frame () here)
    * while flushing (xine_stop ()) may freeze.
    */
-  if (this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first)) {
+  if (this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_used (this))) {
     img->free (img);
     this->redraw_needed = 0;
     return;
@@ -2544,7 +2762,7 @@ static void *video_out_loop (void *this_gen) {
      */
 
     if ((vpts - this->last_delivery_pts > 30000) &&
-        !this->display_queue.first && !this->rp.ready_first) {
+        !vo_display_queue_used (this) && !this->rp.ready_first) {
       if (this->last_delivery_pts && !this->disable_decoder_flush_from_video_out) {
         xine_stream_private_t **s;
         xine_rwlock_rdlock (&this->streams_lock);
@@ -2597,7 +2815,7 @@ static void *video_out_loop (void *this_gen) {
     while (this->video_loop_running) {
       int timedout, wait;
 
-      if (this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first))
+      if (this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_used (this)))
         break;
 
       if (this->rp.speed == XINE_SPEED_PAUSE) {
@@ -2688,6 +2906,7 @@ int xine_get_next_video_frame (xine_video_port_t *this_gen, xine_video_frame_t *
   struct timespec now = {0, 990000000};
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_fetch (this);
 
   while (!this->display_queue.first) {
     {
@@ -2711,8 +2930,12 @@ int xine_get_next_video_frame (xine_video_port_t *this_gen, xine_video_frame_t *
     }
     {
       struct timespec ts = now;
-      pthread_cond_timedwait (&this->display_queue.not_empty, &this->display_queue.mutex, &ts);
+      vo_at_add (&this->display_queue.num_waiters, 1);
+      if (!vo_at_list_get (&this->display_queue.pending))
+        pthread_cond_timedwait (&this->display_queue.not_empty, &this->display_queue.mutex, &ts);
+      vo_at_add (&this->display_queue.num_waiters, -1);
     }
+    vo_display_queue_fetch (this);
   }
 
   /*
@@ -2808,12 +3031,17 @@ static int vo_get_property (xine_video_port_t *this_gen, int property) {
     ret = this->display_queue.discard_frames;
     break;
 
+  case VO_PROP_DECODE_HINT:
+    ret = this->decode_hint;
+    break;
+
   case VO_PROP_BUFS_IN_FIFO:
-    ret = this->video_loop_running ? this->display_queue.num_buffers + this->rp.ready_num : -1;
+    ret = this->video_loop_running
+        ? this->display_queue.num_buffers + vo_at_get (&this->display_queue.num_pending) + this->rp.ready_num : -1;
     break;
 
   case VO_PROP_BUFS_FREE:
-    ret = this->video_loop_running ? this->free_queue.num_buffers : -1;
+    ret = this->video_loop_running ? this->free_queue.num_buffers + vo_at_get (&this->free_queue.num_pending) : -1;
     break;
 
   case VO_PROP_BUFS_TOTAL:
@@ -2927,7 +3155,7 @@ static int vo_set_property (xine_video_port_t *this_gen, int property, int value
       pthread_mutex_lock (&this->display_queue.mutex);
       if (this->display_queue.discard_frames) {
         if (this->display_queue.discard_frames == 1) {
-          if (this->video_loop_running && (this->display_queue.flush_extra || this->display_queue.first)) {
+          if (this->video_loop_running && (this->display_queue.flush_extra || vo_display_queue_used (this))) {
             /* Usually, render thread already did that in the meantime. Anyway, make sure display queue
                is empty, and more importantly, there are free frames for decoding when discard gets lifted. */
             vo_wait_flush (this);
@@ -3223,6 +3451,18 @@ static void vo_trigger_drawing (xine_video_port_t *this_gen) {
   pthread_mutex_unlock (&this->trigger_drawing.mutex);
 }
 
+int _x_video_decode_hint (xine_stream_t *s) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  int hint;
+
+  if (!stream || !stream->s.video_out)
+    return VO_DECODE_HINT_NONE;
+  hint = stream->s.video_out->get_property (stream->s.video_out, VO_PROP_DECODE_HINT);
+  if (stream->keyframes_only && (hint < VO_DECODE_HINT_NONKEY))
+    hint = VO_DECODE_HINT_NONKEY;
+  return hint;
+}
+
 xine_video_port_t *_x_vo_new_port (xine_t *xine, vo_driver_t *driver, int grabonly) {
   vos_t *this;
   int    num_frame_buffers;
@@ -3249,6 +3489,9 @@ xine_video_port_t *_x_vo_new_port (xine_t *xine, vo_driver_t *driver, int grabon
   this->frames_peak_used      = 0;
   this->frame_drop_cpt        = 0;
   this->frame_drop_suggested  = 0;
+  this->decode_hint           = VO_DECODE_HINT_NONE;
+  this->decode_hint_late      = 0;
+  this->decode_hint_good      = 0;
   this->rp.ready_first        = NULL;
   this->rp.ready_num          = 0;
   this->rp.need_flush_signal  = 0;
@@ -3427,9 +3670,6 @@ xine_video_port_t *_x_vo_new_port (xine_t *xine, vo_driver_t *driver, int grabon
 
     this->video_loop_running = 1;
 
-    /* render thread needs no display queue signals */
-    this->display_queue.locked_for_read = 1000;
-
     pthread_attr_init(&pth_attrs);
 #if defined(_POSIX_THREAD_PRIORITY_SCHEDULING) && (_POSIX_THREAD_PRIORITY_SCHEDULING > 0)
     pthread_attr_setscope(&pth_attrs, PTHREAD_SCOPE_SYSTEM);
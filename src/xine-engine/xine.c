@@ -919,6 +919,8 @@ static void close_internal (xine_stream_private_t *stream) {
     xine_rwlock_wrlock (&stream->info_lock);
     for (i = 0; i < XINE_STREAM_INFO_MAX; i++)
       stream->stream_info[i] = 0;
+    /* this one is a stream param. */
+    stream->stream_info[XINE_STREAM_INFO_KEYFRAMES_ONLY] = stream->keyframes_only;
     xine_rwlock_unlock (&stream->info_lock);
     xine_rwlock_wrlock (&stream->meta_lock);
     for (i = 0; i < XINE_STREAM_INFO_MAX; i++) {
@@ -1068,6 +1070,7 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
   stream->early_finish_event       = 0;
   stream->delay_finish_event       = 0;
   stream->gapless_switch           = 0;
+  stream->keyframes_only           = 0;
   stream->keep_ao_driver_open      = 0;
   stream->video_channel            = 0;
   stream->video_decoder_plugin     = NULL;
@@ -1317,6 +1320,7 @@ xine_stream_t *xine_get_side_stream (xine_stream_t *master, int index) {
   s->early_finish_event       = 0;
   s->delay_finish_event       = 0;
   s->gapless_switch           = 0;
+  s->keyframes_only           = 0;
   s->keep_ao_driver_open      = 0;
   s->video_channel            = 0;
   s->video_decoder_plugin     = NULL;
@@ -1556,6 +1560,7 @@ typedef enum {
   _X_ARG_compression,
   _X_ARG_subtitle,
   _X_ARG_rewind,
+  _X_ARG_timeshift,
   _X_ARG_LAST
 } _xine_arg_type_t;
 
@@ -1584,6 +1589,7 @@ static const struct {
   {_X_ARG_rewind,         "rewind"},
   {_X_ARG_save,           "save"},
   {_X_ARG_subtitle,       "subtitle"},
+  {_X_ARG_timeshift,      "timeshift"},
   {_X_ARG_volume,         "volume"}
 };
 
@@ -1712,7 +1718,7 @@ static int _xine_str2secs (const uint8_t *s) {
 static int open_internal (xine_stream_private_t *stream, const char *mrl, input_plugin_t *input) {
   _xine_args_t _args;
   uint8_t *buf, *name, *args;
-  int no_cache = 0;
+  int no_cache = 0, timeshift = 0;
 
   if (!mrl) {
     xprintf (stream->s.xine, XINE_VERBOSITY_LOG, _("xine: error while parsing mrl\n"));
@@ -1888,6 +1894,23 @@ static int open_internal (xine_stream_private_t *stream, const char *mrl, input_
           }
           break;
 
+        case _X_ARG_timeshift:
+          {
+            input_plugin_t *input_tshift;
+
+            if (value)
+              _x_mrl_unescape (value);
+            input_tshift = _x_timeshift_plugin_get_instance (&stream->s, value);
+            if (input_tshift) {
+              stream->s.input_plugin = input_tshift;
+              timeshift = 1;
+            } else {
+              xprintf (stream->s.xine, XINE_VERBOSITY_LOG, _("xine: error opening timeshift input plugin instance\n"));
+            }
+            key = NULL;
+          }
+          break;
+
         case _X_ARG_lastdemuxprobe:
           if (value) {
             /* all demuxers will be probed before the specified one */
@@ -2000,6 +2023,19 @@ static int open_internal (xine_stream_private_t *stream, const char *mrl, input_
   _xine_free_args (&_args);
   free (buf);
 
+  if (!timeshift && !stream->demux.plugin
+    && (stream->s.input_plugin->get_capabilities (stream->s.input_plugin) & INPUT_CAP_LIVE)
+    && stream->s.xine->config->register_bool (stream->s.xine->config, "media.timeshift.live_inputs", 0,
+      _("timeshift live streams"),
+      _("Keep the recent part of live streams like DVB in a temporary file, "
+        "so they can be paused and seeked back in. The same can be requested "
+        "per stream by adding #timeshift to the MRL."),
+      20, NULL, NULL)) {
+    input_plugin_t *input_tshift = _x_timeshift_plugin_get_instance (&stream->s, NULL);
+    if (input_tshift)
+      stream->s.input_plugin = input_tshift;
+  }
+
   /* Nasty xine-ui issue:
    * 1. User pauses playback, then opens a playlist.
    * 2. Xine-ui grabs a separate stream tied to our "none" output plugins.
@@ -2244,6 +2280,65 @@ static void wait_first_frame (xine_stream_private_t *stream) {
   }
 }
 
+/* Accurate seek. Demux seeks to the keyframe before the target as usual.
+ * Decoders then decode everything from there, but video_out and audio_out
+ * drop the results before target early, without vo/ao driver or post work.
+ * Metronom maps target instead of the keyframe to the start vpts, so there
+ * is no extra delay. */
+void xine_accurate_seek_arm (xine_stream_private_t *stream, uint32_t which) {
+  int on;
+
+  pthread_mutex_lock (&stream->first_frame.lock);
+  on = stream->accurate_seek.want & which;
+  stream->accurate_seek.want &= ~which;
+  pthread_mutex_unlock (&stream->first_frame.lock);
+  if (which == 1) {
+    stream->accurate_seek.video = on ? 1 : 0;
+    stream->accurate_seek.video_last_pts = 0;
+  } else {
+    stream->accurate_seek.audio = on ? 1 : 0;
+    stream->accurate_seek.audio_last_pts = 0;
+  }
+}
+
+void xine_accurate_seek_map (xine_stream_private_t *stream, buf_element_t *buf) {
+  if (!buf->pts || (buf->extra_info->input_time < 0))
+    return;
+  pthread_mutex_lock (&stream->first_frame.lock);
+  if (!stream->accurate_seek.pts) {
+    /* demuxers give input time as pts / 90 + start offset. */
+    int64_t pts = buf->pts + (int64_t)(stream->accurate_seek.time - buf->extra_info->input_time) * 90;
+    stream->accurate_seek.pts = pts ? pts : 1;
+    stream->s.metronom->set_option (stream->s.metronom, METRONOM_SEEK_TARGET, pts);
+    xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
+      "accurate_seek: %d.%03d = pts %" PRId64 ".\n",
+      stream->accurate_seek.time / 1000, stream->accurate_seek.time % 1000, pts);
+  }
+  pthread_mutex_unlock (&stream->first_frame.lock);
+}
+
+int xine_accurate_seek_skip (xine_stream_private_t *stream, int64_t pts, int duration, uint32_t which) {
+  int64_t target, *last = which == 1 ? &stream->accurate_seek.video_last_pts : &stream->accurate_seek.audio_last_pts;
+
+  pthread_mutex_lock (&stream->first_frame.lock);
+  target = stream->accurate_seek.pts;
+  pthread_mutex_unlock (&stream->first_frame.lock);
+
+  /* reordered frames may come without pts. */
+  if (!pts && *last)
+    pts = *last + duration;
+  *last = pts;
+  if (target && pts && (pts + (duration > 0 ? duration : 1) <= target))
+    return 1;
+
+  /* target reached, or no way to tell. */
+  if (which == 1)
+    stream->accurate_seek.video = 0;
+  else
+    stream->accurate_seek.audio = 0;
+  return 0;
+}
+
 static int play_internal (xine_stream_private_t *stream, int start_pos, int start_time) {
   xine_private_t *xine = (xine_private_t *)stream->s.xine;
   int        flush;
@@ -2379,6 +2474,16 @@ static int play_internal (xine_stream_private_t *stream, int start_pos, int star
   stream->demux.max_seek_bufs = sides[1].s ? 1 : 0xffffffff;
   pthread_mutex_unlock (&stream->demux.pair);
 
+  /* arm accurate seek before demux sends the new seek discontinuity. */
+  pthread_mutex_lock (&stream->first_frame.lock);
+  stream->accurate_seek.want = 0;
+  stream->accurate_seek.pts = 0;
+  if (xine->accurate_seek && !start_pos && (start_time > 0)) {
+    stream->accurate_seek.want = 3;
+    stream->accurate_seek.time = start_time;
+  }
+  pthread_mutex_unlock (&stream->first_frame.lock);
+
   /* seek to new position (no data is sent to decoders yet) */
   sp = sides;
   do {
@@ -2891,6 +2996,16 @@ static void join_av_cb (void *this_gen, xine_cfg_entry_t *entry) {
   this->join_av = entry->num_value;
 }
 
+static void seek_index_cb (void *this_gen, xine_cfg_entry_t *entry) {
+  xine_private_t *this = (xine_private_t *)this_gen;
+  this->seek_index = entry->num_value;
+}
+
+static void accurate_seek_cb (void *this_gen, xine_cfg_entry_t *entry) {
+  xine_private_t *this = (xine_private_t *)this_gen;
+  this->accurate_seek = entry->num_value;
+}
+
 void xine_init (xine_t *this_gen) {
   xine_private_t *this = (xine_private_t *)this_gen;
 
@@ -3021,6 +3136,32 @@ void xine_init (xine_t *this_gen) {
         "This mainly serves as a test for engine side streams."),
       20, join_av_cb, this);
 
+  /*
+   * remember keyframe positions of mpeg ts/ps files.
+   */
+  {
+    static const char *const seek_index_modes[] = {"off", "while playing", "prebuild", NULL};
+    this->seek_index = this->x.config->register_enum (this->x.config,
+      "media.files.seek_index", 1, (char **)seek_index_modes,
+      _("Keep a seek index of MPEG files"),
+      _("Remember where the keyframes of local MPEG transport and program stream files are, "
+        "and store that in the cache directory. This makes later time seeks exact and fast.\n"
+        "off: dont.\n"
+        "while playing: index the parts that get played.\n"
+        "prebuild: index the whole file in the background while playing."),
+      20, seek_index_cb, this);
+  }
+
+  /*
+   * frame exact seeking
+   */
+  this->accurate_seek = this->x.config->register_bool (this->x.config,
+      "engine.decoder.accurate_seek", 0,
+      _("Frame exact seeking"),
+      _("Time seeks show the exact frame asked for, instead of the keyframe before. "
+        "The frames in between are decoded and dropped, so seeking may take longer."),
+      20, accurate_seek_cb, this);
+
   /*
    * keep track of all opened streams
    */
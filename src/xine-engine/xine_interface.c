@@ -570,6 +570,12 @@ void xine_set_param (xine_stream_t *s, int param, int value) {
     }
     break;
 
+  case XINE_PARAM_KEYFRAMES_ONLY:
+    stream->keyframes_only = !!value;
+    _x_stream_info_set (&stream->s, XINE_STREAM_INFO_KEYFRAMES_ONLY, stream->keyframes_only);
+    stream->s.metronom->set_option (stream->s.metronom, METRONOM_KEYFRAMES_ONLY, stream->keyframes_only);
+    break;
+
   default:
     xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
 	     "xine_interface: unknown or deprecated stream param %d set\n", param);
@@ -743,6 +749,10 @@ int xine_get_param (xine_stream_t *s, int param) {
     ret = stream->gapless_switch;
     break;
 
+  case XINE_PARAM_KEYFRAMES_ONLY:
+    ret = stream->keyframes_only;
+    break;
+
   default:
     xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
 	     "xine_interface: unknown or deprecated stream param %d requested\n", param);
@@ -803,6 +813,9 @@ uint32_t xine_get_stream_info (xine_stream_t *s, int info) {
   case XINE_STREAM_INFO_DVD_CHAPTER_COUNT:
   case XINE_STREAM_INFO_DVD_ANGLE_NUMBER:
   case XINE_STREAM_INFO_DVD_ANGLE_COUNT:
+  case XINE_STREAM_INFO_NET_KERNEL_DROPS:
+  case XINE_STREAM_INFO_NET_INPUT_DROPS:
+  case XINE_STREAM_INFO_KEYFRAMES_ONLY:
     return _x_stream_info_get_public (&stream->s, info);
 
   case XINE_STREAM_INFO_MAX_AUDIO_CHANNEL:
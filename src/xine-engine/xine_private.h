@@ -240,9 +240,15 @@ void _x_free_audio_driver (xine_t *xine, ao_driver_t **driver) INTERNAL;
  */
 demux_plugin_t *_x_find_demux_plugin_last_probe(xine_stream_t *stream, const char *last_demux_name, input_plugin_t *input) INTERNAL;
 input_plugin_t *_x_rip_plugin_get_instance (xine_stream_t *stream, const char *filename) INTERNAL;
+input_plugin_t *_x_timeshift_plugin_get_instance (xine_stream_t *stream, const char *size) INTERNAL;
 input_plugin_t *_x_cache_plugin_get_instance (xine_stream_t *stream) INTERNAL;
 ///@}
 
+/** while demuxers probe an input, serve its first size bytes from buf.
+ *  _x_demux_read_header () and _x_demux_read_stream_header () use this
+ *  instead of another seek/read round trip. buf == NULL unregisters. */
+void _x_demux_probe_header (input_plugin_t *input, const uint8_t *buf, int size) INTERNAL;
+
 ///@{
 /**
  * @defgroup
@@ -510,6 +516,8 @@ typedef struct {
   }                          ip_pref;
 
   uint32_t                   join_av:1;
+  uint32_t                   seek_index:2;
+  uint32_t                   accurate_seek:1;
 
   /* lock controlling speed change access.
    * if we should ever introduce per stream clock and ticket,
@@ -558,6 +566,7 @@ typedef struct xine_stream_private_st {
   uint32_t                   gapless_switch:1;       /*< next stream switch will be gapless */
   uint32_t                   keep_ao_driver_open:1;
   uint32_t                   finished_naturally:1;
+  uint32_t                   keyframes_only:1;       /*< XINE_PARAM_KEYFRAMES_ONLY */
 
   input_class_t             *eject_class;
 
@@ -569,6 +578,8 @@ typedef struct xine_stream_private_st {
   int                        video_channel;
 
   int                        audio_track_map_entries;
+  /* optional per track decoder workers, see audio_decoder.c. */
+  struct xine_audio_tracks_s *audio_tracks;
 
   int                        audio_decoder_streamtype;
   pthread_t                  audio_thread;
@@ -629,6 +640,20 @@ typedef struct xine_stream_private_st {
     uint32_t                 flag:2;
   } first_frame;
 
+  /* accurate seek: decode from the keyframe before, but drop all output
+   * before the target. want, time and pts are protected by first_frame.lock. */
+  struct {
+    /* 1 (video), 2 (audio): decoder has not seen the seek yet. */
+    uint32_t                 want;
+    /* target stream time in ms. */
+    int                      time;
+    /* target pts, 0 until known. */
+    int64_t                  pts;
+    /* decoder thread local. */
+    int64_t                  video_last_pts, audio_last_pts;
+    uint8_t                  video, audio;
+  } accurate_seek;
+
   /* wait for headers sent / stream decoding finished */
   struct {
     pthread_mutex_t          lock;
@@ -712,6 +737,12 @@ typedef struct xine_stream_private_st {
 
 void xine_current_extra_info_set (xine_stream_private_t *stream, const extra_info_t *info) INTERNAL;
 
+/* Accurate seek helpers. Decoder loops arm at the seek discontinuity, and map the
+ * target time to a pts at the first buffer. Output ports then ask whether to skip. */
+void xine_accurate_seek_arm (xine_stream_private_t *stream, uint32_t which) INTERNAL;
+void xine_accurate_seek_map (xine_stream_private_t *stream, buf_element_t *buf) INTERNAL;
+int xine_accurate_seek_skip (xine_stream_private_t *stream, int64_t pts, int duration, uint32_t which) INTERNAL;
+
 /* Nasty net_buf_ctrl helper: inform about something outside its regular callbacks. */
 #define XINE_NBC_EVENT_AUDIO_DRY 1
 void xine_nbc_event (xine_stream_private_t *stream, uint32_t type) INTERNAL;